@@ -0,0 +1,1222 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <sys/mman.h>
+
+#include "binary_io.hpp"
+#include "file_header.hpp"
+#include "mapped_file.hpp"
+#include "my_exception.hpp"
+
+// Typed read-only views of the binary files of the pipeline. The files are memory-mapped and decoded on access, so a scan runs at page cache speed
+// and skipping a record (or the entities of a block) costs nothing. Pass MADV_SEQUENTIAL (the default) for scans and MADV_RANDOM for lookups.
+// Every file starts with a FileHeader (see file_header.hpp), which the views check against the format they expect. The matching writers are at the end.
+//
+//   binary_encoding.bin                      TripleFile            (subject, predicate, object), see visit_triple_file for other entity widths
+//   outcome_condensed-XXXX.bin               OutcomeFile           block, entity count, entities (optionally delta packed)
+//   mapping-XXXXtoYYYY.bin                   MappingFile           block, new block count, new blocks
+//   singleton_mapping-XXXXtoYYYY.bin         SingletonMappingFile  block, singleton count, singletons (as negative block IDs)
+//   condensed_multi_summary_graph.bin        CondensedEdgeFile     (subject, predicate, object) as blocks or singletons
+//   summary_graph-XXXX.bin                   CondensedEdgeFile
+//   quotient_graph_triples-XXXX.bin          CondensedEdgeFile     (a TripleFile when written with --make_ids_positive)
+//   condensed_multi_summary_intervals.bin    IntervalFile          (block or singleton, first level, last level)
+//   condensed_multi_summary_local_global_map.bin  LocalGlobalMapFile  (level, local block, global block)
+
+template <int BYTES>
+inline uint64_t load_uint_little_endian(const char *data)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < BYTES; i++)
+    {
+        value |= uint64_t(uint8_t(data[i])) << (i * 8);
+    }
+    return value;
+}
+
+// Two's complement values of fewer than 8 bytes, which are sign extended
+template <int BYTES>
+inline int64_t load_int_little_endian(const char *data)
+{
+    constexpr int unused_bits = 64 - 8 * BYTES;
+    return int64_t(load_uint_little_endian<BYTES>(data) << unused_bits) >> unused_bits;
+}
+
+template <typename T, int BYTES>
+inline T load_little_endian(const char *data)
+{
+    if constexpr (std::is_signed_v<T>)
+    {
+        return T(load_int_little_endian<BYTES>(data));
+    }
+    else
+    {
+        return T(load_uint_little_endian<BYTES>(data));
+    }
+}
+
+// A run of values of BYTES bytes each inside a mapped file
+template <typename T, int BYTES>
+class PackedValues
+{
+private:
+    const char *data;
+    std::size_t count;
+
+public:
+    class iterator
+    {
+    private:
+        const char *position;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = T;
+
+        iterator() : position(nullptr)
+        {
+        }
+
+        explicit iterator(const char *position) : position(position)
+        {
+        }
+
+        T operator*() const
+        {
+            return load_little_endian<T, BYTES>(this->position);
+        }
+
+        iterator &operator++()
+        {
+            this->position += BYTES;
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            this->position += BYTES;
+            return previous;
+        }
+
+        bool operator==(const iterator &other) const = default;
+    };
+
+    PackedValues() : data(nullptr), count(0)
+    {
+    }
+
+    PackedValues(const char *data, std::size_t count) : data(data), count(count)
+    {
+    }
+
+    std::size_t size() const
+    {
+        return this->count;
+    }
+
+    bool empty() const
+    {
+        return this->count == 0;
+    }
+
+    T operator[](std::size_t index) const
+    {
+        return load_little_endian<T, BYTES>(this->data + index * BYTES);
+    }
+
+    iterator begin() const
+    {
+        return iterator(this->data);
+    }
+
+    iterator end() const
+    {
+        return iterator(this->data + this->count * BYTES);
+    }
+};
+
+struct TripleRecord
+{
+    node_index subject;
+    edge_type predicate;
+    node_index object;
+};
+
+struct CondensedEdgeRecord
+{
+    block_or_singleton_index subject;
+    edge_type predicate;
+    block_or_singleton_index object;
+};
+
+struct IntervalRecord
+{
+    block_or_singleton_index block;
+    k_type start;
+    k_type end;
+};
+
+struct LocalGlobalRecord
+{
+    k_type level;
+    block_or_singleton_index local_block;
+    block_or_singleton_index global_block;
+};
+
+// A block followed by a list of values, such as its entities or the blocks it was split into
+template <typename T, int BYTES>
+struct BlockListRecord
+{
+    block_index block;
+    PackedValues<T, BYTES> values;
+};
+
+// Singletons are stored as negative numbers, which are left out of the IDs in the header
+inline void add_block_id(FileHeader &header, block_or_singleton_index block)
+{
+    if (block >= 0)
+    {
+        header.add_id(uint64_t(block));
+    }
+}
+
+// The entities of a triple file take ENTITY_BYTES bytes, which the header records. BYTES_PER_ENTITY is the default,
+// 4 bytes suffice for graphs of up to 2^32 nodes and 6 bytes are needed beyond 2^40 nodes.
+inline constexpr int MIN_ENTITY_BYTES = 4;
+inline constexpr int MAX_ENTITY_BYTES = 6;
+
+template <int ENTITY_BYTES>
+struct SizedTripleFormat
+{
+    static_assert(ENTITY_BYTES >= MIN_ENTITY_BYTES && ENTITY_BYTES <= MAX_ENTITY_BYTES);
+
+    using record_type = TripleRecord;
+    static constexpr std::size_t RECORD_BYTES = 2 * ENTITY_BYTES + BYTES_PER_PREDICATE;
+    static constexpr const char *NAME = "triple";
+    static constexpr FileKind KIND = FileKind::TRIPLES;
+    static constexpr FieldWidths FIELD_BYTES = {ENTITY_BYTES, BYTES_PER_PREDICATE, ENTITY_BYTES, 0};
+
+    static record_type decode(const char *data)
+    {
+        return {load_uint_little_endian<ENTITY_BYTES>(data),
+                edge_type(load_uint_little_endian<BYTES_PER_PREDICATE>(data + ENTITY_BYTES)),
+                load_uint_little_endian<ENTITY_BYTES>(data + ENTITY_BYTES + BYTES_PER_PREDICATE)};
+    }
+
+    static void encode(BlockWriter &writer, const record_type &record)
+    {
+        writer.write_triple<ENTITY_BYTES>(record.subject, record.predicate, record.object);
+    }
+
+    static void add_ids(FileHeader &header, const record_type &record)
+    {
+        header.add_id(std::max(record.subject, record.object));
+    }
+};
+
+using TripleFormat = SizedTripleFormat<BYTES_PER_ENTITY>;
+
+struct CondensedEdgeFormat
+{
+    using record_type = CondensedEdgeRecord;
+    static constexpr std::size_t RECORD_BYTES = 2 * BYTES_PER_BLOCK_OR_SINGLETON + BYTES_PER_PREDICATE;
+    static constexpr const char *NAME = "condensed edge";
+    static constexpr FileKind KIND = FileKind::CONDENSED_EDGES;
+    static constexpr FieldWidths FIELD_BYTES = {BYTES_PER_BLOCK_OR_SINGLETON, BYTES_PER_PREDICATE, BYTES_PER_BLOCK_OR_SINGLETON, 0};
+
+    static record_type decode(const char *data)
+    {
+        return {load_int_little_endian<BYTES_PER_BLOCK_OR_SINGLETON>(data),
+                edge_type(load_uint_little_endian<BYTES_PER_PREDICATE>(data + BYTES_PER_BLOCK_OR_SINGLETON)),
+                load_int_little_endian<BYTES_PER_BLOCK_OR_SINGLETON>(data + BYTES_PER_BLOCK_OR_SINGLETON + BYTES_PER_PREDICATE)};
+    }
+
+    static void encode(BlockWriter &writer, const record_type &record)
+    {
+        writer.write_int_BLOCK_OR_SINGLETON_little_endian(record.subject);
+        writer.write_uint_PREDICATE_little_endian(record.predicate);
+        writer.write_int_BLOCK_OR_SINGLETON_little_endian(record.object);
+    }
+
+    static void add_ids(FileHeader &header, const record_type &record)
+    {
+        add_block_id(header, record.subject);
+        add_block_id(header, record.object);
+    }
+};
+
+struct IntervalFormat
+{
+    using record_type = IntervalRecord;
+    static constexpr std::size_t RECORD_BYTES = BYTES_PER_BLOCK_OR_SINGLETON + 2 * BYTES_PER_K_TYPE;
+    static constexpr const char *NAME = "interval";
+    static constexpr FileKind KIND = FileKind::INTERVALS;
+    static constexpr FieldWidths FIELD_BYTES = {BYTES_PER_BLOCK_OR_SINGLETON, BYTES_PER_K_TYPE, BYTES_PER_K_TYPE, 0};
+
+    static record_type decode(const char *data)
+    {
+        return {load_int_little_endian<BYTES_PER_BLOCK_OR_SINGLETON>(data),
+                k_type(load_uint_little_endian<BYTES_PER_K_TYPE>(data + BYTES_PER_BLOCK_OR_SINGLETON)),
+                k_type(load_uint_little_endian<BYTES_PER_K_TYPE>(data + BYTES_PER_BLOCK_OR_SINGLETON + BYTES_PER_K_TYPE))};
+    }
+
+    static void encode(BlockWriter &writer, const record_type &record)
+    {
+        writer.write_int_BLOCK_OR_SINGLETON_little_endian(record.block);
+        writer.write_uint_K_TYPE_little_endian(record.start);
+        writer.write_uint_K_TYPE_little_endian(record.end);
+    }
+
+    static void add_ids(FileHeader &header, const record_type &record)
+    {
+        add_block_id(header, record.block);
+    }
+};
+
+struct LocalGlobalFormat
+{
+    using record_type = LocalGlobalRecord;
+    static constexpr std::size_t RECORD_BYTES = BYTES_PER_K_TYPE + 2 * BYTES_PER_BLOCK_OR_SINGLETON;
+    static constexpr const char *NAME = "local to global map";
+    static constexpr FileKind KIND = FileKind::LOCAL_GLOBAL_MAP;
+    static constexpr FieldWidths FIELD_BYTES = {BYTES_PER_K_TYPE, BYTES_PER_BLOCK_OR_SINGLETON, BYTES_PER_BLOCK_OR_SINGLETON, 0};
+
+    static record_type decode(const char *data)
+    {
+        return {k_type(load_uint_little_endian<BYTES_PER_K_TYPE>(data)),
+                load_int_little_endian<BYTES_PER_BLOCK_OR_SINGLETON>(data + BYTES_PER_K_TYPE),
+                load_int_little_endian<BYTES_PER_BLOCK_OR_SINGLETON>(data + BYTES_PER_K_TYPE + BYTES_PER_BLOCK_OR_SINGLETON)};
+    }
+
+    static void encode(BlockWriter &writer, const record_type &record)
+    {
+        writer.write_uint_K_TYPE_little_endian(record.level);
+        writer.write_int_BLOCK_OR_SINGLETON_little_endian(record.local_block);
+        writer.write_int_BLOCK_OR_SINGLETON_little_endian(record.global_block);
+    }
+
+    static void add_ids(FileHeader &header, const record_type &record)
+    {
+        add_block_id(header, record.local_block);
+        add_block_id(header, record.global_block);
+    }
+};
+
+// The count of a list is stored in COUNT_BYTES bytes as a value of type Count, which is signed in the singleton mapping files
+template <FileKind FILE_KIND, typename Count, int COUNT_BYTES, typename T, int BYTES>
+struct BlockListFormat
+{
+    using record_type = BlockListRecord<T, BYTES>;
+    using value_type = T;
+    static constexpr std::size_t HEADER_BYTES = BYTES_PER_BLOCK + COUNT_BYTES;
+    static constexpr std::size_t VALUE_BYTES = BYTES;
+    static constexpr FileKind KIND = FILE_KIND;
+    static constexpr FieldWidths FIELD_BYTES = {BYTES_PER_BLOCK, COUNT_BYTES, BYTES, 0};
+    // The values of an outcome file are entities, which are counted in the header instead of its blocks
+    static constexpr bool VALUES_ARE_ENTITIES = FILE_KIND == FileKind::OUTCOME;
+
+    // Returns the start of the next record, or nullptr if the record does not fit before `end`
+    static const char *decode(const char *position, const char *end, record_type &record)
+    {
+        if (std::size_t(end - position) < HEADER_BYTES)
+        {
+            return nullptr;
+        }
+        record.block = load_uint_little_endian<BYTES_PER_BLOCK>(position);
+        Count count = load_little_endian<Count, COUNT_BYTES>(position + BYTES_PER_BLOCK);
+        position += HEADER_BYTES;
+        if constexpr (std::is_signed_v<Count>)
+        {
+            if (count < 0)
+            {
+                return nullptr;
+            }
+        }
+        if (std::size_t(end - position) / BYTES < std::size_t(count))
+        {
+            return nullptr;
+        }
+        record.values = PackedValues<T, BYTES>(position, count);
+        return position + std::size_t(count) * BYTES;
+    }
+
+    static void encode_block(BlockWriter &writer, FileHeader &header, block_index block, uint64_t count)
+    {
+        writer.write_little_endian<BYTES_PER_BLOCK>(block);
+        writer.write_little_endian<COUNT_BYTES>(Count(count));
+        if constexpr (!VALUES_ARE_ENTITIES)
+        {
+            header.add_id(block);
+        }
+    }
+
+    static void encode_value(BlockWriter &writer, FileHeader &header, T value)
+    {
+        writer.write_little_endian<BYTES>(value);
+        if constexpr (VALUES_ARE_ENTITIES)
+        {
+            header.add_id(value);
+        }
+        else
+        {
+            add_block_id(header, value);
+        }
+    }
+};
+
+using OutcomeFormat = BlockListFormat<FileKind::OUTCOME, node_index, BYTES_PER_ENTITY, node_index, BYTES_PER_ENTITY>;
+using MappingFormat = BlockListFormat<FileKind::MAPPING, block_index, BYTES_PER_BLOCK, block_index, BYTES_PER_BLOCK>;
+using SingletonMappingFormat = BlockListFormat<FileKind::SINGLETON_MAPPING, block_or_singleton_index, BYTES_PER_BLOCK_OR_SINGLETON, block_or_singleton_index, BYTES_PER_BLOCK_OR_SINGLETON>;
+
+// Checks the CRC-32C in the header of a file against its records, which costs a full pass over the file
+inline void verify_checksum(const FileHeader &header, std::string_view records, const std::string &filename)
+{
+    if (!(header.flags & FileHeader::HAS_CHECKSUM))
+    {
+        return;
+    }
+    uint32_t checksum = crc32c(0, reinterpret_cast<const std::byte *>(records.data()), records.size());
+    if (checksum != header.checksum)
+    {
+        throw MyException("The checksum of " + filename + " does not match its contents, the file is damaged");
+    }
+}
+
+// A file of fixed-size records, which can be indexed directly
+template <typename Format>
+class RecordFile
+{
+private:
+    MappedFile file;
+    std::string filename;
+    FileHeader file_header;
+    std::string_view bytes;
+
+public:
+    using record_type = typename Format::record_type;
+
+    class iterator
+    {
+    private:
+        const char *position;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = record_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = record_type;
+
+        iterator() : position(nullptr)
+        {
+        }
+
+        explicit iterator(const char *position) : position(position)
+        {
+        }
+
+        record_type operator*() const
+        {
+            return Format::decode(this->position);
+        }
+
+        iterator &operator++()
+        {
+            this->position += Format::RECORD_BYTES;
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            this->position += Format::RECORD_BYTES;
+            return previous;
+        }
+
+        bool operator==(const iterator &other) const = default;
+    };
+
+    explicit RecordFile(const std::string &filename, int advice = MADV_SEQUENTIAL)
+        : file(filename, advice),
+          filename(filename),
+          file_header(read_file_header(this->file.contents(), filename, Format::KIND, Format::FIELD_BYTES)),
+          bytes(this->file.contents().substr(sizeof(FileHeader)))
+    {
+        if (this->bytes.size() / Format::RECORD_BYTES != this->file_header.record_count || this->bytes.size() % Format::RECORD_BYTES != 0)
+        {
+            throw MyException("The file " + filename + " should hold " + std::to_string(this->file_header.record_count) + " " + Format::NAME + " records of "
+                              + std::to_string(Format::RECORD_BYTES) + " bytes, but it holds " + std::to_string(this->bytes.size()) + " bytes");
+        }
+    }
+
+    const FileHeader &header() const
+    {
+        return this->file_header;
+    }
+
+    void verify_checksum() const
+    {
+        ::verify_checksum(this->file_header, this->bytes, this->filename);
+    }
+
+    std::size_t size() const
+    {
+        return this->file_header.record_count;
+    }
+
+    // The number of bytes of the records, without the header
+    std::size_t size_in_bytes() const
+    {
+        return this->bytes.size();
+    }
+
+    record_type operator[](std::size_t index) const
+    {
+        return Format::decode(this->bytes.data() + index * Format::RECORD_BYTES);
+    }
+
+    iterator begin() const
+    {
+        return iterator(this->bytes.data());
+    }
+
+    iterator end() const
+    {
+        return iterator(this->bytes.data() + this->bytes.size());
+    }
+};
+
+// A file of blocks that are each followed by a list of values. The records have different sizes, so they can only be scanned in order.
+// The iterator checks every record against the end of the file, such that a truncated file is reported instead of read beyond.
+template <typename Format>
+class BlockListFile
+{
+private:
+    MappedFile file;
+    std::string filename;
+    FileHeader file_header;
+    std::string_view bytes;
+
+public:
+    using record_type = typename Format::record_type;
+
+    class iterator
+    {
+    private:
+        const BlockListFile *owner;
+        const char *position;
+        const char *next;
+        record_type record;
+
+        void decode_current()
+        {
+            const char *end = this->owner->bytes.data() + this->owner->bytes.size();
+            if (this->position == end)
+            {
+                return;
+            }
+            this->next = Format::decode(this->position, end, this->record);
+            if (this->next == nullptr)
+            {
+                throw MyException("The file " + this->owner->filename + " ends within a record at byte " + std::to_string(this->position - this->owner->bytes.data()));
+            }
+        }
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = record_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const record_type *;
+        using reference = const record_type &;
+
+        iterator() : owner(nullptr), position(nullptr), next(nullptr), record()
+        {
+        }
+
+        iterator(const BlockListFile *owner, const char *position) : owner(owner), position(position), next(nullptr), record()
+        {
+            this->decode_current();
+        }
+
+        const record_type &operator*() const
+        {
+            return this->record;
+        }
+
+        const record_type *operator->() const
+        {
+            return &this->record;
+        }
+
+        iterator &operator++()
+        {
+            this->position = this->next;
+            this->decode_current();
+            return *this;
+        }
+
+        bool operator==(const iterator &other) const
+        {
+            return this->position == other.position;
+        }
+    };
+
+    explicit BlockListFile(const std::string &filename, int advice = MADV_SEQUENTIAL)
+        : file(filename, advice),
+          filename(filename),
+          file_header(read_file_header(this->file.contents(), filename, Format::KIND, Format::FIELD_BYTES)),
+          bytes(this->file.contents().substr(sizeof(FileHeader)))
+    {
+        if (this->file_header.record_count * Format::HEADER_BYTES + this->file_header.value_count * Format::VALUE_BYTES != this->bytes.size())
+        {
+            throw MyException("The file " + filename + " should hold " + std::to_string(this->file_header.record_count) + " blocks with "
+                              + std::to_string(this->file_header.value_count) + " values, but it holds " + std::to_string(this->bytes.size()) + " bytes");
+        }
+    }
+
+    BlockListFile(const BlockListFile &) = delete;
+    BlockListFile &operator=(const BlockListFile &) = delete;
+
+    const FileHeader &header() const
+    {
+        return this->file_header;
+    }
+
+    void verify_checksum() const
+    {
+        ::verify_checksum(this->file_header, this->bytes, this->filename);
+    }
+
+    // The number of blocks
+    std::size_t size() const
+    {
+        return this->file_header.record_count;
+    }
+
+    iterator begin() const
+    {
+        return iterator(this, this->bytes.data());
+    }
+
+    iterator end() const
+    {
+        return iterator(this, this->bytes.data() + this->bytes.size());
+    }
+};
+
+// The entities of a block in an outcome file. They either point into the file, or into a buffer of the iterator that decoded them
+// if the file is delta packed. The iterator is branch-free in the common case that all blocks of a file are stored the same way.
+class EntityList
+{
+private:
+    PackedValues<node_index, BYTES_PER_ENTITY> stored;
+    const node_index *decoded;
+    std::size_t count;
+
+public:
+    class iterator
+    {
+    private:
+        PackedValues<node_index, BYTES_PER_ENTITY>::iterator stored;
+        const node_index *decoded;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = node_index;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = node_index;
+
+        iterator() : stored(), decoded(nullptr)
+        {
+        }
+
+        iterator(PackedValues<node_index, BYTES_PER_ENTITY>::iterator stored, const node_index *decoded) : stored(stored), decoded(decoded)
+        {
+        }
+
+        node_index operator*() const
+        {
+            return this->decoded != nullptr ? *this->decoded : *this->stored;
+        }
+
+        iterator &operator++()
+        {
+            if (this->decoded != nullptr)
+            {
+                ++this->decoded;
+            }
+            else
+            {
+                ++this->stored;
+            }
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const iterator &other) const = default;
+    };
+
+    EntityList() : stored(), decoded(nullptr), count(0)
+    {
+    }
+
+    explicit EntityList(PackedValues<node_index, BYTES_PER_ENTITY> stored) : stored(stored), decoded(nullptr), count(stored.size())
+    {
+    }
+
+    EntityList(const node_index *decoded, std::size_t count) : stored(), decoded(decoded), count(count)
+    {
+    }
+
+    std::size_t size() const
+    {
+        return this->count;
+    }
+
+    bool empty() const
+    {
+        return this->count == 0;
+    }
+
+    node_index operator[](std::size_t index) const
+    {
+        return this->decoded != nullptr ? this->decoded[index] : this->stored[index];
+    }
+
+    iterator begin() const
+    {
+        return iterator(this->stored.begin(), this->decoded);
+    }
+
+    iterator end() const
+    {
+        return iterator(this->stored.end(), this->decoded != nullptr ? this->decoded + this->count : nullptr);
+    }
+};
+
+struct OutcomeRecord
+{
+    block_index block;
+    EntityList values;
+};
+
+// An outcome file, whose entities are stored either as BYTES_PER_ENTITY-byte values (see OutcomeFormat), or delta packed when it was written
+// with `delta_packed` (see delta_pack in binary_io.hpp). The header flags say which. Both are read the same way, so readers need not know.
+// A delta packed block is decoded in bulk when the iterator reaches it, and its entities stay valid until the iterator moves on.
+// Its entities are sorted, while the entities of other files are in the order in which they were written.
+class OutcomeFile
+{
+private:
+    MappedFile file;
+    std::string filename;
+    FileHeader file_header;
+    std::string_view bytes;
+
+public:
+    using record_type = OutcomeRecord;
+
+    // Delta packed entities have no fixed width, which also makes readers that do not know the flag reject the file
+    static FieldWidths field_bytes(bool delta_packed)
+    {
+        return delta_packed ? FieldWidths{BYTES_PER_BLOCK, BYTES_PER_ENTITY, 0, 0} : OutcomeFormat::FIELD_BYTES;
+    }
+
+    class iterator
+    {
+    private:
+        const OutcomeFile *owner;
+        const char *position;
+        const char *next;
+        record_type record;
+        std::vector<node_index> decoded;
+
+        void decode_current()
+        {
+            const char *end = this->owner->bytes.data() + this->owner->bytes.size();
+            if (this->position == end)
+            {
+                return;
+            }
+            if (this->owner->delta_packed())
+            {
+                this->next = nullptr;
+                if (std::size_t(end - this->position) >= OutcomeFormat::HEADER_BYTES)
+                {
+                    this->record.block = load_uint_little_endian<BYTES_PER_BLOCK>(this->position);
+                    uint64_t count = load_uint_little_endian<BYTES_PER_ENTITY>(this->position + BYTES_PER_BLOCK);
+                    // Every frame of the count takes at least a byte, which bounds the buffer for a damaged count
+                    if (count / DELTA_FRAME_VALUES < uint64_t(end - this->position))
+                    {
+                        this->decoded.resize(count);
+                        const std::byte *packed = reinterpret_cast<const std::byte *>(this->position + OutcomeFormat::HEADER_BYTES);
+                        this->next = reinterpret_cast<const char *>(delta_unpack(packed, reinterpret_cast<const std::byte *>(end), count, this->decoded.data()));
+                        this->record.values = EntityList(this->decoded.data(), count);
+                    }
+                }
+            }
+            else
+            {
+                BlockListRecord<node_index, BYTES_PER_ENTITY> stored{};
+                this->next = OutcomeFormat::decode(this->position, end, stored);
+                this->record = {stored.block, EntityList(stored.values)};
+            }
+            if (this->next == nullptr)
+            {
+                throw MyException("The file " + this->owner->filename + " ends within a record at byte " + std::to_string(this->position - this->owner->bytes.data()));
+            }
+        }
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = record_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const record_type *;
+        using reference = const record_type &;
+
+        iterator() : owner(nullptr), position(nullptr), next(nullptr), record()
+        {
+        }
+
+        iterator(const OutcomeFile *owner, const char *position) : owner(owner), position(position), next(nullptr), record()
+        {
+            this->decode_current();
+        }
+
+        // A copy decodes the block again, as the entities of the record point into the buffer of the iterator
+        iterator(const iterator &other) : iterator()
+        {
+            *this = other;
+        }
+
+        iterator &operator=(const iterator &other)
+        {
+            this->owner = other.owner;
+            this->position = other.position;
+            this->next = nullptr;
+            this->record = record_type();
+            if (this->owner != nullptr)
+            {
+                this->decode_current();
+            }
+            return *this;
+        }
+
+        const record_type &operator*() const
+        {
+            return this->record;
+        }
+
+        const record_type *operator->() const
+        {
+            return &this->record;
+        }
+
+        iterator &operator++()
+        {
+            this->position = this->next;
+            this->decode_current();
+            return *this;
+        }
+
+        bool operator==(const iterator &other) const
+        {
+            return this->position == other.position;
+        }
+    };
+
+    explicit OutcomeFile(const std::string &filename, int advice = MADV_SEQUENTIAL)
+        : file(filename, advice),
+          filename(filename),
+          file_header(read_file_header(this->file.contents(), filename, OutcomeFormat::KIND)),
+          bytes(this->file.contents().substr(sizeof(FileHeader)))
+    {
+        read_file_header(this->file.contents(), filename, OutcomeFormat::KIND, field_bytes(this->delta_packed()));
+        // The size of delta packed entities is only known once they are decoded, so only their block headers are checked upfront
+        uint64_t value_bytes = this->delta_packed() ? 0 : this->file_header.value_count * OutcomeFormat::VALUE_BYTES;
+        uint64_t expected_bytes = this->file_header.record_count * OutcomeFormat::HEADER_BYTES + value_bytes;
+        if (this->delta_packed() ? this->bytes.size() < expected_bytes : this->bytes.size() != expected_bytes)
+        {
+            throw MyException("The file " + filename + " should hold " + std::to_string(this->file_header.record_count) + " blocks with "
+                              + std::to_string(this->file_header.value_count) + " values, but it holds " + std::to_string(this->bytes.size()) + " bytes");
+        }
+    }
+
+    OutcomeFile(const OutcomeFile &) = delete;
+    OutcomeFile &operator=(const OutcomeFile &) = delete;
+
+    const FileHeader &header() const
+    {
+        return this->file_header;
+    }
+
+    bool delta_packed() const
+    {
+        return this->file_header.flags & FileHeader::DELTA_PACKED;
+    }
+
+    void verify_checksum() const
+    {
+        ::verify_checksum(this->file_header, this->bytes, this->filename);
+    }
+
+    // The number of blocks
+    std::size_t size() const
+    {
+        return this->file_header.record_count;
+    }
+
+    iterator begin() const
+    {
+        return iterator(this, this->bytes.data());
+    }
+
+    iterator end() const
+    {
+        return iterator(this, this->bytes.data() + this->bytes.size());
+    }
+};
+
+template <int ENTITY_BYTES>
+using SizedTripleFile = RecordFile<SizedTripleFormat<ENTITY_BYTES>>;
+using TripleFile = SizedTripleFile<BYTES_PER_ENTITY>;
+using CondensedEdgeFile = RecordFile<CondensedEdgeFormat>;
+using IntervalFile = RecordFile<IntervalFormat>;
+using LocalGlobalMapFile = RecordFile<LocalGlobalFormat>;
+using MappingFile = BlockListFile<MappingFormat>;
+using SingletonMappingFile = BlockListFile<SingletonMappingFormat>;
+
+// Writes a file that starts with a FileHeader. A placeholder header is written first, which `finish` replaces by the complete header.
+// Call `finish` when done. A file that is not finished (e.g. because an exception was thrown while writing it) keeps the placeholder,
+// which does not count any of its records, so readers reject it instead of reading a partial file.
+class HeaderedFileWriter
+{
+protected:
+    std::string filename;
+    std::ofstream outputstream;
+    BlockWriter writer;
+    FileHeader file_header;
+
+    HeaderedFileWriter(const std::string &filename, FileKind kind, FieldWidths field_bytes)
+        : filename(filename),
+          outputstream(filename, std::ios::trunc | std::ios::binary),
+          writer(this->outputstream),
+          file_header(FileHeader::placeholder(kind, field_bytes))
+    {
+        if (!this->outputstream.is_open())
+        {
+            throw MyException("Opening the file to write failed: " + filename);
+        }
+        this->outputstream.write(reinterpret_cast<const char *>(&this->file_header), sizeof(FileHeader));
+    }
+
+    HeaderedFileWriter(const HeaderedFileWriter &) = delete;
+    HeaderedFileWriter &operator=(const HeaderedFileWriter &) = delete;
+
+public:
+    // Writes the records that are still buffered and the complete header, and closes the file
+    void finish()
+    {
+        this->writer.flush();
+        this->file_header.flags |= FileHeader::HAS_CHECKSUM;
+        this->file_header.checksum = this->writer.checksum();
+        this->outputstream.seekp(0);
+        this->outputstream.write(reinterpret_cast<const char *>(&this->file_header), sizeof(FileHeader));
+        this->outputstream.close();
+        if (this->outputstream.fail())
+        {
+            throw MyException("Writing the header of " + this->filename + " failed, the disk might be full");
+        }
+    }
+};
+
+// Writes a file of fixed-size records, which a RecordFile reads
+template <typename Format>
+class RecordFileWriter : public HeaderedFileWriter
+{
+public:
+    using record_type = typename Format::record_type;
+
+    explicit RecordFileWriter(const std::string &filename) : HeaderedFileWriter(filename, Format::KIND, Format::FIELD_BYTES)
+    {
+    }
+
+    void write(const record_type &record)
+    {
+        Format::encode(this->writer, record);
+        Format::add_ids(this->file_header, record);
+        this->file_header.record_count++;
+    }
+};
+
+// Writes a file of blocks that are each followed by a list of values, which a BlockListFile reads.
+// Every `write_block` must be followed by as many `write_value` calls as its count says.
+template <typename Format>
+class BlockListFileWriter : public HeaderedFileWriter
+{
+private:
+    uint64_t pending_values;
+
+    void check_complete() const
+    {
+        if (this->pending_values != 0)
+        {
+            throw MyException("A block in " + this->filename + " is missing " + std::to_string(this->pending_values) + " of its values. Probably a programming error");
+        }
+    }
+
+public:
+    using value_type = typename Format::value_type;
+
+    explicit BlockListFileWriter(const std::string &filename) : HeaderedFileWriter(filename, Format::KIND, Format::FIELD_BYTES), pending_values(0)
+    {
+    }
+
+    void write_block(block_index block, uint64_t count)
+    {
+        this->check_complete();
+        Format::encode_block(this->writer, this->file_header, block, count);
+        this->file_header.record_count++;
+        this->file_header.value_count += count;
+        this->pending_values = count;
+    }
+
+    void write_value(value_type value)
+    {
+        if (this->pending_values == 0)
+        {
+            throw MyException("A block in " + this->filename + " got more values than its count says. Probably a programming error");
+        }
+        Format::encode_value(this->writer, this->file_header, value);
+        this->pending_values--;
+    }
+
+    void finish()
+    {
+        this->check_complete();
+        HeaderedFileWriter::finish();
+    }
+};
+
+// Writes an outcome file, which an OutcomeFile reads. With `delta_packed`, the entities of a block are collected until the last of them has
+// been written, and are then sorted and delta packed. That makes the file several times smaller for large blocks of nearby entities.
+class OutcomeFileWriter : public HeaderedFileWriter
+{
+private:
+    bool delta_packed;
+    uint64_t pending_values;
+    std::vector<node_index> entities;
+    std::vector<std::byte> packed;
+
+    void check_complete() const
+    {
+        if (this->pending_values != 0)
+        {
+            throw MyException("A block in " + this->filename + " is missing " + std::to_string(this->pending_values) + " of its values. Probably a programming error");
+        }
+    }
+
+    void write_packed_entities()
+    {
+        std::sort(this->entities.begin(), this->entities.end());
+        this->packed.clear();
+        delta_pack(this->entities.data(), this->entities.size(), this->packed);
+        this->writer.write_bytes(this->packed.data(), this->packed.size());
+    }
+
+public:
+    using value_type = node_index;
+
+    explicit OutcomeFileWriter(const std::string &filename, bool delta_packed = false)
+        : HeaderedFileWriter(filename, OutcomeFormat::KIND, OutcomeFile::field_bytes(delta_packed)), delta_packed(delta_packed), pending_values(0)
+    {
+        // The placeholder on disk keeps the flag unset, as it counts no records anyway
+        if (delta_packed)
+        {
+            this->file_header.flags |= FileHeader::DELTA_PACKED;
+        }
+    }
+
+    void write_block(block_index block, uint64_t count)
+    {
+        this->check_complete();
+        OutcomeFormat::encode_block(this->writer, this->file_header, block, count);
+        this->file_header.record_count++;
+        this->file_header.value_count += count;
+        this->pending_values = count;
+        this->entities.clear();
+    }
+
+    void write_value(node_index value)
+    {
+        if (this->pending_values == 0)
+        {
+            throw MyException("A block in " + this->filename + " got more values than its count says. Probably a programming error");
+        }
+        this->pending_values--;
+        if (!this->delta_packed)
+        {
+            OutcomeFormat::encode_value(this->writer, this->file_header, value);
+            return;
+        }
+        this->file_header.add_id(value);
+        this->entities.push_back(value);
+        if (this->pending_values == 0)
+        {
+            this->write_packed_entities();
+        }
+    }
+
+    void finish()
+    {
+        this->check_complete();
+        HeaderedFileWriter::finish();
+    }
+};
+
+// Writes the complete header of a file of fixed-size records that were written after a placeholder header by other means,
+// such as the preprocessor, which writes the triples of several threads to one stream. It costs one pass over the records.
+template <typename Format>
+void seal_file_header(const std::string &filename)
+{
+    FileHeader header = FileHeader::placeholder(Format::KIND, Format::FIELD_BYTES);
+    {
+        MappedFile file(filename);
+        std::string_view contents = file.contents();
+        read_file_header(contents, filename, Format::KIND, Format::FIELD_BYTES);
+        std::string_view records = contents.substr(sizeof(FileHeader));
+        if (records.size() % Format::RECORD_BYTES != 0)
+        {
+            throw MyException("The size of the records in " + filename + " is not a multiple of the " + std::to_string(Format::RECORD_BYTES) + " bytes of a " + Format::NAME + " record");
+        }
+        header.record_count = records.size() / Format::RECORD_BYTES;
+        for (std::size_t i = 0; i < header.record_count; i++)
+        {
+            Format::add_ids(header, Format::decode(records.data() + i * Format::RECORD_BYTES));
+        }
+        header.flags |= FileHeader::HAS_CHECKSUM;
+        header.checksum = crc32c(0, reinterpret_cast<const std::byte *>(records.data()), records.size());
+    }
+    std::fstream outputstream(filename, std::ios::in | std::ios::out | std::ios::binary);
+    outputstream.write(reinterpret_cast<const char *>(&header), sizeof(FileHeader));
+    outputstream.close();
+    if (outputstream.fail())
+    {
+        throw MyException("Writing the header of " + filename + " failed");
+    }
+}
+
+// Appends the records in `segment_file`, which has no header, to the sealed file `filename` and removes the segment.
+// The header is updated from the old header and the new records alone, so this costs one pass over the segment instead of over the whole file:
+// the checksum is continued over the new bytes and the ID bound is the larger of the old and the new one.
+template <typename Format>
+void append_sealed_records(const std::string &filename, const std::string &segment_file)
+{
+    FileHeader header;
+    {
+        std::ifstream inputstream(filename, std::ios::binary);
+        char contents[sizeof(FileHeader)];
+        inputstream.read(contents, sizeof(FileHeader));
+        header = read_file_header(std::string_view(contents, inputstream.gcount()), filename, Format::KIND, Format::FIELD_BYTES);
+    }
+    if (std::filesystem::file_size(filename) != sizeof(FileHeader) + header.record_count * Format::RECORD_BYTES)
+    {
+        throw MyException("The size of " + filename + " does not match the number of records in its header, so the records can not be appended to it");
+    }
+    {
+        MappedFile segment(segment_file);
+        std::string_view records = segment.contents();
+        if (records.size() % Format::RECORD_BYTES != 0)
+        {
+            throw MyException("The size of the records in " + segment_file + " is not a multiple of the " + std::to_string(Format::RECORD_BYTES) + " bytes of a " + Format::NAME + " record");
+        }
+        std::size_t record_count = records.size() / Format::RECORD_BYTES;
+        for (std::size_t i = 0; i < record_count; i++)
+        {
+            Format::add_ids(header, Format::decode(records.data() + i * Format::RECORD_BYTES));
+        }
+        header.record_count += record_count;
+        if (header.flags & FileHeader::HAS_CHECKSUM)
+        {
+            header.checksum = crc32c(header.checksum, reinterpret_cast<const std::byte *>(records.data()), records.size());
+        }
+
+        std::ofstream outputstream(filename, std::ios::app | std::ios::binary);
+        outputstream.write(records.data(), records.size());
+        outputstream.close();
+        if (outputstream.fail())
+        {
+            throw MyException("Appending the records of " + segment_file + " to " + filename + " failed, the disk might be full");
+        }
+    }
+    std::fstream outputstream(filename, std::ios::in | std::ios::out | std::ios::binary);
+    outputstream.write(reinterpret_cast<const char *>(&header), sizeof(FileHeader));
+    outputstream.close();
+    if (outputstream.fail())
+    {
+        throw MyException("Writing the header of " + filename + " failed");
+    }
+    std::filesystem::remove(segment_file);
+}
+
+template <int ENTITY_BYTES>
+using SizedTripleFileWriter = RecordFileWriter<SizedTripleFormat<ENTITY_BYTES>>;
+using TripleFileWriter = SizedTripleFileWriter<BYTES_PER_ENTITY>;
+using CondensedEdgeFileWriter = RecordFileWriter<CondensedEdgeFormat>;
+using IntervalFileWriter = RecordFileWriter<IntervalFormat>;
+using LocalGlobalMapFileWriter = RecordFileWriter<LocalGlobalFormat>;
+using MappingFileWriter = BlockListFileWriter<MappingFormat>;
+using SingletonMappingFileWriter = BlockListFileWriter<SingletonMappingFormat>;
+
+// Calls `visitor` with a std::integral_constant<int, ENTITY_BYTES> for the given entity width, such that it can instantiate the triple formats
+// of that width. All instantiations of `visitor` must return the same type.
+template <typename Visitor>
+decltype(auto) dispatch_entity_bytes(int entity_bytes, Visitor &&visitor)
+{
+    switch (entity_bytes)
+    {
+    case 4:
+        return visitor(std::integral_constant<int, 4>());
+    case 5:
+        return visitor(std::integral_constant<int, 5>());
+    case 6:
+        return visitor(std::integral_constant<int, 6>());
+    }
+    throw MyException("Entities of " + std::to_string(entity_bytes) + " bytes are not supported, they must take between "
+                      + std::to_string(MIN_ENTITY_BYTES) + " and " + std::to_string(MAX_ENTITY_BYTES) + " bytes");
+}
+
+// The width of the entities in a triple file, as its header records it
+inline int triple_file_entity_bytes(const std::string &filename)
+{
+    return peek_file_header(filename, FileKind::TRIPLES).field_bytes[0];
+}
+
+// Opens a triple file with the view that matches the width of its entities and calls `visitor` with it, e.g.
+//     visit_triple_file(filename, [&](const auto &triples) { for (TripleRecord triple: triples) ... });
+template <typename Visitor>
+decltype(auto) visit_triple_file(const std::string &filename, Visitor &&visitor, int advice = MADV_SEQUENTIAL)
+{
+    return dispatch_entity_bytes(triple_file_entity_bytes(filename), [&](auto entity_bytes) -> decltype(auto)
+    {
+        SizedTripleFile<decltype(entity_bytes)::value> triples(filename, advice);
+        return visitor(triples);
+    });
+}
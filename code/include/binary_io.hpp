@@ -1,7 +1,11 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <iosfwd>
+#include <memory>
+#include <span>
+#include <vector>
 
 using edge_type = uint32_t;
 using node_index = uint64_t;
@@ -14,6 +18,7 @@ inline constexpr int BYTES_PER_PREDICATE = 4;
 inline constexpr int BYTES_PER_BLOCK = 4;
 inline constexpr int BYTES_PER_BLOCK_OR_SINGLETON = 5;
 inline constexpr int BYTES_PER_K_TYPE = 2;
+inline constexpr std::size_t BYTES_PER_TRIPLE = 2 * BYTES_PER_ENTITY + BYTES_PER_PREDICATE;
 
 inline constexpr block_or_singleton_index MAX_SIGNED_BLOCK_SIZE = std::numeric_limits<block_or_singleton_index>::max();
 inline constexpr edge_type MAX_EDGE_ID = std::numeric_limits<edge_type>::max();
@@ -28,4 +33,156 @@ void write_uint_ENTITY_little_endian(std::ostream &outputstream, node_index valu
 void write_uint_PREDICATE_little_endian(std::ostream &outputstream, edge_type value);
 void write_uint_BLOCK_little_endian(std::ostream &outputstream, block_index value);
 void write_int_BLOCK_OR_SINGLETON_little_endian(std::ostream &outputstream, block_or_singleton_index value);
-void write_uint_K_TYPE_little_endian(std::ostream &outputstream, k_type value);
\ No newline at end of file
+void write_uint_K_TYPE_little_endian(std::ostream &outputstream, k_type value);
+
+// Bulk variants of the functions above, which decode or encode `count` consecutive values at once.
+// They use SIMD shuffles when the compiler targets AVX2 or SSSE3 (e.g. with -march=native) and a plain loop otherwise.
+void decode_entities(const std::byte *in, std::size_t count, node_index *out);
+void decode_predicates(const std::byte *in, std::size_t count, edge_type *out);
+void decode_blocks(const std::byte *in, std::size_t count, block_index *out);
+void decode_blocks_or_singletons(const std::byte *in, std::size_t count, block_or_singleton_index *out);
+// Decodes `count` records of BYTES_PER_TRIPLE bytes into three separate arrays
+void decode_triples(const std::byte *in, std::size_t count, node_index *subjects, edge_type *predicates, node_index *objects);
+void encode_entities(const node_index *in, std::size_t count, std::byte *out);
+void encode_blocks(const block_index *in, std::size_t count, std::byte *out);
+
+// Sorted lists of distinct values, stored as the gaps between them. The gaps are bit-packed in frames of DELTA_FRAME_VALUES values,
+// where each frame has the width of its largest gap. `delta_pack` appends the packed values to `out`. `delta_unpack` decodes `count` values
+// and returns the end of them, or nullptr if they do not end before `end`. See binary_io.cpp for the layout.
+inline constexpr std::size_t DELTA_FRAME_VALUES = 128;
+void delta_pack(const node_index *in, std::size_t count, std::vector<std::byte> &out);
+const std::byte *delta_unpack(const std::byte *in, const std::byte *end, std::size_t count, node_index *out);
+
+// Continues a CRC-32C (Castagnoli) checksum over `size` more bytes, starting from 0 for the first bytes.
+// It uses the crc32 instruction when the compiler targets SSE 4.2 and a table otherwise, which give the same result.
+uint32_t crc32c(uint32_t crc, const std::byte *data, std::size_t size);
+
+// Reads `out.size()` values with large stream reads and decodes them in bulk. Throws a MyException if the stream ends before that.
+void read_uint_ENTITY_span_little_endian(std::istream &inputstream, std::span<node_index> out);
+void read_uint_BLOCK_span_little_endian(std::istream &inputstream, std::span<block_index> out);
+
+// Reads a binary encoding of BYTES_PER_TRIPLE-byte triples in large chunks, which are decoded in bulk
+class TripleReader
+{
+private:
+    std::istream &inputstream;
+    std::vector<std::byte> buffer;
+    std::vector<node_index> subjects;
+    std::vector<edge_type> predicates;
+    std::vector<node_index> objects;
+    std::size_t count;
+    std::size_t position;
+
+public:
+    explicit TripleReader(std::istream &inputstream, std::size_t chunk_triples = 1 << 16);
+
+    // Returns false at the end of the stream. An incomplete triple at the end is ignored, like the single value readers do.
+    bool next(node_index &subject, edge_type &predicate, node_index &object)
+    {
+        if (this->position == this->count && !this->refill())
+        {
+            return false;
+        }
+        subject = this->subjects[this->position];
+        predicate = this->predicates[this->position];
+        object = this->objects[this->position];
+        this->position++;
+        return true;
+    }
+
+private:
+    bool refill();
+};
+
+// Packs the same little-endian values as the functions above into a large buffer, which is written to the stream in one call whenever it is full.
+// This avoids a stream call (and its error check) per value. A failed write throws a MyException.
+// Call `flush` when done: the destructor writes whatever is left, but it can not report an error.
+class BlockWriter
+{
+private:
+    std::ostream &outputstream;
+    std::unique_ptr<char[]> buffer;
+    std::size_t capacity;
+    std::size_t used;
+    uint32_t crc;  // Of the bytes written to the stream so far
+
+    BlockWriter(const BlockWriter &) = delete;
+    BlockWriter &operator=(const BlockWriter &) = delete;
+
+    void write_buffer();
+
+    template <int BYTES, typename T>
+    void put(T value)
+    {
+        if (this->used + BYTES > this->capacity)
+        {
+            this->write_buffer();
+        }
+        char *data = this->buffer.get() + this->used;
+        for (int i = 0; i < BYTES; i++)
+        {
+            data[i] = char(value);
+            value = value >> 8;
+        }
+        this->used += BYTES;
+    }
+
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 1 << 20;
+
+    explicit BlockWriter(std::ostream &outputstream, std::size_t capacity = DEFAULT_CAPACITY);
+    ~BlockWriter();
+
+    void write_uint_ENTITY_little_endian(node_index value)
+    {
+        this->put<BYTES_PER_ENTITY>(value);
+    }
+
+    void write_uint_PREDICATE_little_endian(edge_type value)
+    {
+        this->put<BYTES_PER_PREDICATE>(value);
+    }
+
+    void write_uint_BLOCK_little_endian(block_index value)
+    {
+        this->put<BYTES_PER_BLOCK>(value);
+    }
+
+    void write_int_BLOCK_OR_SINGLETON_little_endian(block_or_singleton_index value)
+    {
+        this->put<BYTES_PER_BLOCK_OR_SINGLETON>(value);
+    }
+
+    void write_uint_K_TYPE_little_endian(k_type value)
+    {
+        this->put<BYTES_PER_K_TYPE>(value);
+    }
+
+    // Writes a (subject, predicate, object) record of BYTES_PER_TRIPLE bytes, or with entities of another width (see SizedTripleFormat)
+    template <int ENTITY_BYTES = BYTES_PER_ENTITY>
+    void write_triple(node_index subject, edge_type predicate, node_index object)
+    {
+        this->put<ENTITY_BYTES>(subject);
+        this->put<BYTES_PER_PREDICATE>(predicate);
+        this->put<ENTITY_BYTES>(object);
+    }
+
+    // Writes the lowest BYTES bytes of a value, for the record writers in binary_formats.hpp
+    template <int BYTES, typename T>
+    void write_little_endian(T value)
+    {
+        this->put<BYTES>(value);
+    }
+
+    // Writes bytes that were encoded elsewhere, such as a delta packed list
+    void write_bytes(const std::byte *data, std::size_t size);
+
+    // Writes the buffered values and flushes the stream
+    void flush();
+
+    // The CRC-32C of everything this writer has written to the stream, which after `flush` includes every value
+    uint32_t checksum() const
+    {
+        return this->crc;
+    }
+};
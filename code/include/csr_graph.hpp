@@ -0,0 +1,297 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "my_exception.hpp"
+#include "binary_formats.hpp"
+#include "binary_io.hpp"
+#include "mapped_file.hpp"
+
+// A graph in compressed sparse row (CSR) format, as written to `graph_csr.bin`.
+// The forward part holds the outgoing edges of every node as (label, target) pairs, in the order in which they appear in `binary_encoding.bin`.
+// The reverse part holds the distinct predecessors of every node in increasing order, which is what the bisimulator uses to find dirty blocks.
+// The nodes are numbered 0 up to the largest ID in the triples, like the bisimulator numbers them.
+// The arrays have the layout of the bisimulator's graph in memory, so it maps the file and uses them in place: the file is a snapshot of that graph.
+// The header records which binary encoding the graph was built from, such that a graph of another (e.g. regenerated) encoding is not used by mistake.
+//
+// Layout (native byte order, every array starts at a multiple of 8 bytes):
+//   CSRHeader
+//   uint64_t forward_offsets[node_count + 1]
+//   CSREdge edges[edge_count]                    (padded to a multiple of 8 bytes)
+//   uint64_t reverse_offsets[node_count + 1]
+//   node_index sources[reverse_edge_count]
+
+// An edge is stored in 12 bytes instead of 16, since the target does not need to be aligned to 8 bytes
+#pragma pack(push, 4)
+struct CSREdge
+{
+    edge_type label;
+    node_index target;
+};
+#pragma pack(pop)
+static_assert(sizeof(CSREdge) == 12);
+
+// Identifies the binary encoding that a graph was built from by its size, the time it was last modified and the checksum in its header
+struct CSRSource
+{
+    uint64_t bytes;
+    int64_t modified;  // In the ticks of std::filesystem::file_time_type
+    uint32_t checksum;
+    uint32_t reserved;
+
+    bool operator==(const CSRSource &other) const = default;
+
+    static CSRSource of(const std::string &binary_file)
+    {
+        CSRSource source{};
+        source.bytes = std::filesystem::file_size(binary_file);
+        source.modified = std::filesystem::last_write_time(binary_file).time_since_epoch().count();
+        FileHeader header = peek_file_header(binary_file, FileKind::TRIPLES);
+        if (header.flags & FileHeader::HAS_CHECKSUM)
+        {
+            source.checksum = header.checksum;
+        }
+        else
+        {
+            MappedFile file(binary_file);
+            std::string_view records = file.contents().substr(sizeof(FileHeader));
+            source.checksum = crc32c(0, reinterpret_cast<const std::byte *>(records.data()), records.size());
+        }
+        return source;
+    }
+};
+
+struct CSRHeader
+{
+    static constexpr char MAGIC[8] = {'C', 'S', 'R', 'G', 'R', 'A', 'P', 'H'};
+    static constexpr uint32_t VERSION = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t label_bytes;
+    uint64_t node_count;
+    uint64_t edge_count;
+    uint64_t reverse_edge_count;
+    CSRSource source;
+    edge_type rdf_type_id;  // The label of rdf:type in the encoding, or MAX_EDGE_ID if it has none
+    uint32_t reserved;
+};
+static_assert(sizeof(CSRHeader) == 72);
+
+namespace csr_detail
+{
+    inline std::size_t padded_size(std::size_t bytes)
+    {
+        return (bytes + 7) & ~std::size_t(7);
+    }
+
+    template <typename T>
+    void write_array(std::ofstream &out, std::span<const T> values)
+    {
+        out.write(reinterpret_cast<const char *>(values.data()), values.size_bytes());
+        const char padding[8] = {};
+        out.write(padding, padded_size(values.size_bytes()) - values.size_bytes());
+    }
+}
+
+// Writes a graph whose arrays are already in CSR form, e.g. the graph of the bisimulator
+inline void write_csr_graph(const std::string &csr_file, const CSRSource &source, edge_type rdf_type_id, std::span<const uint64_t> forward_offsets,
+                            std::span<const CSREdge> edges, std::span<const uint64_t> reverse_offsets, std::span<const node_index> sources)
+{
+    std::ofstream out(csr_file, std::ios::trunc | std::ios::binary);
+    if (!out.is_open())
+    {
+        throw MyException("Opening the CSR file failed: " + csr_file);
+    }
+    CSRHeader header{};
+    std::memcpy(header.magic, CSRHeader::MAGIC, sizeof(header.magic));
+    header.version = CSRHeader::VERSION;
+    header.label_bytes = sizeof(edge_type);
+    header.node_count = forward_offsets.size() - 1;
+    header.edge_count = edges.size();
+    header.reverse_edge_count = sources.size();
+    header.source = source;
+    header.rdf_type_id = rdf_type_id;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    csr_detail::write_array(out, forward_offsets);
+    csr_detail::write_array(out, edges);
+    csr_detail::write_array(out, reverse_offsets);
+    csr_detail::write_array(out, sources);
+    out.close();
+    if (out.fail())
+    {
+        throw MyException("Writing the CSR file failed, the disk might be full");
+    }
+}
+
+// Builds the CSR file from the triples of a binary encoding. The triples are read from a mapping twice: once to count the degrees and once to fill the arrays.
+// Returns the number of nodes.
+template <typename TripleView>
+uint64_t build_csr_graph_from_triples(const TripleView &triples, const std::string &csr_file, const CSRSource &source, edge_type rdf_type_id)
+{
+    const uint64_t edge_count = triples.size();
+    // The header gives the number of nodes, so the offsets are allocated once
+    const uint64_t node_count = triples.header().id_bound;
+
+    // First pass: the out-degree and in-degree (with duplicates) of every node
+    std::vector<uint64_t> forward_offsets(node_count + 1, 0);
+    std::vector<uint64_t> reverse_offsets(node_count + 1, 0);
+    for (TripleRecord triple: triples)
+    {
+        forward_offsets[triple.subject + 1]++;
+        reverse_offsets[triple.object + 1]++;
+    }
+    for (uint64_t node = 0; node < node_count; node++)
+    {
+        forward_offsets[node + 1] += forward_offsets[node];
+        reverse_offsets[node + 1] += reverse_offsets[node];
+    }
+
+    // Second pass: scatter the edges, which keeps the edges of every node in file order
+    std::vector<CSREdge> edges(edge_count);
+    std::vector<node_index> sources(edge_count);
+    {
+        std::vector<uint64_t> forward_fill(forward_offsets.begin(), forward_offsets.end() - 1);
+        std::vector<uint64_t> reverse_fill(reverse_offsets.begin(), reverse_offsets.end() - 1);
+        for (TripleRecord triple: triples)
+        {
+            edges[forward_fill[triple.subject]++] = CSREdge{triple.predicate, triple.object};
+            sources[reverse_fill[triple.object]++] = triple.subject;
+        }
+    }
+
+    // Deduplicate the predecessors of every node in place, compacting the array as we go
+    uint64_t reverse_edge_count = 0;
+    for (uint64_t node = 0; node < node_count; node++)
+    {
+        auto begin = sources.begin() + reverse_offsets[node];
+        auto end = sources.begin() + reverse_offsets[node + 1];
+        std::sort(begin, end);
+        auto unique_end = std::unique(begin, end);
+        reverse_offsets[node] = reverse_edge_count;
+        reverse_edge_count = std::copy(begin, unique_end, sources.begin() + reverse_edge_count) - sources.begin();
+    }
+    reverse_offsets[node_count] = reverse_edge_count;
+    sources.resize(reverse_edge_count);
+
+    write_csr_graph(csr_file, source, rdf_type_id, forward_offsets, edges, reverse_offsets, sources);
+    return node_count;
+}
+
+// Builds the CSR file from a binary encoding with entities of any width
+inline uint64_t build_csr_graph(const std::string &binary_file, const std::string &csr_file, edge_type rdf_type_id)
+{
+    CSRSource source = CSRSource::of(binary_file);
+    return visit_triple_file(binary_file, [&](const auto &triples) { return build_csr_graph_from_triples(triples, csr_file, source, rdf_type_id); });
+}
+
+// A read-only view of a CSR file, which is mapped into memory instead of being read
+class CSRGraphFile
+{
+private:
+    MappedFile file;
+    CSRHeader header;
+    std::span<const uint64_t> forward_offsets;
+    std::span<const CSREdge> edges;
+    std::span<const uint64_t> reverse_offsets;
+    std::span<const node_index> sources;
+
+    template <typename T>
+    std::span<const T> take_array(std::size_t &offset, uint64_t count)
+    {
+        std::size_t bytes = count * sizeof(T);
+        if (offset + bytes > this->file.contents().size())
+        {
+            throw MyException("The CSR file is shorter than its header says");
+        }
+        std::span<const T> array(reinterpret_cast<const T *>(this->file.contents().data() + offset), count);
+        offset += csr_detail::padded_size(bytes);
+        return array;
+    }
+
+public:
+    explicit CSRGraphFile(const std::string &filename) : file(filename, MADV_RANDOM)
+    {
+        std::string_view contents = this->file.contents();
+        if (contents.size() < sizeof(CSRHeader))
+        {
+            throw MyException("The CSR file " + filename + " is too short to hold a header");
+        }
+        std::memcpy(&this->header, contents.data(), sizeof(CSRHeader));
+        if (std::memcmp(this->header.magic, CSRHeader::MAGIC, sizeof(this->header.magic)) != 0)
+        {
+            throw MyException(filename + " is not a CSR file");
+        }
+        if (this->header.version != CSRHeader::VERSION || this->header.label_bytes != sizeof(edge_type))
+        {
+            throw MyException("The CSR file " + filename + " has version " + std::to_string(this->header.version) + " with " + std::to_string(this->header.label_bytes)
+                              + "-byte labels, but version " + std::to_string(CSRHeader::VERSION) + " with " + std::to_string(sizeof(edge_type)) + "-byte labels is expected");
+        }
+        std::size_t offset = sizeof(CSRHeader);
+        this->forward_offsets = this->take_array<uint64_t>(offset, this->header.node_count + 1);
+        this->edges = this->take_array<CSREdge>(offset, this->header.edge_count);
+        this->reverse_offsets = this->take_array<uint64_t>(offset, this->header.node_count + 1);
+        this->sources = this->take_array<node_index>(offset, this->header.reverse_edge_count);
+    }
+
+    // Whether `filename` is a CSR file of this version that was built from the binary encoding `source`. Only the header is read.
+    static bool is_built_from(const std::string &filename, const CSRSource &source)
+    {
+        std::ifstream inputstream(filename, std::ios::binary);
+        CSRHeader header{};
+        if (!inputstream.read(reinterpret_cast<char *>(&header), sizeof(CSRHeader)))
+        {
+            return false;
+        }
+        return std::memcmp(header.magic, CSRHeader::MAGIC, sizeof(header.magic)) == 0 && header.version == CSRHeader::VERSION
+               && header.label_bytes == sizeof(edge_type) && header.source == source;
+    }
+
+    uint64_t node_count() const
+    {
+        return this->header.node_count;
+    }
+
+    uint64_t edge_count() const
+    {
+        return this->header.edge_count;
+    }
+
+    edge_type rdf_type_id() const
+    {
+        return this->header.rdf_type_id;
+    }
+
+    std::span<const uint64_t> get_forward_offsets() const
+    {
+        return this->forward_offsets;
+    }
+
+    std::span<const CSREdge> get_edges() const
+    {
+        return this->edges;
+    }
+
+    std::span<const uint64_t> get_reverse_offsets() const
+    {
+        return this->reverse_offsets;
+    }
+
+    std::span<const node_index> get_sources() const
+    {
+        return this->sources;
+    }
+
+    // The distinct predecessors of `node`, in increasing order
+    std::span<const node_index> predecessors(node_index node) const
+    {
+        return this->sources.subspan(this->reverse_offsets[node], this->reverse_offsets[node + 1] - this->reverse_offsets[node]);
+    }
+};
@@ -0,0 +1,577 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <bzlib.h>
+#include <lz4frame.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#include "my_exception.hpp"
+
+// Reads a possibly compressed file as a stream. The compression is detected from the magic bytes at the start of the file.
+// A dedicated reader thread decompresses into a ring of large buffers, such that decompression overlaps with parsing.
+
+enum class Compression
+{
+    none,
+    gzip,
+    bzip2,
+    zstd,
+    lz4
+};
+
+inline Compression detect_compression(std::string_view magic)
+{
+    if (magic.substr(0, 2) == "\x1f\x8b")
+    {
+        return Compression::gzip;
+    }
+    if (magic.substr(0, 3) == "BZh")
+    {
+        return Compression::bzip2;
+    }
+    if (magic.substr(0, 4) == "\x28\xb5\x2f\xfd")
+    {
+        return Compression::zstd;
+    }
+    if (magic.substr(0, 4) == "\x04\x22\x4d\x18")
+    {
+        return Compression::lz4;
+    }
+    return Compression::none;
+}
+
+inline std::string compression_name(Compression compression)
+{
+    switch (compression)
+    {
+    case Compression::gzip:
+        return "gzip";
+    case Compression::bzip2:
+        return "bzip2";
+    case Compression::zstd:
+        return "zstd";
+    case Compression::lz4:
+        return "lz4";
+    default:
+        return "uncompressed";
+    }
+}
+
+// Reads as many bytes as possible (up to `size`), retrying short reads such as those from a pipe. Returns 0 at the end of the file.
+inline std::size_t read_fully(int file_descriptor, char *buffer, std::size_t size)
+{
+    std::size_t total = 0;
+    while (total < size)
+    {
+        ssize_t read_bytes = read(file_descriptor, buffer + total, size - total);
+        if (read_bytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw MyException("Reading the input failed: " + std::string(std::strerror(errno)));
+        }
+        if (read_bytes == 0)
+        {
+            break;
+        }
+        total += read_bytes;
+    }
+    return total;
+}
+
+// Peeks at the magic bytes of a regular file
+inline Compression detect_file_compression(const std::string &filename)
+{
+    int file_descriptor = open(filename.c_str(), O_RDONLY);
+    if (file_descriptor < 0)
+    {
+        throw MyException("Opening the input file failed: " + filename);
+    }
+    char magic[4];
+    std::size_t magic_size = read_fully(file_descriptor, magic, sizeof(magic));
+    close(file_descriptor);
+    return detect_compression(std::string_view(magic, magic_size));
+}
+
+// Decompresses from [input, input_end) into [output, output_end), advancing `input` and `output` past the bytes consumed and produced
+class Decompressor
+{
+public:
+    virtual ~Decompressor() = default;
+    virtual void decompress(const char *&input, const char *input_end, char *&output, char *output_end) = 0;
+    // Whether the input seen so far ends on a complete frame (or member), i.e. it was not truncated
+    virtual bool at_frame_end() const = 0;
+};
+
+class PassThrough : public Decompressor
+{
+public:
+    void decompress(const char *&input, const char *input_end, char *&output, char *output_end) override
+    {
+        std::size_t size = std::min(input_end - input, output_end - output);
+        std::memcpy(output, input, size);
+        input += size;
+        output += size;
+    }
+
+    bool at_frame_end() const override
+    {
+        return true;
+    }
+};
+
+class GzipDecompressor : public Decompressor
+{
+private:
+    z_stream stream;
+    bool member_ended;
+
+public:
+    GzipDecompressor() : stream(), member_ended(false)
+    {
+        // 15 + 32 makes zlib accept the gzip header
+        if (inflateInit2(&this->stream, 15 + 32) != Z_OK)
+        {
+            throw MyException("Initializing the gzip decompression failed");
+        }
+    }
+
+    ~GzipDecompressor() override
+    {
+        inflateEnd(&this->stream);
+    }
+
+    void decompress(const char *&input, const char *input_end, char *&output, char *output_end) override
+    {
+        // Concatenated gzip members (e.g. from parallel compressors) are decompressed one after the other
+        if (this->member_ended)
+        {
+            if (input == input_end)
+            {
+                return;
+            }
+            inflateReset(&this->stream);
+            this->member_ended = false;
+        }
+        this->stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input));
+        this->stream.avail_in = std::min<std::size_t>(input_end - input, UINT_MAX);
+        this->stream.next_out = reinterpret_cast<Bytef *>(output);
+        this->stream.avail_out = std::min<std::size_t>(output_end - output, UINT_MAX);
+        int result = inflate(&this->stream, Z_NO_FLUSH);
+        input = reinterpret_cast<const char *>(this->stream.next_in);
+        output = reinterpret_cast<char *>(this->stream.next_out);
+        if (result == Z_STREAM_END)
+        {
+            this->member_ended = true;
+        }
+        else if (result != Z_OK && result != Z_BUF_ERROR)
+        {
+            throw MyException("Decompressing the gzip input failed: " + std::string(this->stream.msg != nullptr ? this->stream.msg : "unknown error"));
+        }
+    }
+
+    bool at_frame_end() const override
+    {
+        return this->member_ended;
+    }
+};
+
+class Bzip2Decompressor : public Decompressor
+{
+private:
+    bz_stream stream;
+    bool stream_ended;
+
+public:
+    Bzip2Decompressor() : stream(), stream_ended(false)
+    {
+        if (BZ2_bzDecompressInit(&this->stream, 0, 0) != BZ_OK)
+        {
+            throw MyException("Initializing the bzip2 decompression failed");
+        }
+    }
+
+    ~Bzip2Decompressor() override
+    {
+        BZ2_bzDecompressEnd(&this->stream);
+    }
+
+    void decompress(const char *&input, const char *input_end, char *&output, char *output_end) override
+    {
+        // Concatenated bzip2 streams (e.g. from pbzip2) are decompressed one after the other
+        if (this->stream_ended)
+        {
+            if (input == input_end)
+            {
+                return;
+            }
+            BZ2_bzDecompressEnd(&this->stream);
+            if (BZ2_bzDecompressInit(&this->stream, 0, 0) != BZ_OK)
+            {
+                throw MyException("Initializing the bzip2 decompression failed");
+            }
+            this->stream_ended = false;
+        }
+        this->stream.next_in = const_cast<char *>(input);
+        this->stream.avail_in = std::min<std::size_t>(input_end - input, UINT_MAX);
+        this->stream.next_out = output;
+        this->stream.avail_out = std::min<std::size_t>(output_end - output, UINT_MAX);
+        int result = BZ2_bzDecompress(&this->stream);
+        input = this->stream.next_in;
+        output = this->stream.next_out;
+        if (result == BZ_STREAM_END)
+        {
+            this->stream_ended = true;
+        }
+        else if (result != BZ_OK)
+        {
+            throw MyException("Decompressing the bzip2 input failed with error code " + std::to_string(result));
+        }
+    }
+
+    bool at_frame_end() const override
+    {
+        return this->stream_ended;
+    }
+};
+
+class ZstdDecompressor : public Decompressor
+{
+private:
+    ZSTD_DStream *stream;
+    bool frame_ended;
+
+public:
+    ZstdDecompressor() : stream(ZSTD_createDStream()), frame_ended(false)
+    {
+        if (this->stream == nullptr)
+        {
+            throw MyException("Initializing the zstd decompression failed");
+        }
+    }
+
+    ~ZstdDecompressor() override
+    {
+        ZSTD_freeDStream(this->stream);
+    }
+
+    void decompress(const char *&input, const char *input_end, char *&output, char *output_end) override
+    {
+        // zstd continues with the next frame by itself
+        ZSTD_inBuffer in_buffer = {input, std::size_t(input_end - input), 0};
+        ZSTD_outBuffer out_buffer = {output, std::size_t(output_end - output), 0};
+        std::size_t result = ZSTD_decompressStream(this->stream, &out_buffer, &in_buffer);
+        if (ZSTD_isError(result))
+        {
+            throw MyException("Decompressing the zstd input failed: " + std::string(ZSTD_getErrorName(result)));
+        }
+        input += in_buffer.pos;
+        output += out_buffer.pos;
+        // Without any progress, the result is a hint about the next frame
+        if (in_buffer.pos > 0 || out_buffer.pos > 0)
+        {
+            this->frame_ended = result == 0;
+        }
+    }
+
+    bool at_frame_end() const override
+    {
+        return this->frame_ended;
+    }
+};
+
+class Lz4Decompressor : public Decompressor
+{
+private:
+    LZ4F_dctx *context;
+    bool frame_ended;
+
+public:
+    Lz4Decompressor() : context(nullptr), frame_ended(false)
+    {
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&this->context, LZ4F_VERSION)))
+        {
+            throw MyException("Initializing the lz4 decompression failed");
+        }
+    }
+
+    ~Lz4Decompressor() override
+    {
+        LZ4F_freeDecompressionContext(this->context);
+    }
+
+    void decompress(const char *&input, const char *input_end, char *&output, char *output_end) override
+    {
+        // After a frame has ended, the context accepts the next frame by itself
+        std::size_t input_size = input_end - input;
+        std::size_t output_size = output_end - output;
+        std::size_t result = LZ4F_decompress(this->context, output, &output_size, input, &input_size, nullptr);
+        if (LZ4F_isError(result))
+        {
+            throw MyException("Decompressing the lz4 input failed: " + std::string(LZ4F_getErrorName(result)));
+        }
+        input += input_size;
+        output += output_size;
+        // Without any progress, the result is a hint about the next frame
+        if (input_size > 0 || output_size > 0)
+        {
+            this->frame_ended = result == 0;
+        }
+    }
+
+    bool at_frame_end() const override
+    {
+        return this->frame_ended;
+    }
+};
+
+inline std::unique_ptr<Decompressor> make_decompressor(Compression compression)
+{
+    switch (compression)
+    {
+    case Compression::gzip:
+        return std::make_unique<GzipDecompressor>();
+    case Compression::bzip2:
+        return std::make_unique<Bzip2Decompressor>();
+    case Compression::zstd:
+        return std::make_unique<ZstdDecompressor>();
+    case Compression::lz4:
+        return std::make_unique<Lz4Decompressor>();
+    default:
+        return std::make_unique<PassThrough>();
+    }
+}
+
+// A stream buffer that hands out the buffers filled by the reader thread.
+// The buffers are recycled: once the parser moves on to the next buffer, the previous one goes back to the reader thread.
+class DecompressingStreamBuf : public std::streambuf
+{
+private:
+    static constexpr std::size_t INPUT_BLOCK_SIZE = 4 * 1024 * 1024;
+
+    struct Buffer
+    {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    int file_descriptor;
+    Compression compression;
+    std::unique_ptr<Decompressor> decompressor;
+    std::unique_ptr<char[]> input;
+    std::size_t input_size;
+    std::size_t buffer_size;
+    std::vector<Buffer> buffers;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::size_t> free_buffers;
+    std::deque<std::size_t> filled_buffers;
+    bool finished;
+    bool stopping;
+    std::exception_ptr error;
+    std::optional<std::size_t> current_buffer;
+    std::thread reader;
+
+    DecompressingStreamBuf(const DecompressingStreamBuf &) = delete;
+    DecompressingStreamBuf &operator=(const DecompressingStreamBuf &) = delete;
+
+    void read_loop()
+    {
+        try
+        {
+            const char *input_position = this->input.get();
+            const char *input_end = this->input.get() + this->input_size;
+            bool input_ended = this->input_size == 0;
+            while (true)
+            {
+                std::size_t index;
+                {
+                    std::unique_lock<std::mutex> lock(this->mutex);
+                    this->changed.wait(lock, [this]() { return this->stopping || !this->free_buffers.empty(); });
+                    if (this->stopping)
+                    {
+                        return;
+                    }
+                    index = this->free_buffers.front();
+                    this->free_buffers.pop_front();
+                }
+                Buffer &buffer = this->buffers[index];
+                char *output = buffer.data.get();
+                char *output_end = output + this->buffer_size;
+                while (output < output_end)
+                {
+                    if (input_position == input_end && !input_ended)
+                    {
+                        std::size_t read_bytes = read_fully(this->file_descriptor, this->input.get(), INPUT_BLOCK_SIZE);
+                        input_position = this->input.get();
+                        input_end = this->input.get() + read_bytes;
+                        input_ended = read_bytes < INPUT_BLOCK_SIZE;
+                        continue;
+                    }
+                    const char *previous_input = input_position;
+                    char *previous_output = output;
+                    this->decompressor->decompress(input_position, input_end, output, output_end);
+                    if (input_position == previous_input && output == previous_output)
+                    {
+                        // Once all input has been read, the decompressor is called until it has flushed all its output
+                        if (input_position == input_end)
+                        {
+                            break;
+                        }
+                        throw MyException("Decompressing the " + compression_name(this->compression) + " input made no progress");
+                    }
+                }
+                buffer.size = output - buffer.data.get();
+                bool done = input_ended && input_position == input_end && output < output_end;
+                if (done && !this->decompressor->at_frame_end())
+                {
+                    throw MyException("The " + compression_name(this->compression) + " input ended in the middle of a frame, the file might be truncated");
+                }
+                {
+                    std::lock_guard<std::mutex> lock(this->mutex);
+                    if (buffer.size > 0)
+                    {
+                        this->filled_buffers.push_back(index);
+                    }
+                    else
+                    {
+                        this->free_buffers.push_back(index);
+                    }
+                    this->finished = done;
+                }
+                this->changed.notify_all();
+                if (done)
+                {
+                    return;
+                }
+            }
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->error = std::current_exception();
+                this->finished = true;
+            }
+            this->changed.notify_all();
+        }
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (this->gptr() < this->egptr())
+        {
+            return traits_type::to_int_type(*this->gptr());
+        }
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if (this->current_buffer)
+        {
+            this->free_buffers.push_back(*this->current_buffer);
+            this->current_buffer.reset();
+            this->changed.notify_all();
+        }
+        this->changed.wait(lock, [this]() { return this->finished || !this->filled_buffers.empty(); });
+        if (this->filled_buffers.empty())
+        {
+            if (this->error)
+            {
+                std::rethrow_exception(this->error);
+            }
+            return traits_type::eof();
+        }
+        std::size_t index = this->filled_buffers.front();
+        this->filled_buffers.pop_front();
+        this->current_buffer = index;
+        Buffer &buffer = this->buffers[index];
+        this->setg(buffer.data.get(), buffer.data.get(), buffer.data.get() + buffer.size);
+        return traits_type::to_int_type(*this->gptr());
+    }
+
+public:
+    DecompressingStreamBuf(const std::string &filename, std::size_t buffer_size, std::size_t buffer_count)
+        : file_descriptor(-1), compression(Compression::none), input(new char[INPUT_BLOCK_SIZE]), input_size(0),
+          buffer_size(buffer_size), finished(false), stopping(false)
+    {
+        this->file_descriptor = open(filename.c_str(), O_RDONLY);
+        if (this->file_descriptor < 0)
+        {
+            throw MyException("Opening the input file failed: " + filename);
+        }
+        // The first block is read here, such that the compression is known before the reader thread starts. This also works for pipes, which can not be peeked.
+        try
+        {
+            this->input_size = read_fully(this->file_descriptor, this->input.get(), INPUT_BLOCK_SIZE);
+            this->compression = detect_compression(std::string_view(this->input.get(), this->input_size));
+            this->decompressor = make_decompressor(this->compression);
+        }
+        catch (...)
+        {
+            close(this->file_descriptor);
+            throw;
+        }
+        for (std::size_t i = 0; i < buffer_count; i++)
+        {
+            this->buffers.push_back({std::unique_ptr<char[]>(new char[buffer_size]), 0});
+            this->free_buffers.push_back(i);
+        }
+        this->reader = std::thread(&DecompressingStreamBuf::read_loop, this);
+    }
+
+    ~DecompressingStreamBuf() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->changed.notify_all();
+        this->reader.join();
+        close(this->file_descriptor);
+    }
+
+    Compression get_compression() const
+    {
+        return this->compression;
+    }
+};
+
+// An input stream over a DecompressingStreamBuf. Errors of the reader thread (e.g. corrupt input) are rethrown by the reading operations.
+class DecompressingStream : public std::istream
+{
+private:
+    DecompressingStreamBuf buffer;
+
+public:
+    // By default the reader thread can run ahead of the parser by 4 buffers of 16 MiB
+    explicit DecompressingStream(const std::string &filename, std::size_t buffer_size = 16 * 1024 * 1024, std::size_t buffer_count = 4)
+        : std::istream(nullptr), buffer(filename, buffer_size, buffer_count)
+    {
+        this->rdbuf(&this->buffer);
+        this->exceptions(std::ios::badbit);
+    }
+
+    Compression get_compression() const
+    {
+        return this->buffer.get_compression();
+    }
+};
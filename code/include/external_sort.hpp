@@ -0,0 +1,519 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "my_exception.hpp"
+#include "string_arena.hpp"
+
+// Building blocks for encoding a graph whose dictionary does not fit in memory.
+// Term occurrences are collected until the memory budget is used up, and are then sorted and spilled to a run file on disk.
+// Merging the runs visits every distinct term once in sorted order, which is where it gets its dense ID.
+// The IDs are finally brought back into triple order by a second external sort on the position (slot) at which each term occurred.
+// The run files are temporary and use the native byte order.
+
+namespace external_sort
+{
+    // The number of runs that are merged at once. If there are more runs, they are first merged in groups, which keeps the number of open files bounded.
+    inline constexpr std::size_t MAX_MERGE_FAN_IN = 64;
+    inline constexpr std::size_t RUN_BUFFER_SIZE = 1 << 20;
+
+    inline void write_uint64(std::ostream &out, uint64_t value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    inline bool read_uint64(std::istream &in, uint64_t &value)
+    {
+        return bool(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+    }
+
+    // Hands out fresh file names in the directory used for the runs
+    class RunDirectory
+    {
+    private:
+        std::string directory;
+        std::size_t run_counter;
+
+    public:
+        explicit RunDirectory(const std::string &directory) : directory(directory), run_counter(0)
+        {
+            boost::filesystem::create_directories(directory);
+        }
+
+        std::string next_run_file(const std::string &name)
+        {
+            return this->directory + "/" + name + "_" + std::to_string(this->run_counter++) + ".run";
+        }
+    };
+
+    // A run file opened with a large buffer, since a merge reads from many runs in an interleaved fashion
+    class BufferedRunFile
+    {
+    protected:
+        std::unique_ptr<char[]> buffer;
+        std::fstream file;
+
+        BufferedRunFile(const std::string &filename, std::ios::openmode mode) : buffer(new char[RUN_BUFFER_SIZE])
+        {
+            this->file.rdbuf()->pubsetbuf(this->buffer.get(), RUN_BUFFER_SIZE);
+            this->file.open(filename, mode | std::ios::binary);
+            if (!this->file.is_open())
+            {
+                throw MyException("Opening the run file failed: " + filename);
+            }
+        }
+
+        void check_written(const std::string &what)
+        {
+            if (this->file.fail())
+            {
+                throw MyException("Writing " + what + " failed, the disk might be full");
+            }
+        }
+    };
+
+    // Sorts pairs of 64-bit values, e.g. (slot, ID) pairs by their slot or packed triples
+    class PairSorter
+    {
+    private:
+        using value_pair = std::pair<uint64_t, uint64_t>;
+
+        class RunWriter : BufferedRunFile
+        {
+        public:
+            explicit RunWriter(const std::string &filename) : BufferedRunFile(filename, std::ios::out | std::ios::trunc)
+            {
+            }
+
+            void write(value_pair pair)
+            {
+                write_uint64(this->file, pair.first);
+                write_uint64(this->file, pair.second);
+            }
+
+            void close()
+            {
+                this->file.flush();
+                this->check_written("a run of pairs");
+                this->file.close();
+            }
+        };
+
+        class RunReader : BufferedRunFile
+        {
+        private:
+            value_pair current;
+
+        public:
+            explicit RunReader(const std::string &filename) : BufferedRunFile(filename, std::ios::in)
+            {
+            }
+
+            bool advance()
+            {
+                return read_uint64(this->file, this->current.first) && read_uint64(this->file, this->current.second);
+            }
+
+            value_pair pair() const
+            {
+                return this->current;
+            }
+        };
+
+        RunDirectory &run_directory;
+        std::string name;
+        std::size_t capacity;
+        std::vector<value_pair> buffer;
+        std::vector<std::string> runs;
+
+        void spill()
+        {
+            std::sort(this->buffer.begin(), this->buffer.end());
+            std::string run_file = this->run_directory.next_run_file(this->name);
+            RunWriter writer(run_file);
+            for (const value_pair &pair : this->buffer)
+            {
+                writer.write(pair);
+            }
+            writer.close();
+            this->runs.push_back(run_file);
+            this->buffer.clear();
+        }
+
+        template <typename Visitor>
+        void merge_runs(const std::vector<std::string> &run_files, Visitor &&visit)
+        {
+            std::vector<std::unique_ptr<RunReader>> readers;
+            for (const std::string &run_file : run_files)
+            {
+                readers.push_back(std::make_unique<RunReader>(run_file));
+            }
+            // A priority queue holds the current pair of every run
+            using entry = std::pair<value_pair, std::size_t>;
+            std::priority_queue<entry, std::vector<entry>, std::greater<entry>> heads;
+            for (std::size_t i = 0; i < readers.size(); i++)
+            {
+                if (readers[i]->advance())
+                {
+                    heads.emplace(readers[i]->pair(), i);
+                }
+            }
+            while (!heads.empty())
+            {
+                std::size_t i = heads.top().second;
+                heads.pop();
+                visit(readers[i]->pair());
+                if (readers[i]->advance())
+                {
+                    heads.emplace(readers[i]->pair(), i);
+                }
+            }
+            readers.clear();
+            for (const std::string &run_file : run_files)
+            {
+                boost::filesystem::remove(run_file);
+            }
+        }
+
+    public:
+        PairSorter(RunDirectory &run_directory, std::size_t memory_budget, const std::string &name = "slots")
+            : run_directory(run_directory), name(name), capacity(std::max<std::size_t>(memory_budget / sizeof(value_pair), 1))
+        {
+            this->buffer.reserve(this->capacity);
+        }
+
+        void add(uint64_t slot, uint64_t id)
+        {
+            this->buffer.emplace_back(slot, id);
+            if (this->buffer.size() >= this->capacity)
+            {
+                this->spill();
+            }
+        }
+
+        // Calls `visit(first, second)` for every pair, in increasing order. The sorter is empty afterwards.
+        template <typename Visitor>
+        void merge(Visitor &&visit)
+        {
+            if (this->runs.empty())
+            {
+                std::sort(this->buffer.begin(), this->buffer.end());
+                for (const value_pair &pair : this->buffer)
+                {
+                    visit(pair.first, pair.second);
+                }
+                this->buffer.clear();
+                return;
+            }
+            if (!this->buffer.empty())
+            {
+                this->spill();
+            }
+            std::vector<value_pair>().swap(this->buffer);  // Give the memory back before the merge allocates its read buffers
+            while (this->runs.size() > MAX_MERGE_FAN_IN)
+            {
+                std::vector<std::string> merged_runs;
+                for (std::size_t start = 0; start < this->runs.size(); start += MAX_MERGE_FAN_IN)
+                {
+                    std::size_t end = std::min(start + MAX_MERGE_FAN_IN, this->runs.size());
+                    std::vector<std::string> group(this->runs.begin() + start, this->runs.begin() + end);
+                    std::string run_file = this->run_directory.next_run_file(this->name);
+                    RunWriter writer(run_file);
+                    this->merge_runs(group, [&writer](value_pair pair)
+                    {
+                        writer.write(pair);
+                    });
+                    writer.close();
+                    merged_runs.push_back(run_file);
+                }
+                this->runs = std::move(merged_runs);
+            }
+            this->merge_runs(this->runs, [&visit](value_pair pair)
+            {
+                visit(pair.first, pair.second);
+            });
+            this->runs.clear();
+        }
+    };
+
+    // The external counterpart of the IDMapper. Terms are added together with the slot they occur in, and only get their IDs in `assign_IDs`.
+    // The IDs are dense and follow the sorted order of the terms.
+    template <typename T>
+    class ExternalIDMapper
+    {
+    private:
+        // A run stores every distinct term once, in sorted order, as: term length, term bytes, slot count, slots
+        class RunWriter : BufferedRunFile
+        {
+        public:
+            explicit RunWriter(const std::string &filename) : BufferedRunFile(filename, std::ios::out | std::ios::trunc)
+            {
+            }
+
+            void write_term(std::string_view term, uint64_t slot_count)
+            {
+                write_uint64(this->file, term.size());
+                this->file.write(term.data(), term.size());
+                write_uint64(this->file, slot_count);
+            }
+
+            void write_slot(uint64_t slot)
+            {
+                write_uint64(this->file, slot);
+            }
+
+            void close()
+            {
+                this->file.flush();
+                this->check_written("a run of terms");
+                this->file.close();
+            }
+        };
+
+        class RunReader : BufferedRunFile
+        {
+        private:
+            std::string current_term;
+            uint64_t remaining_slots;
+
+        public:
+            explicit RunReader(const std::string &filename) : BufferedRunFile(filename, std::ios::in), remaining_slots(0)
+            {
+            }
+
+            // Moves on to the next term. All slots of the current term must have been read.
+            bool advance()
+            {
+                uint64_t term_size;
+                if (!read_uint64(this->file, term_size))
+                {
+                    return false;
+                }
+                this->current_term.resize(term_size);
+                if (!this->file.read(this->current_term.data(), term_size) || !read_uint64(this->file, this->remaining_slots))
+                {
+                    throw MyException("A run of terms ended unexpectedly");
+                }
+                return true;
+            }
+
+            std::string_view head() const
+            {
+                return this->current_term;
+            }
+
+            uint64_t slot_count() const
+            {
+                return this->remaining_slots;
+            }
+
+            uint64_t next_slot()
+            {
+                uint64_t slot;
+                if (!read_uint64(this->file, slot))
+                {
+                    throw MyException("A run of terms ended unexpectedly");
+                }
+                this->remaining_slots--;
+                return slot;
+            }
+        };
+
+        // Every term costs its bytes plus roughly this much for its hash table entry
+        static constexpr std::size_t BYTES_PER_TERM = 32;
+
+        RunDirectory &run_directory;
+        std::string name;
+        std::unique_ptr<ArenaStringMap<uint32_t>> terms;
+        std::vector<std::pair<uint32_t, uint64_t>> occurrences;  // (local term number, slot)
+        std::size_t term_bytes;
+        std::vector<std::string> runs;
+
+        uint32_t local_term(std::string_view term)
+        {
+            const uint32_t *existing = this->terms->find(term);
+            if (existing != nullptr)
+            {
+                return *existing;
+            }
+            uint32_t local = this->terms->size();
+            this->terms->insert(term, local);
+            this->term_bytes += term.size();
+            return local;
+        }
+
+        // Merges the given runs, calling `visit_term(term, slot_count)` for every distinct term and `visit_slot(slot)` for each of its slots
+        template <typename TermVisitor, typename SlotVisitor>
+        void merge_runs(const std::vector<std::string> &run_files, TermVisitor &&visit_term, SlotVisitor &&visit_slot)
+        {
+            std::vector<std::unique_ptr<RunReader>> readers;
+            for (const std::string &run_file : run_files)
+            {
+                readers.push_back(std::make_unique<RunReader>(run_file));
+            }
+            // The heads are views of the current terms of the readers, which stay valid until the reader is advanced
+            using entry = std::pair<std::string_view, std::size_t>;
+            std::priority_queue<entry, std::vector<entry>, std::greater<entry>> heads;
+            for (std::size_t i = 0; i < readers.size(); i++)
+            {
+                if (readers[i]->advance())
+                {
+                    heads.emplace(readers[i]->head(), i);
+                }
+            }
+            std::vector<std::size_t> equal_terms;
+            while (!heads.empty())
+            {
+                // Equal terms from different runs are combined into one
+                std::string_view term = heads.top().first;
+                uint64_t slot_count = 0;
+                while (!heads.empty() && heads.top().first == term)
+                {
+                    equal_terms.push_back(heads.top().second);
+                    slot_count += readers[heads.top().second]->slot_count();
+                    heads.pop();
+                }
+                visit_term(term, slot_count);
+                for (std::size_t i : equal_terms)
+                {
+                    while (readers[i]->slot_count() > 0)
+                    {
+                        visit_slot(readers[i]->next_slot());
+                    }
+                }
+                for (std::size_t i : equal_terms)
+                {
+                    if (readers[i]->advance())
+                    {
+                        heads.emplace(readers[i]->head(), i);
+                    }
+                }
+                equal_terms.clear();
+            }
+            readers.clear();
+            for (const std::string &run_file : run_files)
+            {
+                boost::filesystem::remove(run_file);
+            }
+        }
+
+    public:
+        ExternalIDMapper(RunDirectory &run_directory, const std::string &name)
+            : run_directory(run_directory), name(name), terms(std::make_unique<ArenaStringMap<uint32_t>>()), term_bytes(0)
+        {
+        }
+
+        // Records that `term` occurs at `slot`
+        void add(std::string_view term, uint64_t slot)
+        {
+            this->occurrences.emplace_back(this->local_term(term), slot);
+        }
+
+        // Makes sure `term` gets an ID, without recording an occurrence
+        void add(std::string_view term)
+        {
+            this->local_term(term);
+        }
+
+        std::size_t memory_usage() const
+        {
+            return this->term_bytes + this->terms->size() * BYTES_PER_TERM + this->occurrences.size() * sizeof(this->occurrences[0]);
+        }
+
+        // Sorts the terms collected so far and writes them, with their slots, to a new run
+        void spill()
+        {
+            if (this->terms->size() == 0)
+            {
+                return;
+            }
+            std::vector<std::pair<std::string_view, uint32_t>> sorted_terms;
+            sorted_terms.reserve(this->terms->size());
+            this->terms->for_each([&sorted_terms](std::string_view term, uint32_t local)
+            {
+                sorted_terms.emplace_back(term, local);
+            });
+            std::sort(sorted_terms.begin(), sorted_terms.end());
+
+            // Renumber the occurrences by the rank of their term, such that sorting them groups them per term in sorted order
+            std::vector<uint32_t> rank(sorted_terms.size());
+            for (uint32_t i = 0; i < sorted_terms.size(); i++)
+            {
+                rank[sorted_terms[i].second] = i;
+            }
+            for (auto &occurrence : this->occurrences)
+            {
+                occurrence.first = rank[occurrence.first];
+            }
+            std::vector<uint32_t>().swap(rank);
+            std::sort(this->occurrences.begin(), this->occurrences.end());
+
+            std::string run_file = this->run_directory.next_run_file(this->name);
+            RunWriter writer(run_file);
+            auto occurrence = this->occurrences.cbegin();
+            for (uint32_t i = 0; i < sorted_terms.size(); i++)
+            {
+                auto term_end = occurrence;
+                while (term_end != this->occurrences.cend() && term_end->first == i)
+                {
+                    term_end++;
+                }
+                writer.write_term(sorted_terms[i].first, term_end - occurrence);
+                for (; occurrence != term_end; occurrence++)
+                {
+                    writer.write_slot(occurrence->second);
+                }
+            }
+            writer.close();
+            this->runs.push_back(run_file);
+
+            this->terms = std::make_unique<ArenaStringMap<uint32_t>>();
+            std::vector<std::pair<uint32_t, uint64_t>>().swap(this->occurrences);
+            this->term_bytes = 0;
+        }
+
+        // Assigns the dense IDs. `visit_term(term, id)` is called for every distinct term in sorted order and the (slot, ID) pairs are added to `slots`.
+        // Returns the number of distinct terms. The mapper is empty afterwards.
+        template <typename TermVisitor>
+        std::size_t assign_IDs(PairSorter &slots, TermVisitor &&visit_term)
+        {
+            this->spill();
+            while (this->runs.size() > MAX_MERGE_FAN_IN)
+            {
+                std::vector<std::string> merged_runs;
+                for (std::size_t start = 0; start < this->runs.size(); start += MAX_MERGE_FAN_IN)
+                {
+                    std::size_t end = std::min(start + MAX_MERGE_FAN_IN, this->runs.size());
+                    std::vector<std::string> group(this->runs.begin() + start, this->runs.begin() + end);
+                    std::string run_file = this->run_directory.next_run_file(this->name);
+                    RunWriter writer(run_file);
+                    this->merge_runs(group,
+                                     [&writer](std::string_view term, uint64_t slot_count) { writer.write_term(term, slot_count); },
+                                     [&writer](uint64_t slot) { writer.write_slot(slot); });
+                    writer.close();
+                    merged_runs.push_back(run_file);
+                }
+                this->runs = std::move(merged_runs);
+            }
+            T next_id = 0;
+            this->merge_runs(this->runs,
+                             [&](std::string_view term, uint64_t)
+                             {
+                                 visit_term(term, next_id);
+                                 next_id++;
+                             },
+                             [&](uint64_t slot) { slots.add(slot, next_id - 1); });
+            this->runs.clear();
+            return next_id;
+        }
+    };
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "mapped_file.hpp"
+#include "my_exception.hpp"
+
+// Every binary file that the pipeline writes starts with a FileHeader (graph_csr.bin and the binary dictionaries have headers of their own).
+// It tells a reader what the file holds before any record is read: a file with other field widths is rejected right away,
+// arrays indexed by the IDs in the file can be sized exactly, and the records of a file with fixed-size records can be split among threads by index.
+//
+// The header is written in native byte order, the records after it are little-endian as before.
+// The counts are only known once the records have been written, so writers first write a placeholder and fill it in at the end.
+enum class FileKind : uint8_t
+{
+    TRIPLES = 1,            // binary_encoding.bin, quotient_graph_triples-XXXX.bin (with --make_ids_positive)
+    OUTCOME = 2,            // outcome_condensed-XXXX.bin
+    MAPPING = 3,            // mapping-XXXXtoYYYY.bin
+    SINGLETON_MAPPING = 4,  // singleton_mapping-XXXXtoYYYY.bin
+    CONDENSED_EDGES = 5,    // condensed_multi_summary_graph.bin, summary_graph-XXXX.bin, quotient_graph_triples-XXXX.bin
+    INTERVALS = 6,          // condensed_multi_summary_intervals.bin
+    LOCAL_GLOBAL_MAP = 7,   // condensed_multi_summary_local_global_map.bin
+};
+
+// The widths in bytes of the fields of a record in the order in which they are stored, padded with zeros.
+// The records of a block list are described by the widths of the block, the count and a single value.
+using FieldWidths = std::array<uint8_t, 4>;
+
+struct FileHeader
+{
+    static constexpr char MAGIC[8] = {'S', 'U', 'M', 'M', 'A', 'R', 'Y', 'B'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint8_t HAS_CHECKSUM = 1;
+    static constexpr uint8_t DELTA_PACKED = 2;  // The values of an outcome file are delta packed, see OutcomeFile
+
+    char magic[8];
+    uint32_t version;
+    FileKind kind;
+    uint8_t flags;
+    FieldWidths field_bytes;
+    uint16_t reserved;
+    uint32_t checksum;      // The CRC-32C of everything after the header, if the HAS_CHECKSUM flag is set
+    uint64_t record_count;  // The number of records, i.e. the number of blocks in a block list file
+    uint64_t value_count;   // The number of values in all lists of a block list file together, 0 for other files
+    // The largest ID in the file plus one, or 0 if it holds none: the size of an array that is indexed by these IDs.
+    // These are the nodes of a triple file and the entities of an outcome file. For all other files they are the (non-negative) blocks,
+    // while singletons, which are stored as negative numbers, are left out.
+    uint64_t id_bound;
+
+    static FileHeader placeholder(FileKind kind, FieldWidths field_bytes)
+    {
+        FileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        header.kind = kind;
+        header.field_bytes = field_bytes;
+        return header;
+    }
+
+    void add_id(uint64_t id)
+    {
+        if (id >= this->id_bound)
+        {
+            this->id_bound = id + 1;
+        }
+    }
+};
+static_assert(sizeof(FileHeader) == 48);
+
+// Reads the header at the start of a file and checks that the file is of the expected kind, but not the widths of its fields.
+// This lets a program choose the instantiation of its readers that matches the widths of a file.
+inline FileHeader read_file_header(std::string_view contents, const std::string &filename, FileKind kind)
+{
+    FileHeader header;
+    if (contents.size() < sizeof(FileHeader) || std::memcmp(contents.data(), FileHeader::MAGIC, sizeof(FileHeader::MAGIC)) != 0)
+    {
+        throw MyException("The file " + filename + " does not start with a file header. Either it was not written completely, or it was written by an older version of the pipeline and needs to be written again");
+    }
+    std::memcpy(&header, contents.data(), sizeof(FileHeader));
+    if (header.version != FileHeader::VERSION)
+    {
+        throw MyException("The file " + filename + " has version " + std::to_string(header.version) + ", but version " + std::to_string(FileHeader::VERSION) + " is expected");
+    }
+    if (header.kind != kind)
+    {
+        throw MyException("The file " + filename + " holds records of kind " + std::to_string(int(header.kind)) + " instead of kind " + std::to_string(int(kind)));
+    }
+    return header;
+}
+
+// Reads the header at the start of a file and checks that the file is of the expected kind and has the expected field widths
+inline FileHeader read_file_header(std::string_view contents, const std::string &filename, FileKind kind, FieldWidths field_bytes)
+{
+    FileHeader header = read_file_header(contents, filename, kind);
+    if (header.field_bytes != field_bytes)
+    {
+        auto widths = [](FieldWidths widths)
+        {
+            std::string result;
+            for (uint8_t width: widths)
+            {
+                if (width != 0)
+                {
+                    result += (result.empty() ? "" : "/") + std::to_string(width);
+                }
+            }
+            return result;
+        };
+        throw MyException("The file " + filename + " has fields of " + widths(header.field_bytes) + " bytes, but fields of " + widths(field_bytes) + " bytes are expected");
+    }
+    return header;
+}
+
+// Reads only the header of a file, e.g. to find the widths of its fields before it is mapped.
+// Of a compressed container only the first frame is decompressed.
+inline FileHeader peek_file_header(const std::string &filename, FileKind kind)
+{
+    std::ifstream inputstream(filename, std::ios::binary);
+    if (!inputstream.is_open())
+    {
+        throw MyException("Opening the file failed: " + filename);
+    }
+    char contents[sizeof(FileHeader)];
+    inputstream.read(contents, sizeof(FileHeader));
+    std::string_view header_contents(contents, inputstream.gcount());
+    if (is_frame_container(header_contents))
+    {
+        MappedFile mapped_container(filename, MADV_RANDOM, false);
+        FrameContainer container(mapped_container.contents(), filename);
+        header_contents = header_contents.substr(0, std::min<uint64_t>(container.size(), sizeof(FileHeader)));
+        container.read(0, header_contents.size(), contents);
+    }
+    return read_file_header(header_contents, filename, kind);
+}
@@ -0,0 +1,339 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <lz4.h>
+#include <zstd.h>
+
+#include "binary_io.hpp"
+#include "my_exception.hpp"
+
+// A container that stores a file in frames of `frame_bytes` bytes (1 MiB by default), which are compressed independently with zstd or lz4.
+// An index at the end of the container gives the position of every frame. The frames can therefore be decompressed in parallel,
+// and a range of the file can be read by decompressing only the frames that hold it.
+// MappedFile recognizes a container by its magic and decompresses it, so all readers of the binary files accept it in place of the file.
+//
+//   ContainerHeader     magic, version, codec, frame size and the size of the decompressed file
+//   frames              the compressed frames, one after the other
+//   index               a FrameEntry (offset in the container, compressed size, CRC-32C of the compressed bytes) per frame
+//   ContainerTrailer    the offset of the index, the number of frames and the magic again
+//
+// Like the FileHeader, these structures are stored in native byte order.
+
+enum class FrameCodec : uint8_t
+{
+    zstd = 1,
+    lz4 = 2,
+};
+
+struct ContainerHeader
+{
+    static constexpr char MAGIC[8] = {'S', 'U', 'M', 'M', 'A', 'R', 'Y', 'Z'};
+    static constexpr uint32_t VERSION = 1;
+
+    char magic[8];
+    uint32_t version;
+    FrameCodec codec;
+    uint8_t reserved[3];
+    uint64_t frame_bytes;    // The decompressed size of every frame but the last
+    uint64_t content_bytes;  // The size of the decompressed file
+};
+static_assert(sizeof(ContainerHeader) == 32);
+
+struct FrameEntry
+{
+    uint64_t offset;
+    uint32_t compressed_bytes;
+    uint32_t checksum;  // Neither codec notices every damaged frame by itself
+};
+static_assert(sizeof(FrameEntry) == 16);
+
+struct ContainerTrailer
+{
+    uint64_t index_offset;
+    uint64_t frame_count;
+    char magic[8];
+};
+static_assert(sizeof(ContainerTrailer) == 24);
+
+inline constexpr std::size_t DEFAULT_FRAME_BYTES = 1 << 20;
+
+inline bool is_frame_container(std::string_view contents)
+{
+    return contents.size() >= sizeof(ContainerHeader) && std::memcmp(contents.data(), ContainerHeader::MAGIC, sizeof(ContainerHeader::MAGIC)) == 0;
+}
+
+inline std::string frame_codec_name(FrameCodec codec)
+{
+    return codec == FrameCodec::zstd ? "zstd" : "lz4";
+}
+
+// A read-only view of a container in memory, such as a mapped file
+class FrameContainer
+{
+private:
+    std::string_view contents;
+    std::string filename;
+    ContainerHeader container_header;
+    std::vector<FrameEntry> index;
+
+public:
+    FrameContainer(std::string_view contents, const std::string &filename) : contents(contents), filename(filename), container_header()
+    {
+        if (!is_frame_container(contents) || contents.size() < sizeof(ContainerHeader) + sizeof(ContainerTrailer))
+        {
+            throw MyException("The file " + filename + " is not a compressed container");
+        }
+        std::memcpy(&this->container_header, contents.data(), sizeof(ContainerHeader));
+        if (this->container_header.version != ContainerHeader::VERSION)
+        {
+            throw MyException("The container " + filename + " has version " + std::to_string(this->container_header.version) + ", but version "
+                              + std::to_string(ContainerHeader::VERSION) + " is expected");
+        }
+        if (this->container_header.codec != FrameCodec::zstd && this->container_header.codec != FrameCodec::lz4)
+        {
+            throw MyException("The container " + filename + " uses the unknown codec " + std::to_string(int(this->container_header.codec)));
+        }
+        ContainerTrailer trailer;
+        std::memcpy(&trailer, contents.data() + contents.size() - sizeof(ContainerTrailer), sizeof(ContainerTrailer));
+        uint64_t expected_frames = this->container_header.frame_bytes == 0 ? 0 : (this->container_header.content_bytes + this->container_header.frame_bytes - 1) / this->container_header.frame_bytes;
+        if (std::memcmp(trailer.magic, ContainerHeader::MAGIC, sizeof(ContainerHeader::MAGIC)) != 0 || trailer.frame_count != expected_frames
+            || trailer.index_offset > contents.size() - sizeof(ContainerTrailer)
+            || (contents.size() - sizeof(ContainerTrailer) - trailer.index_offset) / sizeof(FrameEntry) != trailer.frame_count)
+        {
+            throw MyException("The container " + filename + " has no valid frame index at its end. Either it was not written completely, or it is damaged");
+        }
+        this->index.resize(trailer.frame_count);
+        std::memcpy(this->index.data(), contents.data() + trailer.index_offset, trailer.frame_count * sizeof(FrameEntry));
+        for (const FrameEntry &entry: this->index)
+        {
+            if (entry.offset < sizeof(ContainerHeader) || entry.offset > trailer.index_offset || entry.compressed_bytes > trailer.index_offset - entry.offset)
+            {
+                throw MyException("The frame index of the container " + filename + " points outside of its frames");
+            }
+        }
+    }
+
+    const ContainerHeader &header() const
+    {
+        return this->container_header;
+    }
+
+    // The size of the decompressed file
+    uint64_t size() const
+    {
+        return this->container_header.content_bytes;
+    }
+
+    std::size_t frame_count() const
+    {
+        return this->index.size();
+    }
+
+    // The decompressed size of a frame
+    std::size_t frame_size(std::size_t frame) const
+    {
+        uint64_t start = frame * this->container_header.frame_bytes;
+        return std::min(this->container_header.frame_bytes, this->container_header.content_bytes - start);
+    }
+
+    // Decompresses a frame into `out`, which must have room for `frame_size(frame)` bytes
+    void decompress_frame(std::size_t frame, char *out) const
+    {
+        const FrameEntry &entry = this->index[frame];
+        const char *compressed = this->contents.data() + entry.offset;
+        std::size_t expected = this->frame_size(frame);
+        if (crc32c(0, reinterpret_cast<const std::byte *>(compressed), entry.compressed_bytes) != entry.checksum)
+        {
+            throw MyException("Frame " + std::to_string(frame) + " of " + this->filename + " does not match its checksum. The container is damaged");
+        }
+        std::size_t decompressed;
+        if (this->container_header.codec == FrameCodec::zstd)
+        {
+            decompressed = ZSTD_decompress(out, expected, compressed, entry.compressed_bytes);
+            if (ZSTD_isError(decompressed))
+            {
+                throw MyException("Decompressing frame " + std::to_string(frame) + " of " + this->filename + " failed: " + ZSTD_getErrorName(decompressed));
+            }
+        }
+        else
+        {
+            int result = LZ4_decompress_safe(compressed, out, int(entry.compressed_bytes), int(expected));
+            decompressed = result < 0 ? 0 : std::size_t(result);
+        }
+        if (decompressed != expected)
+        {
+            throw MyException("Frame " + std::to_string(frame) + " of " + this->filename + " should decompress to " + std::to_string(expected) + " bytes, but it gives "
+                              + std::to_string(decompressed) + " bytes. The container is damaged");
+        }
+    }
+
+    // Decompresses the bytes [offset, offset + size) of the file into `out`, which only decompresses the frames that hold them
+    void read(uint64_t offset, std::size_t size, char *out) const
+    {
+        if (offset > this->size() || size > this->size() - offset)
+        {
+            throw MyException("Reading " + std::to_string(size) + " bytes at " + std::to_string(offset) + " goes beyond the end of " + this->filename);
+        }
+        std::vector<char> buffer(this->container_header.frame_bytes);
+        while (size > 0)
+        {
+            std::size_t frame = offset / this->container_header.frame_bytes;
+            std::size_t within = offset % this->container_header.frame_bytes;
+            std::size_t chunk = std::min(size, this->frame_size(frame) - within);
+            this->decompress_frame(frame, buffer.data());
+            std::memcpy(out, buffer.data() + within, chunk);
+            out += chunk;
+            offset += chunk;
+            size -= chunk;
+        }
+    }
+
+    // Decompresses the whole file into `out`, which must have room for `size()` bytes. The frames are divided over `threads` threads.
+    void decompress_all(char *out, unsigned int threads) const
+    {
+        threads = std::max(1u, std::min<unsigned int>(threads, this->frame_count()));
+        std::vector<std::exception_ptr> errors(threads);
+        auto decompress_frames = [&](unsigned int thread)
+        {
+            try
+            {
+                for (std::size_t frame = thread; frame < this->frame_count(); frame += threads)
+                {
+                    this->decompress_frame(frame, out + frame * this->container_header.frame_bytes);
+                }
+            }
+            catch (...)
+            {
+                errors[thread] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int thread = 1; thread < threads; thread++)
+        {
+            workers.emplace_back(decompress_frames, thread);
+        }
+        decompress_frames(0);
+        for (std::thread &worker: workers)
+        {
+            worker.join();
+        }
+        for (const std::exception_ptr &error: errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+};
+
+// Compresses `contents` into a container at `filename`. The frames are compressed on `threads` threads, in rounds of a few frames per thread,
+// such that only those frames are held in memory.
+inline void write_frame_container(std::string_view contents, const std::string &filename, FrameCodec codec, std::size_t frame_bytes, int level, unsigned int threads)
+{
+    if (frame_bytes == 0 || frame_bytes > std::size_t(LZ4_MAX_INPUT_SIZE))
+    {
+        throw MyException("The frame size must be between 1 byte and " + std::to_string(LZ4_MAX_INPUT_SIZE) + " bytes");
+    }
+    std::ofstream outputstream(filename, std::ios::trunc | std::ios::binary);
+    if (!outputstream.is_open())
+    {
+        throw MyException("Opening the file to write failed: " + filename);
+    }
+    ContainerHeader header{};
+    std::memcpy(header.magic, ContainerHeader::MAGIC, sizeof(header.magic));
+    header.version = ContainerHeader::VERSION;
+    header.codec = codec;
+    header.frame_bytes = frame_bytes;
+    header.content_bytes = contents.size();
+    outputstream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    threads = std::max(1u, threads);
+    const std::size_t frame_count = (contents.size() + frame_bytes - 1) / frame_bytes;
+    const std::size_t round_frames = 4 * std::size_t(threads);
+    std::vector<FrameEntry> index;
+    index.reserve(frame_count);
+    uint64_t offset = sizeof(ContainerHeader);
+    std::vector<std::string> compressed(round_frames);
+    std::vector<std::exception_ptr> errors(threads);
+    for (std::size_t round_start = 0; round_start < frame_count; round_start += round_frames)
+    {
+        std::size_t round_end = std::min(frame_count, round_start + round_frames);
+        auto compress_frames = [&](unsigned int thread)
+        {
+            try
+            {
+                for (std::size_t frame = round_start + thread; frame < round_end; frame += threads)
+                {
+                    std::string_view input = contents.substr(frame * frame_bytes, frame_bytes);
+                    std::string &output = compressed[frame - round_start];
+                    if (codec == FrameCodec::zstd)
+                    {
+                        output.resize(ZSTD_compressBound(input.size()));
+                        std::size_t size = ZSTD_compress(output.data(), output.size(), input.data(), input.size(), level);
+                        if (ZSTD_isError(size))
+                        {
+                            throw MyException("Compressing a frame of " + filename + " failed: " + ZSTD_getErrorName(size));
+                        }
+                        output.resize(size);
+                    }
+                    else
+                    {
+                        output.resize(LZ4_compressBound(int(input.size())));
+                        int size = LZ4_compress_default(input.data(), output.data(), int(input.size()), int(output.size()));
+                        if (size <= 0)
+                        {
+                            throw MyException("Compressing a frame of " + filename + " failed");
+                        }
+                        output.resize(size);
+                    }
+                }
+            }
+            catch (...)
+            {
+                errors[thread] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int thread = 1; thread < threads; thread++)
+        {
+            workers.emplace_back(compress_frames, thread);
+        }
+        compress_frames(0);
+        for (std::thread &worker: workers)
+        {
+            worker.join();
+        }
+        for (const std::exception_ptr &error: errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+        for (std::size_t frame = round_start; frame < round_end; frame++)
+        {
+            const std::string &output = compressed[frame - round_start];
+            outputstream.write(output.data(), output.size());
+            index.push_back({offset, uint32_t(output.size()), crc32c(0, reinterpret_cast<const std::byte *>(output.data()), output.size())});
+            offset += output.size();
+        }
+    }
+
+    outputstream.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(FrameEntry));
+    ContainerTrailer trailer{offset, index.size(), {}};
+    std::memcpy(trailer.magic, ContainerHeader::MAGIC, sizeof(trailer.magic));
+    outputstream.write(reinterpret_cast<const char *>(&trailer), sizeof(trailer));
+    outputstream.close();
+    if (outputstream.fail())
+    {
+        throw MyException("Writing the container " + filename + " failed, the disk might be full");
+    }
+}
@@ -0,0 +1,284 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <boost/container_hash/hash.hpp>
+#include <boost/unordered/unordered_flat_map.hpp>
+
+#include "string_arena.hpp"
+#include "varint.hpp"
+
+// Most of the bytes of an IRI are its namespace (e.g. "http://www.wikidata.org/entity/"), which is shared by many other IRIs.
+// These helpers split a term into its namespace and its local name, such that the namespace can be stored once and referred to by a small ID.
+
+// Namespaces shorter than this are not worth an ID
+inline constexpr std::size_t MIN_PREFIX_LENGTH = 8;
+
+// The length of the namespace of a term, i.e. everything up to and including the last '/' or '#'. Terms without either (such as blank nodes) have none.
+inline std::size_t namespace_length(std::string_view term)
+{
+    for (std::size_t split = term.size(); split > 0; split--)
+    {
+        if (term[split - 1] == '/' || term[split - 1] == '#')
+        {
+            return split;
+        }
+    }
+    return 0;
+}
+
+// Compares first_a + second_a with first_b + second_b, without concatenating them
+inline int compare_concatenations(std::string_view first_a, std::string_view second_a, std::string_view first_b, std::string_view second_b)
+{
+    if (first_a.data() == first_b.data() && first_a.size() == first_b.size())  // The common case of two terms with the same stored prefix
+    {
+        return second_a.compare(second_b);
+    }
+    std::string_view a = first_a;
+    std::string_view b = first_b;
+    bool a_in_second = false;
+    bool b_in_second = false;
+    while (true)
+    {
+        if (a.empty() && !a_in_second)
+        {
+            a = second_a;
+            a_in_second = true;
+            continue;
+        }
+        if (b.empty() && !b_in_second)
+        {
+            b = second_b;
+            b_in_second = true;
+            continue;
+        }
+        if (a.empty() || b.empty())
+        {
+            return int(!a.empty()) - int(!b.empty());
+        }
+        std::size_t length = std::min(a.size(), b.size());
+        int result = std::memcmp(a.data(), b.data(), length);
+        if (result != 0)
+        {
+            return result;
+        }
+        a.remove_prefix(length);
+        b.remove_prefix(length);
+    }
+}
+
+// The namespaces that have an ID. IDs are handed out in the order in which the namespaces are added.
+class PrefixTable
+{
+private:
+    std::deque<std::string> prefixes;  // A deque never moves its elements, so the views in `ids` stay valid
+    boost::unordered_flat_map<std::string_view, uint32_t> ids;
+    // Consecutive terms often share their namespace, so the last hit is checked before hashing
+    std::string_view last_prefix;
+    uint32_t last_id = 0;
+
+public:
+    std::optional<uint32_t> find(std::string_view prefix)
+    {
+        if (!this->last_prefix.empty() && prefix == this->last_prefix)
+        {
+            return this->last_id;
+        }
+        auto result = this->ids.find(prefix);
+        if (result == this->ids.end())
+        {
+            return std::nullopt;
+        }
+        this->last_prefix = result->first;
+        this->last_id = result->second;
+        return result->second;
+    }
+
+    // Only call this for prefixes that are not present yet
+    uint32_t add(std::string_view prefix)
+    {
+        uint32_t id = this->prefixes.size();
+        this->ids.emplace(this->prefixes.emplace_back(prefix), id);
+        return id;
+    }
+
+    std::string_view prefix(uint32_t id) const
+    {
+        return this->prefixes[id];
+    }
+
+    std::size_t size() const
+    {
+        return this->prefixes.size();
+    }
+};
+
+// An ArenaStringMap in which the keys are stored as (prefix ID, local name) when their namespace is one of the frequent ones.
+// The first `sample_size` keys are stored as they are while their namespaces are counted. The most frequent namespaces then get an ID
+// and the sampled keys are stored again. From then on the prefixes are fixed, so every key has exactly one encoding.
+// A stored key starts with a varint that is 0 for a key without a prefix, or the prefix ID plus 1 otherwise.
+template <typename T>
+class PrefixedStringMap
+{
+private:
+    static constexpr std::size_t MAX_PREFIXES = 1 << 14;  // Keeps the varint of a prefix ID within 2 bytes
+
+    struct NamespaceHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view key) const
+        {
+            return boost::hash<std::string_view>()(key);
+        }
+    };
+
+    std::size_t expected_size;
+    std::size_t sample_size;
+    std::unique_ptr<ArenaStringMap<T>> mapping;
+    PrefixTable prefixes;
+    bool learning;
+    boost::unordered_flat_map<std::string, std::size_t, NamespaceHash, std::equal_to<>> namespace_counts;  // Only used while learning
+    std::string key_buffer;
+
+    PrefixedStringMap(const PrefixedStringMap &) = delete;
+    PrefixedStringMap &operator=(const PrefixedStringMap &) = delete;
+
+    // The encoded key is only valid until the next call
+    std::string_view encode(std::string_view term)
+    {
+        this->key_buffer.clear();
+        std::size_t split = namespace_length(term);
+        std::optional<uint32_t> prefix_id;
+        if (!this->learning && split >= MIN_PREFIX_LENGTH)
+        {
+            prefix_id = this->prefixes.find(term.substr(0, split));
+        }
+        if (prefix_id)
+        {
+            write_varint(this->key_buffer, uint64_t(*prefix_id) + 1);
+            this->key_buffer.append(term.substr(split));
+        }
+        else
+        {
+            write_varint(this->key_buffer, 0);
+            this->key_buffer.append(term);
+        }
+        return this->key_buffer;
+    }
+
+    // Splits a stored key into its prefix and its local name
+    std::pair<std::string_view, std::string_view> decode(std::string_view key) const
+    {
+        const char *position = key.data();
+        uint64_t prefix_id = read_varint(position);
+        std::string_view local(position, key.data() + key.size() - position);
+        return {prefix_id == 0 ? std::string_view() : this->prefixes.prefix(prefix_id - 1), local};
+    }
+
+    void choose_prefixes()
+    {
+        std::vector<std::pair<std::size_t, std::string_view>> candidates;
+        for (const auto &[prefix, count] : this->namespace_counts)
+        {
+            if (count > 1)
+            {
+                candidates.emplace_back(count, prefix);
+            }
+        }
+        // The most frequent first, with ties broken by the prefix such that the choice does not depend on the hash table order
+        std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b)
+        {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        candidates.resize(std::min(candidates.size(), MAX_PREFIXES));
+        for (const auto &candidate : candidates)
+        {
+            this->prefixes.add(candidate.second);
+        }
+        this->learning = false;
+
+        std::unique_ptr<ArenaStringMap<T>> sampled = std::move(this->mapping);
+        this->mapping = std::make_unique<ArenaStringMap<T>>(std::max(this->expected_size, sampled->size()));
+        sampled->for_each([this](std::string_view key, T value)
+        {
+            this->mapping->insert(this->encode(this->decode(key).second), value);
+        });
+        decltype(this->namespace_counts)().swap(this->namespace_counts);
+    }
+
+public:
+    static constexpr std::size_t DEFAULT_SAMPLE_SIZE = 1 << 20;
+
+    // The expected size is used to size the hash table upfront, it will still grow beyond that if needed
+    explicit PrefixedStringMap(std::size_t expected_size = 0, std::size_t sample_size = DEFAULT_SAMPLE_SIZE)
+        : expected_size(expected_size),
+          sample_size(sample_size),
+          mapping(std::make_unique<ArenaStringMap<T>>(std::min(expected_size, sample_size))),
+          learning(true)
+    {
+    }
+
+    // Returns a pointer to the value for the key, or nullptr if the key is not present
+    const T *find(std::string_view key)
+    {
+        return this->mapping->find(this->encode(key));
+    }
+
+    // Only call this for keys that are not present yet
+    void insert(std::string_view key, T value)
+    {
+        if (this->learning)
+        {
+            std::size_t split = namespace_length(key);
+            if (split >= MIN_PREFIX_LENGTH)
+            {
+                std::string_view prefix = key.substr(0, split);
+                auto count = this->namespace_counts.find(prefix);
+                if (count == this->namespace_counts.end())
+                {
+                    this->namespace_counts.emplace(prefix, 1);
+                }
+                else
+                {
+                    count->second++;
+                }
+            }
+        }
+        this->mapping->insert(this->encode(key), value);
+        if (this->learning && this->mapping->size() >= this->sample_size)
+        {
+            this->choose_prefixes();
+        }
+    }
+
+    std::size_t size() const
+    {
+        return this->mapping->size();
+    }
+
+    void reserve(std::size_t expected_size)
+    {
+        this->expected_size = expected_size;
+        this->mapping->reserve(this->learning ? std::min(expected_size, this->sample_size) : expected_size);
+    }
+
+    // Calls `visit(prefix, local, value)` for every entry, in hash table order. The key is the concatenation of the prefix and the local name.
+    template <typename Visitor>
+    void for_each(Visitor &&visit) const
+    {
+        this->mapping->for_each([this, &visit](std::string_view key, T value)
+        {
+            auto [prefix, local] = this->decode(key);
+            visit(prefix, local, value);
+        });
+    }
+};
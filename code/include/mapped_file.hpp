@@ -0,0 +1,179 @@
+#pragma once
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "frame_container.hpp"
+#include "my_exception.hpp"
+
+// A read-only memory mapping of a complete file. The contents can be accessed without copying them into a buffer first.
+// A compressed container (see frame_container.hpp) is decompressed in parallel into anonymous memory instead, so its contents are those of the original file.
+class MappedFile
+{
+private:
+    int file_descriptor;
+    char *data;
+    std::size_t size;
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+public:
+    // The advice is passed on to `madvise`, e.g. MADV_SEQUENTIAL for scans or MADV_RANDOM for lookups.
+    // Without `expand_containers` a container is mapped as it is, e.g. to read only a part of it with a FrameContainer.
+    explicit MappedFile(const std::string &filename, int advice = MADV_SEQUENTIAL, bool expand_containers = true) : file_descriptor(-1), data(nullptr), size(0)
+    {
+        this->file_descriptor = open(filename.c_str(), O_RDONLY);
+        if (this->file_descriptor < 0)
+        {
+            throw MyException("Opening the file to map failed: " + filename);
+        }
+        struct stat file_stats;
+        if (fstat(this->file_descriptor, &file_stats) != 0)
+        {
+            close(this->file_descriptor);
+            throw MyException("Reading the size of the file to map failed: " + filename);
+        }
+        this->size = file_stats.st_size;
+        // mmap does not accept a length of 0, so an empty file simply has no mapping
+        if (this->size == 0)
+        {
+            return;
+        }
+        void *mapping = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, this->file_descriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close(this->file_descriptor);
+            throw MyException("Mapping the file failed: " + filename);
+        }
+        this->data = static_cast<char *>(mapping);
+        madvise(this->data, this->size, advice);
+        if (expand_containers && is_frame_container(this->contents()))
+        {
+            this->expand_container(filename);
+        }
+    }
+
+    ~MappedFile()
+    {
+        if (this->data != nullptr)
+        {
+            munmap(this->data, this->size);
+        }
+        if (this->file_descriptor >= 0)
+        {
+            close(this->file_descriptor);
+        }
+    }
+
+private:
+    // Replaces the mapping of a container by an anonymous mapping of its decompressed contents
+    void expand_container(const std::string &filename)
+    {
+        char *container_data = this->data;
+        std::size_t container_size = this->size;
+        this->data = nullptr;
+        this->size = 0;
+        close(this->file_descriptor);
+        this->file_descriptor = -1;
+        try
+        {
+            FrameContainer container(std::string_view(container_data, container_size), filename);
+            if (container.size() > 0)
+            {
+                void *mapping = mmap(nullptr, container.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (mapping == MAP_FAILED)
+                {
+                    throw MyException("Allocating " + std::to_string(container.size()) + " bytes to decompress " + filename + " failed");
+                }
+                this->data = static_cast<char *>(mapping);
+                this->size = container.size();
+                container.decompress_all(this->data, std::thread::hardware_concurrency());
+                mprotect(this->data, this->size, PROT_READ);
+            }
+        }
+        catch (...)
+        {
+            munmap(container_data, container_size);
+            if (this->data != nullptr)
+            {
+                munmap(this->data, this->size);
+            }
+            throw;
+        }
+        munmap(container_data, container_size);
+    }
+
+public:
+    std::string_view contents() const
+    {
+        return std::string_view(this->data, this->size);
+    }
+
+    // Only regular files can be mapped, e.g. a named pipe has to be read as a stream instead
+    static bool is_mappable(const std::string &filename)
+    {
+        struct stat file_stats;
+        if (stat(filename.c_str(), &file_stats) != 0)
+        {
+            return false;
+        }
+        return S_ISREG(file_stats.st_mode);
+    }
+};
+
+// Hands out the lines of a buffer as views into that buffer. The line break characters are not included.
+class LineScanner
+{
+private:
+    std::string_view buffer;
+    std::size_t position;
+
+public:
+    explicit LineScanner(std::string_view buffer) : buffer(buffer), position(0)
+    {
+    }
+
+    bool next_line(std::string_view &line)
+    {
+        if (this->position >= this->buffer.size())
+        {
+            return false;
+        }
+        const char *start = this->buffer.data() + this->position;
+        std::size_t remaining = this->buffer.size() - this->position;
+        const char *line_break = static_cast<const char *>(std::memchr(start, '\n', remaining));
+        std::size_t line_length = line_break == nullptr ? remaining : std::size_t(line_break - start);
+        line = std::string_view(start, line_length);
+        this->position += line_length + 1;
+        return true;
+    }
+
+    // The part of the buffer that has not been scanned yet
+    std::string_view remainder() const
+    {
+        if (this->position >= this->buffer.size())
+        {
+            return std::string_view();
+        }
+        return this->buffer.substr(this->position);
+    }
+};
+
+// Removes leading and trailing whitespace from a view, like boost::trim does for strings
+inline std::string_view trim_view(std::string_view line)
+{
+    const char *whitespace = " \t\n\v\f\r";
+    std::size_t first = line.find_first_not_of(whitespace);
+    if (first == std::string_view::npos)
+    {
+        return std::string_view();
+    }
+    std::size_t last = line.find_last_not_of(whitespace);
+    return line.substr(first, last - first + 1);
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <boost/container_hash/hash.hpp>
+#include <boost/unordered/unordered_flat_map.hpp>
+
+#include "my_exception.hpp"
+
+// An append-only store for strings. The strings are packed back to back in large blocks, such that a string costs no more than its own bytes.
+// A stored string is referred to by a 64-bit handle: the lower 24 bits hold its length and the upper 40 bits hold its offset in the arena.
+class StringArena
+{
+private:
+    static constexpr unsigned int BLOCK_BITS = 26;  // 64 MiB blocks
+    static constexpr std::size_t BLOCK_SIZE = std::size_t(1) << BLOCK_BITS;
+    static constexpr unsigned int LENGTH_BITS = 24;
+    static constexpr uint64_t LENGTH_MASK = (uint64_t(1) << LENGTH_BITS) - 1;
+    static constexpr uint64_t MAX_OFFSET = (uint64_t(1) << (64 - LENGTH_BITS)) - 1;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t used_in_last_block;
+
+    StringArena(const StringArena &) = delete;
+    StringArena &operator=(const StringArena &) = delete;
+
+public:
+    using handle = uint64_t;
+
+    StringArena() : used_in_last_block(BLOCK_SIZE)
+    {
+    }
+
+    handle append(std::string_view str)
+    {
+        if (str.size() > LENGTH_MASK)
+        {
+            throw MyException("A string of " + std::to_string(str.size()) + " bytes is too long to be stored in the StringArena");
+        }
+        // Strings never span two blocks, so the views into the blocks stay contiguous
+        if (this->used_in_last_block + str.size() > BLOCK_SIZE)
+        {
+            this->blocks.push_back(std::unique_ptr<char[]>(new char[BLOCK_SIZE]));  // Not value-initialized, such that untouched pages are never faulted in
+            this->used_in_last_block = 0;
+        }
+        uint64_t offset = ((this->blocks.size() - 1) << BLOCK_BITS) + this->used_in_last_block;
+        if (offset > MAX_OFFSET)
+        {
+            throw MyException("The StringArena has run out of addressable space");
+        }
+        std::memcpy(this->blocks.back().get() + this->used_in_last_block, str.data(), str.size());
+        this->used_in_last_block += str.size();
+        return (offset << LENGTH_BITS) | str.size();
+    }
+
+    std::string_view view(handle h) const
+    {
+        uint64_t offset = h >> LENGTH_BITS;
+        return std::string_view(this->blocks[offset >> BLOCK_BITS].get() + (offset & (BLOCK_SIZE - 1)), h & LENGTH_MASK);
+    }
+
+    // The number of bytes allocated for the blocks
+    std::size_t capacity() const
+    {
+        return this->blocks.size() * BLOCK_SIZE;
+    }
+};
+
+// A hash map from strings to values in which the keys are interned in a StringArena.
+// The table itself only holds (handle, value) pairs, and lookups take a std::string_view, so no std::string is ever created.
+template <typename T>
+class ArenaStringMap
+{
+private:
+    // The hash and equality functions resolve handles through the arena. They accept both handles and views, which allows heterogeneous lookup.
+    struct KeyHash
+    {
+        using is_transparent = void;
+        const StringArena *arena;
+
+        std::size_t operator()(std::string_view key) const
+        {
+            return boost::hash<std::string_view>()(key);
+        }
+        std::size_t operator()(StringArena::handle key) const
+        {
+            return (*this)(this->arena->view(key));
+        }
+    };
+
+    struct KeyEqual
+    {
+        using is_transparent = void;
+        const StringArena *arena;
+
+        std::string_view resolve(std::string_view key) const
+        {
+            return key;
+        }
+        std::string_view resolve(StringArena::handle key) const
+        {
+            return this->arena->view(key);
+        }
+        template <typename A, typename B>
+        bool operator()(const A &a, const B &b) const
+        {
+            return this->resolve(a) == this->resolve(b);
+        }
+    };
+
+    StringArena arena;
+    boost::unordered_flat_map<StringArena::handle, T, KeyHash, KeyEqual> mapping;
+
+    ArenaStringMap(const ArenaStringMap &) = delete;
+    ArenaStringMap &operator=(const ArenaStringMap &) = delete;
+
+public:
+    explicit ArenaStringMap(std::size_t expected_size = 0) : mapping(expected_size, KeyHash{&arena}, KeyEqual{&arena})
+    {
+    }
+
+    // Returns a pointer to the value for the key, or nullptr if the key is not present
+    const T *find(std::string_view key) const
+    {
+        auto result = this->mapping.find(key);
+        if (result == this->mapping.end())
+        {
+            return nullptr;
+        }
+        return &result->second;
+    }
+
+    // Only call this for keys that are not present yet
+    void insert(std::string_view key, T value)
+    {
+        this->mapping.emplace(this->arena.append(key), value);
+    }
+
+    std::size_t size() const
+    {
+        return this->mapping.size();
+    }
+
+    void reserve(std::size_t expected_size)
+    {
+        this->mapping.reserve(expected_size);
+    }
+
+    // Calls `visit(key, value)` for every entry, in hash table order
+    template <typename Visitor>
+    void for_each(Visitor &&visit) const
+    {
+        for (auto a = this->mapping.cbegin(); a != this->mapping.cend(); a++)
+        {
+            visit(this->arena.view(a->first), a->second);
+        }
+    }
+};
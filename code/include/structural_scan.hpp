@@ -0,0 +1,85 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+// Finds the structural characters of an n-triples line (`<`, `>`, `"`, `_` and spaces) a whole block at a time.
+// The instruction set is picked at compile time (we compile with -march=native): AVX2 handles 32 bytes per block, SSE4.2 handles 16 and the scalar fallback handles 64.
+// Escape characters are not included, since a quote is only checked for being escaped once it is found.
+
+#if defined(__AVX2__)
+inline constexpr std::size_t STRUCTURAL_BLOCK_SIZE = 32;
+using structural_mask_t = uint32_t;
+
+inline structural_mask_t structural_mask(const char *block)
+{
+    const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+    __m256i matches = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('<'));
+    matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(input, _mm256_set1_epi8('>')));
+    matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(input, _mm256_set1_epi8('"')));
+    matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(input, _mm256_set1_epi8('_')));
+    matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(input, _mm256_set1_epi8(' ')));
+    return structural_mask_t(_mm256_movemask_epi8(matches));
+}
+#elif defined(__SSE4_2__)
+inline constexpr std::size_t STRUCTURAL_BLOCK_SIZE = 16;
+using structural_mask_t = uint32_t;
+
+inline structural_mask_t structural_mask(const char *block)
+{
+    const __m128i structural_characters = _mm_setr_epi8('<', '>', '"', '_', ' ', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+    // Explicit lengths are used, such that zero bytes in the input do not end the comparison
+    const __m128i matches = _mm_cmpestrm(structural_characters, 5, input, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK);
+    return structural_mask_t(_mm_cvtsi128_si32(matches)) & 0xFFFF;
+}
+#else
+inline constexpr std::size_t STRUCTURAL_BLOCK_SIZE = 64;
+using structural_mask_t = uint64_t;
+
+inline structural_mask_t structural_mask(const char *block)
+{
+    structural_mask_t mask = 0;
+    for (std::size_t i = 0; i < STRUCTURAL_BLOCK_SIZE; i++)
+    {
+        const char c = block[i];
+        const bool structural = c == '<' || c == '>' || c == '"' || c == '_' || c == ' ';
+        mask |= structural_mask_t(structural) << i;
+    }
+    return mask;
+}
+#endif
+
+// Calls `visit` with an iterator to every structural character in `buffer`, in order.
+// The final partial block is copied into a padded block, so we never read beyond the end of the buffer (which may be the end of a mapped file).
+template <typename Visitor>
+inline void for_each_structural_character(std::string_view buffer, Visitor &&visit)
+{
+    const std::size_t size = buffer.size();
+    std::size_t offset = 0;
+    for (; offset + STRUCTURAL_BLOCK_SIZE <= size; offset += STRUCTURAL_BLOCK_SIZE)
+    {
+        structural_mask_t mask = structural_mask(buffer.data() + offset);
+        while (mask != 0)
+        {
+            visit(buffer.begin() + offset + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+    if (offset < size)
+    {
+        // The padding is zero, which is not a structural character
+        char padded_block[STRUCTURAL_BLOCK_SIZE] = {};
+        std::memcpy(padded_block, buffer.data() + offset, size - offset);
+        structural_mask_t mask = structural_mask(padded_block);
+        while (mask != 0)
+        {
+            visit(buffer.begin() + offset + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+}
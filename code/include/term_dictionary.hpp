@@ -0,0 +1,361 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "my_exception.hpp"
+#include "mapped_file.hpp"
+#include "iri_prefixes.hpp"
+#include "varint.hpp"
+
+// A binary dictionary between terms and their dense IDs, as an alternative to the "term id" lines of entity2ID.txt and rel2ID.txt.
+// The terms are stored in sorted order in a front-coded heap: every bucket of TERMS_PER_BUCKET terms starts with a complete term,
+// and every following term only stores the length of the prefix it shares with its predecessor plus the rest of its bytes.
+// The complete term at the start of a bucket is stored as (prefix ID, local name), where the prefixes are the namespaces of the terms (see iri_prefixes.hpp).
+// Two arrays map between the IDs and the ranks of the terms in sorted order, so a reader can map the file and
+//  - resolve an ID by decoding at most one bucket, and
+//  - find the ID of a term with a binary search over the first terms of the buckets.
+//
+// Layout (native byte order):
+//   TermDictionaryHeader
+//   the heap, padded to a multiple of 8 bytes
+//   the prefix heap, padded to a multiple of 8 bytes
+//   uint64_t prefix_offsets[prefix_count + 1]   (relative to the start of the prefix heap)
+//   uint64_t bucket_offsets[bucket_count + 1]   (relative to the start of the heap)
+//   uint64_t rank_to_id[term_count]
+//   uint64_t id_to_rank[term_count]
+// The first term of a bucket is a varint that is 0 for a term without a prefix or the prefix ID plus 1 otherwise, followed by the length and the bytes of the rest.
+// All lengths are unsigned LEB128 varints.
+struct TermDictionaryHeader
+{
+    static constexpr char MAGIC[8] = {'T', 'E', 'R', 'M', 'D', 'I', 'C', 'T'};
+    static constexpr uint32_t VERSION = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t terms_per_bucket;
+    uint64_t term_count;
+    uint64_t heap_offset;
+    uint64_t heap_size;
+    uint64_t bucket_offsets_offset;
+    uint64_t rank_to_id_offset;
+    uint64_t id_to_rank_offset;
+    uint64_t prefix_count;
+    uint64_t prefix_heap_offset;
+    uint64_t prefix_offsets_offset;
+};
+
+namespace term_dictionary_detail
+{
+    inline constexpr uint32_t TERMS_PER_BUCKET = 16;
+    inline constexpr std::size_t MAX_PREFIXES = 1 << 16;
+
+    inline std::size_t padding(std::size_t bytes)
+    {
+        return (8 - bytes % 8) % 8;
+    }
+}
+
+// Writes a dictionary from terms that are added in sorted order. Only the heap of the current bucket and the ID arrays are kept in memory.
+// The IDs must be dense, i.e. every ID below the number of terms occurs exactly once.
+class TermDictionaryWriter
+{
+private:
+    std::string filename;
+    std::ofstream out;
+    std::string bucket;
+    std::string previous_term;
+    std::vector<uint64_t> bucket_offsets;
+    std::vector<uint64_t> rank_to_id;
+    uint64_t heap_size;
+    // Since the terms are sorted, the terms of a namespace follow each other, and a namespace gets an ID as soon as it starts a bucket
+    PrefixTable prefixes;
+
+    void flush_bucket()
+    {
+        this->out.write(this->bucket.data(), this->bucket.size());
+        this->heap_size += this->bucket.size();
+        this->bucket.clear();
+    }
+
+    template <typename T>
+    void write_array(const std::vector<T> &values)
+    {
+        this->out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+    }
+
+public:
+    explicit TermDictionaryWriter(const std::string &filename) : filename(filename), out(filename, std::ios::trunc | std::ios::binary), heap_size(0)
+    {
+        if (!this->out.is_open())
+        {
+            throw MyException("Opening the dictionary to write failed: " + filename);
+        }
+        // The header is written last, once all offsets are known
+        TermDictionaryHeader header{};
+        this->out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    void add(std::string_view term, uint64_t id)
+    {
+        using namespace term_dictionary_detail;
+        uint64_t rank = this->rank_to_id.size();
+        if (rank > 0 && term <= std::string_view(this->previous_term))
+        {
+            throw MyException("The terms of a dictionary must be added in strictly increasing order, but \"" + std::string(term) + "\" follows \"" + this->previous_term + "\"");
+        }
+        if (rank % TERMS_PER_BUCKET == 0)
+        {
+            this->flush_bucket();
+            this->bucket_offsets.push_back(this->heap_size);
+            std::size_t split = namespace_length(term);
+            std::optional<uint32_t> prefix_id;
+            if (split >= MIN_PREFIX_LENGTH)
+            {
+                prefix_id = this->prefixes.find(term.substr(0, split));
+                if (!prefix_id && this->prefixes.size() < MAX_PREFIXES)
+                {
+                    prefix_id = this->prefixes.add(term.substr(0, split));
+                }
+            }
+            std::string_view rest = prefix_id ? term.substr(split) : term;
+            write_varint(this->bucket, prefix_id ? uint64_t(*prefix_id) + 1 : 0);
+            write_varint(this->bucket, rest.size());
+            this->bucket.append(rest);
+        }
+        else
+        {
+            std::size_t shared = std::mismatch(term.begin(), term.end(), this->previous_term.begin(), this->previous_term.end()).first - term.begin();
+            write_varint(this->bucket, shared);
+            write_varint(this->bucket, term.size() - shared);
+            this->bucket.append(term.substr(shared));
+        }
+        this->previous_term.assign(term);
+        this->rank_to_id.push_back(id);
+    }
+
+    void close()
+    {
+        this->flush_bucket();
+        this->bucket_offsets.push_back(this->heap_size);
+        const char zeros[8] = {};
+        this->out.write(zeros, term_dictionary_detail::padding(this->heap_size));
+
+        std::vector<uint64_t> prefix_offsets(1, 0);
+        for (std::size_t prefix_id = 0; prefix_id < this->prefixes.size(); prefix_id++)
+        {
+            std::string_view prefix = this->prefixes.prefix(prefix_id);
+            this->out.write(prefix.data(), prefix.size());
+            prefix_offsets.push_back(prefix_offsets.back() + prefix.size());
+        }
+        uint64_t prefix_heap_size = prefix_offsets.back();
+        this->out.write(zeros, term_dictionary_detail::padding(prefix_heap_size));
+
+        uint64_t term_count = this->rank_to_id.size();
+        std::vector<uint64_t> id_to_rank(term_count, UINT64_MAX);
+        for (uint64_t rank = 0; rank < term_count; rank++)
+        {
+            uint64_t id = this->rank_to_id[rank];
+            if (id >= term_count || id_to_rank[id] != UINT64_MAX)
+            {
+                throw MyException("The IDs in the dictionary " + this->filename + " are not dense, ID " + std::to_string(id) + " is out of range or occurs twice");
+            }
+            id_to_rank[id] = rank;
+        }
+
+        TermDictionaryHeader header{};
+        std::memcpy(header.magic, TermDictionaryHeader::MAGIC, sizeof(header.magic));
+        header.version = TermDictionaryHeader::VERSION;
+        header.terms_per_bucket = term_dictionary_detail::TERMS_PER_BUCKET;
+        header.term_count = term_count;
+        header.heap_offset = sizeof(TermDictionaryHeader);
+        header.heap_size = this->heap_size;
+        header.prefix_count = this->prefixes.size();
+        header.prefix_heap_offset = header.heap_offset + this->heap_size + term_dictionary_detail::padding(this->heap_size);
+        header.prefix_offsets_offset = header.prefix_heap_offset + prefix_heap_size + term_dictionary_detail::padding(prefix_heap_size);
+        header.bucket_offsets_offset = header.prefix_offsets_offset + prefix_offsets.size() * sizeof(uint64_t);
+        header.rank_to_id_offset = header.bucket_offsets_offset + this->bucket_offsets.size() * sizeof(uint64_t);
+        header.id_to_rank_offset = header.rank_to_id_offset + term_count * sizeof(uint64_t);
+
+        this->write_array(prefix_offsets);
+        this->write_array(this->bucket_offsets);
+        this->write_array(this->rank_to_id);
+        this->write_array(id_to_rank);
+        this->out.seekp(0);
+        this->out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        this->out.close();
+        if (this->out.fail())
+        {
+            throw MyException("Writing the dictionary " + this->filename + " failed, the disk might be full");
+        }
+    }
+};
+
+// A read-only view of a dictionary written by the TermDictionaryWriter. The file is mapped, so only the parts that are used are read from disk.
+class TermDictionary
+{
+private:
+    MappedFile file;
+    TermDictionaryHeader header;
+    const char *heap;
+    const char *prefix_heap;
+    std::span<const uint64_t> prefix_offsets;
+    std::span<const uint64_t> bucket_offsets;
+    std::span<const uint64_t> rank_to_id;
+    std::span<const uint64_t> id_to_rank;
+
+    template <typename T>
+    std::span<const T> array_at(uint64_t offset, uint64_t count) const
+    {
+        if (offset + count * sizeof(T) > this->file.contents().size())
+        {
+            throw MyException("The dictionary is shorter than its header says");
+        }
+        return std::span<const T>(reinterpret_cast<const T *>(this->file.contents().data() + offset), count);
+    }
+
+    // Returns the prefix and the rest of the first term of a bucket, and advances `position` past it
+    std::pair<std::string_view, std::string_view> first_term(const char *&position) const
+    {
+        uint64_t prefix_id = read_varint(position);
+        uint64_t length = read_varint(position);
+        std::string_view rest(position, length);
+        position += length;
+        if (prefix_id == 0)
+        {
+            return {std::string_view(), rest};
+        }
+        uint64_t begin = this->prefix_offsets[prefix_id - 1];
+        return {std::string_view(this->prefix_heap + begin, this->prefix_offsets[prefix_id] - begin), rest};
+    }
+
+    // Calls `visit(rank, term)` for the terms of a bucket, until it returns false
+    template <typename Visitor>
+    void decode_bucket(uint64_t bucket, Visitor &&visit) const
+    {
+        const char *position = this->heap + this->bucket_offsets[bucket];
+        const char *end = this->heap + this->bucket_offsets[bucket + 1];
+        auto [prefix, rest] = this->first_term(position);
+        std::string term;
+        term.reserve(prefix.size() + rest.size());
+        term.append(prefix).append(rest);
+        for (uint64_t rank = bucket * this->header.terms_per_bucket;; rank++)
+        {
+            if (!visit(rank, std::string_view(term)) || position == end)
+            {
+                return;
+            }
+            uint64_t shared = read_varint(position);
+            uint64_t suffix = read_varint(position);
+            term.resize(shared);
+            term.append(position, suffix);
+            position += suffix;
+        }
+    }
+
+public:
+    explicit TermDictionary(const std::string &filename) : file(filename, MADV_RANDOM)
+    {
+        std::string_view contents = this->file.contents();
+        if (contents.size() < sizeof(TermDictionaryHeader))
+        {
+            throw MyException("The dictionary " + filename + " is too short to hold a header");
+        }
+        std::memcpy(&this->header, contents.data(), sizeof(TermDictionaryHeader));
+        if (std::memcmp(this->header.magic, TermDictionaryHeader::MAGIC, sizeof(this->header.magic)) != 0)
+        {
+            throw MyException(filename + " is not a binary dictionary");
+        }
+        if (this->header.version != TermDictionaryHeader::VERSION)
+        {
+            throw MyException("The dictionary " + filename + " has version " + std::to_string(this->header.version) + ", but version " + std::to_string(TermDictionaryHeader::VERSION) + " is expected");
+        }
+        uint64_t bucket_count = (this->header.term_count + this->header.terms_per_bucket - 1) / this->header.terms_per_bucket;
+        this->heap = contents.data() + this->header.heap_offset;
+        this->prefix_heap = contents.data() + this->header.prefix_heap_offset;
+        this->prefix_offsets = this->array_at<uint64_t>(this->header.prefix_offsets_offset, this->header.prefix_count + 1);
+        this->bucket_offsets = this->array_at<uint64_t>(this->header.bucket_offsets_offset, bucket_count + 1);
+        this->rank_to_id = this->array_at<uint64_t>(this->header.rank_to_id_offset, this->header.term_count);
+        this->id_to_rank = this->array_at<uint64_t>(this->header.id_to_rank_offset, this->header.term_count);
+    }
+
+    uint64_t size() const
+    {
+        return this->header.term_count;
+    }
+
+    std::string term(uint64_t id) const
+    {
+        if (id >= this->header.term_count)
+        {
+            throw MyException("The ID " + std::to_string(id) + " is not in the dictionary of " + std::to_string(this->header.term_count) + " terms");
+        }
+        uint64_t rank = this->id_to_rank[id];
+        std::string result;
+        this->decode_bucket(rank / this->header.terms_per_bucket, [&](uint64_t current_rank, std::string_view current_term)
+        {
+            if (current_rank == rank)
+            {
+                result.assign(current_term);
+                return false;
+            }
+            return true;
+        });
+        return result;
+    }
+
+    std::optional<uint64_t> find(std::string_view term) const
+    {
+        if (this->header.term_count == 0)
+        {
+            return std::nullopt;
+        }
+        // Find the last bucket whose first term is not larger than the term
+        uint64_t low = 0;
+        uint64_t high = this->bucket_offsets.size() - 1;
+        while (high - low > 1)
+        {
+            uint64_t middle = low + (high - low) / 2;
+            const char *position = this->heap + this->bucket_offsets[middle];
+            auto [prefix, rest] = this->first_term(position);
+            if (compare_concatenations(prefix, rest, term, std::string_view()) <= 0)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        std::optional<uint64_t> result;
+        this->decode_bucket(low, [&](uint64_t rank, std::string_view current_term)
+        {
+            if (current_term == term)
+            {
+                result = this->rank_to_id[rank];
+            }
+            return current_term < term;
+        });
+        return result;
+    }
+
+    // Calls `visit(term, id)` for every term, in sorted order of the terms
+    template <typename Visitor>
+    void for_each(Visitor &&visit) const
+    {
+        for (uint64_t bucket = 0; bucket + 1 < this->bucket_offsets.size(); bucket++)
+        {
+            this->decode_bucket(bucket, [&](uint64_t rank, std::string_view current_term)
+            {
+                visit(current_term, this->rank_to_id[rank]);
+                return true;
+            });
+        }
+    }
+};
@@ -0,0 +1,808 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include <boost/unordered/unordered_flat_map.hpp>
+
+#include "my_exception.hpp"
+
+// The input of the TurtleParser: either a complete buffer (e.g. a mapped file) or a stream that is read block by block.
+// Only a few characters of lookahead are needed, so a stream is never held in memory as a whole.
+class TurtleInput
+{
+private:
+    static constexpr std::size_t BLOCK_SIZE = 1 << 20;
+
+    std::istream *stream;
+    std::unique_ptr<char[]> storage;
+    const char *current;
+    const char *end;
+    unsigned long line;
+
+    // Makes sure that at least `count` characters are available, unless the input ends before that
+    bool ensure(std::size_t count)
+    {
+        if (std::size_t(this->end - this->current) >= count)
+        {
+            return true;
+        }
+        if (this->stream == nullptr || !*this->stream)
+        {
+            return false;
+        }
+        // Keep the characters that were not consumed yet at the front of the block
+        std::size_t left = this->end - this->current;
+        std::memmove(this->storage.get(), this->current, left);
+        this->stream->read(this->storage.get() + left, BLOCK_SIZE - left);
+        this->current = this->storage.get();
+        this->end = this->storage.get() + left + this->stream->gcount();
+        return std::size_t(this->end - this->current) >= count;
+    }
+
+public:
+    explicit TurtleInput(std::string_view contents)
+        : stream(nullptr), current(contents.data()), end(contents.data() + contents.size()), line(1)
+    {
+    }
+
+    explicit TurtleInput(std::istream &stream)
+        : stream(&stream), storage(new char[BLOCK_SIZE]), current(storage.get()), end(storage.get()), line(1)
+    {
+    }
+
+    // Returns the character `offset` positions ahead without consuming anything, or EOF
+    int peek(std::size_t offset = 0)
+    {
+        if (!this->ensure(offset + 1))
+        {
+            return EOF;
+        }
+        return static_cast<unsigned char>(this->current[offset]);
+    }
+
+    int get()
+    {
+        int c = this->peek();
+        if (c != EOF)
+        {
+            this->current++;
+            if (c == '\n')
+            {
+                this->line++;
+            }
+        }
+        return c;
+    }
+
+    // Appends characters to `out` for as long as `accept` holds for them, and returns the first character that is not accepted (without consuming it), or EOF.
+    // This scans the buffered block directly, which avoids the overhead of `get` for the long runs of characters in IRIs and names.
+    template <typename Predicate>
+    int read_while(std::string &out, Predicate &&accept)
+    {
+        while (true)
+        {
+            const char *start = this->current;
+            const char *position = start;
+            while (position != this->end && accept(static_cast<unsigned char>(*position)))
+            {
+                position++;
+            }
+            out.append(start, position);
+            this->line += std::count(start, position, '\n');
+            this->current = position;
+            if (position != this->end)
+            {
+                return static_cast<unsigned char>(*position);
+            }
+            if (!this->ensure(1))
+            {
+                return EOF;
+            }
+        }
+    }
+
+    unsigned long line_number() const
+    {
+        return this->line;
+    }
+
+    bool bad() const
+    {
+        return this->stream != nullptr && this->stream->bad();
+    }
+};
+
+// A streaming parser for Turtle. It supports prefixes and a base (both the @-forms and the SPARQL forms), `;` and `,` lists, `a`,
+// blank node property lists, collections, and string, numeric and boolean literals.
+// Every triple is passed to the visitor in n-triples syntax: IRIs as "<iri>", blank nodes as "_:label" and literals as "\"lexical form\"".
+// The datatype and language tag of a literal are dropped, and escape sequences are kept as they are, since the preprocessor does not look at them.
+// Relative IRIs are resolved against the base as in section 5.2 of RFC 3986, including the removal of dot segments. Absolute IRIs are kept as they are.
+// Blank nodes without a label get a generated label that starts with '#', which a label in the input can not contain, so they never merge with a labeled blank node.
+// The labels also contain the scope given to the constructor, such that the blank nodes of different inputs (e.g. of an appended file) can be kept apart.
+class TurtleParser
+{
+private:
+    static constexpr std::string_view RDF_NAMESPACE = "http://www.w3.org/1999/02/22-rdf-syntax-ns#";
+    static constexpr std::string_view XSD_NAMESPACE = "http://www.w3.org/2001/XMLSchema#";
+
+    TurtleInput &input;
+    boost::unordered_flat_map<std::string, std::string> prefixes;
+    std::string base;
+    unsigned long blank_node_scope;
+    unsigned long blank_node_counter;
+
+    [[noreturn]] void fail(const std::string &expected)
+    {
+        int c = this->input.peek();
+        std::string found = c == EOF ? "the end of the input" : "'" + std::string(1, char(c)) + "'";
+        throw MyException("Turtle syntax error on line " + std::to_string(this->input.line_number()) + ": expected " + expected + ", but found " + found);
+    }
+
+    void skip_whitespace()
+    {
+        while (true)
+        {
+            int c = this->input.peek();
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            {
+                this->input.get();
+            }
+            else if (c == '#')
+            {
+                while (c != EOF && c != '\n')
+                {
+                    c = this->input.get();
+                }
+            }
+            else
+            {
+                return;
+            }
+        }
+    }
+
+    void expect(char expected)
+    {
+        this->skip_whitespace();
+        if (this->input.peek() != expected)
+        {
+            this->fail("'" + std::string(1, expected) + "'");
+        }
+        this->input.get();
+    }
+
+    static bool is_name_character(int c)
+    {
+        return std::isalnum(c) || c == '_' || c == '-' || c == ':' || c == '%' || c == '\\' || c >= 0x80;
+    }
+
+    std::string new_blank_node()
+    {
+        return "_:#genid" + std::to_string(this->blank_node_scope) + "_" + std::to_string(this->blank_node_counter++);
+    }
+
+    // The components of an IRI reference (section 3 of RFC 3986). A component that is absent differs from one that is empty, e.g. "a?" has an empty query.
+    struct IRIParts
+    {
+        std::string_view scheme;
+        bool has_authority = false;
+        std::string_view authority;
+        std::string_view path;
+        bool has_query = false;
+        std::string_view query;
+        bool has_fragment = false;
+        std::string_view fragment;
+    };
+
+    static bool has_scheme(std::string_view iri)
+    {
+        std::size_t scheme_end = iri.find(':');
+        return scheme_end != std::string_view::npos && scheme_end > 0 && std::isalpha(static_cast<unsigned char>(iri[0]))
+               && iri.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789+-.") == scheme_end;
+    }
+
+    static IRIParts split_IRI(std::string_view iri)
+    {
+        IRIParts parts;
+        std::size_t fragment_start = iri.find('#');
+        if (fragment_start != std::string_view::npos)
+        {
+            parts.has_fragment = true;
+            parts.fragment = iri.substr(fragment_start + 1);
+            iri = iri.substr(0, fragment_start);
+        }
+        std::size_t query_start = iri.find('?');
+        if (query_start != std::string_view::npos)
+        {
+            parts.has_query = true;
+            parts.query = iri.substr(query_start + 1);
+            iri = iri.substr(0, query_start);
+        }
+        if (has_scheme(iri))
+        {
+            std::size_t scheme_end = iri.find(':');
+            parts.scheme = iri.substr(0, scheme_end);
+            iri = iri.substr(scheme_end + 1);
+        }
+        if (iri.substr(0, 2) == "//")
+        {
+            std::size_t authority_end = std::min(iri.find('/', 2), iri.size());
+            parts.has_authority = true;
+            parts.authority = iri.substr(2, authority_end - 2);
+            iri = iri.substr(authority_end);
+        }
+        parts.path = iri;
+        return parts;
+    }
+
+    // Removes the "." and ".." segments from a path (section 5.2.4 of RFC 3986)
+    static std::string remove_dot_segments(std::string_view input)
+    {
+        std::string output;
+        while (!input.empty())
+        {
+            if (input.substr(0, 3) == "../")
+            {
+                input.remove_prefix(3);
+            }
+            else if (input.substr(0, 2) == "./")
+            {
+                input.remove_prefix(2);
+            }
+            else if (input.substr(0, 3) == "/./")
+            {
+                input.remove_prefix(2);
+            }
+            else if (input == "/.")
+            {
+                input = "/";
+            }
+            else if (input.substr(0, 4) == "/../" || input == "/..")
+            {
+                input = input.size() == 3 ? std::string_view("/") : input.substr(3);
+                std::size_t last_segment = output.rfind('/');
+                output.erase(last_segment == std::string::npos ? 0 : last_segment);
+            }
+            else if (input == "." || input == "..")
+            {
+                input = std::string_view();
+            }
+            else
+            {
+                // Move the first segment, including its leading slash (if any), to the output
+                std::size_t segment_end = std::min(input.find('/', 1), input.size());
+                output.append(input.substr(0, segment_end));
+                input.remove_prefix(segment_end);
+            }
+        }
+        return output;
+    }
+
+    // Resolves an IRI reference against the base (section 5.2.2 of RFC 3986). An IRI with a scheme is absolute and kept as it is.
+    std::string resolve(const std::string &iri) const
+    {
+        if (this->base.empty() || has_scheme(iri.substr(0, iri.find_first_of("?#"))))
+        {
+            return iri;
+        }
+        IRIParts reference = split_IRI(iri);
+        IRIParts base_parts = split_IRI(this->base);
+
+        IRIParts target;
+        std::string path;
+        target.scheme = base_parts.scheme;
+        if (reference.has_authority)
+        {
+            target.has_authority = true;
+            target.authority = reference.authority;
+            path = remove_dot_segments(reference.path);
+            target.has_query = reference.has_query;
+            target.query = reference.query;
+        }
+        else
+        {
+            target.has_authority = base_parts.has_authority;
+            target.authority = base_parts.authority;
+            if (reference.path.empty())
+            {
+                path = base_parts.path;
+                target.has_query = reference.has_query || base_parts.has_query;
+                target.query = reference.has_query ? reference.query : base_parts.query;
+            }
+            else
+            {
+                if (reference.path.front() == '/')
+                {
+                    path = remove_dot_segments(reference.path);
+                }
+                else if (base_parts.has_authority && base_parts.path.empty())
+                {
+                    path = remove_dot_segments("/" + std::string(reference.path));
+                }
+                else
+                {
+                    std::size_t last_slash = base_parts.path.rfind('/');
+                    std::string_view directory = last_slash == std::string_view::npos ? std::string_view() : base_parts.path.substr(0, last_slash + 1);
+                    path = remove_dot_segments(std::string(directory) + std::string(reference.path));
+                }
+                target.has_query = reference.has_query;
+                target.query = reference.query;
+            }
+        }
+
+        std::string result;
+        if (!target.scheme.empty())
+        {
+            result.append(target.scheme).push_back(':');
+        }
+        if (target.has_authority)
+        {
+            result.append("//").append(target.authority);
+        }
+        result.append(path);
+        if (target.has_query)
+        {
+            result.append("?").append(target.query);
+        }
+        if (reference.has_fragment)
+        {
+            result.append("#").append(reference.fragment);
+        }
+        return result;
+    }
+
+    // Reads "<...>" and returns the IRI between the angle brackets
+    std::string read_IRI_reference()
+    {
+        this->expect('<');
+        std::string iri;
+        int c = this->input.read_while(iri, [](int c) { return c != '>' && c != '\n' && c != ' '; });
+        if (c != '>')
+        {
+            this->fail("'>' to close the IRI");
+        }
+        this->input.get();
+        return iri;
+    }
+
+    // Reads a prefixed name, a blank node label or a keyword. Trailing dots are left alone, since they end the statement.
+    std::string read_name()
+    {
+        std::string name;
+        while (true)
+        {
+            int c = this->input.read_while(name, [](int c) { return c != '.' && c != '\\' && is_name_character(c); });
+            if (c == '.')
+            {
+                int next = this->input.peek(1);
+                if (!is_name_character(next) && next != '.')
+                {
+                    return name;
+                }
+            }
+            else if (!is_name_character(c))
+            {
+                return name;
+            }
+            this->input.get();
+            if (c == '\\')
+            {
+                // A local name escape such as "\-" stands for the character itself
+                c = this->input.get();
+                if (c == EOF)
+                {
+                    this->fail("an escaped character");
+                }
+            }
+            name.push_back(char(c));
+        }
+    }
+
+    std::string expand_prefixed_name(const std::string &name)
+    {
+        std::size_t colon = name.find(':');
+        if (colon == std::string::npos)
+        {
+            this->fail("a prefixed name instead of \"" + name + "\"");
+        }
+        auto prefix = this->prefixes.find(name.substr(0, colon));
+        if (prefix == this->prefixes.end())
+        {
+            throw MyException("Turtle syntax error on line " + std::to_string(this->input.line_number()) + ": the prefix \"" + name.substr(0, colon) + ":\" was not declared");
+        }
+        return "<" + prefix->second + name.substr(colon + 1) + ">";
+    }
+
+    // Reads an IRI, either "<...>" or a prefixed name, in n-triples syntax
+    std::string read_IRI()
+    {
+        this->skip_whitespace();
+        if (this->input.peek() == '<')
+        {
+            return "<" + this->resolve(this->read_IRI_reference()) + ">";
+        }
+        return this->expand_prefixed_name(this->read_name());
+    }
+
+    std::string read_string_literal()
+    {
+        char quote = char(this->input.get());
+        bool long_string = this->input.peek() == quote && this->input.peek(1) == quote;
+        if (long_string)
+        {
+            this->input.get();
+            this->input.get();
+        }
+        std::string literal = "\"";
+        // The closing quote directly follows the opening one for the empty string
+        bool closed = !long_string && this->input.peek() == quote;
+        if (closed)
+        {
+            this->input.get();
+        }
+        while (!closed)
+        {
+            int c = this->input.get();
+            if (c == EOF)
+            {
+                this->fail("the end of the string literal");
+            }
+            if (c == '\\')
+            {
+                literal.push_back('\\');
+                c = this->input.get();
+                if (c == EOF)
+                {
+                    this->fail("an escaped character");
+                }
+            }
+            else if (c == quote && (!long_string || (this->input.peek() == quote && this->input.peek(1) == quote)))
+            {
+                if (long_string)
+                {
+                    // A long string ends at the last three quotes of a run, so the quotes before them (at most two) are part of the content
+                    while (this->input.peek(2) == quote)
+                    {
+                        literal.push_back(char(c));
+                        this->input.get();
+                    }
+                    this->input.get();
+                    this->input.get();
+                }
+                closed = true;
+                continue;
+            }
+            else if (!long_string && (c == '\n' || c == '\r'))
+            {
+                this->fail("a closing quote before the end of the line");
+            }
+            literal.push_back(char(c));
+        }
+        literal.push_back('"');
+
+        // The language tag or datatype is parsed, but not kept
+        if (this->input.peek() == '@')
+        {
+            this->input.get();
+            while (std::isalnum(this->input.peek()) || this->input.peek() == '-')
+            {
+                this->input.get();
+            }
+        }
+        else if (this->input.peek() == '^' && this->input.peek(1) == '^')
+        {
+            this->input.get();
+            this->input.get();
+            this->read_IRI();
+        }
+        return literal;
+    }
+
+    std::string read_numeric_literal()
+    {
+        std::string number;
+        if (this->input.peek() == '+' || this->input.peek() == '-')
+        {
+            number.push_back(char(this->input.get()));
+        }
+        while (true)
+        {
+            int c = this->input.peek();
+            if (std::isdigit(c))
+            {
+                number.push_back(char(this->input.get()));
+            }
+            else if (c == '.' && std::isdigit(this->input.peek(1)))
+            {
+                // A dot that is not followed by a digit ends the statement
+                number.push_back(char(this->input.get()));
+            }
+            else if ((c == 'e' || c == 'E') && number.find_first_of("eE") == std::string::npos)
+            {
+                number.push_back(char(this->input.get()));
+                if (this->input.peek() == '+' || this->input.peek() == '-')
+                {
+                    number.push_back(char(this->input.get()));
+                }
+            }
+            else
+            {
+                break;
+            }
+        }
+        if (number.find_first_of("0123456789") == std::string::npos)
+        {
+            this->fail("a number");
+        }
+        return "\"" + number + "\"";
+    }
+
+    template <typename Visitor>
+    std::string read_collection(Visitor &&visit)
+    {
+        this->expect('(');
+        std::string head = "<" + std::string(RDF_NAMESPACE) + "nil>";
+        std::string previous;
+        const std::string first = "<" + std::string(RDF_NAMESPACE) + "first>";
+        const std::string rest = "<" + std::string(RDF_NAMESPACE) + "rest>";
+        while (true)
+        {
+            this->skip_whitespace();
+            if (this->input.peek() == ')')
+            {
+                this->input.get();
+                break;
+            }
+            std::string node = this->new_blank_node();
+            if (previous.empty())
+            {
+                head = node;
+            }
+            else
+            {
+                visit(std::string_view(previous), std::string_view(rest), std::string_view(node));
+            }
+            std::string element = this->read_object(visit);
+            visit(std::string_view(node), std::string_view(first), std::string_view(element));
+            previous = std::move(node);
+        }
+        if (!previous.empty())
+        {
+            std::string nil = "<" + std::string(RDF_NAMESPACE) + "nil>";
+            visit(std::string_view(previous), std::string_view(rest), std::string_view(nil));
+        }
+        return head;
+    }
+
+    // Reads "[ ... ]" and returns the blank node it stands for
+    template <typename Visitor>
+    std::string read_blank_node_property_list(Visitor &&visit)
+    {
+        this->expect('[');
+        std::string node = this->new_blank_node();
+        this->skip_whitespace();
+        if (this->input.peek() != ']')
+        {
+            this->read_predicate_object_list(node, visit);
+        }
+        this->expect(']');
+        return node;
+    }
+
+    template <typename Visitor>
+    std::string read_object(Visitor &&visit)
+    {
+        this->skip_whitespace();
+        int c = this->input.peek();
+        switch (c)
+        {
+        case '<':
+            return this->read_IRI();
+        case '"':
+        case '\'':
+            return this->read_string_literal();
+        case '[':
+            return this->read_blank_node_property_list(visit);
+        case '(':
+            return this->read_collection(visit);
+        case '_':
+            if (this->input.peek(1) == ':')
+            {
+                return this->read_name();
+            }
+            break;
+        case '+':
+        case '-':
+        case '.':
+        case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+            return this->read_numeric_literal();
+        default:
+            break;
+        }
+        std::string name = this->read_name();
+        if (name == "true" || name == "false")
+        {
+            return "\"" + name + "\"";
+        }
+        if (name.empty())
+        {
+            this->fail("an object");
+        }
+        return this->expand_prefixed_name(name);
+    }
+
+    std::string read_verb()
+    {
+        this->skip_whitespace();
+        if (this->input.peek() == 'a')
+        {
+            int next = this->input.peek(1);
+            if (next == ' ' || next == '\t' || next == '\r' || next == '\n' || next == '<' || next == '[' || next == '"' || next == '(' || next == '#')
+            {
+                this->input.get();
+                return "<" + std::string(RDF_NAMESPACE) + "type>";
+            }
+        }
+        return this->read_IRI();
+    }
+
+    template <typename Visitor>
+    void read_predicate_object_list(const std::string &subject, Visitor &&visit)
+    {
+        while (true)
+        {
+            std::string predicate = this->read_verb();
+            while (true)
+            {
+                std::string object = this->read_object(visit);
+                visit(std::string_view(subject), std::string_view(predicate), std::string_view(object));
+                this->skip_whitespace();
+                if (this->input.peek() != ',')
+                {
+                    break;
+                }
+                this->input.get();
+            }
+            // Any number of semicolons may follow, and the last one may be followed by the end of the list
+            bool separated = false;
+            while (this->input.peek() == ';')
+            {
+                this->input.get();
+                this->skip_whitespace();
+                separated = true;
+            }
+            int c = this->input.peek();
+            if (!separated || c == '.' || c == ']' || c == EOF)
+            {
+                return;
+            }
+        }
+    }
+
+    // Handles "@prefix", "@base", "PREFIX" and "BASE". Returns false if the statement is not a directive.
+    bool read_directive()
+    {
+        bool sparql_style = this->input.peek() != '@';
+        if (!sparql_style)
+        {
+            this->input.get();
+        }
+        std::string keyword;
+        for (std::size_t i = 0; std::isalpha(this->input.peek(i)); i++)
+        {
+            keyword.push_back(char(this->input.peek(i)));
+        }
+        bool is_prefix = boost::iequals(keyword, "prefix");
+        bool is_base = boost::iequals(keyword, "base");
+        if (!(is_prefix || is_base) || (!sparql_style && keyword != "prefix" && keyword != "base"))
+        {
+            if (!sparql_style)
+            {
+                this->fail("\"prefix\" or \"base\" after '@'");
+            }
+            return false;
+        }
+        // A SPARQL style keyword has to be followed by whitespace, otherwise it is the start of a prefixed name (such as "base:x")
+        int after_keyword = this->input.peek(keyword.size());
+        if (sparql_style && !(after_keyword == ' ' || after_keyword == '\t' || after_keyword == '\r' || after_keyword == '\n'))
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < keyword.size(); i++)
+        {
+            this->input.get();
+        }
+        if (is_prefix)
+        {
+            this->skip_whitespace();
+            std::string prefix = this->read_name();
+            if (prefix.empty() || prefix.back() != ':')
+            {
+                this->fail("a prefix ending in ':'");
+            }
+            prefix.pop_back();
+            this->prefixes[prefix] = this->resolve(this->read_IRI_reference());
+        }
+        else
+        {
+            this->base = this->resolve(this->read_IRI_reference());
+        }
+        if (!sparql_style)
+        {
+            this->expect('.');
+        }
+        return true;
+    }
+
+public:
+    // Blank nodes without a label are numbered within `blank_node_scope`, so parsers with different scopes never generate the same label
+    explicit TurtleParser(TurtleInput &input, unsigned long blank_node_scope = 0) : input(input), blank_node_scope(blank_node_scope), blank_node_counter(0)
+    {
+        // The xsd prefix is not predefined in Turtle, but it is used so often without a declaration that we accept it
+        this->prefixes["xsd"] = std::string(XSD_NAMESPACE);
+    }
+
+    // Calls `visit(subject, predicate, object)` for every triple, with the terms in n-triples syntax
+    template <typename Visitor>
+    void parse(Visitor &&visit)
+    {
+        while (true)
+        {
+            this->skip_whitespace();
+            int c = this->input.peek();
+            if (c == EOF)
+            {
+                return;
+            }
+            if ((c == '@' || c == 'p' || c == 'P' || c == 'b' || c == 'B') && this->read_directive())
+            {
+                continue;
+            }
+
+            std::string subject;
+            bool allows_empty_list = false;
+            switch (c)
+            {
+            case '<':
+                subject = this->read_IRI();
+                break;
+            case '[':
+                // A blank node property list may form a statement on its own
+                subject = this->read_blank_node_property_list(visit);
+                allows_empty_list = true;
+                break;
+            case '(':
+                subject = this->read_collection(visit);
+                break;
+            default:
+                subject = this->read_name();
+                if (subject.substr(0, 2) != "_:")
+                {
+                    if (subject.empty())
+                    {
+                        this->fail("a subject");
+                    }
+                    subject = this->expand_prefixed_name(subject);
+                }
+            }
+            this->skip_whitespace();
+            if (!(allows_empty_list && this->input.peek() == '.'))
+            {
+                this->read_predicate_object_list(subject, visit);
+            }
+            this->expect('.');
+        }
+    }
+
+    unsigned long line_number() const
+    {
+        return this->input.line_number();
+    }
+};
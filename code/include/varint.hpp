@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Unsigned LEB128 varints: 7 bits per byte, least significant group first, with the high bit set on every byte but the last
+
+inline void write_varint(std::string &out, uint64_t value)
+{
+    while (value >= 128)
+    {
+        out.push_back(char((value & 127) | 128));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+
+// Reads a varint and advances `position` past it
+inline uint64_t read_varint(const char *&position)
+{
+    uint64_t value = 0;
+    for (unsigned int shift = 0;; shift += 7)
+    {
+        uint8_t byte = uint8_t(*position++);
+        value |= uint64_t(byte & 127) << shift;
+        if (byte < 128)
+        {
+            return value;
+        }
+    }
+}
@@ -1,6 +1,8 @@
 import os
 import json
+import struct
 from collections import Counter
+from typing import Iterator
 
 BYTES_PER_ENTITY = 5
 BYTES_PER_PREDICATE = 4
@@ -8,6 +10,146 @@ BYTES_PER_BLOCK = 4
 BYTES_PER_BLOCK_OR_SINGLETON = 5
 BYTES_PER_K_TYPE = 2
 
+# The header at the start of every binary file of the pipeline (see code/include/file_header.hpp)
+FILE_HEADER_FORMAT = "<8sIBB4sHIQQQ"
+FILE_HEADER_BYTES = struct.calcsize(FILE_HEADER_FORMAT)
+FILE_HEADER_VERSION = 1
+TRIPLES = (1, (BYTES_PER_ENTITY, BYTES_PER_PREDICATE, BYTES_PER_ENTITY, 0))
+OUTCOME = (2, (BYTES_PER_BLOCK, BYTES_PER_ENTITY, BYTES_PER_ENTITY, 0))
+MAPPING = (3, (BYTES_PER_BLOCK, BYTES_PER_BLOCK, BYTES_PER_BLOCK, 0))
+SINGLETON_MAPPING = (
+    4,
+    (BYTES_PER_BLOCK, BYTES_PER_BLOCK_OR_SINGLETON, BYTES_PER_BLOCK_OR_SINGLETON, 0),
+)
+CONDENSED_EDGES = (
+    5,
+    (BYTES_PER_BLOCK_OR_SINGLETON, BYTES_PER_PREDICATE, BYTES_PER_BLOCK_OR_SINGLETON, 0),
+)
+INTERVALS = (6, (BYTES_PER_BLOCK_OR_SINGLETON, BYTES_PER_K_TYPE, BYTES_PER_K_TYPE, 0))
+LOCAL_GLOBAL_MAP = (
+    7,
+    (BYTES_PER_K_TYPE, BYTES_PER_BLOCK_OR_SINGLETON, BYTES_PER_BLOCK_OR_SINGLETON, 0),
+)
+# Outcome files written with --pack_outcomes have this flag, and their entities have no fixed width
+# (see delta_pack in code/src/binary_io.cpp)
+FILE_HEADER_DELTA_PACKED = 2
+OUTCOME_DELTA_PACKED_FIELD_BYTES = (BYTES_PER_BLOCK, BYTES_PER_ENTITY, 0, 0)
+DELTA_FRAME_VALUES = 128
+
+
+def read_file_header(f, expected: tuple[int, tuple[int, ...]]) -> dict[str, int]:
+    """
+    Read the header of a binary file that was opened for reading, and check that it holds the expected kind of records
+
+    Parameters
+    ----------
+    f : BinaryIO
+        The file, positioned at its start. Afterwards it is positioned at the first record.
+    expected : tuple[int, tuple[int, ...]]
+        The kind of the file and the widths of its fields, one of the constants above (e.g. OUTCOME)
+
+    Returns
+    -------
+    dict[str, int]
+        The counts in the header: the number of records, the number of values (for block lists) and the largest ID plus one,
+        and whether the values are delta packed
+    """
+    header = f.read(FILE_HEADER_BYTES)
+    assert len(header) == FILE_HEADER_BYTES and header.startswith(
+        b"SUMMARYB"
+    ), f"{f.name} has no file header, it was probably written by an older version of the pipeline"
+    (
+        _magic,
+        version,
+        kind,
+        flags,
+        field_bytes,
+        _reserved,
+        _checksum,
+        record_count,
+        value_count,
+        id_bound,
+    ) = struct.unpack(FILE_HEADER_FORMAT, header)
+    assert version == FILE_HEADER_VERSION, f"{f.name} has unsupported version {version}"
+    expected_kind, expected_field_bytes = expected
+    assert kind == expected_kind, f"{f.name} holds records of kind {kind} instead of {expected_kind}"
+    delta_packed = bool(flags & FILE_HEADER_DELTA_PACKED)
+    if delta_packed and expected == OUTCOME:
+        expected_field_bytes = OUTCOME_DELTA_PACKED_FIELD_BYTES
+    assert (
+        tuple(field_bytes) == expected_field_bytes
+    ), f"{f.name} has fields of {tuple(field_bytes)} bytes instead of {expected_field_bytes}"
+    return {
+        "record_count": record_count,
+        "value_count": value_count,
+        "id_bound": id_bound,
+        "delta_packed": delta_packed,
+    }
+
+
+def read_delta_packed(f, count: int) -> list[int]:
+    """
+    Read a sorted list of `count` entities, which are stored as bit-packed gaps in frames of up to DELTA_FRAME_VALUES values.
+    Every frame starts with a byte that gives the width in bits of its gaps.
+    """
+    values = []
+    previous = -1
+    for frame_start in range(0, count, DELTA_FRAME_VALUES):
+        frame_size = min(DELTA_FRAME_VALUES, count - frame_start)
+        bits = f.read(1)[0]
+        frame = int.from_bytes(f.read((frame_size * bits + 7) // 8), "little")
+        mask = (1 << bits) - 1
+        for i in range(frame_size):
+            previous += ((frame >> (i * bits)) & mask) + 1
+            values.append(previous)
+    return values
+
+
+def skip_delta_packed(f, count: int) -> None:
+    for frame_start in range(0, count, DELTA_FRAME_VALUES):
+        frame_size = min(DELTA_FRAME_VALUES, count - frame_start)
+        bits = f.read(1)[0]
+        f.seek((frame_size * bits + 7) // 8, 1)
+
+
+def read_outcome_blocks(
+    f, with_entities: bool = True
+) -> Iterator[tuple[int, int, list[int]]]:
+    """
+    Read the header of an outcome file that was opened for reading, and yield its blocks, whether their entities are delta packed or not
+
+    Parameters
+    ----------
+    f : BinaryIO
+        The file, positioned at its start
+    with_entities : bool
+        Whether the entities are read. Otherwise they are skipped and an empty list is yielded instead.
+
+    Yields
+    ------
+    tuple[int, int, list[int]]
+        The block, its number of entities and its entities (sorted if they are delta packed)
+    """
+    delta_packed = read_file_header(f, OUTCOME)["delta_packed"]
+    while block_bytes := f.read(BYTES_PER_BLOCK):
+        block_id = int.from_bytes(block_bytes, "little", signed=False)
+        block_size = int.from_bytes(f.read(BYTES_PER_ENTITY), "little", signed=False)
+        if not with_entities:
+            if delta_packed:
+                skip_delta_packed(f, block_size)
+            else:
+                f.seek(block_size * BYTES_PER_ENTITY, 1)
+            yield block_id, block_size, []
+        elif delta_packed:
+            yield block_id, block_size, read_delta_packed(f, block_size)
+        else:
+            data = f.read(block_size * BYTES_PER_ENTITY)
+            entities = [
+                int.from_bytes(data[i : i + BYTES_PER_ENTITY], "little", signed=False)
+                for i in range(0, len(data), BYTES_PER_ENTITY)
+            ]
+            yield block_id, block_size, entities
+
 
 def get_summary_graph(experiment_directory: str) -> tuple[list[list[int]], list[int]]:
     assert os.path.exists(
@@ -22,6 +164,7 @@ def get_summary_graph(experiment_directory: str) -> tuple[list[list[int]], list[
     edge_type = []
 
     with open(graph_binary_file, "rb") as f:
+        read_file_header(f, CONDENSED_EDGES)
         while subject_bytes := f.read(BYTES_PER_BLOCK_OR_SINGLETON):
             subject_id = int.from_bytes(subject_bytes, "little", signed=True)
             predicate_id = int.from_bytes(
@@ -52,6 +195,7 @@ def get_node_intervals(experiment_directory: str) -> dict[int, tuple[int,int]]:
     node_intervals = dict()
 
     with open(intervals_binary_file, "rb") as f:
+        read_file_header(f, INTERVALS)
         while node_bytes := f.read(BYTES_PER_BLOCK_OR_SINGLETON):
             node_id = int.from_bytes(node_bytes, "little", signed=True)
             start_level = int.from_bytes(
@@ -83,6 +227,7 @@ def get_local_global_maps(
     global_to_local_map = dict()
 
     with open(local_to_global_map_binary_file, "rb") as f:
+        read_file_header(f, LOCAL_GLOBAL_MAP)
         while level_bytes := f.read(BYTES_PER_K_TYPE):
             local_level = int.from_bytes(level_bytes, "little", signed=False)
             local_block_id = int.from_bytes(
@@ -155,18 +300,8 @@ def get_outcome(experiment_directory: str, level: int) -> dict[int, set[int]]:
 
     outcome = dict()
     with open(outcome_binary_file, "rb") as f:
-        while block_bytes := f.read(BYTES_PER_BLOCK):
-            block_id = int.from_bytes(block_bytes, "little", signed=False)
-            block_size = int.from_bytes(
-                f.read(BYTES_PER_ENTITY), "little", signed=False
-            )
-
-            outcome[block_id] = set()
-            for i in range(block_size):
-                entity = int.from_bytes(
-                    f.read(BYTES_PER_ENTITY), "little", signed=False
-                )
-                outcome[block_id].add(entity)
+        for block_id, _, entities in read_outcome_blocks(f):
+            outcome[block_id] = set(entities)
 
     return outcome
 
@@ -234,6 +369,7 @@ def get_sizes_and_split_blocks(
             split_blocks.append({})
 
             with open(mapping_binary_file, "rb") as f:
+                read_file_header(f, MAPPING)
                 while merged_bytes := f.read(BYTES_PER_BLOCK):
                     merged_id = int.from_bytes(merged_bytes, "little", signed=False)
                     split_count = int.from_bytes(
@@ -246,14 +382,9 @@ def get_sizes_and_split_blocks(
                     f.seek(split_count * BYTES_PER_BLOCK, 1)
 
         with open(outcome_binary_file, "rb") as f:
-            while block_bytes := f.read(BYTES_PER_BLOCK):
-                block_id = int.from_bytes(block_bytes, "little", signed=False)
-                block_size = int.from_bytes(
-                    f.read(BYTES_PER_ENTITY), "little", signed=False
-                )
+            for block_id, block_size, _ in read_outcome_blocks(f, with_entities=False):
                 sizes[block_id] = block_size
                 accumulated_sizes[(i, block_id)] = block_size
-                f.seek(block_size * BYTES_PER_ENTITY, 1)
         statistics.append(
             {
                 "Block sizes": Counter(sizes.values()),
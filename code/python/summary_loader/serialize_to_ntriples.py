@@ -1,15 +1,20 @@
 import hashlib
 import base64
+import struct
 import sys
 import os
 from collections import Counter
-from typing import Protocol
+from typing import Iterator, Protocol
 from urllib.parse import quote
 from loader_functions import (
     get_local_global_maps,
     get_fixed_point,
     get_node_intervals,
-    BYTES_PER_ENTITY,
+    read_file_header,
+    read_outcome_blocks,
+    MAPPING,
+    SINGLETON_MAPPING,
+    CONDENSED_EDGES,
     BYTES_PER_PREDICATE,
     BYTES_PER_BLOCK,
     BYTES_PER_BLOCK_OR_SINGLETON,
@@ -79,6 +84,75 @@ class SortedIRIHashMapper:
         return NAMESPACE + parse_to_iri("hash_block-" + iri_hash_string)
 
 
+def read_binary_dictionary(dictionary_file: str) -> Iterator[tuple[str, int]]:
+    """
+    Read a binary dictionary (as written by the preprocessor with --binary_dictionary)
+
+    Parameters
+    ----------
+    dictionary_file : str
+        The path to an entity2ID.dict or rel2ID.dict file
+
+    Yields
+    ------
+    tuple[str, int]
+        The (term, id) pairs, in sorted order of the terms
+    """
+    with open(dictionary_file, "rb") as f:
+        contents = f.read()
+    (
+        magic,
+        version,
+        terms_per_bucket,
+        term_count,
+        heap_offset,
+        heap_size,
+        _bucket_offsets_offset,
+        rank_to_id_offset,
+        _id_to_rank_offset,
+        prefix_count,
+        prefix_heap_offset,
+        prefix_offsets_offset,
+    ) = struct.unpack_from("<8sIIQQQQQQQQQ", contents)
+    assert magic == b"TERMDICT", f"{dictionary_file} is not a binary dictionary"
+    assert version == 2, f"{dictionary_file} has unsupported version {version}"
+
+    def read_varint(position: int) -> tuple[int, int]:
+        value = 0
+        shift = 0
+        while True:
+            byte = contents[position]
+            position += 1
+            value |= (byte & 127) << shift
+            if byte < 128:
+                return value, position
+            shift += 7
+
+    prefix_offsets = struct.unpack_from(
+        f"<{prefix_count + 1}Q", contents, prefix_offsets_offset
+    )
+    prefixes = [
+        contents[prefix_heap_offset + begin : prefix_heap_offset + end]
+        for begin, end in zip(prefix_offsets, prefix_offsets[1:])
+    ]
+    rank_to_id = struct.unpack_from(f"<{term_count}Q", contents, rank_to_id_offset)
+    position = heap_offset
+    term = b""
+    for rank in range(term_count):
+        # The first term of a bucket is (prefix ID + 1 or 0, rest), the others share a prefix with their predecessor
+        if rank % terms_per_bucket == 0:
+            prefix_id, position = read_varint(position)
+            term = prefixes[prefix_id - 1] if prefix_id > 0 else b""
+            shared = len(term)
+        else:
+            shared, position = read_varint(position)
+        suffix, position = read_varint(position)
+        term = term[:shared] + contents[position : position + suffix]
+        position += suffix
+        yield term.decode("utf-8"), rank_to_id[rank]
+    assert position == heap_offset + heap_size, f"{dictionary_file} is corrupt"
+
+
 def get_id_entity_maps(
     experiment_directory: str, include_inverted_index=False
 ) -> tuple[dict[int, str], dict[str, int]]:
@@ -86,10 +160,18 @@ def get_id_entity_maps(
         experiment_directory
     ), "The experiment directory string should refer to a valid (existing) directory"
     entity_to_id_map_file = experiment_directory + "entity2ID.txt"
+    binary_map_file = experiment_directory + "entity2ID.dict"
 
     id_to_entity_map = dict()
     entity_to_id_map = dict()
 
+    if os.path.isfile(binary_map_file):
+        for entity_iri, entity_id in read_binary_dictionary(binary_map_file):
+            id_to_entity_map[entity_id] = entity_iri
+            if include_inverted_index:
+                entity_to_id_map[entity_iri] = entity_id
+        return id_to_entity_map, entity_to_id_map
+
     with open(entity_to_id_map_file, "r", encoding="utf-8") as f:
         for line_number, line in enumerate(f, start=1):
             try:
@@ -116,10 +198,18 @@ def get_id_predicate_maps(
         experiment_directory
     ), "The experiment directory string should refer to a valid (existing) directory"
     entity_to_id_map_file = experiment_directory + "rel2ID.txt"
+    binary_map_file = experiment_directory + "rel2ID.dict"
 
     id_to_predicate_map = dict()
     predicate_to_id_map = dict()
 
+    if os.path.isfile(binary_map_file):
+        for predicate_iri, predicate_id in read_binary_dictionary(binary_map_file):
+            id_to_predicate_map[predicate_id] = predicate_iri
+            if include_inverted_index:
+                predicate_to_id_map[predicate_iri] = predicate_id
+        return id_to_predicate_map, predicate_to_id_map
+
     with open(entity_to_id_map_file, "r", encoding="utf-8") as f:
         for line_number, line in enumerate(f, start=1):
             try:
@@ -180,6 +270,7 @@ def process_outcomes(
                 # If singletons were created, then the singleton_mapping file contains this information
                 if os.path.isfile(singleton_mapping_binary_file):
                     with open(singleton_mapping_binary_file, "rb") as f:
+                        read_file_header(f, SINGLETON_MAPPING)
                         while merged_bytes := f.read(BYTES_PER_BLOCK):
                             _ = int.from_bytes(merged_bytes, "little", signed=False)
                             singleton_count = int.from_bytes(
@@ -208,18 +299,7 @@ def process_outcomes(
                                 )
 
             with open(outcome_binary_file, "rb") as f:
-                while block_bytes := f.read(BYTES_PER_BLOCK):
-                    block_id = int.from_bytes(block_bytes, "little", signed=False)
-                    block_size = int.from_bytes(
-                        f.read(BYTES_PER_ENTITY), "little", signed=False
-                    )
-
-                    entity_id_list = []
-                    for i in range(block_size):
-                        entity = int.from_bytes(
-                            f.read(BYTES_PER_ENTITY), "little", signed=False
-                        )
-                        entity_id_list.append(entity)
+                for block_id, block_size, entity_id_list in read_outcome_blocks(f):
                     global_block_id = local_to_global_block_map[(block_id, level)]
                     global_id_to_iri_map[global_block_id] = block_to_string_mapper(
                         entity_id_list
@@ -265,13 +345,8 @@ def load_and_store_refines_edges(
         experiment_directory + f"bisimulation/outcome_condensed-{start:04d}.bin"
     )
     with open(outcome_binary_file, "rb") as infile:
-        while block_bytes := infile.read(BYTES_PER_BLOCK):
-            block_id = int.from_bytes(block_bytes, "little", signed=False)
-            block_size = int.from_bytes(
-                infile.read(BYTES_PER_ENTITY), "little", signed=False
-            )
+        for block_id, _, _ in read_outcome_blocks(infile, with_entities=False):
             block_to_start_map[block_id] = start
-            infile.seek(block_size * BYTES_PER_ENTITY, 1)
 
     with open(refines_edges_file, "w") as outfile:
         for i in range(start + 1, depth + 1):
@@ -289,6 +364,7 @@ def load_and_store_refines_edges(
             # If singletons were created, then the singleton_mapping file contains this information
             if os.path.isfile(singleton_mapping_binary_file):
                 with open(singleton_mapping_binary_file, "rb") as infile:
+                    read_file_header(infile, SINGLETON_MAPPING)
                     while merged_bytes := infile.read(BYTES_PER_BLOCK):
                         merged_id = int.from_bytes(merged_bytes, "little", signed=False)
                         global_merged_id = local_to_global_block_map[
@@ -311,6 +387,7 @@ def load_and_store_refines_edges(
 
             # For all non-singleton blocks, read the mapping file
             with open(mapping_binary_file, "rb") as infile:
+                read_file_header(infile, MAPPING)
                 while merged_bytes := infile.read(BYTES_PER_BLOCK):
                     merged_id = int.from_bytes(merged_bytes, "little", signed=False)
                     global_merged_id = local_to_global_block_map[
@@ -357,6 +434,7 @@ def load_and_store_data_edges(
     data_edges_file = rdf_output_directory + "data.nt"
 
     with open(graph_binary_file, "rb") as infile, open(data_edges_file, "w") as outfile:
+        read_file_header(infile, CONDENSED_EDGES)
         while subject_bytes := infile.read(BYTES_PER_BLOCK_OR_SINGLETON):
             subject_id = int.from_bytes(subject_bytes, "little", signed=True)
             predicate_id = int.from_bytes(
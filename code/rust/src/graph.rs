@@ -24,6 +24,19 @@ pub type NodeIndex = usize;
 pub const BYTES_PER_ENTITY: usize = 5;
 pub const BYTES_PER_PREDICATE: usize = 4;
 pub const BYTES_PER_TRIPLE: usize = 2 * BYTES_PER_ENTITY + BYTES_PER_PREDICATE;
+
+// Every binary file of the pipeline starts with a header, see code/include/file_header.hpp.
+// The triples of binary_encoding.bin follow a header of kind 1 (triples).
+pub const FILE_HEADER_BYTES: usize = 48;
+const FILE_HEADER_MAGIC: &[u8; 8] = b"SUMMARYB";
+const FILE_HEADER_VERSION: u32 = 1;
+const FILE_KIND_TRIPLES: u8 = 1;
+const TRIPLE_FIELD_BYTES: [u8; 4] = [
+    BYTES_PER_ENTITY as u8,
+    BYTES_PER_PREDICATE as u8,
+    BYTES_PER_ENTITY as u8,
+    0,
+];
 // Rust's Vec handles capacity growth automatically, but we can hint at it.
 
 #[derive(Debug, Error)]
@@ -35,6 +48,77 @@ pub enum GraphValidationError {
         "The graph binary size ({num_bytes} bytes) is not divisible by the number of bytes per triple ({BYTES_PER_TRIPLE})"
     )]
     NotDivisible { num_bytes: usize },
+
+    #[error("The header counts {header_count} triples, but the graph binary holds {triple_count}")]
+    CountMismatch {
+        header_count: u64,
+        triple_count: usize,
+    },
+}
+
+/// The counts in the header of a triple file.
+#[derive(Debug, Clone, Copy)]
+pub struct TripleFileHeader {
+    pub record_count: u64,
+    /// The largest node ID plus one
+    pub id_bound: u64,
+}
+
+/// Checks the header at the start of a triple file and returns its counts.
+pub fn parse_triple_file_header(header: &[u8]) -> io::Result<TripleFileHeader> {
+    let invalid = |message: String| io::Error::new(io::ErrorKind::InvalidData, message);
+    if header.len() < FILE_HEADER_BYTES || &header[0..8] != FILE_HEADER_MAGIC {
+        return Err(invalid(
+            "The file does not start with a file header, it was probably written by an older version of the pipeline".to_string(),
+        ));
+    }
+    let u64_at = |offset: usize| u64::from_le_bytes(header[offset..offset + 8].try_into().unwrap());
+    let version = u32::from_le_bytes(header[8..12].try_into().unwrap());
+    if version != FILE_HEADER_VERSION {
+        return Err(invalid(format!(
+            "The file has version {version}, but version {FILE_HEADER_VERSION} is expected"
+        )));
+    }
+    if header[12] != FILE_KIND_TRIPLES {
+        return Err(invalid(format!(
+            "The file holds records of kind {} instead of triples",
+            header[12]
+        )));
+    }
+    // The preprocessor can write entities of 4 to 6 bytes (--entity_bytes), only the default width is read here
+    if header[14..18] != TRIPLE_FIELD_BYTES {
+        return Err(invalid(format!(
+            "The file has entities of {} bytes, but only entities of {BYTES_PER_ENTITY} bytes are supported. Run the preprocessor with --entity_bytes={BYTES_PER_ENTITY}",
+            header[14]
+        )));
+    }
+    Ok(TripleFileHeader {
+        record_count: u64_at(24),
+        id_bound: u64_at(40),
+    })
+}
+
+/// Reads and checks the header at the start of a triple stream.
+pub fn read_triple_file_header<R: Read>(r: &mut R) -> io::Result<TripleFileHeader> {
+    let mut header = [0u8; FILE_HEADER_BYTES];
+    r.read_exact(&mut header)?;
+    parse_triple_file_header(&header)
+}
+
+/// Writes the header of a triple file, without a checksum.
+pub fn write_triple_file_header<W: Write>(
+    w: &mut W,
+    record_count: u64,
+    id_bound: u64,
+) -> io::Result<()> {
+    let mut header = [0u8; FILE_HEADER_BYTES];
+    header[0..8].copy_from_slice(FILE_HEADER_MAGIC);
+    header[8..12].copy_from_slice(&FILE_HEADER_VERSION.to_le_bytes());
+    header[12] = FILE_KIND_TRIPLES;
+    header[14..18].copy_from_slice(&TRIPLE_FIELD_BYTES);
+    header[24..32].copy_from_slice(&record_count.to_le_bytes());
+    header[40..48].copy_from_slice(&id_bound.to_le_bytes());
+    w.write_all(&header)
 }
 
 #[derive(Debug, Clone)]
@@ -205,9 +289,11 @@ impl Graph {
     /// Reads a graph from reader.
     pub fn read_graph_from_reader<R: Read>(
         &mut self,
-        reader: R,
+        mut reader: R,
         reverse_edges: bool,
     ) -> io::Result<()> {
+        let header = read_triple_file_header(&mut reader)?;
+        self.resize(header.id_bound as usize);
         // We define the callback here to mutate 'self'
         read_triples_from_stream(reader, reverse_edges, |s, p, o| {
             let largest = max(s, o);
@@ -284,10 +370,13 @@ impl Graph {
         let chunck_size = (BYTES_PER_ENTITY * 2 + BYTES_PER_PREDICATE) * TRIPLE_PER_CHUNK;
 
         let mmap = unsafe { MmapOptions::new().populate().map(&file) }?;
+        let header = parse_triple_file_header(&mmap)?;
+        self.resize(header.id_bound as usize);
         let (sender, receiver) = channel();
 
         rayon::spawn(move || {
-            mmap.chunks(chunck_size)
+            mmap[FILE_HEADER_BYTES..]
+                .chunks(chunck_size)
                 .par_bridge()
                 .map(|file_chunk| {
                     Self::process_variable_triples_per_chunk(
@@ -370,8 +459,11 @@ impl Graph {
         let chunck_size = (BYTES_PER_ENTITY * 2 + BYTES_PER_PREDICATE) * TRIPLE_PER_CHUNK;
 
         let mmap = unsafe { MmapOptions::new().populate().map(&file) }?;
+        let header = parse_triple_file_header(&mmap)?;
+        self.resize(header.id_bound as usize);
 
-        mmap.chunks(chunck_size)
+        mmap[FILE_HEADER_BYTES..]
+            .chunks(chunck_size)
             .map(|file_chunk| {
                 // println!("{}", file_chunk.len());
 
@@ -407,7 +499,9 @@ impl Graph {
 
         // provide backpressure so the reader doesn't exhaust RAM if the builder is slower.
         let (tx, rx) = mpsc::sync_channel(10_000);
-        let file = File::open(path)?;
+        let mut file = File::open(path)?;
+        let header = read_triple_file_header(&mut file)?;
+        self.resize(header.id_bound as usize);
 
         // Spawn the Reader Thread
         let handle = thread::spawn(move || {
@@ -511,6 +605,18 @@ impl Graph {
 
     /// Writes the graph in the custom binary format.
     pub fn write<W: Write>(&self, w: &mut W) -> io::Result<()> {
+        let record_count = self.get_total_edge_count() as u64;
+        let id_bound = self
+            .nodes
+            .iter()
+            .enumerate()
+            .filter(|(_, node)| !node.edges.is_empty())
+            .flat_map(|(subject, node)| {
+                std::iter::once(subject).chain(node.edges.iter().map(|edge| edge.target))
+            })
+            .max()
+            .map_or(0, |largest| largest as u64 + 1);
+        write_triple_file_header(w, record_count, id_bound)?;
         for (subject_index, node) in self.nodes.iter().enumerate() {
             for edge in &node.edges {
                 write_triple(w, subject_index, edge.label, edge.target)?;
@@ -804,11 +910,19 @@ pub fn get_graph_triple_count_from_binary_file<P: AsRef<Path>>(
     file: P,
 ) -> Result<usize, GraphValidationError> {
     let path = file.as_ref();
-    let graph_binary_size = fs::metadata(path)?.len() as usize;
+    let graph_binary_size = (fs::metadata(path)?.len() as usize).saturating_sub(FILE_HEADER_BYTES);
     if graph_binary_size % BYTES_PER_TRIPLE != 0 {
         return Err(GraphValidationError::NotDivisible {
             num_bytes: (graph_binary_size),
         });
     }
-    Ok(graph_binary_size / BYTES_PER_TRIPLE)
+    let header = read_triple_file_header(&mut File::open(path)?)?;
+    let triple_count = graph_binary_size / BYTES_PER_TRIPLE;
+    if header.record_count as usize != triple_count {
+        return Err(GraphValidationError::CountMismatch {
+            header_count: header.record_count,
+            triple_count,
+        });
+    }
+    Ok(triple_count)
 }
@@ -0,0 +1,145 @@
+// This program compresses the binary files of the pipeline into containers of independently compressed frames, or decompresses them again (see frame_container.hpp).
+// The files are replaced in place, and all programs of the pipeline read a compressed file as if it were the original.
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "../include/frame_container.hpp"
+#include "../include/mapped_file.hpp"
+#include "../include/my_exception.hpp"
+
+void print_time()
+{
+    auto t = std::time(nullptr);
+    auto ptm = std::localtime(&t);
+    std::cout << std::put_time(ptm, "%Y/%m/%d %H:%M:%S") << " ";
+}
+
+// The new contents are written next to the file first, such that an interrupted run leaves the original file intact
+void compress_file(const std::string &filename, FrameCodec codec, std::size_t frame_bytes, int level, unsigned int threads)
+{
+    std::string temporary_file = filename + ".compressing";
+    uint64_t original_bytes;
+    {
+        MappedFile mapped_file(filename, MADV_SEQUENTIAL, false);
+        if (is_frame_container(mapped_file.contents()))
+        {
+            print_time();
+            std::cout << filename << " is already compressed" << std::endl;
+            return;
+        }
+        original_bytes = mapped_file.contents().size();
+        auto t_start = std::chrono::high_resolution_clock::now();
+        write_frame_container(mapped_file.contents(), temporary_file, codec, frame_bytes, level, threads);
+        auto t_end = std::chrono::high_resolution_clock::now();
+        print_time();
+        std::cout << "Compressed " << filename << " with " << frame_codec_name(codec) << " from " << original_bytes << " to " << std::filesystem::file_size(temporary_file)
+                  << " bytes in " << std::chrono::duration<double, std::milli>(t_end - t_start).count() << " ms" << std::endl;
+    }
+    std::filesystem::rename(temporary_file, filename);
+}
+
+void decompress_file(const std::string &filename, unsigned int threads)
+{
+    std::string temporary_file = filename + ".decompressing";
+    {
+        MappedFile mapped_container(filename, MADV_SEQUENTIAL, false);
+        if (!is_frame_container(mapped_container.contents()))
+        {
+            print_time();
+            std::cout << filename << " is not compressed" << std::endl;
+            return;
+        }
+        FrameContainer container(mapped_container.contents(), filename);
+        auto t_start = std::chrono::high_resolution_clock::now();
+        std::vector<char> contents(container.size());
+        container.decompress_all(contents.data(), threads);
+        std::ofstream outputstream(temporary_file, std::ios::trunc | std::ios::binary);
+        if (!outputstream.is_open())
+        {
+            throw MyException("Opening the file to write failed: " + temporary_file);
+        }
+        outputstream.write(contents.data(), contents.size());
+        outputstream.close();
+        if (outputstream.fail())
+        {
+            throw MyException("Writing the file " + temporary_file + " failed, the disk might be full");
+        }
+        auto t_end = std::chrono::high_resolution_clock::now();
+        print_time();
+        std::cout << "Decompressed " << filename << " from " << mapped_container.contents().size() << " to " << container.size() << " bytes in "
+                  << std::chrono::duration<double, std::milli>(t_end - t_start).count() << " ms" << std::endl;
+    }
+    std::filesystem::rename(temporary_file, filename);
+}
+
+int main(int ac, char *av[])
+{
+    // This structure was inspired by https://gist.github.com/randomphrase/10801888
+    namespace po = boost::program_options;
+
+    po::options_description global("Global options");
+    global.add_options()("command", po::value<std::string>(), "Either \"compress\" or \"decompress\"");
+    global.add_options()("files", po::value<std::vector<std::string>>(), "The binary files to compress or decompress in place");
+    global.add_options()("codec", po::value<std::string>()->default_value("zstd"), "The codec for the frames: \"zstd\" compresses better, \"lz4\" decompresses faster. Default is \"zstd\".");
+    global.add_options()("frame_size", po::value<std::size_t>()->default_value(DEFAULT_FRAME_BYTES), "The number of bytes of the file in every frame. Default is 1 MiB.");
+    global.add_options()("level", po::value<int>()->default_value(3), "The zstd compression level. Default is 3.");
+    global.add_options()("threads", po::value<unsigned int>(), "The number of threads that compress or decompress frames. Default is the number of hardware threads.");
+
+    po::positional_options_description pos;
+    pos.add("command", 1).add("files", -1);
+
+    po::variables_map vm;
+
+    po::parsed_options parsed = po::command_line_parser(ac, av).options(global).positional(pos).run();
+
+    po::store(parsed, vm);
+    po::notify(vm);
+
+    if (!vm.count("command") || !vm.count("files"))
+    {
+        std::cout << "Usage: binary_container compress|decompress FILE... [--codec=zstd|lz4] [--frame_size=BYTES] [--level=LEVEL] [--threads=THREADS]" << std::endl;
+        std::cout << global << std::endl;
+        return 1;
+    }
+    std::string command = vm["command"].as<std::string>();
+    std::vector<std::string> files = vm["files"].as<std::vector<std::string>>();
+    std::string codec_name = vm["codec"].as<std::string>();
+    unsigned int threads = vm.count("threads") ? vm["threads"].as<unsigned int>() : std::max(1u, std::thread::hardware_concurrency());
+
+    FrameCodec codec;
+    if (codec_name == "zstd")
+    {
+        codec = FrameCodec::zstd;
+    }
+    else if (codec_name == "lz4")
+    {
+        codec = FrameCodec::lz4;
+    }
+    else
+    {
+        throw MyException("Unknown codec \"" + codec_name + "\", use \"zstd\" or \"lz4\"");
+    }
+
+    for (const std::string &file: files)
+    {
+        if (command == "compress")
+        {
+            compress_file(file, codec, vm["frame_size"].as<std::size_t>(), vm["level"].as<int>(), threads);
+        }
+        else if (command == "decompress")
+        {
+            decompress_file(file, threads);
+        }
+        else
+        {
+            throw MyException("Unknown command \"" + command + "\", use \"compress\" or \"decompress\"");
+        }
+    }
+}
@@ -1,7 +1,16 @@
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <span>
+#if defined(__SSSE3__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
 
 #include "../include/binary_io.hpp"
+#include "../include/my_exception.hpp"
 
 node_index read_uint_ENTITY_little_endian(std::istream &inputstream)
 {
@@ -237,3 +246,486 @@ void write_uint_K_TYPE_little_endian(std::ostream &outputstream, k_type value)
         exit(outputstream.rdstate());
     }
 }
+
+BlockWriter::BlockWriter(std::ostream &outputstream, std::size_t capacity)
+    : outputstream(outputstream), buffer(new char[capacity]), capacity(capacity), used(0), crc(0)
+{
+}
+
+BlockWriter::~BlockWriter()
+{
+    if (this->used > 0 && this->outputstream.good())
+    {
+        this->outputstream.write(this->buffer.get(), this->used);
+    }
+}
+
+void BlockWriter::write_buffer()
+{
+    this->crc = crc32c(this->crc, reinterpret_cast<const std::byte *>(this->buffer.get()), this->used);
+    this->outputstream.write(this->buffer.get(), this->used);
+    this->used = 0;
+    if (this->outputstream.fail())
+    {
+        throw MyException("Writing a block of binary data failed with stream state " + std::to_string(this->outputstream.rdstate()) + ", the disk might be full");
+    }
+}
+
+void BlockWriter::flush()
+{
+    this->write_buffer();
+    this->outputstream.flush();
+    if (this->outputstream.fail())
+    {
+        throw MyException("Flushing binary data failed with stream state " + std::to_string(this->outputstream.rdstate()) + ", the disk might be full");
+    }
+}
+
+void BlockWriter::write_bytes(const std::byte *data, std::size_t size)
+{
+    while (size > 0)
+    {
+        if (this->used == this->capacity)
+        {
+            this->write_buffer();
+        }
+        std::size_t chunk = std::min(size, this->capacity - this->used);
+        std::memcpy(this->buffer.get() + this->used, data, chunk);
+        this->used += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+namespace
+{
+    template <int BYTES>
+    inline uint64_t load_little_endian(const std::byte *in)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < BYTES; i++)
+        {
+            value |= uint64_t(in[i]) << (i * 8);
+        }
+        return value;
+    }
+
+    template <int BYTES>
+    inline void store_little_endian(std::byte *out, uint64_t value)
+    {
+        for (int i = 0; i < BYTES; i++)
+        {
+            out[i] = std::byte(value);
+            value >>= 8;
+        }
+    }
+
+    inline int64_t sign_extend_BLOCK_OR_SINGLETON(uint64_t value)
+    {
+        constexpr int unused_bits = 64 - 8 * BYTES_PER_BLOCK_OR_SINGLETON;
+        return int64_t(value << unused_bits) >> unused_bits;
+    }
+}
+
+// The SIMD loops below load 16 bytes at a time, which can reach beyond the last value they decode, so they stop early enough to stay
+// within the input (or output) and leave the last few values to the scalar loop.
+
+void decode_entities(const std::byte *in, std::size_t count, node_index *out)
+{
+    static_assert(BYTES_PER_ENTITY == 5);
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    // Each 128-bit lane turns the first 10 bytes of its load into two 64-bit values
+    const __m256i spread = _mm256_setr_epi8(0, 1, 2, 3, 4, -1, -1, -1, 5, 6, 7, 8, 9, -1, -1, -1,
+                                            0, 1, 2, 3, 4, -1, -1, -1, 5, 6, 7, 8, 9, -1, -1, -1);
+    for (; i + 6 <= count; i += 4)
+    {
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 5));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 5 + 10));
+        __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_shuffle_epi8(bytes, spread));
+    }
+#endif
+#if defined(__SSSE3__)
+    const __m128i spread_128 = _mm_setr_epi8(0, 1, 2, 3, 4, -1, -1, -1, 5, 6, 7, 8, 9, -1, -1, -1);
+    for (; i + 4 <= count; i += 2)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 5));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_shuffle_epi8(bytes, spread_128));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        out[i] = load_little_endian<BYTES_PER_ENTITY>(in + i * BYTES_PER_ENTITY);
+    }
+}
+
+void decode_predicates(const std::byte *in, std::size_t count, edge_type *out)
+{
+    static_assert(BYTES_PER_PREDICATE == sizeof(edge_type));
+    if constexpr (std::endian::native == std::endian::little)
+    {
+        std::memcpy(out, in, count * sizeof(edge_type));
+    }
+    else
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            out[i] = edge_type(load_little_endian<BYTES_PER_PREDICATE>(in + i * BYTES_PER_PREDICATE));
+        }
+    }
+}
+
+void decode_blocks(const std::byte *in, std::size_t count, block_index *out)
+{
+    static_assert(BYTES_PER_BLOCK == 4);
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_cvtepu32_epi64(bytes));
+    }
+#endif
+#if defined(__SSSE3__)
+    const __m128i spread = _mm_setr_epi8(0, 1, 2, 3, -1, -1, -1, -1, 4, 5, 6, 7, -1, -1, -1, -1);
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_shuffle_epi8(bytes, spread));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        out[i] = load_little_endian<BYTES_PER_BLOCK>(in + i * BYTES_PER_BLOCK);
+    }
+}
+
+void decode_blocks_or_singletons(const std::byte *in, std::size_t count, block_or_singleton_index *out)
+{
+    static_assert(BYTES_PER_BLOCK_OR_SINGLETON == 5);
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    // The spread copies the top byte of every value into its three upper bytes. Comparing those bytes with zero then gives the sign extension.
+    const __m256i spread = _mm256_setr_epi8(0, 1, 2, 3, 4, 4, 4, 4, 5, 6, 7, 8, 9, 9, 9, 9,
+                                            0, 1, 2, 3, 4, 4, 4, 4, 5, 6, 7, 8, 9, 9, 9, 9);
+    const __m256i value_bytes = _mm256_set1_epi64x(0x000000FFFFFFFFFFll);
+    for (; i + 6 <= count; i += 4)
+    {
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 5));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 5 + 10));
+        __m256i spread_bytes = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1), spread);
+        __m256i sign_bytes = _mm256_cmpgt_epi8(_mm256_setzero_si256(), spread_bytes);
+        __m256i values = _mm256_or_si256(_mm256_and_si256(spread_bytes, value_bytes), _mm256_andnot_si256(value_bytes, sign_bytes));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), values);
+    }
+#endif
+#if defined(__SSSE3__)
+    const __m128i spread_128 = _mm_setr_epi8(0, 1, 2, 3, 4, 4, 4, 4, 5, 6, 7, 8, 9, 9, 9, 9);
+    const __m128i value_bytes_128 = _mm_set1_epi64x(0x000000FFFFFFFFFFll);
+    for (; i + 4 <= count; i += 2)
+    {
+        __m128i spread_bytes = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 5)), spread_128);
+        __m128i sign_bytes = _mm_cmpgt_epi8(_mm_setzero_si128(), spread_bytes);
+        __m128i values = _mm_or_si128(_mm_and_si128(spread_bytes, value_bytes_128), _mm_andnot_si128(value_bytes_128, sign_bytes));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), values);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        out[i] = sign_extend_BLOCK_OR_SINGLETON(load_little_endian<BYTES_PER_BLOCK_OR_SINGLETON>(in + i * BYTES_PER_BLOCK_OR_SINGLETON));
+    }
+}
+
+void decode_triples(const std::byte *in, std::size_t count, node_index *subjects, edge_type *predicates, node_index *objects)
+{
+    static_assert(BYTES_PER_TRIPLE == 14);
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    // Each lane holds one triple. The first shuffle gives (subject, object) per lane and the second puts the predicate in the lowest 4 bytes.
+    const __m256i entities = _mm256_setr_epi8(0, 1, 2, 3, 4, -1, -1, -1, 9, 10, 11, 12, 13, -1, -1, -1,
+                                              0, 1, 2, 3, 4, -1, -1, -1, 9, 10, 11, 12, 13, -1, -1, -1);
+    const __m256i predicate = _mm256_setr_epi8(5, 6, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               5, 6, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i gather_predicates = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+    for (; i + 3 <= count; i += 2)
+    {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 14));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 14 + 14));
+        __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+        // (s0, o0, s1, o1) becomes (s0, s1, o0, o1)
+        __m256i subject_object = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(bytes, entities), 0b11011000);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(subjects + i), _mm256_castsi256_si128(subject_object));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(objects + i), _mm256_extracti128_si256(subject_object, 1));
+        __m256i predicate_pair = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(bytes, predicate), gather_predicates);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(predicates + i), _mm256_castsi256_si128(predicate_pair));
+    }
+#endif
+#if defined(__SSSE3__)
+    const __m128i entities_128 = _mm_setr_epi8(0, 1, 2, 3, 4, -1, -1, -1, 9, 10, 11, 12, 13, -1, -1, -1);
+    for (; i + 2 <= count; i++)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 14));
+        __m128i subject_object = _mm_shuffle_epi8(bytes, entities_128);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(subjects + i), subject_object);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(objects + i), _mm_unpackhi_epi64(subject_object, subject_object));
+        predicates[i] = edge_type(load_little_endian<BYTES_PER_PREDICATE>(in + i * 14 + BYTES_PER_ENTITY));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        const std::byte *record = in + i * BYTES_PER_TRIPLE;
+        subjects[i] = load_little_endian<BYTES_PER_ENTITY>(record);
+        predicates[i] = edge_type(load_little_endian<BYTES_PER_PREDICATE>(record + BYTES_PER_ENTITY));
+        objects[i] = load_little_endian<BYTES_PER_ENTITY>(record + BYTES_PER_ENTITY + BYTES_PER_PREDICATE);
+    }
+}
+
+void encode_entities(const node_index *in, std::size_t count, std::byte *out)
+{
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    // Each lane packs its two values into its first 10 bytes. The second store overwrites the 6 bytes of padding that the first one leaves.
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1,
+                                          0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1);
+    for (; i + 6 <= count; i += 4)
+    {
+        __m256i packed = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i)), pack);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 5), _mm256_castsi256_si128(packed));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 5 + 10), _mm256_extracti128_si256(packed, 1));
+    }
+#endif
+#if defined(__SSSE3__)
+    const __m128i pack_128 = _mm_setr_epi8(0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1);
+    for (; i + 4 <= count; i += 2)
+    {
+        __m128i packed = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), pack_128);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 5), packed);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        store_little_endian<BYTES_PER_ENTITY>(out + i * BYTES_PER_ENTITY, in[i]);
+    }
+}
+
+void encode_blocks(const block_index *in, std::size_t count, std::byte *out)
+{
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i values = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i)), low_halves);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4), _mm256_castsi256_si128(values));
+    }
+#endif
+#if defined(__SSSE3__)
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i values = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), _MM_SHUFFLE(3, 3, 2, 0));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i * 4), values);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        store_little_endian<BYTES_PER_BLOCK>(out + i * BYTES_PER_BLOCK, in[i]);
+    }
+}
+
+// A delta packed list consists of frames of DELTA_FRAME_VALUES gaps (the last frame may hold fewer). The gap of the first value is the value
+// itself, the gap of every other value is its difference with the previous value minus one, so consecutive values have a gap of 0.
+// A frame starts with a byte that gives the number of bits b of its largest gap, followed by its gaps in b bits each, least significant
+// bit first, in ceil(b * size / 8) bytes. A frame of consecutive values thus takes one byte.
+// Unlike varints, all gaps of a frame have the same width, so every gap is decoded with one unaligned load and no branch.
+namespace
+{
+    // The decoder loads 8 bytes at the first byte of a gap, of which up to 7 bits belong to the gap before it
+    constexpr int MAX_DELTA_BITS = 57;
+}
+
+void delta_pack(const node_index *in, std::size_t count, std::vector<std::byte> &out)
+{
+    node_index previous = std::numeric_limits<node_index>::max();  // Such that the first gap is the first value
+    node_index gaps[DELTA_FRAME_VALUES];
+    for (std::size_t frame_start = 0; frame_start < count; frame_start += DELTA_FRAME_VALUES)
+    {
+        std::size_t frame_size = std::min(DELTA_FRAME_VALUES, count - frame_start);
+        node_index all_gaps = 0;
+        for (std::size_t i = 0; i < frame_size; i++)
+        {
+            node_index value = in[frame_start + i];
+            if (value <= previous && previous != std::numeric_limits<node_index>::max())
+            {
+                throw MyException("The values of a delta packed list must be sorted and distinct, but " + std::to_string(value) + " follows " + std::to_string(previous));
+            }
+            gaps[i] = value - previous - 1;
+            previous = value;
+            all_gaps |= gaps[i];
+        }
+        int bits = std::bit_width(all_gaps);
+        if (bits > MAX_DELTA_BITS)
+        {
+            throw MyException("The gap " + std::to_string(all_gaps) + " is too large to be delta packed");
+        }
+        out.push_back(std::byte(bits));
+        uint64_t pending = 0;
+        int pending_bits = 0;
+        for (std::size_t i = 0; i < frame_size; i++)
+        {
+            pending |= gaps[i] << pending_bits;
+            pending_bits += bits;
+            while (pending_bits >= 8)
+            {
+                out.push_back(std::byte(pending));
+                pending >>= 8;
+                pending_bits -= 8;
+            }
+        }
+        if (pending_bits > 0)
+        {
+            out.push_back(std::byte(pending));
+        }
+    }
+}
+
+const std::byte *delta_unpack(const std::byte *in, const std::byte *end, std::size_t count, node_index *out)
+{
+    node_index previous = std::numeric_limits<node_index>::max();
+    for (std::size_t frame_start = 0; frame_start < count; frame_start += DELTA_FRAME_VALUES)
+    {
+        std::size_t frame_size = std::min(DELTA_FRAME_VALUES, count - frame_start);
+        if (in == end)
+        {
+            return nullptr;
+        }
+        int bits = int(*in++);
+        std::size_t frame_bytes = (frame_size * bits + 7) / 8;
+        if (bits > MAX_DELTA_BITS || std::size_t(end - in) < frame_bytes)
+        {
+            return nullptr;
+        }
+        // The loads of the last gaps read up to 7 bytes past the frame, which may be past the end of the input, so such a frame is copied first
+        const std::byte *frame = in;
+        std::byte padded[DELTA_FRAME_VALUES * 8 + 8];
+        if (std::size_t(end - in) < frame_bytes + 8)
+        {
+            std::memcpy(padded, in, frame_bytes);
+            std::memset(padded + frame_bytes, 0, 8);
+            frame = padded;
+        }
+        const uint64_t mask = (uint64_t(1) << bits) - 1;
+        for (std::size_t i = 0; i < frame_size; i++)
+        {
+            std::size_t bit = i * bits;
+            uint64_t word;
+            std::memcpy(&word, frame + bit / 8, sizeof(word));
+            if constexpr (std::endian::native == std::endian::big)
+            {
+                word = __builtin_bswap64(word);
+            }
+            previous += ((word >> (bit % 8)) & mask) + 1;
+            out[frame_start + i] = previous;
+        }
+        in += frame_bytes;
+    }
+    return in;
+}
+
+namespace
+{
+    // Reads `out.size()` values of BYTES bytes in chunks through a fixed buffer, and decodes every chunk with `decode`
+    template <int BYTES, typename T, typename Decoder>
+    void read_span(std::istream &inputstream, std::span<T> out, Decoder decode, const char *name)
+    {
+        constexpr std::size_t CHUNK = 1 << 12;
+        std::byte buffer[CHUNK * BYTES];
+        for (std::size_t done = 0; done < out.size();)
+        {
+            std::size_t chunk = std::min(CHUNK, out.size() - done);
+            inputstream.read(reinterpret_cast<char *>(buffer), chunk * BYTES);
+            if (inputstream.gcount() != std::streamsize(chunk * BYTES))
+            {
+                throw MyException(std::string("The stream ended while reading ") + std::to_string(out.size()) + " " + name + " values");
+            }
+            decode(buffer, chunk, out.data() + done);
+            done += chunk;
+        }
+    }
+}
+
+void read_uint_ENTITY_span_little_endian(std::istream &inputstream, std::span<node_index> out)
+{
+    read_span<BYTES_PER_ENTITY>(inputstream, out, decode_entities, "entity");
+}
+
+void read_uint_BLOCK_span_little_endian(std::istream &inputstream, std::span<block_index> out)
+{
+    read_span<BYTES_PER_BLOCK>(inputstream, out, decode_blocks, "block");
+}
+
+TripleReader::TripleReader(std::istream &inputstream, std::size_t chunk_triples)
+    : inputstream(inputstream),
+      buffer(chunk_triples * BYTES_PER_TRIPLE),
+      subjects(chunk_triples),
+      predicates(chunk_triples),
+      objects(chunk_triples),
+      count(0),
+      position(0)
+{
+}
+
+bool TripleReader::refill()
+{
+    this->inputstream.read(reinterpret_cast<char *>(this->buffer.data()), this->buffer.size());
+    if (this->inputstream.bad())
+    {
+        throw MyException("Reading the triples failed with stream state " + std::to_string(this->inputstream.rdstate()));
+    }
+    this->count = std::size_t(this->inputstream.gcount()) / BYTES_PER_TRIPLE;
+    this->position = 0;
+    decode_triples(this->buffer.data(), this->count, this->subjects.data(), this->predicates.data(), this->objects.data());
+    return this->count > 0;
+}
+
+namespace
+{
+    // The byte-wise table of the reflected CRC-32C polynomial, for targets without the SSE 4.2 crc32 instruction
+    constexpr std::array<uint32_t, 256> make_crc32c_table()
+    {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    constexpr std::array<uint32_t, 256> CRC32C_TABLE = make_crc32c_table();
+}
+
+uint32_t crc32c(uint32_t crc, const std::byte *data, std::size_t size)
+{
+    crc = ~crc;
+    std::size_t i = 0;
+#if defined(__SSE4_2__)
+    uint64_t crc_64 = crc;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        crc_64 = _mm_crc32_u64(crc_64, word);
+    }
+    crc = uint32_t(crc_64);
+#endif
+    for (; i < size; i++)
+    {
+        crc = (crc >> 8) ^ CRC32C_TABLE[(crc ^ uint32_t(data[i])) & 255];
+    }
+    return ~crc;
+}
@@ -2,7 +2,9 @@
 #include <vector>
 #include <map>
 #include <stack>
-// #include <span>
+#include <atomic>
+#include <span>
+#include <numeric>
 #include <fstream>
 #include <string>
 // #define BOOST_USE_VALGRIND  // TODO disable this command in the final running version
@@ -26,6 +28,8 @@
 #include "../include/my_exception.hpp"
 #include "../include/stopwatch.hpp"
 #include "../include/binary_io.hpp"
+#include "../include/binary_formats.hpp"
+#include "../include/csr_graph.hpp"
 
 using json = nlohmann::json;
 
@@ -33,40 +37,45 @@ using set_of_types = boost::unordered_flat_set<edge_type>;
 
 #define CREATE_REVERSE_INDEX
 
-class Node;
-
-struct Edge
-{
-public:
-    const edge_type label;
-    const node_index target;
-};
-
-class Node
+// Runs `work(thread, begin, end)` on `thread_count` threads, which divide [0, count) into contiguous ranges, e.g. of nodes or of triples.
+// The calling thread takes the first range.
+template <typename Work>
+void run_on_ranges(unsigned int thread_count, uint64_t count, Work work)
 {
-    std::vector<Edge> edges;
-
-public:
-    Node()
+    std::vector<std::thread> workers;
+    for (unsigned int thread = 1; thread < thread_count; thread++)
     {
-        edges.reserve(1);
+        workers.emplace_back(work, thread, count * thread / thread_count, count * (thread + 1) / thread_count);
     }
-    std::vector<Edge>& get_outgoing_edges()
+    work(0, 0, count / thread_count);
+    for (std::thread &worker: workers)
     {
-        std::vector<Edge> & edges_ref = edges;
-        return edges_ref;
+        worker.join();
     }
+}
 
-    void add_edge(edge_type label, node_index target)
-    {
-        edges.emplace_back(label, target);
-    }
-};
-
+// The edges have the layout of the CSR file, such that a snapshot of the graph can be used in place
+using Edge = CSREdge;
+
+// The graph in compressed sparse row (CSR) form: the outgoing edges of all nodes are stored one after the other in a single array,
+// and the edges of node v are edges[offsets[v]] up to edges[offsets[v + 1]]. The reverse index has the same layout.
+// This avoids a vector (and a heap allocation) per node, and a scan over the nodes of a block reads their edges without chasing pointers.
+//
+// The graph is built in two passes over the edges, such that the arrays are allocated once:
+// `start_counting` and `count_edge` for every edge, then `start_filling` and `add_edge` for every edge, and finally `finish_filling`.
+// With CONCURRENT set, several threads can count and add edges at the same time, and the edges of a node end up in any order.
+// The atomic increments that this takes are a few times slower than plain ones, so a single thread does without them.
+//
+// All reads go through views of the arrays. These either point into the vectors that the graph was built in, or into a mapped snapshot
+// (see `load_snapshot`), in which case the graph is used straight from the page cache without being copied.
 class Graph
 {
 private:
-    std::vector<Node> nodes;
+    std::vector<uint64_t> offsets;
+    std::vector<Edge> edges;
+    std::span<const uint64_t> offset_view;
+    std::span<const Edge> edge_view;
+    std::unique_ptr<CSRGraphFile> snapshot;
 
     Graph(Graph &)
     {
@@ -76,70 +85,285 @@ public:
     Graph()
     {
     }
-    node_index add_vertex()
+
+    void start_counting(node_index vertex_count)
     {
-        nodes.emplace_back();
-        return nodes.size() - 1;
+        this->offsets.assign(vertex_count + 1, 0);
+        this->edges.clear();
     }
-    void resize(node_index vertex_count)
+
+    template <bool CONCURRENT = false>
+    void count_edge(node_index source)
     {
-        nodes.resize(vertex_count);
+        if constexpr (CONCURRENT)
+        {
+            std::atomic_ref<uint64_t>(this->offsets[source + 1]).fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            this->offsets[source + 1]++;
+        }
     }
 
-    std::vector<Node>& get_nodes()
+    void start_filling()
     {
-        std::vector<Node> & nodes_ref = nodes;
-        return nodes_ref;
+        for (node_index node = 0; node + 1 < this->offsets.size(); node++)
+        {
+            this->offsets[node + 1] += this->offsets[node];
+        }
+        this->edges.resize(this->offsets.back());
     }
-    inline node_index size()
+
+    // While filling, offsets[v] is where the next edge of v goes
+    template <bool CONCURRENT = false>
+    void add_edge(node_index source, edge_type label, node_index target)
     {
-        return nodes.size();
+        if constexpr (CONCURRENT)
+        {
+            this->edges[std::atomic_ref<uint64_t>(this->offsets[source]).fetch_add(1, std::memory_order_relaxed)] = Edge{label, target};
+        }
+        else
+        {
+            this->edges[this->offsets[source]++] = Edge{label, target};
+        }
+    }
+
+    // Every offset has moved to the start of the next node, so they are shifted back
+    void finish_filling()
+    {
+        if (this->offsets.back() != this->edges.size() || (this->offsets.size() > 1 && this->offsets[this->offsets.size() - 2] != this->edges.size()))
+        {
+            throw MyException("The graph was filled with other edges than were counted. Probably a programming error");
+        }
+        for (node_index node = this->offsets.size() - 1; node > 0; node--)
+        {
+            this->offsets[node] = this->offsets[node - 1];
+        }
+        this->offsets[0] = 0;
+        this->offset_view = this->offsets;
+        this->edge_view = this->edges;
+    }
+
+    std::span<const Edge> get_outgoing_edges(node_index node) const
+    {
+        return this->edge_view.subspan(this->offset_view[node], this->offset_view[node + 1] - this->offset_view[node]);
+    }
+
+    inline node_index size() const
+    {
+        return this->offset_view.empty() ? 0 : this->offset_view.size() - 1;
     }
 #ifdef CREATE_REVERSE_INDEX
-    std::vector<std::vector<node_index>> reverse;
+private:
+    // The distinct predecessors of node v are reverse_sources[reverse_offsets[v]] up to reverse_sources[reverse_offsets[v + 1]]
+    std::vector<uint64_t> reverse_offsets;
+    std::vector<node_index> reverse_sources;
+    std::span<const uint64_t> reverse_offset_view;
+    std::span<const node_index> reverse_source_view;
 
-    void compute_reverse_index()
+public:
+    // Builds the reverse index with a counting sort of the (target, source) pairs, so nothing is allocated per node.
+    // The nodes are divided over `thread_count` threads: they count the predecessors of every target, scatter the sources to their targets,
+    // and then sort and deduplicate the sources of every target in place, which gives the distinct predecessors in increasing order.
+    void compute_reverse_index(unsigned int thread_count)
     {
-        if (!this->reverse.empty())
+        if (!this->reverse_offset_view.empty())
         {
             throw MyException("computing the reverse while this has been computed before. Probably a programming error");
         }
-        size_t number_of_nodes = this->nodes.size();
-        // we create it first with sets to remove duplicates
-        std::vector<boost::unordered_flat_set<node_index>> unique_index(number_of_nodes);
-        for (node_index sourceID = 0; sourceID < number_of_nodes; sourceID++)
+        const node_index number_of_nodes = this->size();
+        thread_count = std::max<uint64_t>(1, std::min<uint64_t>(thread_count, number_of_nodes));
+        this->reverse_offsets.assign(number_of_nodes + 1, 0);
+
+        // First pass: the number of predecessors of every target (with duplicates), which is shifted by one for the prefix sum
+        run_on_ranges(thread_count, number_of_nodes, [&](unsigned int, node_index begin, node_index end)
+        {
+            for (node_index sourceID = begin; sourceID < end; sourceID++)
+            {
+                for (const Edge edge : this->get_outgoing_edges(sourceID))
+                {
+                    std::atomic_ref<uint64_t>(this->reverse_offsets[edge.target + 1]).fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+        for (node_index targetID = 0; targetID < number_of_nodes; targetID++)
+        {
+            this->reverse_offsets[targetID + 1] += this->reverse_offsets[targetID];
+        }
+
+        // Second pass: scatter the sources, while reverse_offsets[v] is where the next predecessor of v goes
+        this->reverse_sources.resize(this->reverse_offsets[number_of_nodes]);
+        run_on_ranges(thread_count, number_of_nodes, [&](unsigned int, node_index begin, node_index end)
         {
-            Node &node = this->nodes[sourceID];
-            for (const Edge edge : node.get_outgoing_edges())
+            for (node_index sourceID = begin; sourceID < end; sourceID++)
             {
-                node_index targetID = edge.target;
-                unique_index[targetID].insert(sourceID);
+                for (const Edge edge : this->get_outgoing_edges(sourceID))
+                {
+                    uint64_t position = std::atomic_ref<uint64_t>(this->reverse_offsets[edge.target]).fetch_add(1, std::memory_order_relaxed);
+                    this->reverse_sources[position] = sourceID;
+                }
             }
+        });
+        // Every offset has moved to the start of the next target, so they are shifted back
+        for (node_index targetID = number_of_nodes; targetID > 0; targetID--)
+        {
+            this->reverse_offsets[targetID] = this->reverse_offsets[targetID - 1];
         }
-        // now convert to the final index
-        this->reverse.resize(number_of_nodes);
-        for (node_index targetID = 0; targetID < number_of_nodes; targetID++)
+        this->reverse_offsets[0] = 0;
+
+        // Sort and deduplicate the sources of every target. Each thread compacts the sources of its targets towards the start of its part of the array.
+        std::vector<uint64_t> part_starts(thread_count);
+        std::vector<uint64_t> part_ends(thread_count);
+        run_on_ranges(thread_count, number_of_nodes, [&](unsigned int thread, node_index begin, node_index end)
         {
-            for (const node_index &sourceID : unique_index[targetID])
+            uint64_t write_position = this->reverse_offsets[begin];
+            part_starts[thread] = write_position;
+            for (node_index targetID = begin; targetID < end; targetID++)
             {
-                this->reverse[targetID].push_back(sourceID);
+                // The offset of the next target is read before it is overwritten. The first target of a part keeps its offset,
+                // which is not written at all, since the previous thread reads it as the end of its last target.
+                auto first = this->reverse_sources.begin() + this->reverse_offsets[targetID];
+                auto last = this->reverse_sources.begin() + this->reverse_offsets[targetID + 1];
+                std::sort(first, last);
+                last = std::unique(first, last);
+                if (targetID != begin)
+                {
+                    this->reverse_offsets[targetID] = write_position;
+                }
+                write_position = std::copy(first, last, this->reverse_sources.begin() + write_position) - this->reverse_sources.begin();
+            }
+            part_ends[thread] = write_position;
+        });
+        // Move the compacted parts together
+        uint64_t reverse_edge_count = part_ends[0];
+        for (unsigned int thread = 1; thread < thread_count; thread++)
+        {
+            uint64_t shift = part_starts[thread] - reverse_edge_count;
+            std::copy(this->reverse_sources.begin() + part_starts[thread], this->reverse_sources.begin() + part_ends[thread], this->reverse_sources.begin() + reverse_edge_count);
+            for (node_index targetID = number_of_nodes * thread / thread_count; targetID < number_of_nodes * (thread + 1) / thread_count; targetID++)
+            {
+                this->reverse_offsets[targetID] -= shift;
             }
-            // minimize memory usage
-            this->reverse[targetID].shrink_to_fit();
+            reverse_edge_count += part_ends[thread] - part_starts[thread];
         }
+        this->reverse_offsets[number_of_nodes] = reverse_edge_count;
+        this->reverse_sources.resize(reverse_edge_count);
+        this->reverse_sources.shrink_to_fit();
+        this->reverse_offset_view = this->reverse_offsets;
+        this->reverse_source_view = this->reverse_sources;
+    }
+
+    // The distinct predecessors of `node`
+    std::span<const node_index> predecessors(node_index node) const
+    {
+        return this->reverse_source_view.subspan(this->reverse_offset_view[node], this->reverse_offset_view[node + 1] - this->reverse_offset_view[node]);
+    }
+
+    // Uses the arrays of a mapped snapshot in place. The graph keeps the mapping open for as long as it lives.
+    void load_snapshot(std::unique_ptr<CSRGraphFile> file)
+    {
+        this->offsets.clear();
+        this->edges.clear();
+        this->reverse_offsets.clear();
+        this->reverse_sources.clear();
+        this->offset_view = file->get_forward_offsets();
+        this->edge_view = file->get_edges();
+        this->reverse_offset_view = file->get_reverse_offsets();
+        this->reverse_source_view = file->get_sources();
+        this->snapshot = std::move(file);
+    }
+
+    // Writes the graph and its reverse index as a snapshot, which `load_snapshot` can use on a later run
+    void write_snapshot(const std::string &csr_file, const CSRSource &source, edge_type rdf_type_id) const
+    {
+        write_csr_graph(csr_file, source, rdf_type_id, this->offset_view, this->edge_view, this->reverse_offset_view, this->reverse_source_view);
+    }
+
+    // Renumbers the nodes, such that node `new_to_old[v]` becomes node v, where `old_to_new` is the inverse permutation.
+    // The edges of every node keep their order and the predecessors are sorted again. Afterwards the graph owns its arrays, also if it used a snapshot before.
+    void relabel_nodes(const std::vector<node_index> &new_to_old, const std::vector<node_index> &old_to_new, unsigned int thread_count)
+    {
+        const node_index number_of_nodes = this->size();
+        thread_count = std::max<uint64_t>(1, std::min<uint64_t>(thread_count, number_of_nodes));
+        std::vector<uint64_t> new_offsets(number_of_nodes + 1, 0);
+        std::vector<uint64_t> new_reverse_offsets(number_of_nodes + 1, 0);
+        for (node_index node = 0; node < number_of_nodes; node++)
+        {
+            new_offsets[node + 1] = new_offsets[node] + this->get_outgoing_edges(new_to_old[node]).size();
+            new_reverse_offsets[node + 1] = new_reverse_offsets[node] + this->predecessors(new_to_old[node]).size();
+        }
+        std::vector<Edge> new_edges(new_offsets[number_of_nodes]);
+        std::vector<node_index> new_reverse_sources(new_reverse_offsets[number_of_nodes]);
+        run_on_ranges(thread_count, number_of_nodes, [&](unsigned int, node_index begin, node_index end)
+        {
+            for (node_index node = begin; node < end; node++)
+            {
+                uint64_t position = new_offsets[node];
+                for (const Edge edge : this->get_outgoing_edges(new_to_old[node]))
+                {
+                    new_edges[position++] = Edge{edge.label, old_to_new[edge.target]};
+                }
+                auto first = new_reverse_sources.begin() + new_reverse_offsets[node];
+                auto last = first;
+                for (node_index source : this->predecessors(new_to_old[node]))
+                {
+                    *last++ = old_to_new[source];
+                }
+                std::sort(first, last);
+            }
+        });
+        this->offsets = std::move(new_offsets);
+        this->edges = std::move(new_edges);
+        this->reverse_offsets = std::move(new_reverse_offsets);
+        this->reverse_sources = std::move(new_reverse_sources);
+        this->offset_view = this->offsets;
+        this->edge_view = this->edges;
+        this->reverse_offset_view = this->reverse_offsets;
+        this->reverse_source_view = this->reverse_sources;
+        this->snapshot.reset();
     }
 #endif
 };
 
-u_int64_t read_graph_from_stream_timed(std::istream &inputstream, Graph &g)
+// The two passes of loading a graph from triples, which divide the records over the threads. These index the mapped file directly.
+template <bool CONCURRENT, typename TripleView>
+void count_and_fill_edges(const TripleView &triples, Graph &g, unsigned int thread_count)
 {
-    StopWatch<boost::chrono::process_cpu_clock> w = StopWatch<boost::chrono::process_cpu_clock>::create_not_started();
-
-    const int BufferSize = 8 * 16184;
-
-    char _buffer[BufferSize];
+    const node_index vertex_count = triples.header().id_bound;
+    std::atomic<bool> damaged = false;
+    run_on_ranges(thread_count, triples.size(), [&](unsigned int, uint64_t begin, uint64_t end)
+    {
+        for (uint64_t index = begin; index < end; index++)
+        {
+            TripleRecord triple = triples[index];
+            if (triple.subject >= vertex_count || triple.object >= vertex_count)
+            {
+                damaged = true;
+                return;
+            }
+            g.template count_edge<CONCURRENT>(triple.subject);
+        }
+    });
+    if (damaged)
+    {
+        throw MyException("The triple file holds a node beyond the largest ID in its header. The file is damaged");
+    }
+    g.start_filling();
+    run_on_ranges(thread_count, triples.size(), [&](unsigned int, uint64_t begin, uint64_t end)
+    {
+        for (uint64_t index = begin; index < end; index++)
+        {
+            TripleRecord triple = triples[index];
+            g.template add_edge<CONCURRENT>(triple.subject, triple.predicate, triple.object);
+        }
+    });
+}
 
-    inputstream.rdbuf()->pubsetbuf(_buffer, BufferSize);
+// Reads a graph from a triple file of any entity width, see `read_graph_from_file_timed`
+template <typename TripleView>
+u_int64_t read_graph_from_triples_timed(const TripleView &triples, Graph &g, unsigned int thread_count)
+{
+    StopWatch<boost::chrono::process_cpu_clock> w = StopWatch<boost::chrono::process_cpu_clock>::create_not_started();
 
     w.start_step("Reading graph");
     u_int64_t edge_count = 0;
@@ -149,66 +373,39 @@ u_int64_t read_graph_from_stream_timed(std::istream &inputstream, Graph &g)
     std::tm *ptm_start{std::localtime(&time_t_start)};
 
     std::cout << std::put_time(ptm_start, "%Y/%m/%d %H:%M:%S") << " Reading started" << std::endl;
-    while (true)
+    // The outcome files store every entity in BYTES_PER_ENTITY bytes, no matter how wide they are in the triple file
+    if (triples.header().id_bound > (uint64_t(1) << (8 * BYTES_PER_ENTITY)))
     {
-        // subject
-        // node_index subject_index = node_ID_Mapper.getID(parts[0]);
-        node_index subject_index = read_uint_ENTITY_little_endian(inputstream);
-
-        // edge
-        // edge_type edge_label = edge_ID_Mapper.getID(parts[1]);
-        edge_type edge_label = read_uint_PREDICATE_little_endian(inputstream);
-
-        // object
-        // node_index object_index = node_ID_Mapper.getID(parts[2]);
-        node_index object_index = read_uint_ENTITY_little_endian(inputstream);
-
-        // Break when the last valid values have been read
-        if (inputstream.eof())
-        {
-            break;
-        }
-        // std::cout << subject_index << " " << edge_label <<  " " << object_index << std::endl;
-
-        // Add Nodes
-        // while (subject_index >= g.get_nodes().size())
-        // {
-        //     g.add_vertex();
-        // }
-        // while (object_index >= g.get_nodes().size())
-        // {
-        //     g.add_vertex();
-        // }
-        node_index largest = std::max(subject_index, object_index);
-        if (largest >= g.size())
-        {
-            g.resize(largest + 1);
-        }
-
-        g.get_nodes()[subject_index].add_edge(edge_label, object_index);
-        // also add reverse
-        // g.get_nodes()[object_index].add_edge(edge_label, subject_index);
-
-        if (edge_count % 1000000 == 0)
-        {
-            auto now{boost::chrono::system_clock::to_time_t(boost::chrono::system_clock::now())};
-            std::tm *ptm{std::localtime(&now)};
-            std::cout << std::put_time(ptm, "%Y/%m/%d %H:%M:%S") << " done with " << edge_count << " triples" << std::endl;
-        }
-        edge_count++;
+        throw MyException("The graph has " + std::to_string(triples.header().id_bound) + " entities, but the outcome files can only hold entities of " + std::to_string(BYTES_PER_ENTITY) + " bytes");
+    }
+    // The header knows the largest node, so the first pass only has to count the out-degrees
+    node_index vertex_count = triples.header().id_bound;
+    edge_count = triples.size();
+    thread_count = std::max<uint64_t>(1, std::min<uint64_t>(thread_count, edge_count));
+    g.start_counting(vertex_count);
+    if (thread_count == 1)
+    {
+        count_and_fill_edges<false>(triples, g, thread_count);
     }
+    else
+    {
+        count_and_fill_edges<true>(triples, g, thread_count);
+    }
+    g.finish_filling();
     w.stop_step();
 
     auto t_reading_done{boost::chrono::system_clock::now()};
     auto time_t_reading_done{boost::chrono::system_clock::to_time_t(t_reading_done)};
     std::tm *ptm_reading_done{std::localtime(&time_t_reading_done)};
 
+    double reading_seconds = boost::chrono::duration<double>(t_reading_done - t_start).count();
     std::cout << std::put_time(ptm_reading_done, "%Y/%m/%d %H:%M:%S")
               << " Time taken for reading = " << boost::chrono::ceil<boost::chrono::milliseconds>(t_reading_done - t_start).count()
-              << " ms, memory = " << w.get_times()[0].memory_in_kb << " kB" << std::endl;
+              << " ms with " << thread_count << " threads (" << std::fixed << std::setprecision(1) << triples.size_in_bytes() / 1e6 / std::max(reading_seconds, 1e-9)
+              << std::defaultfloat << " MB/s), memory = " << w.get_times()[0].memory_in_kb << " kB" << std::endl;
 #ifdef CREATE_REVERSE_INDEX
     w.start_step("Creating reverse index");
-    g.compute_reverse_index();
+    g.compute_reverse_index(thread_count);
     w.stop_step();
 
     auto t_reverse_index_done{boost::chrono::system_clock::now()};
@@ -222,14 +419,186 @@ u_int64_t read_graph_from_stream_timed(std::istream &inputstream, Graph &g)
     return edge_count;
 }
 
-u_int64_t read_graph_timed(const std::string &filename, Graph &g)
+u_int64_t read_graph_from_file_timed(const std::string &filename, Graph &g, unsigned int thread_count)
 {
+    return visit_triple_file(filename, [&](const auto &triples) { return read_graph_from_triples_timed(triples, g, thread_count); });
+}
+
+// Maps the graph and its reverse index from a snapshot (see csr_graph.hpp), which skips parsing the triples and building the reverse index.
+// Sets `rdf_type_id` to the one that is stored in the snapshot.
+u_int64_t read_graph_from_snapshot_timed(const std::string &filename, Graph &g, edge_type &rdf_type_id)
+{
+    StopWatch<boost::chrono::process_cpu_clock> w = StopWatch<boost::chrono::process_cpu_clock>::create_not_started();
+    w.start_step("Mapping graph snapshot");
 
-    std::ifstream infile(filename, std::ifstream::in);
-    u_int64_t edge_count = read_graph_from_stream_timed(infile, g);
+    auto t_start{boost::chrono::system_clock::now()};
+    auto time_t_start{boost::chrono::system_clock::to_time_t(t_start)};
+    std::tm *ptm_start{std::localtime(&time_t_start)};
+    std::cout << std::put_time(ptm_start, "%Y/%m/%d %H:%M:%S") << " Mapping the graph snapshot " << filename << std::endl;
+
+    std::unique_ptr<CSRGraphFile> csr = std::make_unique<CSRGraphFile>(filename);
+    u_int64_t edge_count = csr->edge_count();
+    rdf_type_id = csr->rdf_type_id();
+    g.load_snapshot(std::move(csr));
+    w.stop_step();
+
+    auto t_reading_done{boost::chrono::system_clock::now()};
+    auto time_t_reading_done{boost::chrono::system_clock::to_time_t(t_reading_done)};
+    std::tm *ptm_reading_done{std::localtime(&time_t_reading_done)};
+    std::cout << std::put_time(ptm_reading_done, "%Y/%m/%d %H:%M:%S")
+              << " Time taken for mapping the graph snapshot = " << boost::chrono::ceil<boost::chrono::milliseconds>(t_reading_done - t_start).count()
+              << " ms, memory = " << w.get_times()[0].memory_in_kb << " kB" << std::endl;
     return edge_count;
 }
 
+// Reads the id for rdf:type from the metadata of the preprocessor, if it exists, otherwise returns MAX_EDGE_ID
+edge_type read_rdf_type_id(const std::string &input_path)
+{
+    std::ifstream rel2id_metadata_file(input_path + "rel2ID.meta.json");
+    json rel2id_metadata;
+    rel2id_metadata_file >> rel2id_metadata;
+    return rel2id_metadata["special_relations"].value("http://www.w3.org/1999/02/22-rdf-syntax-ns#type", MAX_EDGE_ID);
+}
+
+u_int64_t read_graph_timed(const std::string &filename, Graph &g, unsigned int thread_count)
+{
+
+    u_int64_t edge_count = read_graph_from_file_timed(filename, g, thread_count);
+    return edge_count;
+}
+
+// The order in which the nodes are numbered during the bisimulation. The IDs of the preprocessor follow the order in which the IRIs appear,
+// so the targets of the edges of a block are spread over the whole graph, and looking up their blocks misses the cache on almost every edge.
+// Renumbering the nodes such that neighbours get nearby IDs makes these lookups more local. All orders treat the graph as undirected.
+enum class NodeOrder
+{
+    none,    // The IDs of the preprocessor
+    bfs,     // A breadth-first search from every node that has not been reached yet, in the order of the original IDs
+    degree,  // By decreasing degree, such that the blocks of the hubs, which are looked up most, are close together
+    rcm      // Reverse Cuthill-McKee: a breadth-first search from nodes of low degree that visits the neighbours by increasing degree, reversed
+};
+
+NodeOrder parse_node_order(const std::string &name)
+{
+    if (name == "none")
+    {
+        return NodeOrder::none;
+    }
+    else if (name == "bfs")
+    {
+        return NodeOrder::bfs;
+    }
+    else if (name == "degree")
+    {
+        return NodeOrder::degree;
+    }
+    else if (name == "rcm")
+    {
+        return NodeOrder::rcm;
+    }
+    throw MyException("Unknown node order \"" + name + "\", use \"none\", \"bfs\", \"degree\" or \"rcm\"");
+}
+
+#ifdef CREATE_REVERSE_INDEX
+// Returns the nodes in their new order, i.e. the node at position v gets ID v
+std::vector<node_index> compute_node_order(const Graph &g, NodeOrder order)
+{
+    const node_index number_of_nodes = g.size();
+    std::vector<uint64_t> degrees(number_of_nodes);
+    for (node_index node = 0; node < number_of_nodes; node++)
+    {
+        degrees[node] = g.get_outgoing_edges(node).size() + g.predecessors(node).size();
+    }
+    auto by_increasing_degree = [&](node_index a, node_index b) { return degrees[a] < degrees[b]; };
+
+    std::vector<node_index> new_to_old;
+    new_to_old.reserve(number_of_nodes);
+    if (order == NodeOrder::degree)
+    {
+        new_to_old.resize(number_of_nodes);
+        std::iota(new_to_old.begin(), new_to_old.end(), 0);
+        std::stable_sort(new_to_old.begin(), new_to_old.end(), [&](node_index a, node_index b) { return degrees[a] > degrees[b]; });
+        return new_to_old;
+    }
+
+    std::vector<node_index> starts(number_of_nodes);
+    std::iota(starts.begin(), starts.end(), 0);
+    if (order == NodeOrder::rcm)
+    {
+        std::stable_sort(starts.begin(), starts.end(), by_increasing_degree);
+    }
+    // The nodes that have been numbered so far also serve as the queue of the search
+    boost::dynamic_bitset<> reached(number_of_nodes);
+    std::vector<node_index> neighbours;
+    for (node_index start : starts)
+    {
+        if (reached[start])
+        {
+            continue;
+        }
+        reached.set(start);
+        std::size_t head = new_to_old.size();
+        new_to_old.push_back(start);
+        while (head < new_to_old.size())
+        {
+            node_index node = new_to_old[head++];
+            neighbours.clear();
+            for (const Edge edge : g.get_outgoing_edges(node))
+            {
+                if (!reached[edge.target])
+                {
+                    reached.set(edge.target);
+                    neighbours.push_back(edge.target);
+                }
+            }
+            for (node_index source : g.predecessors(node))
+            {
+                if (!reached[source])
+                {
+                    reached.set(source);
+                    neighbours.push_back(source);
+                }
+            }
+            if (order == NodeOrder::rcm)
+            {
+                std::stable_sort(neighbours.begin(), neighbours.end(), by_increasing_degree);
+            }
+            new_to_old.insert(new_to_old.end(), neighbours.begin(), neighbours.end());
+        }
+    }
+    if (order == NodeOrder::rcm)
+    {
+        std::reverse(new_to_old.begin(), new_to_old.end());
+    }
+    return new_to_old;
+}
+
+// Renumbers the nodes of the graph in the given order. Returns the original ID of every new node, which the outcome files are written with.
+std::vector<node_index> reorder_nodes_timed(Graph &g, NodeOrder order, const std::string &order_name, unsigned int thread_count)
+{
+    StopWatch<boost::chrono::process_cpu_clock> w = StopWatch<boost::chrono::process_cpu_clock>::create_not_started();
+    w.start_step("Reordering nodes");
+    auto t_start{boost::chrono::system_clock::now()};
+
+    std::vector<node_index> new_to_old = compute_node_order(g, order);
+    std::vector<node_index> old_to_new(new_to_old.size());
+    for (node_index node = 0; node < new_to_old.size(); node++)
+    {
+        old_to_new[new_to_old[node]] = node;
+    }
+    g.relabel_nodes(new_to_old, old_to_new, thread_count);
+    w.stop_step();
+
+    auto t_reordering_done{boost::chrono::system_clock::now()};
+    auto time_t_reordering_done{boost::chrono::system_clock::to_time_t(t_reordering_done)};
+    std::tm *ptm_reordering_done{std::localtime(&time_t_reordering_done)};
+    std::cout << std::put_time(ptm_reordering_done, "%Y/%m/%d %H:%M:%S")
+              << " Time taken for reordering the nodes (" << order_name << ") = " << boost::chrono::ceil<boost::chrono::milliseconds>(t_reordering_done - t_start).count()
+              << " ms, memory = " << w.get_times()[0].memory_in_kb << " kB" << std::endl;
+    return new_to_old;
+}
+#endif
+
 using Block = std::vector<node_index>;
 
 using BlockPtr = std::shared_ptr<Block>;
@@ -477,7 +846,7 @@ KBisumulationOutcome get_0_bisimulation(Graph &g)
 
     BlockPtr block = std::make_shared<Block>();
 
-    std::size_t amount = g.get_nodes().size();
+    std::size_t amount = g.size();
     block->reserve(amount);
     for (unsigned int i = 0; i < amount; i++)
     {
@@ -499,12 +868,9 @@ KBisumulationOutcome get_typed_0_bisimulation(Graph &g, edge_type rdf_type_id=MA
 {
     // collect the signatures for nodes in the block
     boost::unordered_flat_map<set_of_types, BlockPtr> partition_map;
-    auto nodes = g.get_nodes();
-
-    for (uint64_t i = 0; i < nodes.size(); i++ ){
+    for (uint64_t i = 0; i < g.size(); i++ ){
         set_of_types set_of_types_of_node;
-        Node & node = nodes[i];
-        for (auto edge : node.get_outgoing_edges()){
+        for (auto edge : g.get_outgoing_edges(i)){
             // N.B. the code assumes MAX_EDGE_ID corresponds to no rdf_type_id having been found.
             // The following will happily run if edge.label ever reaches MAX_EDGE_ID, which could in very rare cases cause incorrect outputs, without crashing.
             if (edge.label == rdf_type_id){
@@ -603,7 +969,7 @@ KBisumulationOutcome get_k_bisimulation(Graph &g, const KBisumulationOutcome &k_
             {
                 node_index v = *v_iter;
                 signature_t signature;
-                for (Edge edge_info : g.get_nodes()[v].get_outgoing_edges())
+                for (Edge edge_info : g.get_outgoing_edges(v))
                 {
                     size_t to_block = k_minus_one_outcome.get_block_ID_for_node(edge_info.target);
                     signature.emplace(edge_info.label, to_block);
@@ -666,7 +1032,7 @@ KBisumulationOutcome get_k_bisimulation(Graph &g, const KBisumulationOutcome &k_
         {
             node_index v = *v_iter;
             signature_t signature;
-            for (Edge edge_info : g.get_nodes()[v].get_outgoing_edges())
+            for (Edge edge_info : g.get_outgoing_edges(v))
             {
                 size_t to_block = k_minus_one_outcome.get_block_ID_for_node(edge_info.target);
                 signature.emplace(edge_info.label, to_block);
@@ -753,11 +1119,11 @@ KBisumulationOutcome get_k_bisimulation(Graph &g, const KBisumulationOutcome &k_
     // start marking
     for (node_index target : nodes_from_split_blocks)
     {
-        if (target > g.size() || target < 0)
+        if (target >= g.size() || target < 0)
         {
             throw MyException("impossible: target index goes beyond graph size");
         }
-        for (node_index source : g.reverse.at(target))
+        for (node_index source : g.predecessors(target))
         {
             if (source > g.size() || target < 0)
             {
@@ -781,10 +1147,8 @@ KBisumulationOutcome get_k_bisimulation(Graph &g, const KBisumulationOutcome &k_
         }
     }
 #else
-    std::vector<Node> nodes = g.get_nodes();
-    for (node_index the_node_index = 0; the_node_index < nodes.size(); the_node_index++)
+    for (node_index the_node_index = 0; the_node_index < g.size(); the_node_index++)
     {
-        Node &node = nodes[the_node_index];
         int64_t source_block = k_node_to_block->get_block(the_node_index);
         if (source_block < 0)
         {
@@ -799,7 +1163,7 @@ KBisumulationOutcome get_k_bisimulation(Graph &g, const KBisumulationOutcome &k_
         }
         // else
 
-        for (auto edge : node.get_outgoing_edges())
+        for (auto edge : g.get_outgoing_edges(the_node_index))
         {
             if (nodes_from_split_blocks.contains(edge.target))
             {
@@ -817,15 +1181,62 @@ KBisumulationOutcome get_k_bisimulation(Graph &g, const KBisumulationOutcome &k_
     return outcome;
 }
 
-void run_k_bisimulation_store_partition_condensed_timed(const std::string &input_path, uint support, const std::string &output_path, bool typed_start)
+void run_k_bisimulation_store_partition_condensed_timed(const std::string &input_path, uint support, const std::string &output_path, bool typed_start, bool pack_outcomes, unsigned int thread_count,
+                                                        bool write_snapshot, NodeOrder node_order, const std::string &node_order_name)
 {
 
     StopWatch<boost::chrono::process_cpu_clock> w = StopWatch<boost::chrono::process_cpu_clock>::create_not_started();
     Graph g;
     w.start_step("Read graph", true);  // Set newline to true
-    uint64_t edge_count = read_graph_timed(input_path + "binary_encoding.bin", g);
+    // The snapshot is only present if the preprocessor was run with --csr, or an earlier run with --snapshot.
+    // It is only used if it was built from the current binary encoding.
+    const std::string binary_file = input_path + "binary_encoding.bin";
+    const std::string snapshot_file = input_path + "graph_csr.bin";
+    const bool snapshot_exists = std::filesystem::exists(snapshot_file);
+    CSRSource source{};
+    if (snapshot_exists || write_snapshot)
+    {
+        source = CSRSource::of(binary_file);
+    }
+    uint64_t edge_count;
+    edge_type rdf_type_id = MAX_EDGE_ID;
+    if (snapshot_exists && CSRGraphFile::is_built_from(snapshot_file, source))
+    {
+        edge_count = read_graph_from_snapshot_timed(snapshot_file, g, rdf_type_id);
+    }
+    else
+    {
+        if (snapshot_exists)
+        {
+            std::cout << "Ignoring the graph snapshot " << snapshot_file << ", since it was not built from the current " << binary_file << std::endl;
+        }
+        edge_count = read_graph_timed(binary_file, g, thread_count);
+        if (typed_start || write_snapshot)
+        {
+            rdf_type_id = read_rdf_type_id(input_path);
+        }
+        if (write_snapshot)
+        {
+            g.write_snapshot(snapshot_file, source, rdf_type_id);
+            std::cout << "Wrote the graph snapshot " << snapshot_file << std::endl;
+        }
+    }
     w.stop_step();
 
+    // The nodes are renumbered after the snapshot is written, which keeps the original IDs. The outcome files are written with the original IDs as well.
+    std::vector<node_index> original_ids;
+    if (node_order != NodeOrder::none)
+    {
+#ifdef CREATE_REVERSE_INDEX
+        w.start_step("Reordering nodes", true);  // Set newline to true
+        original_ids = reorder_nodes_timed(g, node_order, node_order_name, thread_count);
+        w.stop_step();
+#else
+        throw MyException("Reordering the nodes needs the reverse index");
+#endif
+    }
+    auto original_id = [&](node_index v) { return original_ids.empty() ? v : original_ids[v]; };
+
     auto t_start_bisim{boost::chrono::system_clock::now()};
     auto time_t_start_bisim{boost::chrono::system_clock::to_time_t(t_start_bisim)};
     std::tm *ptm_start_bisim{std::localtime(&time_t_start_bisim)};
@@ -833,6 +1244,7 @@ void run_k_bisimulation_store_partition_condensed_timed(const std::string &input
     std::ofstream graph_stats_output(output_path + "ad_hoc_results/graph_stats.json", std::ios::trunc);
     graph_stats_output << "{\n    \"Vertex count\": " << g.size();
     graph_stats_output << ",\n    \"Edge count\": " << edge_count;
+    graph_stats_output << ",\n    \"Node order\": \"" << node_order_name << "\"";
 
     std::cout << std::put_time(ptm_start_bisim, "%Y/%m/%d %H:%M:%S") << " Graph read with " << g.size() << " nodes" << std::endl;
     std::vector<std::string> lines;
@@ -848,12 +1260,6 @@ void run_k_bisimulation_store_partition_condensed_timed(const std::string &input
     }
     else
     {
-        // Read the id for rdf:type, if it exists, otherwise assign MAX_EDGE_ID
-        std::ifstream rel2id_metadata_file(input_path + "rel2ID.meta.json");
-        json rel2id_metadata;
-        rel2id_metadata_file >> rel2id_metadata;
-        edge_type rdf_type_id = rel2id_metadata["special_relations"].value("http://www.w3.org/1999/02/22-rdf-syntax-ns#type", MAX_EDGE_ID);
-
         res_ptr = std::make_unique<KBisumulationOutcome>(get_typed_0_bisimulation(g, rdf_type_id));
     }
     KBisumulationOutcome res = *res_ptr;
@@ -888,21 +1294,20 @@ void run_k_bisimulation_store_partition_condensed_timed(const std::string &input
         ad_hoc_output.flush();
 
         w.start_step("0000-bisimulation (condensed) writing outcome to disk", true);  // Set newline to true
-        std::ofstream condensed_output(output_path + "bisimulation/outcome_condensed-0000.bin", std::ios::trunc);
+        OutcomeFileWriter condensed_writer(output_path + "bisimulation/outcome_condensed-0000.bin", pack_outcomes);
         // bool found_singletons = false;
         for (block_index i = 0; i<outcomes[0].blocks.size(); i++)
         {
             BlockPtr new_block_ptr = outcomes[0].blocks[i];
             uint64_t block_size = new_block_ptr->end() - new_block_ptr->begin();
-            write_uint_BLOCK_little_endian(condensed_output, i+1);  // We add 1, because we want to reserve 0 for the singleton blocks
-            write_uint_ENTITY_little_endian(condensed_output, u_int64_t(block_size));  // The reader needs this size to decode the data
+            condensed_writer.write_block(i+1, u_int64_t(block_size));  // We add 1, because we want to reserve 0 for the singleton blocks. The reader needs the size to decode the data
             for (auto v_iter = new_block_ptr->begin(); v_iter != new_block_ptr->end(); v_iter++)
             {
-                node_index v = *v_iter;
-                write_uint_ENTITY_little_endian(condensed_output, u_int64_t(v));  // We store each entity contained in the new block
+                node_index v = original_id(*v_iter);
+                condensed_writer.write_value(u_int64_t(v));  // We store each entity contained in the new block
             }
         }
-        condensed_output.flush();
+        condensed_writer.finish();
         w.stop_step();
         previous_total = outcomes[0].total_blocks();
     }
@@ -933,17 +1338,16 @@ void run_k_bisimulation_store_partition_condensed_timed(const std::string &input
         if (typed_start || i > 0)
         {
             w.start_step(k_next_string + "-bisimulation writing " + k_string + " to " + k_next_string + " refines edges to disk");
-            std::ofstream mapping_output(output_path + "bisimulation/mapping-" + k_string + "to" + k_next_string + ".bin", std::ios::trunc);
+            MappingFileWriter mapping_writer(output_path + "bisimulation/mapping-" + k_string + "to" + k_next_string + ".bin");
             for (auto orig_new: outcomes[0].k_minus_one_to_k_mapping.refines_edges)
             {
                 block_index split_block_count = u_int64_t(orig_new.second.size());
                 new_block_count += split_block_count;
-                write_uint_BLOCK_little_endian(mapping_output, u_int64_t(orig_new.first));
-                write_uint_BLOCK_little_endian(mapping_output, split_block_count);  // Store in how many blocks the original block had split
+                mapping_writer.write_block(u_int64_t(orig_new.first), split_block_count);  // Store in how many blocks the original block had split
                 for (auto new_block: orig_new.second)
                 {
                     // BlockPtr new_block_ptr = res.blocks[new_block];
-                    write_uint_BLOCK_little_endian(mapping_output, u_int64_t(new_block));  // Write all the new blocks the old one got split into
+                    mapping_writer.write_value(u_int64_t(new_block));  // Write all the new blocks the old one got split into
 
                     // 0 corresponds to a special block for singletons and as such requires special care
                     if (new_block == 0)
@@ -953,7 +1357,7 @@ void run_k_bisimulation_store_partition_condensed_timed(const std::string &input
                 }
             }
             w.stop_step();
-            mapping_output.flush();
+            mapping_writer.finish();
         }
 
         pre_accumulated_block_count = pre_accumulated_block_count + new_block_count;
@@ -968,7 +1372,7 @@ void run_k_bisimulation_store_partition_condensed_timed(const std::string &input
         ad_hoc_output.flush();
 
         w.start_step(k_next_string + "-bisimulation (condensed) writing outcome to disk", true);  // Set newline to true
-        std::ofstream condensed_output(output_path + "bisimulation/outcome_condensed-" + k_next_string + ".bin", std::ios::trunc);
+        OutcomeFileWriter condensed_writer(output_path + "bisimulation/outcome_condensed-" + k_next_string + ".bin", pack_outcomes);
         // bool found_singletons = false;
         for (auto orig_new: outcomes[0].k_minus_one_to_k_mapping.refines_edges)
         {
@@ -983,16 +1387,15 @@ void run_k_bisimulation_store_partition_condensed_timed(const std::string &input
                 // We have to subtract 1 because we added 1 earlier
                 BlockPtr new_block_ptr = outcomes[0].blocks[new_block-1];
                 uint64_t block_size = new_block_ptr->end() - new_block_ptr->begin();
-                write_uint_BLOCK_little_endian(condensed_output, u_int64_t(new_block));
-                write_uint_ENTITY_little_endian(condensed_output, u_int64_t(block_size));  // The reader needs this size to decode the data
+                condensed_writer.write_block(u_int64_t(new_block), u_int64_t(block_size));  // The reader needs the size to decode the data
                 for (auto v_iter = new_block_ptr->begin(); v_iter != new_block_ptr->end(); v_iter++)
                 {
-                    node_index v = *v_iter;
-                    write_uint_ENTITY_little_endian(condensed_output, u_int64_t(v));  // We store each entity contained in the new block
+                    node_index v = original_id(*v_iter);
+                    condensed_writer.write_value(u_int64_t(v));  // We store each entity contained in the new block
                 }
             }
         }
-        condensed_output.flush();
+        condensed_writer.finish();
         // // For the first outcome write the singltons into block 0
         // if (i == 0 && found_singletons)
         // {
@@ -1089,6 +1492,10 @@ int main(int ac, char *av[])
         run_timed_desc.add_options()("output,o", po::value<std::string>(), "output, the output path");
         // run_timed_desc.add_options()("skip_singletons", "flag indicating that singletons must be skipped in the output");
         run_timed_desc.add_options()("typed_start", "flag indicating that the nodes are initially (at k=0) partitioned acording to their RDF type set");
+        run_timed_desc.add_options()("pack_outcomes", "flag indicating that the entities in the outcome files are sorted and delta packed, which makes the files smaller");
+        run_timed_desc.add_options()("threads", po::value<unsigned int>(), "the number of threads that load the graph and build its reverse index, default is the number of hardware threads");
+        run_timed_desc.add_options()("reorder", po::value<std::string>()->default_value("none"), "the order in which the nodes are renumbered before the bisimulation to make the block lookups more local: none, bfs, degree or rcm. The outcome files keep the original IDs");
+        run_timed_desc.add_options()("snapshot", "flag indicating that the graph and its reverse index are written to graph_csr.bin, which later runs on the same binary encoding map instead of reading the triples");
 
         // Collect all the unrecognized options from the first pass. This will include the
         // (positional) command name, so we need to erase that.
@@ -1105,11 +1512,20 @@ int main(int ac, char *av[])
         std::string output_path = vm["output"].as<std::string>();
         // bool skip_singletons = vm.count("skip_singletons");
         bool typed_start = vm.count("typed_start");
+        bool pack_outcomes = vm.count("pack_outcomes");
+        bool write_snapshot = vm.count("snapshot");
+        std::string node_order_name = vm["reorder"].as<std::string>();
+        NodeOrder node_order = parse_node_order(node_order_name);
+        unsigned int thread_count = vm.count("threads") ? vm["threads"].as<unsigned int>() : std::max(1u, std::thread::hardware_concurrency());
+        if (thread_count == 0)
+        {
+            throw MyException("The number of threads must be at least 1");
+        }
 
         std::filesystem::create_directory(output_path + "bisimulation/");
         std::filesystem::create_directory(output_path + "ad_hoc_results/");
 
-        run_k_bisimulation_store_partition_condensed_timed(input_path, support, output_path, typed_start);
+        run_k_bisimulation_store_partition_condensed_timed(input_path, support, output_path, typed_start, pack_outcomes, thread_count, write_snapshot, node_order, node_order_name);
 
         return 0;
     }
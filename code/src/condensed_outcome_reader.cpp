@@ -7,34 +7,7 @@
 #include <boost/program_options.hpp>
 // #include <vector>
 
-const int BYTES_PER_ENTITY = 5;
-const int BYTES_PER_BLOCK = 4;
-
-u_int64_t read_uint_ENTITY_little_endian(std::istream &inputstream)
-{
-    char data[8];
-    inputstream.read(data, BYTES_PER_ENTITY);
-    u_int64_t result = u_int64_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_ENTITY; i++)
-    {
-        result |= (u_int64_t(data[i]) & 255) << (i * 8); // `& 255` makes sure that we only write one byte of data << (i * 8);
-    }
-    return result;
-}
-
-u_int64_t read_uint_BLOCK_little_endian(std::istream &inputstream)
-{
-    char data[8];
-    inputstream.read(data, BYTES_PER_BLOCK);
-    u_int64_t result = u_int64_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_BLOCK; i++)
-    {
-        result |= (u_int64_t(data[i]) & 255) << (i * 8); // `& 255` makes sure that we only write one byte of data << (i * 8);
-    }
-    return result;
-}
+#include "../include/binary_formats.hpp"
 
 int main(int ac, char *av[])
 {
@@ -55,26 +28,20 @@ int main(int ac, char *av[])
 
     std::string input_file = vm["input_file"].as<std::string>();
 
-    std::ifstream infile(input_file, std::ifstream::in);
     u_int64_t block_count = 0;
-    while (true)
+    OutcomeFile outcome(input_file);
+    outcome.verify_checksum();
+    for (const auto &[block, block_entities]: outcome)
     {
-        u_int64_t block = read_uint_BLOCK_little_endian(infile);
-        if (infile.eof())
-        {
-            if (block_count == 0)
-            {
-                std::cout << "There were no new blocks: This is a fixed point of the bisimulation." << std::endl;
-            }
-            break;
-        }
         block_count++;
-        u_int64_t block_size = read_uint_ENTITY_little_endian(infile);
-        std::cout << "Block: " << block << ", Block Size: " << block_size << std::endl;
-        for (u_int64_t i = 0; i < block_size; i++)
+        std::cout << "Block: " << block << ", Block Size: " << block_entities.size() << std::endl;
+        for (node_index entity: block_entities)
         {
-            u_int64_t entity = read_uint_ENTITY_little_endian(infile);
             std::cout << "Entity: " << entity << std::endl;
         }
     }
+    if (block_count == 0)
+    {
+        std::cout << "There were no new blocks: This is a fixed point of the bisimulation." << std::endl;
+    }
 }
@@ -3,40 +3,14 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <filesystem>
 #include <boost/algorithm/string.hpp>
 #include <boost/unordered/unordered_flat_map.hpp>
 #include <iostream>
 #include <boost/program_options.hpp>
 // #include <vector>
 
-const int BYTES_PER_ENTITY = 5;
-const int BYTES_PER_BLOCK = 4;
-
-u_int64_t read_uint_ENTITY_little_endian(std::istream &inputstream)
-{
-    char data[8];
-    inputstream.read(data, BYTES_PER_ENTITY);
-    u_int64_t result = u_int64_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_ENTITY; i++)
-    {
-        result |= (u_int64_t(data[i]) & 255) << (i * 8); // `& 255` makes sure that we only write one byte of data << (i * 8);
-    }
-    return result;
-}
-
-u_int64_t read_uint_BLOCK_little_endian(std::istream &inputstream)
-{
-    char data[8];
-    inputstream.read(data, BYTES_PER_BLOCK);
-    u_int64_t result = u_int64_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_BLOCK; i++)
-    {
-        result |= (u_int64_t(data[i]) & 255) << (i * 8); // `& 255` makes sure that we only write one byte of data << (i * 8);
-    }
-    return result;
-}
+#include "../include/binary_formats.hpp"
 
 int main(int ac, char *av[])
 {
@@ -62,29 +36,22 @@ int main(int ac, char *av[])
     std::map<uint32_t,std::map<u_int64_t,std::vector<u_int64_t>>> block_to_entity_maps;
     while (!final_file)
     {
-        std::ifstream outcome_file(input_path + "_outcome_condensed-" + std::to_string(k) + ".bin", std::ifstream::in);
+        std::string outcome_file = input_path + "_outcome_condensed-" + std::to_string(k) + ".bin";
         u_int64_t block_count = 0;
         // block_to_entity_maps[k] = std::map<u_int64_t,std::vector<u_int64_t>>>;
-        while (true)
+        if (std::filesystem::exists(outcome_file))
         {
-            u_int64_t block = read_uint_BLOCK_little_endian(outcome_file);
-            if (outcome_file.eof())
-            {
-                if (block_count == 0)
-                {
-                    final_file = true;
-                }
-                break;
-            }
-            block_count++;
-            // block_to_entity_maps[k][block] = std::vector<u_int64_t>;
-            u_int64_t block_size = read_uint_ENTITY_little_endian(outcome_file);
-            for (u_int64_t i = 0; i < block_size; i++)
+            for (const auto &[block, block_entities]: OutcomeFile(outcome_file))
             {
-                u_int64_t entity = read_uint_ENTITY_little_endian(outcome_file);
-                block_to_entity_maps[k][block].push_back(entity);
+                block_count++;
+                // block_to_entity_maps[k][block] = std::vector<u_int64_t>;
+                block_to_entity_maps[k][block].assign(block_entities.begin(), block_entities.end());
             }
         }
+        if (block_count == 0)
+        {
+            final_file = true;
+        }
         k++;
     }
 
@@ -92,67 +59,65 @@ int main(int ac, char *av[])
     k = 1;
     while (!final_file)
     {
-        std::ifstream edge_file(input_path + "_mapping-" + std::to_string(k) + "to" + std::to_string(k+1) + ".bin", std::ifstream::in);
+        std::string edge_file = input_path + "_mapping-" + std::to_string(k) + "to" + std::to_string(k+1) + ".bin";
         u_int64_t split_count = 0;
         // std::cout << "K: " << std::to_string(k) << "-->" << std::to_string(k+1) << std::endl;
         std::string mapping_msg_lhs = "K" + std::to_string(k) + "-" + std::to_string(k+1) + ": ";
         std::string mapping_msg = mapping_msg_lhs;
-        while (true)
+        if (std::filesystem::exists(edge_file))
         {
-            bool singleton_found = false;
-            u_int64_t original_block = read_uint_BLOCK_little_endian(edge_file);
-            if (edge_file.eof())
-            {
-                if (split_count == 0)
-                {
-                    std::cout << "K" << std::to_string(k) << "-" << std::to_string(k+1) << ": Fixed Point" << std::endl;
-                    final_file = true;
-                    break;
-                }
-                std::cout << mapping_msg.substr(0,mapping_msg.size() - (mapping_msg_lhs.size() + 1)) << std::endl;
-                break;
-            }
-            split_count++;
-            u_int64_t new_blocks_count = read_uint_BLOCK_little_endian(edge_file);
-            mapping_msg += "{";
-            u_int32_t offset = 0;
-            // The block we need to access might not be in the last outcome, in which case we check earlier outcomes until the block is found
-            while (block_to_entity_maps[k-offset].count(original_block) == 0)
+            for (const auto &[original_block, new_blocks]: MappingFile(edge_file))
             {
-                offset++;
-            }
-            for (auto entity: block_to_entity_maps[k-offset][original_block])
-            {
-                mapping_msg += std::to_string(entity) + ",";
-            }
-            mapping_msg.pop_back();
-            mapping_msg += "} --> ";
-            for (u_int64_t i = 0; i < new_blocks_count; i++)
-            {
-                u_int64_t new_block = read_uint_BLOCK_little_endian(edge_file);
-                if (new_block == 0)
+                bool singleton_found = false;
+                split_count++;
+                mapping_msg += "{";
+                u_int32_t offset = 0;
+                // The block we need to access might not be in the last outcome, in which case we check earlier outcomes until the block is found
+                while (block_to_entity_maps[k-offset].count(original_block) == 0)
                 {
-                    singleton_found = true;
-                    continue;
+                    offset++;
                 }
-                mapping_msg += "{";
-                for (auto entity: block_to_entity_maps[k+1][new_block])
+                for (auto entity: block_to_entity_maps[k-offset][original_block])
                 {
                     mapping_msg += std::to_string(entity) + ",";
                 }
                 mapping_msg.pop_back();
-                mapping_msg += "}, ";
-            }
-            if (singleton_found)
-            {
-                mapping_msg += "{SINGLETONS}";
-            }
-            else
-            {
-                mapping_msg.pop_back();
-                mapping_msg.pop_back();
+                mapping_msg += "} --> ";
+                for (block_index new_block: new_blocks)
+                {
+                    if (new_block == 0)
+                    {
+                        singleton_found = true;
+                        continue;
+                    }
+                    mapping_msg += "{";
+                    for (auto entity: block_to_entity_maps[k+1][new_block])
+                    {
+                        mapping_msg += std::to_string(entity) + ",";
+                    }
+                    mapping_msg.pop_back();
+                    mapping_msg += "}, ";
+                }
+                if (singleton_found)
+                {
+                    mapping_msg += "{SINGLETONS}";
+                }
+                else
+                {
+                    mapping_msg.pop_back();
+                    mapping_msg.pop_back();
+                }
+                mapping_msg += "\n" + std::string(mapping_msg_lhs.size(), ' ');
             }
-            mapping_msg += "\n" + std::string(mapping_msg_lhs.size(), ' ');
+        }
+        if (split_count == 0)
+        {
+            std::cout << "K" << std::to_string(k) << "-" << std::to_string(k+1) << ": Fixed Point" << std::endl;
+            final_file = true;
+        }
+        else
+        {
+            std::cout << mapping_msg.substr(0,mapping_msg.size() - (mapping_msg_lhs.size() + 1)) << std::endl;
         }
         k++;
     }
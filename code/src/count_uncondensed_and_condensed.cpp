@@ -1,5 +1,6 @@
 #include <string>
 #include <fstream>
+#include <filesystem>
 #include <iostream>
 #include <boost/algorithm/string.hpp>
 #include <boost/unordered/unordered_flat_map.hpp>
@@ -10,6 +11,7 @@
 
 #include "../include/my_exception.hpp"
 #include "../include/binary_io.hpp"
+#include "../include/binary_formats.hpp"
 
 using json = nlohmann::json;
 
@@ -70,19 +72,11 @@ public:
         local_to_global_maps_.resize(final_depth+1);
     }
 
-    void load_local_to_global_maps(std::ifstream& local_to_global_maps_file)
+    void load_local_to_global_maps(const std::string& local_to_global_maps_file)
     {
-        while (true)
+        for (LocalGlobalRecord entry: LocalGlobalMapFile(local_to_global_maps_file))
         {
-            k_type level = read_uint_K_TYPE_little_endian(local_to_global_maps_file);
-            if (!local_to_global_maps_file)
-            {
-                if (local_to_global_maps_file.eof()) break;  // clean EOF after a complete read
-                throw std::ios_base::failure("Input error while reading file");
-            }
-            block_or_singleton_index local_block = read_int_BLOCK_OR_SINGLETON_little_endian(local_to_global_maps_file);
-            block_or_singleton_index global_block = read_int_BLOCK_OR_SINGLETON_little_endian(local_to_global_maps_file);
-            local_to_global_maps_.at(level)[local_block] = global_block;
+            local_to_global_maps_.at(entry.level)[entry.local_block] = entry.global_block;
         }
         reset_current_map();  // Set the current map
     }
@@ -119,21 +113,13 @@ private:
     k_type final_depth_;
     std::vector<block_map> refines_maps_;
 
-    void load_refines_map_(std::ifstream& refines_map_file, k_type k, const LocalToGlobalMaps& local_to_global_maps)
+    void load_refines_map_(const std::string& refines_map_file, k_type k, const LocalToGlobalMaps& local_to_global_maps)
     {
-        while (true)
+        for (const auto &[block, new_blocks]: MappingFile(refines_map_file))
         {
-            block_index block = read_uint_BLOCK_little_endian(refines_map_file);
-            if (!refines_map_file)
-            {
-                if (refines_map_file.eof()) break;  // clean EOF after a complete read
-                throw std::ios_base::failure("Input error while reading file");
-            }
             block_or_singleton_index global_block = local_to_global_maps.get_current_map().at(static_cast<block_or_singleton_index>(block));
-            block_index new_block_count = read_uint_BLOCK_little_endian(refines_map_file);
-            for (block_index i = 0; i < new_block_count; i++)
+            for (block_index new_block: new_blocks)
             {
-                block_index new_block = read_uint_BLOCK_little_endian(refines_map_file);
                 if (new_block == 0)
                 {
                     continue;
@@ -147,21 +133,13 @@ private:
         }
     }
 
-    void load_singleton_refines_map_(std::ifstream& singleton_refines_map_file, k_type k, const LocalToGlobalMaps& local_to_global_maps)
+    void load_singleton_refines_map_(const std::string& singleton_refines_map_file, k_type k, const LocalToGlobalMaps& local_to_global_maps)
     {
-        while (true)
+        for (const auto &[block, new_singletons]: SingletonMappingFile(singleton_refines_map_file))
         {
-            block_index block = read_uint_BLOCK_little_endian(singleton_refines_map_file);
-            if (!singleton_refines_map_file)
-            {
-                if (singleton_refines_map_file.eof()) break;  // clean EOF after a complete read
-                throw std::ios_base::failure("Input error while reading file");
-            }
             block_or_singleton_index global_block = local_to_global_maps.get_current_map().at(static_cast<block_or_singleton_index>(block));
-            block_or_singleton_index new_block_count = read_int_BLOCK_OR_SINGLETON_little_endian(singleton_refines_map_file);
-            for (block_or_singleton_index i = 0; i < new_block_count; i++)
+            for (block_or_singleton_index new_singleton: new_singletons)
             {
-                block_or_singleton_index new_singleton = read_int_BLOCK_OR_SINGLETON_little_endian(singleton_refines_map_file);
                 refines_maps_[k][new_singleton] = global_block;
             }
         }
@@ -217,11 +195,10 @@ public:
             k_current_stringstream << std::setw(4) << std::setfill('0') << k;
             std::string k_current_string(k_current_stringstream.str());
 
-            std::ifstream refines_map_file(path_to_refines_maps + "mapping-" + k_previous_string + "to" + k_current_string + ".bin");
-            load_refines_map_(refines_map_file, k-1, local_to_global_maps);
+            load_refines_map_(path_to_refines_maps + "mapping-" + k_previous_string + "to" + k_current_string + ".bin", k-1, local_to_global_maps);
 
-            std::ifstream singleton_refines_map_file(path_to_refines_maps + "singleton_mapping-" + k_previous_string + "to" + k_current_string + ".bin");
-            if (!singleton_refines_map_file) continue;  // If the file can't be read, assume it doesn't exist and continue
+            std::string singleton_refines_map_file = path_to_refines_maps + "singleton_mapping-" + k_previous_string + "to" + k_current_string + ".bin";
+            if (!std::filesystem::exists(singleton_refines_map_file)) continue;  // Only written for levels at which singletons were created
             load_singleton_refines_map_(singleton_refines_map_file, k-1, local_to_global_maps);
         }
     }
@@ -284,31 +261,22 @@ int main(int ac, char *av[])
     // Read the intervals
     std::cout << "Reading intervals" << std::endl;
     std::string intervals_file = experiment_directory + "bisimulation/condensed_multi_summary_intervals.bin";
-    std::ifstream intervals_file_stream(intervals_file, std::ifstream::in);
+    IntervalFile intervals(intervals_file);
 
     interval_map_type interval_map;
+    interval_map.reserve(intervals.size());
 
     // Read an interval file
-    while (true)
+    for (IntervalRecord interval: intervals)
     {
-        block_or_singleton_index global_block = read_int_BLOCK_OR_SINGLETON_little_endian(intervals_file_stream);
-        if (intervals_file_stream.eof())
-        {
-            break;
-        }
-        k_type start_time = read_uint_K_TYPE_little_endian(intervals_file_stream);
-        k_type end_time = read_uint_K_TYPE_little_endian(intervals_file_stream);
         // Assuming start_time <= end_time, we are not only left with summary nodes that are alive during lower_level and/or upper_level
-        interval_map[global_block] = {start_time,end_time};
+        interval_map[interval.block] = {interval.start,interval.end};
     }
-    intervals_file_stream.close();
 
     // Set up the local to global maps for creating the refines maps right after
     std::string local_to_global_file_string = experiment_directory + "bisimulation/condensed_multi_summary_local_global_map.bin";
-    std::ifstream local_to_global_file(local_to_global_file_string);
     LocalToGlobalMaps local_to_global_maps(final_depth);
-    local_to_global_maps.load_local_to_global_maps(local_to_global_file);
-    local_to_global_file.close();
+    local_to_global_maps.load_local_to_global_maps(local_to_global_file_string);
 
     // Set up the stratified refines map
     StratifiedRefinesMaps refines_maps{final_depth, fixed_point_reached};
@@ -316,19 +284,15 @@ int main(int ac, char *av[])
 
     // Read the data edges
     std::string data_edges_file_string = experiment_directory + "bisimulation/condensed_multi_summary_graph.bin";
-    std::ifstream data_edges_file(data_edges_file_string, std::ifstream::in);
+    CondensedEdgeFile data_edges(data_edges_file_string);
     std::vector<uint64_t> condensed_data_edge_counters(final_depth+2, 0);  // [0,...,final_depth+1]
     std::vector<uint64_t> uncondensed_data_edge_counters(final_depth+2, 0);  // [0,...,final_depth+1]
     triple_set current_data_edges;
-    while (true)
+    for (CondensedEdgeRecord edge: data_edges)
     {
-        block_or_singleton_index subject = read_int_BLOCK_OR_SINGLETON_little_endian(data_edges_file);
-        if (data_edges_file.eof())
-        {
-            break;
-        }
-        edge_type predicate = read_uint_PREDICATE_little_endian(data_edges_file);
-        block_or_singleton_index object = read_int_BLOCK_OR_SINGLETON_little_endian(data_edges_file);
+        block_or_singleton_index subject = edge.subject;
+        edge_type predicate = edge.predicate;
+        block_or_singleton_index object = edge.object;
 
         k_type subject_start = interval_map[subject].first;
         k_type subject_end = interval_map[subject].second;
@@ -395,20 +359,10 @@ int main(int ac, char *av[])
 
         // Read a mapping file
         std::string refines_file_string = experiment_directory + "bisimulation/mapping-" + k_previous_string + "to" + k_current_string + ".bin";
-        std::ifstream refines_file(refines_file_string);
-        while (true)
+        for (const auto &mapping: MappingFile(refines_file_string))
         {
-            read_uint_BLOCK_little_endian(refines_file);  // Read and ignore a block id. We need to perform a read to update the eof() flag, even if we ignore the contents of the read operation.
-            if (refines_file.eof())
-            {
-                break;
-            }
-            
-            // TODO This can be done much cleaner with seekg if singleton blocks are just part of the regular mapping files
-            block_index new_block_count = read_uint_BLOCK_little_endian(refines_file);
-            for (block_index i = 0; i < new_block_count; i++)
+            for (block_index new_block: mapping.values)
             {
-                block_index new_block = read_uint_BLOCK_little_endian(refines_file);
                 if (new_block != 0)
                 {
                     condensed_refines_counts[current_level]++;
@@ -419,20 +373,11 @@ int main(int ac, char *av[])
         // Read a singleton mapping file
         // TODO this is not needed if singleton blocks are just part of the regular mapping files
         std::string refines_singletons_file_string = experiment_directory + "bisimulation/singleton_mapping-" + k_previous_string + "to" + k_current_string + ".bin";
-        std::ifstream refines_singletons_file(refines_singletons_file_string);
-        if (!refines_singletons_file) continue;  // If the file can't be read, assume it doesn't exist and continue
+        if (!std::filesystem::exists(refines_singletons_file_string)) continue;  // Only written for levels at which singletons were created
 
-        while (true)
+        for (const auto &singleton_mapping: SingletonMappingFile(refines_singletons_file_string))
         {
-            read_uint_BLOCK_little_endian(refines_singletons_file);  // Read and ignore a block id. We need to perform a read to update the eof() flag, even if we ignore the contents of the read operation.
-            if (refines_singletons_file.eof())
-            {
-                break;
-            }
-
-            block_or_singleton_index new_block_count = read_int_BLOCK_OR_SINGLETON_little_endian(refines_singletons_file);
-            condensed_refines_counts[current_level] += new_block_count;
-            refines_singletons_file.seekg(new_block_count*BYTES_PER_BLOCK_OR_SINGLETON, std::ios::cur);  // Skip over the singleton block ids, as we only care about the count.
+            condensed_refines_counts[current_level] += singleton_mapping.values.size();  // Only the count matters, so the singleton block ids are never read
         }
     }
 
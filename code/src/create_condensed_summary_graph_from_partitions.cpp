@@ -20,6 +20,7 @@
 #include "../include/my_exception.hpp"
 #include "../include/stopwatch.hpp"
 #include "../include/binary_io.hpp"
+#include "../include/binary_formats.hpp"
 
 using json = nlohmann::json;
 
@@ -131,21 +132,20 @@ public:
             std::string previous_level_string(previous_level_stringstream.str());
 
             std::string output_file_path = output_directory + "singleton_mapping-" + previous_level_string + "to" + current_level_string + ".bin";
-            std::ofstream output_file_binary(output_file_path, std::ios::trunc | std::ofstream::out);
+            SingletonMappingFileWriter output_file_writer(output_file_path);
 
             for (auto merged_singletons_pair: block_to_singleton_map.second.get_map())
             {
                 block_index merged_block = static_cast<block_index>(merged_singletons_pair.first);
                 block_or_singleton_index singleton_count = static_cast<block_or_singleton_index>(merged_singletons_pair.second.get_nodes().size());
-                write_uint_BLOCK_little_endian(output_file_binary,merged_block);
-                write_int_BLOCK_OR_SINGLETON_little_endian(output_file_binary,singleton_count);
+                output_file_writer.write_block(merged_block, singleton_count);
                 for (auto singleton: merged_singletons_pair.second.get_nodes())
                 {
                     block_or_singleton_index singleton_block = -(static_cast<block_or_singleton_index>(singleton)+1);
-                    write_int_BLOCK_OR_SINGLETON_little_endian(output_file_binary,singleton_block);
+                    output_file_writer.write_value(singleton_block);
                 }
             }
-            output_file_binary.flush();
+            output_file_writer.finish();
         }
     }
 
@@ -218,8 +218,9 @@ public:
         }
         return global_block;
     }
-    void write_map_to_file_binary(std::ostream &outputstream, interval_map &block_to_interval_map)  // TODO this format is very inefficient (as the level is written for every block), instead store like: LEVEL,SIZE,{{LOCAL,GLOBAL}...}
+    void write_map_to_file_binary(const std::string &output_file_path, interval_map &block_to_interval_map)  // TODO this format is very inefficient (as the level is written for every block), instead store like: LEVEL,SIZE,{{LOCAL,GLOBAL}...}
     {
+        LocalGlobalMapFileWriter writer(output_file_path);
         for (auto local_global_pair: this->get_map())
         {
             // k_type level = local_global_pair.first.first;
@@ -227,11 +228,9 @@ public:
             block_or_singleton_index global_block = local_global_pair.second;
             k_type level = block_to_interval_map[global_block].first;
 
-            write_uint_K_TYPE_little_endian(outputstream,level);
-            write_int_BLOCK_OR_SINGLETON_little_endian(outputstream,local_block);
-            write_int_BLOCK_OR_SINGLETON_little_endian(outputstream,global_block);
+            writer.write({level, local_block, global_block});
         }
-        outputstream.flush();
+        writer.finish();
     }
 };
 
@@ -453,8 +452,9 @@ public:
     //     }
     //     return removed_edges;
     // }
-    void write_graph_to_file_binary(std::ostream &graphoutputstream)
+    void write_graph_to_file_binary(const std::string &output_file_path)
     {
+        CondensedEdgeFileWriter graph_writer(output_file_path);
         for (auto s_po_pair: this->get_nodes())
         {
             block_or_singleton_index subject = s_po_pair.first;
@@ -462,12 +462,10 @@ public:
             {
                 edge_type predicate = po_pair.first;
                 block_or_singleton_index object = po_pair.second;
-                write_int_BLOCK_OR_SINGLETON_little_endian(graphoutputstream, subject);
-                write_uint_PREDICATE_little_endian(graphoutputstream, predicate);
-                write_int_BLOCK_OR_SINGLETON_little_endian(graphoutputstream, object);
+                graph_writer.write({subject, predicate, object});
             }
         }
-        graphoutputstream.flush();
+        graph_writer.finish();
     }
     uint64_t get_vertex_count()
     {
@@ -510,16 +508,12 @@ public:
     // }
 };
 
-void read_graph_into_summary_from_stream_timed(std::istream &inputstream, node_to_block_map_type &node_to_block_map, LocalBlockToGlobalBlockMap& block_map, SplitToMergedMap &split_to_merged_map, boost::unordered_flat_map<block_or_singleton_index, time_interval> &block_to_interval_map, k_type current_level, bool include_zero, bool fixed_point_reached, SummaryGraph &gs)
+// Reads a triple file of any entity width into the summary graph, see `read_graph_into_summary_timed`
+template <typename TripleView>
+void read_triples_into_summary_timed(const TripleView &triples, node_to_block_map_type &node_to_block_map, LocalBlockToGlobalBlockMap& block_map, SplitToMergedMap &split_to_merged_map, boost::unordered_flat_map<block_or_singleton_index, time_interval> &block_to_interval_map, k_type current_level, bool include_zero, bool fixed_point_reached, SummaryGraph &gs)
 {
     StopWatch<boost::chrono::process_cpu_clock> w = StopWatch<boost::chrono::process_cpu_clock>::create_not_started();
 
-    const int BufferSize = 8 * 16184;
-
-    char _buffer[BufferSize];
-
-    inputstream.rdbuf()->pubsetbuf(_buffer, BufferSize);
-
     w.start_step("Reading graph");
     u_int64_t line_counter = 0;
 
@@ -528,22 +522,11 @@ void read_graph_into_summary_from_stream_timed(std::istream &inputstream, node_t
     std::tm *ptm_start{std::localtime(&time_t_start)};
 
     std::cout << std::put_time(ptm_start, "%Y/%m/%d %H:%M:%S") << " Reading started" << std::endl;
-    while (true)
+    for (TripleRecord triple: triples)
     {
-        // subject
-        node_index subject_index = read_uint_ENTITY_little_endian(inputstream);
-
-        // edge
-        edge_type edge_label = read_uint_PREDICATE_little_endian(inputstream);
-
-        // object
-        node_index object_index = read_uint_ENTITY_little_endian(inputstream);
-
-        // Break when the last valid values have been read
-        if (inputstream.eof())
-        {
-            break;
-        }
+        node_index subject_index = triple.subject;
+        edge_type edge_label = triple.predicate;
+        node_index object_index = triple.object;
 
         block_or_singleton_index subject_block = block_map.map_block(current_level,node_to_block_map[subject_index]);
 
@@ -593,11 +576,12 @@ void read_graph_into_summary_from_stream_timed(std::istream &inputstream, node_t
 // #endif
 }
 
-void read_graph_into_summary_timed(const std::string &filename, node_to_block_map_type &node_to_block_map, LocalBlockToGlobalBlockMap &block_map, SplitToMergedMap &split_to_merged_map, boost::unordered_flat_map<block_or_singleton_index, time_interval> &block_to_interval_map, k_type current_level, bool include_zero, bool fixed_point_reached, SummaryGraph &gs)
+void read_graph_into_summary_timed(const std::string &filename, node_to_block_map_type &node_to_block_map, LocalBlockToGlobalBlockMap& block_map, SplitToMergedMap &split_to_merged_map, boost::unordered_flat_map<block_or_singleton_index, time_interval> &block_to_interval_map, k_type current_level, bool include_zero, bool fixed_point_reached, SummaryGraph &gs)
 {
-
-    std::ifstream infile(filename, std::ifstream::in);
-    read_graph_into_summary_from_stream_timed(infile, node_to_block_map, block_map, split_to_merged_map, block_to_interval_map, current_level, include_zero, fixed_point_reached, gs);
+    visit_triple_file(filename, [&](const auto &triples)
+    {
+        read_triples_into_summary_timed(triples, node_to_block_map, block_map, split_to_merged_map, block_to_interval_map, current_level, include_zero, fixed_point_reached, gs);
+    });
 }
 
 struct LocalBlock {
@@ -639,15 +623,12 @@ int main(int ac, char *av[])
 
     std::string graph_stats_line;
     std::string final_depth_string = "\"Final depth\"";
-    std::string vertex_count_string = "\"Vertex count\"";
     std::string fixed_point_string = "\"Fixed point\"";
 
     size_t k;
-    node_index graph_size;
     bool fixed_point_reached;
 
     bool k_found = false;
-    bool size_found = false;
     bool fixed_point_found = false;
 
     bool include_zero_outcome = false;
@@ -674,12 +655,6 @@ int main(int ac, char *av[])
             sstream >> k;
             k_found = true;
         }
-        else if (result[0] == vertex_count_string)
-        {
-            std::stringstream sstream(result[1]);
-            sstream >> graph_size;
-            size_found = true;
-        }
         else if (result[0] == fixed_point_string)
         {
             std::stringstream sstream(result[1]);
@@ -695,7 +670,7 @@ int main(int ac, char *av[])
             }
             fixed_point_found = true;
         }
-        if (k_found && size_found && fixed_point_found)
+        if (k_found && fixed_point_found)
         {
             break;
         }
@@ -713,10 +688,14 @@ int main(int ac, char *av[])
     StopWatch<boost::chrono::process_cpu_clock> w = StopWatch<boost::chrono::process_cpu_clock>::create_not_started();
     w.start_step("Reading outcomes", true);  // Set newline to true
 
-    std::ifstream blocksfile(blocks_file, std::ifstream::in);
+    OutcomeFile blocksfile(blocks_file);
     node_to_block_map_type node_to_block_map;
     boost::unordered_flat_map<block_index, boost::unordered_flat_set<node_index>> blocks;
 
+    // The header of the graph tells how many nodes there are
+    node_index graph_size = peek_file_header(graph_file, FileKind::TRIPLES).id_bound;
+    node_to_block_map.reserve(graph_size);
+
     // Initialize all nodes as being singletons
     for (node_index node = 0; node < graph_size; node++)
     {
@@ -730,19 +709,12 @@ int main(int ac, char *av[])
     std::cout << std::put_time(ptm_reverse_index_done, "%Y/%m/%d %H:%M:%S") << " Processing k=" + std::to_string(first_level) << std::endl;
     
     // Read the first outcome file
-    while (true)
+    for (const auto &[block, block_nodes]: blocksfile)
     {
-        block_index block = read_uint_BLOCK_little_endian(blocksfile);
-        if (blocksfile.eof())
-        {
-            break;
-        }
         assert(block <= MAX_SIGNED_BLOCK_SIZE);  // Later, we are storing a block_index as a block_or_singleton_index, so we need to check if the cast is possible
-        u_int64_t block_size = read_uint_ENTITY_little_endian(blocksfile);
 
-        for (uint64_t i = 0; i < block_size; i++)
+        for (node_index node: block_nodes)
         {
-            node_index node = read_uint_ENTITY_little_endian(blocksfile);
             node_to_block_map[node] = (block_or_singleton_index) block;
             blocks[block].emplace(node);
         }
@@ -768,8 +740,8 @@ int main(int ac, char *av[])
 
         std::string current_mapping = experiment_directory + "bisimulation/mapping-" + previous_i_string + "to" + i_string + ".bin";
         std::string current_outcome = experiment_directory + "bisimulation/outcome_condensed-" + i_string + ".bin";
-        std::ifstream current_mapping_file(current_mapping, std::ifstream::in);
-        std::ifstream current_outcome_file(current_outcome, std::ifstream::in);
+        MappingFile current_mapping_file(current_mapping);
+        OutcomeFile current_outcome_file(current_outcome);
 
         boost::unordered_flat_set<block_index> split_block_incides;
         boost::unordered_flat_set<block_index> new_block_indices;
@@ -778,19 +750,13 @@ int main(int ac, char *av[])
         bool new_singletons_created = false;
 
         // Read a mapping file
-        while (true)
+        for (const auto &[old_block, new_blocks]: current_mapping_file)
         {
-            block_index old_block = read_uint_BLOCK_little_endian(current_mapping_file);
-            if (current_mapping_file.eof())
-            {
-                break;
-            }
             split_block_incides.emplace(old_block);
 
-            block_index new_block_count = read_uint_BLOCK_little_endian(current_mapping_file);
-            for (block_index j = 0; j < new_block_count; j++)
+            block_index new_block_count = new_blocks.size();
+            for (block_index new_block: new_blocks)
             {
-                block_index new_block = read_uint_BLOCK_little_endian(current_mapping_file);
                 if (new_block == 0)
                 {
                     new_singletons_created = true;
@@ -829,18 +795,11 @@ int main(int ac, char *av[])
         }
 
         // Read an outcome file
-        while (true)
+        for (const auto &[block, block_nodes]: current_outcome_file)
         {
-            block_index block = read_uint_BLOCK_little_endian(current_outcome_file);
-            if (current_outcome_file.eof())
-            {
-                break;
-            }
             assert(block <= MAX_SIGNED_BLOCK_SIZE);  // Later, we are storing a block_index as a block_or_singleton_index, so we need to check if the cast is possible
-            u_int64_t block_size = read_uint_ENTITY_little_endian(current_outcome_file);
             blocks[(block_or_singleton_index) block].clear();  // Remove the old map
-            for (uint64_t i = 0; i < block_size; i++) {
-                node_index node = read_uint_ENTITY_little_endian(current_outcome_file);
+            for (node_index node: block_nodes) {
                 node_to_block_map[node] = (block_or_singleton_index) block;
                 blocks[(block_or_singleton_index) block].emplace(node);
             }
@@ -1065,8 +1024,7 @@ int main(int ac, char *av[])
         // Write the condensed summary graph to a file
         std::string output_directory = experiment_directory + "bisimulation/";
         std::string output_graph_file_path = output_directory + "condensed_multi_summary_graph.bin";
-        std::ofstream output_graph_file_binary(output_graph_file_path, std::ios::trunc | std::ofstream::out);
-        gs.write_graph_to_file_binary(output_graph_file_binary);
+        gs.write_graph_to_file_binary(output_graph_file_path);
 
         auto t_write_intervals_instant{boost::chrono::system_clock::now()};
         auto time_t_write_intervals_instant{boost::chrono::system_clock::to_time_t(t_write_intervals_instant)};
@@ -1078,14 +1036,12 @@ int main(int ac, char *av[])
 
         // Write node intvervals to a file
         std::string output_interval_file_path = output_directory + "condensed_multi_summary_intervals.bin";
-        std::ofstream output_interval_file_binary(output_interval_file_path, std::ios::trunc | std::ofstream::out);
+        IntervalFileWriter interval_writer(output_interval_file_path);
         for (auto block_interval_pair: block_to_interval_map)  // We effectively write the following to disk: {block,start_time,end_time}
         {
-            write_int_BLOCK_OR_SINGLETON_little_endian(output_interval_file_binary, block_interval_pair.first);
-            write_uint_K_TYPE_little_endian(output_interval_file_binary, block_interval_pair.second.first);
-            write_uint_K_TYPE_little_endian(output_interval_file_binary, block_interval_pair.second.second);
+            interval_writer.write({block_interval_pair.first, block_interval_pair.second.first, block_interval_pair.second.second});
         }
-        output_interval_file_binary.flush();
+        interval_writer.finish();
 
         auto t_write_map_instant{boost::chrono::system_clock::now()};
         auto time_t_write_map_instant{boost::chrono::system_clock::to_time_t(t_write_map_instant)};
@@ -1094,8 +1050,7 @@ int main(int ac, char *av[])
 
         // Write the LocalBlockToGlobalBlockMap to a file
         std::string output_map_file_path = output_directory + "condensed_multi_summary_local_global_map.bin";
-        std::ofstream output_map_file_binary(output_map_file_path, std::ios::trunc | std::ofstream::out);
-        block_map.write_map_to_file_binary(output_map_file_binary, block_to_interval_map);
+        block_map.write_map_to_file_binary(output_map_file_path, block_to_interval_map);
 
         auto t_early_counts{boost::chrono::system_clock::now()};
         auto time_t_early_counts{boost::chrono::system_clock::to_time_t(t_early_counts)};
@@ -1130,7 +1085,6 @@ int main(int ac, char *av[])
     std::string previous_level_string(previous_level_stringstream.str());
 
     std::string current_mapping = experiment_directory + "bisimulation/mapping-" + previous_level_string + "to" + current_level_string + ".bin";
-    std::ifstream current_mapping_file(current_mapping, std::ifstream::in);
 
     w.start_step("Read edges into summary graph", true);
     if (fixed_point_reached)
@@ -1160,25 +1114,17 @@ int main(int ac, char *av[])
         std::tm *ptm_first_edges{std::localtime(&time_t_first_edges)};
         std::cout << std::put_time(ptm_first_edges, "%Y/%m/%d %H:%M:%S") << " Creating initial condensed data edges (" + current_level_string + "-->" + previous_level_string + ") " << std::endl;
 
-        while (true)
+        MappingFile current_mapping_file(current_mapping);
+        for (const auto &[merged_block, split_blocks]: current_mapping_file)
         {
-            block_index merged_block = read_uint_BLOCK_little_endian(current_mapping_file);
-            if (current_mapping_file.eof())
-            {
-                break;
-            }
-            
             block_or_singleton_index global_block = block_map.add_block(current_level-1, merged_block);
             spawning_blocks[global_block] = {(block_or_singleton_index) merged_block, (k_type) (current_level-1)};  // Earlier (when loading the outcomes) we had already checked that this cast is possible
 
             gs.add_block_node(global_block);
             block_to_interval_map[global_block] = {first_level, current_level-1};
 
-            block_index split_block_count = read_uint_BLOCK_little_endian(current_mapping_file);
-            
-            for (block_index j = 0; j < split_block_count; j++)
+            for (block_index split_block: split_blocks)
             {
-                block_index split_block = read_uint_BLOCK_little_endian(current_mapping_file);
                 if (split_block == 0)
                 {
                     BlockMap& block_to_singletons = blocks_to_singletons.get_map(current_level);
@@ -1276,14 +1222,8 @@ int main(int ac, char *av[])
         std::string previous_level_string(previous_level_stringstream.str());
 
         std::string current_mapping = experiment_directory + "bisimulation/mapping-" + previous_level_string + "to" + current_level_string + ".bin";
-        std::ifstream current_mapping_file(current_mapping, std::ifstream::in);
-        
-        const int BufferSize = 8 * 16184;
+        MappingFile current_mapping_file(current_mapping);
 
-        char _buffer[BufferSize];
-    
-        current_mapping_file.rdbuf()->pubsetbuf(_buffer, BufferSize);
-        
         auto t_edges{boost::chrono::system_clock::now()};
         auto time_t_edges{boost::chrono::system_clock::to_time_t(t_edges)};
         std::tm *ptm_edges{std::localtime(&time_t_edges)};
@@ -1291,24 +1231,16 @@ int main(int ac, char *av[])
         w.start_step("Adding data edges (" + current_level_string + "-->" + previous_level_string + ")", true);  // Set newline to true
 
         // Read a mapping file
-        while (true)
+        for (const auto &[merged_block, split_blocks]: current_mapping_file)
         {
-            block_index merged_block = read_uint_BLOCK_little_endian(current_mapping_file);
-            if (current_mapping_file.eof())
-            {
-                break;
-            }
             block_or_singleton_index global_block = block_map.add_block(current_level-1, merged_block);
             gs.add_block_node(global_block);
             block_to_interval_map[global_block] = {first_level, current_level-1};
 
             spawning_blocks[global_block] = {(block_or_singleton_index) merged_block, (k_type) (current_level-1)};  // Earlier (when loading the outcomes) we had already checked that this cast is possible
 
-            block_index split_block_count = read_uint_BLOCK_little_endian(current_mapping_file);
-            
-            for (block_index j = 0; j < split_block_count; j++)
+            for (block_index split_block: split_blocks)
             {
-                block_index split_block = read_uint_BLOCK_little_endian(current_mapping_file);
                 if (split_block == 0)
                 {
                     BlockMap& block_to_singletons = blocks_to_singletons.get_map(current_level);
@@ -1491,8 +1423,7 @@ int main(int ac, char *av[])
     // Write the condensed summary graph (along with the time intervals) to a file
     std::string output_directory = experiment_directory + "bisimulation/";
     std::string output_graph_file_path = output_directory + "condensed_multi_summary_graph.bin";
-    std::ofstream output_graph_file_binary(output_graph_file_path, std::ios::trunc | std::ofstream::out);
-    gs.write_graph_to_file_binary(output_graph_file_binary);
+    gs.write_graph_to_file_binary(output_graph_file_path);
 
     // Write the merged block to singleton node map to a file
     blocks_to_singletons.write_map_to_file_binary(output_directory);
@@ -1504,14 +1435,12 @@ int main(int ac, char *av[])
 
     // Write node intvervals to a file
     std::string output_interval_file_path = output_directory + "condensed_multi_summary_intervals.bin";
-    std::ofstream output_interval_file_binary(output_interval_file_path, std::ios::trunc | std::ofstream::out);
+    IntervalFileWriter interval_writer(output_interval_file_path);
     for (auto block_interval_pair: block_to_interval_map)  // We effectively write the following to disk: {block,start_time,end_time}
     {
-        write_int_BLOCK_OR_SINGLETON_little_endian(output_interval_file_binary, block_interval_pair.first);
-        write_uint_K_TYPE_little_endian(output_interval_file_binary, block_interval_pair.second.first);
-        write_uint_K_TYPE_little_endian(output_interval_file_binary, block_interval_pair.second.second);
+        interval_writer.write({block_interval_pair.first, block_interval_pair.second.first, block_interval_pair.second.second});
     }
-    output_interval_file_binary.flush();
+    interval_writer.finish();
 
     auto t_write_map{boost::chrono::system_clock::now()};
     auto time_t_write_map{boost::chrono::system_clock::to_time_t(t_write_map)};
@@ -1520,8 +1449,7 @@ int main(int ac, char *av[])
 
     // Write the LocalBlockToGlobalBlockMap to a file
     std::string output_map_file_path = output_directory + "condensed_multi_summary_local_global_map.bin";
-    std::ofstream output_map_file_binary(output_map_file_path, std::ios::trunc | std::ofstream::out);
-    block_map.write_map_to_file_binary(output_map_file_binary, block_to_interval_map);
+    block_map.write_map_to_file_binary(output_map_file_path, block_to_interval_map);
 
     // Report some statistics about the condensed multi-summary graph and time + memory instrumentation
     std::ostringstream first_level_stringstream;
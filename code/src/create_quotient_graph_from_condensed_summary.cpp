@@ -1,5 +1,6 @@
 #include <string>
 #include <vector>
+#include <optional>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -11,6 +12,8 @@
 
 #include "../include/my_exception.hpp"
 #include "../include/binary_io.hpp"
+#include "../include/binary_formats.hpp"
+#include "../include/term_dictionary.hpp"
 
 using interval_map_type = boost::unordered_flat_map<block_or_singleton_index,std::pair<k_type,k_type>>;
 using local_refines_type = std::vector<std::pair<block_or_singleton_index,block_or_singleton_index>>;
@@ -22,6 +25,48 @@ using level_to_local_to_global_map = boost::unordered_flat_map<k_type,boost::uno
 using block_set = boost::unordered_flat_set<block_or_singleton_index>;
 using id_entity_map = boost::unordered_flat_map<node_index,std::string>;
 
+// Resolves entity IDs to their IRIs. A binary dictionary (entity2ID.dict) is mapped and only decodes the IDs that are asked for,
+// while the text dictionary (entity2ID.txt) has to be read completely upfront.
+class EntityNames
+{
+private:
+    std::optional<TermDictionary> dictionary;
+    id_entity_map entity_names;
+
+public:
+    explicit EntityNames(const std::string &experiment_directory)
+    {
+        std::string binary_file = experiment_directory + "entity2ID.dict";
+        if (std::filesystem::exists(binary_file))
+        {
+            this->dictionary.emplace(binary_file);
+            return;
+        }
+        std::string entity_id_file = experiment_directory + "entity2ID.txt";
+        std::ifstream entity_id_file_stream(entity_id_file, std::ifstream::in);
+
+        std::string line;
+        std::string delimiter = " ";
+        while (std::getline(entity_id_file_stream, line))
+        {
+            size_t delimiter_pos = line.find(delimiter);
+            std::string entity_string = line.substr(0, delimiter_pos);
+            std::string id_string = line.substr(delimiter_pos + delimiter.size());
+            this->entity_names[std::stoull(id_string)] = entity_string;
+        }
+        entity_id_file_stream.close();
+    }
+
+    std::string operator[](node_index entity_id)
+    {
+        if (this->dictionary)
+        {
+            return this->dictionary->term(entity_id);
+        }
+        return this->entity_names[entity_id];
+    }
+};
+
 const int SUMMARY_NODE_INTERVAL_PAIR_SIZE = BYTES_PER_BLOCK_OR_SINGLETON + BYTES_PER_K_TYPE + BYTES_PER_K_TYPE;
 
 class Triple
@@ -38,157 +83,85 @@ public:
     }
 };
 
-void read_intervals_from_stream_timed(std::istream &inputstream, interval_map_type &interval_map, k_type level)
+void read_intervals_timed(const std::string &filename, interval_map_type &interval_map, k_type level)
 {
     k_type lower_level = level;
     k_type upper_level = level + 1;
-    // Read a mapping file
-    while (true)
+    for (IntervalRecord interval: IntervalFile(filename))
     {
-        block_or_singleton_index global_block = read_int_BLOCK_OR_SINGLETON_little_endian(inputstream);
-        if (inputstream.eof())
-        {
-            break;
-        }
-        k_type start_time = read_uint_K_TYPE_little_endian(inputstream);
-        if (start_time > upper_level)
-        {
-            inputstream.seekg(BYTES_PER_K_TYPE, std::ios_base::cur);  // No need to read the end time in this case
-            continue;
-        }
-        k_type end_time = read_uint_K_TYPE_little_endian(inputstream);
-        if (end_time < lower_level)
+        if (interval.start > upper_level || interval.end < lower_level)
         {
             continue;
         }
         // Assuming start_time <= end_time, we are not only left with summary nodes that are alive during lower_level and/or upper_level
-        interval_map[global_block] = {start_time,end_time};
+        interval_map[interval.block] = {interval.start,interval.end};
     }
 }
 
-void read_intervals_timed(const std::string &filename, interval_map_type &interval_map, k_type level)
-{
-    std::ifstream infile(filename, std::ifstream::in);
-    read_intervals_from_stream_timed(infile, interval_map, level);
-}
-
-void read_mapping_from_stream_timed(std::istream &inputstream, local_refines_type &refines_map)
+void read_mapping_timed(const std::string &filename, local_refines_type &refines_map)
 {
-    // Read a mapping file
-    while (true)
+    for (const auto &[old_block, new_blocks]: MappingFile(filename))
     {
-        block_or_singleton_index old_block = static_cast<block_or_singleton_index>(read_uint_BLOCK_little_endian(inputstream));
-        if (inputstream.eof())
-        {
-            break;
-        }
-
-        block_index new_block_count = read_uint_BLOCK_little_endian(inputstream);
-        for (block_index j = 0; j < new_block_count; j++)
+        for (block_index new_block: new_blocks)
         {
-            block_or_singleton_index new_block = static_cast<block_or_singleton_index>(read_uint_BLOCK_little_endian(inputstream));
             if (new_block == 0)
             {
                 continue;
             }
-            refines_map.push_back(std::make_pair(new_block,old_block));
+            refines_map.push_back(std::make_pair(static_cast<block_or_singleton_index>(new_block),static_cast<block_or_singleton_index>(old_block)));
         }
     }
 }
 
-void read_mapping_timed(const std::string &filename, local_refines_type &refines_map)
-{
-    std::ifstream infile(filename, std::ifstream::in);
-    read_mapping_from_stream_timed(infile, refines_map);
-}
-
-void read_singleton_mapping_from_stream_timed(std::istream &inputstream, local_refines_type &refines_map)
+void read_singleton_mapping_timed(const std::string &filename, local_refines_type &refines_map)
 {
-    // Read a mapping file
-    while (true)
+    for (const auto &[old_block, new_blocks]: SingletonMappingFile(filename))
     {
-        block_index possible_old_block = read_uint_BLOCK_little_endian(inputstream);
-        if (inputstream.eof())
+        for (block_or_singleton_index new_block: new_blocks)
         {
-            break;
-        }
-        block_or_singleton_index old_block = static_cast<block_or_singleton_index>(possible_old_block);
-
-        block_or_singleton_index new_block_count = read_int_BLOCK_OR_SINGLETON_little_endian(inputstream);
-        for (block_or_singleton_index j = 0; j < new_block_count; j++)
-        {
-            block_or_singleton_index new_block = read_int_BLOCK_OR_SINGLETON_little_endian(inputstream);
-            refines_map.push_back(std::make_pair(new_block,old_block));
+            refines_map.push_back(std::make_pair(new_block,static_cast<block_or_singleton_index>(old_block)));
         }
     }
 }
 
-void read_singleton_mapping_timed(const std::string &filename, local_refines_type &refines_map)
-{
-    std::ifstream infile(filename, std::ifstream::in);
-    read_singleton_mapping_from_stream_timed(infile, refines_map);
-}
-
-void read_local_global_map_from_stream_timed(std::istream &inputstream, local_to_global_map_type &local_to_global_map, k_type level)
+void read_local_global_map_timed(const std::string &filename, local_to_global_map_type &local_to_global_map, k_type level)
 {
     k_type lower_level = level;
     k_type upper_level = level + 1;
-    // Read a mapping file
-    while (true)
+    for (LocalGlobalRecord entry: LocalGlobalMapFile(filename))
     {
-        k_type local_level = read_uint_K_TYPE_little_endian(inputstream);
-        if (inputstream.eof())
-        {
-            break;
-        }
-        if (local_level < lower_level || local_level > upper_level)
+        if (entry.level < lower_level || entry.level > upper_level)
         {
-            inputstream.seekg(2*BYTES_PER_BLOCK_OR_SINGLETON, std::ios_base::cur);  // No need to read the ids in this case
             continue;
         }
-        block_or_singleton_index local_block = read_int_BLOCK_OR_SINGLETON_little_endian(inputstream);
-        block_or_singleton_index global_block = read_int_BLOCK_OR_SINGLETON_little_endian(inputstream);
-        local_to_global_map[std::make_pair(local_level,local_block)] = global_block;
+        local_to_global_map[std::make_pair(entry.level,entry.local_block)] = entry.global_block;
     }
 }
 
-void read_local_global_map_timed(const std::string &filename, local_to_global_map_type &local_to_global_map, k_type level)
-{
-    std::ifstream infile(filename, std::ifstream::in);
-    read_local_global_map_from_stream_timed(infile, local_to_global_map, level);
-}
-
-void read_data_edges_from_stream_timed(std::istream &inputstream, triple_set &quotient_graph_triples, global_refines_type &refines_edges, interval_map_type &interval_map, k_type level)
+void read_data_edges_timed(const std::string &infilename, triple_set &quotient_graph_triples, global_refines_type &refines_edges, interval_map_type &interval_map, k_type level)
 {
     k_type lower_level = level;
     k_type upper_level = level + 1;
 
     auto refines_end_it = refines_edges.cend();
     auto interval_end_it = interval_map.cend();
-    // Read a mapping file
-    while (true)
+    for (CondensedEdgeRecord edge: CondensedEdgeFile(infilename))
     {
-        k_type subject = read_int_BLOCK_OR_SINGLETON_little_endian(inputstream);
-        if (inputstream.eof())
-        {
-            break;
-        }
+        k_type subject = edge.subject;
         auto subject_interval_it = interval_map.find(subject);
         if (subject_interval_it == interval_end_it)
         {
-            inputstream.seekg(BYTES_PER_PREDICATE+BYTES_PER_BLOCK_OR_SINGLETON, std::ios_base::cur);  // No need to read the predicate and object in this case
             continue;
         }
         k_type subject_end_time = (subject_interval_it->second).second;
         if (subject_end_time<upper_level)
         {
-            inputstream.seekg(BYTES_PER_PREDICATE+BYTES_PER_BLOCK_OR_SINGLETON, std::ios_base::cur);  // No need to read the predicate and object in this case
             continue;
         }
 
-        block_or_singleton_index predicate = read_uint_PREDICATE_little_endian(inputstream);
+        block_or_singleton_index predicate = edge.predicate;
 
-        block_or_singleton_index object = read_int_BLOCK_OR_SINGLETON_little_endian(inputstream);
+        block_or_singleton_index object = edge.object;
         auto object_interval_it = interval_map.find(subject);
         if (object_interval_it == interval_end_it)
         {
@@ -211,33 +184,21 @@ void read_data_edges_from_stream_timed(std::istream &inputstream, triple_set &qu
     }
 }
 
-void read_data_edges_timed(const std::string &infilename, triple_set &quotient_graph_triples, global_refines_type &refines_edges, interval_map_type &interval_map, k_type level)
-{
-    std::ifstream infile(infilename, std::ifstream::in);
-    read_data_edges_from_stream_timed(infile, quotient_graph_triples, refines_edges, interval_map, level);
-}
-
-void read_data_edges_from_stream_timed_early(std::istream &inputstream, triple_set &quotient_graph_triples, interval_map_type &interval_map, k_type level)
+void read_data_edges_timed_early(const std::string &infilename, triple_set &quotient_graph_triples, interval_map_type &interval_map, k_type level)
 {
     auto interval_end_it = interval_map.cend();
-    // Read a mapping file
-    while (true)
+    for (CondensedEdgeRecord edge: CondensedEdgeFile(infilename))
     {
-        block_or_singleton_index subject = read_int_BLOCK_OR_SINGLETON_little_endian(inputstream);
-        if (inputstream.eof())
-        {
-            break;
-        }
+        block_or_singleton_index subject = edge.subject;
         auto subject_interval_it = interval_map.find(subject);
         if (subject_interval_it == interval_end_it)
         {
-            inputstream.seekg(BYTES_PER_PREDICATE+BYTES_PER_BLOCK_OR_SINGLETON, std::ios_base::cur);  // No need to read the predicate and object in this case
             continue;
         }
 
-        block_or_singleton_index predicate = read_uint_PREDICATE_little_endian(inputstream);
+        block_or_singleton_index predicate = edge.predicate;
 
-        block_or_singleton_index object = read_int_BLOCK_OR_SINGLETON_little_endian(inputstream);
+        block_or_singleton_index object = edge.object;
         auto object_interval_it = interval_map.find(object);
         if (object_interval_it == interval_end_it)
         {
@@ -253,12 +214,6 @@ void read_data_edges_from_stream_timed_early(std::istream &inputstream, triple_s
     }
 }
 
-void read_data_edges_timed_early(const std::string &infilename, triple_set &quotient_graph_triples, interval_map_type &interval_map, k_type level)
-{
-    std::ifstream infile(infilename, std::ifstream::in);
-    read_data_edges_from_stream_timed_early(infile, quotient_graph_triples, interval_map, level);
-}
-
 int main(int ac, char *av[])
 {
     // This structure was inspired by https://gist.github.com/randomphrase/10801888
@@ -366,20 +321,7 @@ int main(int ac, char *av[])
 
     // Read the entity to id map
     std::cout << "Reading the entity to id map" << std::endl;
-    std::string entity_id_file = experiment_directory + "entity2ID.txt";
-    std::ifstream entity_id_file_stream(entity_id_file, std::ifstream::in);
-
-    id_entity_map entity_names;
-    std::string line;
-    std::string delimiter = " ";
-    while (std::getline(entity_id_file_stream, line))
-    {
-        size_t delimiter_pos = line.find(delimiter);
-        std::string entity_string = line.substr(0, delimiter_pos);
-        std::string id_string = line.substr(delimiter_pos + delimiter.size());
-        entity_names[std::stoull(id_string)] = entity_string;
-    }
-    entity_id_file_stream.close();
+    EntityNames entity_names(experiment_directory);
 
     std::string outcome_contains_file = quotient_graphs_directory + "quotient_graph_contains-" + level_string +".txt";
     std::ofstream outcome_contains_file_stream(outcome_contains_file, std::ios::trunc);
@@ -389,24 +331,16 @@ int main(int ac, char *av[])
         // Read the node intervals
         std::cout << "Reading data edges" << std::endl;
         std::string intervals_file = experiment_directory + "bisimulation/condensed_multi_summary_intervals.bin";
-        std::ifstream intervals_file_stream(intervals_file, std::ifstream::in);
+        IntervalFile intervals(intervals_file);
 
         block_set living_blocks;
         block_set used_living_blocks;  // There might be disconnected nodes in the living blocks, used_living_blocks is used to filter those out
 
-        while (true)
+        for (IntervalRecord interval: intervals)
         {
-            block_or_singleton_index global_block_id = read_int_BLOCK_OR_SINGLETON_little_endian(intervals_file_stream);
-            if (intervals_file_stream.eof())
-            {
-                break;
-            }
-            read_uint_K_TYPE_little_endian(intervals_file_stream);  // Read, but don't store the start time
-            block_or_singleton_index end_time = read_uint_K_TYPE_little_endian(intervals_file_stream);
-            
-            if (end_time == level)
+            if (interval.end == level)
             {
-                living_blocks.emplace(global_block_id);
+                living_blocks.emplace(interval.block);
             }
         }
         used_living_blocks.reserve(living_blocks.size());  // Prevent possbile rehasing later
@@ -414,25 +348,18 @@ int main(int ac, char *av[])
         // Read the local to global ids
         std::cout << "Reading the global ids" << std::endl;
         std::string local_to_global_file = experiment_directory + "bisimulation/condensed_multi_summary_local_global_map.bin";
-        std::ifstream local_to_global_file_stream(local_to_global_file, std::ifstream::in);
+        LocalGlobalMapFile local_to_global_entries(local_to_global_file);
 
         level_to_local_to_global_map local_to_global_map;
         // block_map current_block_map;
 
         auto living_blocks_end_it = living_blocks.cend();
 
-        while (true)
+        for (LocalGlobalRecord entry: local_to_global_entries)
         {
-            k_type local_level = read_uint_K_TYPE_little_endian(local_to_global_file_stream);
-            if (local_to_global_file_stream.eof())
+            if (living_blocks.find(entry.global_block) != living_blocks_end_it)
             {
-                break;
-            }
-            block_or_singleton_index local_block = read_int_BLOCK_OR_SINGLETON_little_endian(local_to_global_file_stream);
-            block_or_singleton_index global_block = read_int_BLOCK_OR_SINGLETON_little_endian(local_to_global_file_stream);
-            if (living_blocks.find(global_block) != living_blocks_end_it)
-            {
-                local_to_global_map[local_level].emplace(local_block,global_block);
+                local_to_global_map[entry.level].emplace(entry.local_block,entry.global_block);
                 // current_block_map[local_block] = std::make_pair(local_level, global_block);
             }
         }
@@ -447,29 +374,19 @@ int main(int ac, char *av[])
             std::string local_level_string(local_level_stringstream.str());
 
             std::string outcome_file = experiment_directory + "bisimulation/outcome_condensed-" + local_level_string + ".bin";
-            std::ifstream outcome_file_stream(outcome_file, std::ifstream::in);
+            OutcomeFile outcomes(outcome_file);
 
-            while (true)
+            for (const auto &[block, block_entities]: outcomes)
             {
-                block_or_singleton_index block = static_cast<block_or_singleton_index>(read_uint_BLOCK_little_endian(outcome_file_stream));
-                if (outcome_file_stream.eof())
-                {
-                    break;
-                }
-
-                node_index block_size = read_uint_ENTITY_little_endian(outcome_file_stream);
-
-                auto block_it = level_map_pair.second.find(block);
+                auto block_it = level_map_pair.second.find(static_cast<block_or_singleton_index>(block));
                 if (block_it == level_end_it)
                 {
-                    outcome_file_stream.seekg(block_size*BYTES_PER_ENTITY, std::ios_base::cur);
-                    continue;
+                    continue;  // The entities of the block are never read
                 }
                 block_or_singleton_index global_block = block_it->second;
                 
-                for (node_index i = 0; i < block_size; i++)
+                for (node_index entity_id: block_entities)
                 {
-                    node_index entity_id = read_uint_ENTITY_little_endian(outcome_file_stream);
                     std::string entity = entity_names[entity_id];
 
                     outcome_contains_file_stream << global_block << " " << entity << "\n";
@@ -481,27 +398,22 @@ int main(int ac, char *av[])
         // Read the data edges
         std::cout << "Reading data edges" << std::endl;
         std::string data_edges_file = experiment_directory + "bisimulation/condensed_multi_summary_graph.bin";
-        std::ifstream data_edges_file_stream(data_edges_file, std::ifstream::in);
+        CondensedEdgeFile condensed_edges(data_edges_file);
 
         triple_set data_edges;
 
-        while (true)
+        for (CondensedEdgeRecord edge: condensed_edges)
         {
-            block_or_singleton_index subject = read_int_BLOCK_OR_SINGLETON_little_endian(data_edges_file_stream);
-            if (data_edges_file_stream.eof())
-            {
-                break;
-            }
+            block_or_singleton_index subject = edge.subject;
             auto living_subject_it = living_blocks.find(subject);
             if (living_subject_it == living_blocks_end_it)
             {
-                intervals_file_stream.seekg(BYTES_PER_PREDICATE+BYTES_PER_BLOCK_OR_SINGLETON, std::ios_base::cur);  // No need to read the predicate and object in this case
                 continue;
             }
 
-            edge_type predicate = read_uint_PREDICATE_little_endian(data_edges_file_stream);
+            edge_type predicate = edge.predicate;
 
-            block_or_singleton_index object = read_int_BLOCK_OR_SINGLETON_little_endian(data_edges_file_stream);
+            block_or_singleton_index object = edge.object;
             auto living_object_it = living_blocks.find(object);
             if (living_object_it == living_blocks_end_it)
             {
@@ -591,62 +503,49 @@ int main(int ac, char *av[])
         if (output_format == "binary" or output_format == "both")
         {
             std::string outcome_binary_triples_file = quotient_graphs_directory + "quotient_graph_triples-" + level_string + ".bin";
-            std::ofstream outcome_binary_triples_file_stream(outcome_binary_triples_file, std::ios::binary | std::ios::trunc);
-
             if (not make_ids_positive)
             {
+                CondensedEdgeFileWriter outcome_binary_triples_writer(outcome_binary_triples_file);
                 for (auto triple: data_edges)
                 {
                     block_or_singleton_index subject = std::get<0>(triple);
                     edge_type predicate = std::get<1>(triple);
                     block_or_singleton_index object = std::get<2>(triple);
 
-                    write_int_BLOCK_OR_SINGLETON_little_endian(outcome_binary_triples_file_stream, subject);
-                    write_uint_PREDICATE_little_endian(outcome_binary_triples_file_stream, predicate);
-                    write_int_BLOCK_OR_SINGLETON_little_endian(outcome_binary_triples_file_stream, object);
+                    outcome_binary_triples_writer.write({subject, predicate, object});
                 }
+                outcome_binary_triples_writer.finish();
             }
             else
             {
+                // With positive IDs the quotient graph has the same format as the input graph
+                TripleFileWriter outcome_binary_triples_writer(outcome_binary_triples_file);
                 for (auto triple: data_edges)
                 {
                     node_index subject = id_mapping[std::get<0>(triple)];
                     edge_type predicate = std::get<1>(triple);
                     node_index object = id_mapping[std::get<2>(triple)];
 
-                    write_uint_ENTITY_little_endian(outcome_binary_triples_file_stream, subject);
-                    write_uint_PREDICATE_little_endian(outcome_binary_triples_file_stream, predicate);
-                    write_uint_ENTITY_little_endian(outcome_binary_triples_file_stream, object);
+                    outcome_binary_triples_writer.write({subject, predicate, object});
                 }
+                outcome_binary_triples_writer.finish();
             }
-            outcome_binary_triples_file_stream.close();
         }
 
         exit(0);  // Close the program
     }
 
     std::string outcome_zero_file = experiment_directory + "bisimulation/outcome_condensed-0000.bin";
-    std::ifstream outcome_zero_file_stream(outcome_zero_file, std::ifstream::in);
-
     block_map living_blocks;  // local_id --> (level, global_id)
 
     const block_or_singleton_index GLOBAL_ID_PLACEHOLDER = 0;
 
     // Read the initial blocks
     std::cout << "Reading the initial blocks" << std::endl;
-    while (true)
+    for (const auto &outcome: OutcomeFile(outcome_zero_file))
     {
-        block_or_singleton_index block = static_cast<block_or_singleton_index>(read_uint_BLOCK_little_endian(outcome_zero_file_stream));
-        if (outcome_zero_file_stream.eof())
-        {
-            break;
-        }
-
-        living_blocks[block] = std::make_pair(0, GLOBAL_ID_PLACEHOLDER);
-        node_index block_size = read_uint_ENTITY_little_endian(outcome_zero_file_stream);
-        outcome_zero_file_stream.seekg(block_size*BYTES_PER_ENTITY, std::ios_base::cur);
+        living_blocks[static_cast<block_or_singleton_index>(outcome.block)] = std::make_pair(0, GLOBAL_ID_PLACEHOLDER);
     }
-    outcome_zero_file_stream.close();
 
     // Find the living blocks at the specified level
     std::cout << "Finding the living blocks" << std::endl;
@@ -667,25 +566,18 @@ int main(int ac, char *av[])
         std::string next_level_string(next_level_stringstream.str());
 
         std::string mapping_file = experiment_directory + "bisimulation/mapping-" + current_level_string + "to" + next_level_string + ".bin";
-        std::ifstream mapping_file_stream(mapping_file, std::ifstream::in);
-
         replaced_blocks.clear();
 
-        while (true)
+        for (const auto &mapping: MappingFile(mapping_file))
         {
-            block_or_singleton_index merged_block = static_cast<block_or_singleton_index>(read_uint_BLOCK_little_endian(mapping_file_stream));
-            if (mapping_file_stream.eof())
-            {
-                break;
-            }
+            block_or_singleton_index merged_block = static_cast<block_or_singleton_index>(mapping.block);
             if (replaced_blocks.find(merged_block) == replaced_blocks.cend())
             {
                 living_blocks.erase(merged_block);
             }
-            block_index split_block_count = read_uint_BLOCK_little_endian(mapping_file_stream);
-            for (block_index j = 0; j < split_block_count; j++)
+            for (block_index new_block: mapping.values)
             {
-                block_or_singleton_index split_block = static_cast<block_or_singleton_index>(read_uint_BLOCK_little_endian(mapping_file_stream));
+                block_or_singleton_index split_block = static_cast<block_or_singleton_index>(new_block);
                 if (split_block == 0)
                 {
                     singletons_found = true;
@@ -694,33 +586,21 @@ int main(int ac, char *av[])
                 replaced_blocks.emplace(split_block);
                 living_blocks[split_block] = std::make_pair(i+1, GLOBAL_ID_PLACEHOLDER);
             }
-
         }
-        mapping_file_stream.close();
 
         if (singletons_found)
         {
             std::string singleton_mapping_file = experiment_directory + "bisimulation/singleton_mapping-" + current_level_string + "to" + next_level_string + ".bin";
-            std::ifstream singleton_mapping_file_stream(singleton_mapping_file, std::ifstream::in);
-
-            while (true)
+            for (const auto &singleton_mapping: SingletonMappingFile(singleton_mapping_file))
             {
-                read_uint_BLOCK_little_endian(singleton_mapping_file_stream);
-                if (singleton_mapping_file_stream.eof())
-                {
-                    break;
-                }
-                block_or_singleton_index singleton_count = read_int_BLOCK_OR_SINGLETON_little_endian(singleton_mapping_file_stream);
-                for (block_or_singleton_index j = 0; j < singleton_count; j++)
+                for (block_or_singleton_index singleton: singleton_mapping.values)
                 {
-                    block_or_singleton_index singleton = read_int_BLOCK_OR_SINGLETON_little_endian(singleton_mapping_file_stream);
                     // TODO We might not have to store the stingleton values???
                     living_blocks[singleton] = std::make_pair(i+1, singleton);  // Singletons have a unique local block ID be design, so it is reused for the global id
                     node_index singleton_entity = static_cast<node_index>(-(singleton+1));
                     outcome_contains_file_stream << singleton << " " << entity_names[singleton_entity] << "\n";
                 }
             }
-            singleton_mapping_file_stream.close();
         }
     }
     outcome_contains_file_stream.flush();  // Flush the intermediate results to the file
@@ -728,44 +608,32 @@ int main(int ac, char *av[])
     // Read and store the global ids for the summary nodes
     std::cout << "Reading the global ids" << std::endl;
     std::string local_to_global_file = experiment_directory + "bisimulation/condensed_multi_summary_local_global_map.bin";
-    std::ifstream local_to_global_file_stream(local_to_global_file, std::ifstream::in);
+    LocalGlobalMapFile local_to_global_entries(local_to_global_file);
 
     block_map next_blocks;  // local_id --> (level, global_id)
 
     auto living_blocks_end_it = living_blocks.cend();
 
-    while (true)
+    for (LocalGlobalRecord entry: local_to_global_entries)
     {
-        k_type local_level = read_uint_K_TYPE_little_endian(local_to_global_file_stream);
-        if (local_to_global_file_stream.eof())
-        {
-            break;
-        }
-        block_or_singleton_index local_block = read_int_BLOCK_OR_SINGLETON_little_endian(local_to_global_file_stream);
-
-        if (local_level == level + 1)  // We will need these ids later when mapping data edge subjects over refines edges
+        if (entry.level == level + 1)  // We will need these ids later when mapping data edge subjects over refines edges
         {
-            block_or_singleton_index global_block = read_int_BLOCK_OR_SINGLETON_little_endian(local_to_global_file_stream);
-            next_blocks[local_block] = std::make_pair(local_level, global_block);
+            next_blocks[entry.local_block] = std::make_pair(entry.level, entry.global_block);
             continue;
         }
 
-        auto local_block_it = living_blocks.find(local_block);
+        auto local_block_it = living_blocks.find(entry.local_block);
         if (local_block_it == living_blocks_end_it)  // No block by the local id found
         {
-            local_to_global_file_stream.seekg(BYTES_PER_BLOCK_OR_SINGLETON, std::ios_base::cur);
             continue;
         }
         k_type stored_local_level = (local_block_it->second).first;
-        if (local_level != stored_local_level)  // The block found by the local id starts at another level
+        if (entry.level != stored_local_level)  // The block found by the local id starts at another level
         {
-            local_to_global_file_stream.seekg(BYTES_PER_BLOCK_OR_SINGLETON, std::ios_base::cur);
             continue;
         }
-        block_or_singleton_index global_block = read_int_BLOCK_OR_SINGLETON_little_endian(local_to_global_file_stream);
-        (local_block_it->second).second = global_block;
+        (local_block_it->second).second = entry.global_block;
     }
-    local_to_global_file_stream.close();
 
     std::ostringstream next_level_stringstream;
     next_level_stringstream << std::setw(4) << std::setfill('0') << level+1;
@@ -775,23 +643,13 @@ int main(int ac, char *av[])
 
     if (std::filesystem::exists(next_level_singleton_mapping_file))
     {
-        std::ifstream next_level_singleton_mapping_file_stream(next_level_singleton_mapping_file, std::ifstream::in);
-
-        while (true)
+        for (const auto &singleton_mapping: SingletonMappingFile(next_level_singleton_mapping_file))
         {
-            read_uint_BLOCK_little_endian(next_level_singleton_mapping_file_stream);
-            if (next_level_singleton_mapping_file_stream.eof())
+            for (block_or_singleton_index singleton: singleton_mapping.values)
             {
-                break;
-            }
-            block_or_singleton_index singleton_count = read_int_BLOCK_OR_SINGLETON_little_endian(next_level_singleton_mapping_file_stream);
-            for (block_or_singleton_index j = 0; j < singleton_count; j++)
-            {
-                block_or_singleton_index singleton = read_int_BLOCK_OR_SINGLETON_little_endian(next_level_singleton_mapping_file_stream);
                 next_blocks[singleton] = std::make_pair(level+1, singleton);
             }
         }
-        next_level_singleton_mapping_file_stream.close();
     }
 
     std::cout << "Reading and storing the contained entities" << std::endl;
@@ -802,35 +660,24 @@ int main(int ac, char *av[])
         std::string current_level_string(current_level_stringstream.str());
         
         std::string outcome_file = experiment_directory + "bisimulation/outcome_condensed-" + current_level_string +".bin";
-        std::ifstream outcome_file_stream(outcome_file, std::ifstream::in);
+        OutcomeFile outcomes(outcome_file);
         
-        while (true)
+        for (const auto &[block, block_entities]: outcomes)
         {
-            block_or_singleton_index block = static_cast<block_or_singleton_index>(read_uint_BLOCK_little_endian(outcome_file_stream));
-            if (outcome_file_stream.eof())
-            {
-                break;
-            }
-
-            node_index block_size = read_uint_ENTITY_little_endian(outcome_file_stream);
-
-            auto block_it = living_blocks.find(block);
+            auto block_it = living_blocks.find(static_cast<block_or_singleton_index>(block));
             if (block_it == living_blocks_end_it)
             {
-                outcome_file_stream.seekg(block_size*BYTES_PER_ENTITY, std::ios_base::cur);
-                continue;
+                continue;  // The entities of the block are never read
             }
             k_type stored_local_level = (block_it->second).first;
             if (i != stored_local_level)
             {
-                outcome_file_stream.seekg(block_size*BYTES_PER_ENTITY, std::ios_base::cur);
                 continue;
             }
             block_or_singleton_index global_block = (block_it->second).second;
             
-            for (node_index j = 0; j < block_size; j++)
+            for (node_index entity_id: block_entities)
             {
-                node_index entity_id = read_uint_ENTITY_little_endian(outcome_file_stream);
                 std::string entity = entity_names[entity_id];
 
                 outcome_contains_file_stream << global_block << " " << entity << "\n";
@@ -841,24 +688,16 @@ int main(int ac, char *av[])
 
     std::cout << "Reading " << level_string << "-->" << next_level_string << " mapping" << std::endl;
     std::string mapping_file = experiment_directory + "bisimulation/mapping-" + level_string + "to" + next_level_string + ".bin";
-    std::ifstream mapping_file_stream(mapping_file, std::ifstream::in);
-
     global_refines_type refines_edges;
 
     bool new_singletons_found = false;
-    while (true)
+    for (const auto &mapping: MappingFile(mapping_file))
     {
-        block_or_singleton_index merged_block = static_cast<block_or_singleton_index>(read_uint_BLOCK_little_endian(mapping_file_stream));
-        if (mapping_file_stream.eof())
-        {
-            break;
-        }
-        block_or_singleton_index global_merged_block = living_blocks[merged_block].second;
+        block_or_singleton_index global_merged_block = living_blocks[static_cast<block_or_singleton_index>(mapping.block)].second;
         
-        block_index split_block_count = read_uint_BLOCK_little_endian(mapping_file_stream);
-        for (block_index i = 0; i < split_block_count; i++)
+        for (block_index new_block: mapping.values)
         {
-            block_or_singleton_index split_block = static_cast<block_or_singleton_index>(read_uint_BLOCK_little_endian(mapping_file_stream));
+            block_or_singleton_index split_block = static_cast<block_or_singleton_index>(new_block);
             if (split_block == 0)
             {
                 new_singletons_found = true;
@@ -867,32 +706,20 @@ int main(int ac, char *av[])
             block_or_singleton_index global_split_block = next_blocks[split_block].second;
             refines_edges[global_split_block] = global_merged_block;
         }
-
     }
-    mapping_file_stream.close();
 
     if (new_singletons_found)
     {
         std::cout << "Reading " << level_string << "-->" << next_level_string << " singleton mapping" << std::endl;
         std::string singleton_mapping_file = experiment_directory + "bisimulation/singleton_mapping-" + level_string + "to" + next_level_string + ".bin";
-        std::ifstream singleton_mapping_file_stream(singleton_mapping_file, std::ifstream::in);
-
-        while (true)
+        for (const auto &singleton_mapping: SingletonMappingFile(singleton_mapping_file))
         {
-            block_or_singleton_index merged_block = static_cast<block_or_singleton_index>(read_uint_BLOCK_little_endian(singleton_mapping_file_stream));
-            if (singleton_mapping_file_stream.eof())
-            {
-                break;
-            }
-            block_or_singleton_index global_merged_block = living_blocks[merged_block].second;
-            block_or_singleton_index singleton_count = read_int_BLOCK_OR_SINGLETON_little_endian(singleton_mapping_file_stream);
-            for (block_or_singleton_index i = 0; i < singleton_count; i++)
+            block_or_singleton_index global_merged_block = living_blocks[static_cast<block_or_singleton_index>(singleton_mapping.block)].second;
+            for (block_or_singleton_index singleton: singleton_mapping.values)
             {
-                block_or_singleton_index singleton = read_int_BLOCK_OR_SINGLETON_little_endian(singleton_mapping_file_stream);
                 refines_edges[singleton] = global_merged_block;
             }
         }
-        singleton_mapping_file_stream.close();
     }
     else
     {
@@ -918,7 +745,7 @@ int main(int ac, char *av[])
     // Read the data edges    
     std::cout << "Reading data edges" << std::endl;
     std::string data_edges_file = experiment_directory + "bisimulation/condensed_multi_summary_graph.bin";
-    std::ifstream data_edges_file_stream(data_edges_file, std::ifstream::in);
+    CondensedEdgeFile condensed_edges(data_edges_file);
 
     auto global_next_blocks_end_it = global_next_blocks.cend();
     auto global_living_blocks_end_it = global_living_blocks.cend();
@@ -927,13 +754,9 @@ int main(int ac, char *av[])
     block_set used_living_blocks;  // There might be disconnected nodes in the living blocks, used_living_blocks is used to filter those out
     used_living_blocks.reserve(global_living_blocks.size() + global_next_blocks.size());  // We care about the size of the union, so taking the size of both maps provides an upper bound
 
-    while (true)
+    for (CondensedEdgeRecord edge: condensed_edges)
     {
-        block_or_singleton_index subject = read_int_BLOCK_OR_SINGLETON_little_endian(data_edges_file_stream);
-        if (data_edges_file_stream.eof())
-        {
-            break;
-        }
+        block_or_singleton_index subject = edge.subject;
 
         auto subject_global_next_block_it = global_next_blocks.find(subject);
         // We know next blocks only contains the newly created blocks, but these are not the only relevant ones
@@ -942,11 +765,10 @@ int main(int ac, char *av[])
             auto subject_global_living_it = global_living_blocks.find(subject);
             if (subject_global_living_it == global_living_blocks_end_it)
             {
-                data_edges_file_stream.seekg(BYTES_PER_PREDICATE+BYTES_PER_BLOCK_OR_SINGLETON, std::ios_base::cur);  // No need to read the predicate and object in this case
                 continue;
             }
-            edge_type predicate = read_uint_PREDICATE_little_endian(data_edges_file_stream);
-            block_or_singleton_index object = read_int_BLOCK_OR_SINGLETON_little_endian(data_edges_file_stream);
+            edge_type predicate = edge.predicate;
+            block_or_singleton_index object = edge.object;
             auto object_global_living_it = global_living_blocks.find(object);
             // If the object is alive at level then the subject is alive at level+1 (and we already established this same subject is alive at level)
             if (object_global_living_it != global_living_blocks_end_it)
@@ -960,8 +782,8 @@ int main(int ac, char *av[])
         }
         // In this case we have a data edge from level+1 to level and we should map the subject over the refines edge (to get an edge from level to level)
         block_or_singleton_index mapped_subject = refines_edges[subject];  // Map the subject over the refines edge
-        edge_type predicate = read_uint_PREDICATE_little_endian(data_edges_file_stream);
-        block_or_singleton_index object = read_int_BLOCK_OR_SINGLETON_little_endian(data_edges_file_stream);
+        edge_type predicate = edge.predicate;
+        block_or_singleton_index object = edge.object;
         auto object_global_living_it = global_living_blocks.find(object);
         if (object_global_living_it == global_living_blocks_end_it)
         {
@@ -1048,34 +870,32 @@ int main(int ac, char *av[])
     if (output_format == "binary" or output_format == "both")
     {
         std::string outcome_binary_triples_file = quotient_graphs_directory + "quotient_graph_triples-" + level_string + ".bin";
-        std::ofstream outcome_binary_triples_file_stream(outcome_binary_triples_file, std::ios::binary | std::ios::trunc);
-
         if (not make_ids_positive)
         {
+            CondensedEdgeFileWriter outcome_binary_triples_writer(outcome_binary_triples_file);
             for (auto triple: data_edges)
             {
                 block_or_singleton_index subject = std::get<0>(triple);
                 edge_type predicate = std::get<1>(triple);
                 block_or_singleton_index object = std::get<2>(triple);
 
-                write_int_BLOCK_OR_SINGLETON_little_endian(outcome_binary_triples_file_stream, subject);
-                write_uint_PREDICATE_little_endian(outcome_binary_triples_file_stream, predicate);
-                write_int_BLOCK_OR_SINGLETON_little_endian(outcome_binary_triples_file_stream, object);
+                outcome_binary_triples_writer.write({subject, predicate, object});
             }
+            outcome_binary_triples_writer.finish();
         }
         else
         {
+            // With positive IDs the quotient graph has the same format as the input graph
+            TripleFileWriter outcome_binary_triples_writer(outcome_binary_triples_file);
             for (auto triple: data_edges)
             {
                 node_index subject = id_mapping[std::get<0>(triple)];
                 edge_type predicate = std::get<1>(triple);
                 node_index object = id_mapping[std::get<2>(triple)];
 
-                write_uint_ENTITY_little_endian(outcome_binary_triples_file_stream, subject);
-                write_uint_PREDICATE_little_endian(outcome_binary_triples_file_stream, predicate);
-                write_uint_ENTITY_little_endian(outcome_binary_triples_file_stream, object);
+                outcome_binary_triples_writer.write({subject, predicate, object});
             }
+            outcome_binary_triples_writer.finish();
         }
-        outcome_binary_triples_file_stream.close();
     }
 }
\ No newline at end of file
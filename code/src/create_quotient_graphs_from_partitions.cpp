@@ -15,16 +15,7 @@
 #include <boost/algorithm/algorithm.hpp>
 #include <boost/algorithm/string.hpp>
 
-using edge_type = uint32_t;
-using node_index = uint64_t;
-using block_index = node_index;
-using block_or_singleton_index = int64_t;
-
-const int BYTES_PER_ENTITY = 5;
-const int BYTES_PER_PREDICATE = 4;
-const int BYTES_PER_BLOCK = 4;
-const int BYTES_PER_BLOCK_OR_SINGLETON = 5;
-const int64_t MAX_SIGNED_BLOCK_SIZE = INT64_MAX;
+#include "../include/binary_formats.hpp"
 
 const std::string outcome_file_regex_string = R"(^outcome_condensed-\d{4}\.bin$)";
 const std::string mapping_file_regex_string = R"(^mapping-\d{4}to\d{4}\.bin$)";
@@ -33,20 +24,6 @@ std::regex mapping_file_regex_pattern(mapping_file_regex_string);
 
 #define CREATE_REVERSE_INDEX
 
-class MyException : public std::exception
-{
-private:
-    const std::string message;
-
-public:
-    MyException(const std::string &err) : message(err) {}
-
-    const char *what() const noexcept override
-    {
-        return message.c_str();
-    }
-};
-
 class Node;
 
 struct Edge
@@ -141,155 +118,6 @@ public:
 #endif
 };
 
-void write_int_BLOCK_OR_SINGLETON_little_endian(std::ostream &outputstream, block_or_singleton_index value)
-{
-    char data[BYTES_PER_BLOCK_OR_SINGLETON];
-    for (unsigned int i = 0; i < BYTES_PER_BLOCK_OR_SINGLETON; i++)
-    {
-        data[i] = char(value);  // TODO check if removing & 0x00000000000000FFull fixed it
-        value = value >> 8;
-    }
-    outputstream.write(data, BYTES_PER_BLOCK_OR_SINGLETON);
-    if (outputstream.fail())
-    {
-        std::cout << "Write block failed with code: " << outputstream.rdstate() << std::endl;
-        std::cout << "Goodbit: " << outputstream.good() << std::endl;
-        std::cout << "Eofbit:  " << outputstream.eof() << std::endl;
-        std::cout << "Failbit: " << (outputstream.fail() && !outputstream.bad()) << std::endl;
-        std::cout << "Badbit:  " << outputstream.bad() << std::endl;
-        exit(outputstream.rdstate());
-    }
-}
-
-void write_uint_PREDICATE_little_endian(std::ostream &outputstream, edge_type value)
-{
-    char data[BYTES_PER_PREDICATE];
-    for (unsigned int i = 0; i < BYTES_PER_PREDICATE; i++)
-    {
-        data[i] = char(value & 0x00000000000000FFull);
-        value = value >> 8;
-    }
-    outputstream.write(data, BYTES_PER_PREDICATE);
-    if (outputstream.fail())
-    {
-        std::cout << "Write block failed with code: " << outputstream.rdstate() << std::endl;
-        std::cout << "Goodbit: " << outputstream.good() << std::endl;
-        std::cout << "Eofbit:  " << outputstream.eof() << std::endl;
-        std::cout << "Failbit: " << (outputstream.fail() && !outputstream.bad()) << std::endl;
-        std::cout << "Badbit:  " << outputstream.bad() << std::endl;
-        exit(outputstream.rdstate());
-    }
-}
-
-u_int64_t read_uint_ENTITY_little_endian(std::istream &inputstream)
-{
-    char data[8];
-    inputstream.read(data, BYTES_PER_ENTITY);
-    if (inputstream.eof())
-    {
-        return UINT64_MAX;
-    }
-    if (inputstream.fail())
-    {
-        std::cout << "Read entity failed with code: " << inputstream.rdstate() << std::endl;
-        std::cout << "Goodbit: " << inputstream.good() << std::endl;
-        std::cout << "Eofbit:  " << inputstream.eof() << std::endl;
-        std::cout << "Failbit: " << (inputstream.fail() && !inputstream.bad()) << std::endl;
-        std::cout << "Badbit:  " << inputstream.bad() << std::endl;
-        exit(inputstream.rdstate());
-    }
-    u_int64_t result = uint64_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_ENTITY; i++)
-    {
-        result |= (uint64_t(data[i]) & 0x00000000000000FFull) << (i * 8); // `& 0x00000000000000FFull` makes sure that we only write one byte of data
-    }
-    return result;
-}
-
-u_int32_t read_PREDICATE_little_endian(std::istream &inputstream)
-{
-    char data[4];
-    inputstream.read(data, BYTES_PER_PREDICATE);
-    if (inputstream.eof())
-    {
-        return UINT32_MAX;
-    }
-    if (inputstream.fail())
-    {
-        std::cout << "Read predicate failed with code: " << inputstream.rdstate() << std::endl;
-        std::cout << "Goodbit: " << inputstream.good() << std::endl;
-        std::cout << "Eofbit:  " << inputstream.eof() << std::endl;
-        std::cout << "Failbit: " << (inputstream.fail() && !inputstream.bad()) << std::endl;
-        std::cout << "Badbit:  " << inputstream.bad() << std::endl;
-        exit(inputstream.rdstate());
-    }
-    u_int32_t result = uint32_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_PREDICATE; i++)
-    {
-        result |= (uint32_t(data[i]) & 0x000000FFul) << (i * 8); // `& 0x000000FFul` makes sure that we only write one byte of data
-    }
-    return result;
-}
-
-u_int64_t read_uint_BLOCK_little_endian(std::istream &inputstream)
-{
-    char data[8];
-    inputstream.read(data, BYTES_PER_BLOCK);
-    if (inputstream.eof())
-    {
-        return UINT64_MAX;
-    }
-    if (inputstream.fail())
-    {
-        std::cout << "Read block failed with code: " << inputstream.rdstate() << std::endl;
-        std::cout << "Goodbit: " << inputstream.good() << std::endl;
-        std::cout << "Eofbit:  " << inputstream.eof() << std::endl;
-        std::cout << "Failbit: " << (inputstream.fail() && !inputstream.bad()) << std::endl;
-        std::cout << "Badbit:  " << inputstream.bad() << std::endl;
-        exit(inputstream.rdstate());
-    }
-    u_int64_t result = u_int64_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_BLOCK; i++)
-    {
-        result |= (u_int64_t(data[i]) & 0x00000000000000FFull) << (i * 8); // `& 0x00000000000000FFull` makes sure that we only write one byte of data << (i * 8);
-    }
-    return result;
-}
-
-int64_t read_int_BLOCK_OR_SINGLETON_little_endian(std::istream &inputstream)
-{
-    char data[BYTES_PER_BLOCK_OR_SINGLETON];
-    inputstream.read(data, BYTES_PER_BLOCK_OR_SINGLETON);
-    if (inputstream.eof())
-    {
-        return INT64_MAX;
-    }
-    if (inputstream.fail())
-    {
-        std::cout << "Read block failed with code: " << inputstream.rdstate() << std::endl;
-        std::cout << "Goodbit: " << inputstream.good() << std::endl;
-        std::cout << "Eofbit:  " << inputstream.eof() << std::endl;
-        std::cout << "Failbit: " << (inputstream.fail() && !inputstream.bad()) << std::endl;
-        std::cout << "Badbit:  " << inputstream.bad() << std::endl;
-        exit(inputstream.rdstate());
-    }
-    int64_t result = 0;
-
-    for (unsigned int i = 0; i < BYTES_PER_BLOCK_OR_SINGLETON; i++)
-    {
-        result |= (int64_t(data[i]) & 0x00000000000000FFl) << (i * 8);
-    }
-    // If this is true, then we are reading a negative number, meaning the high bit needs to be set to 1
-    if (int8_t(data[BYTES_PER_BLOCK_OR_SINGLETON-1]) < 0)
-    {
-        result |= 0xFFFFFF0000000000l;  // We need this conversion due to two's complement
-    }
-    return result;
-}
-
 template <typename clock>
 class StopWatch
 {
@@ -462,16 +290,12 @@ public:
     }
 };
 
-void read_graph_from_stream_timed(std::istream &inputstream, Graph &g)
+// Reads a graph from a triple file of any entity width, see `read_graph_from_file_timed`
+template <typename TripleView>
+void read_graph_from_triples_timed(const TripleView &triples, Graph &g)
 {
     StopWatch<boost::chrono::process_cpu_clock> w = StopWatch<boost::chrono::process_cpu_clock>::create_not_started();
 
-    const int BufferSize = 8 * 16184;
-
-    char _buffer[BufferSize];
-
-    inputstream.rdbuf()->pubsetbuf(_buffer, BufferSize);
-
     w.start_step("Reading graph");
     u_int64_t line_counter = 0;
 
@@ -480,25 +304,11 @@ void read_graph_from_stream_timed(std::istream &inputstream, Graph &g)
     std::tm *ptm_start{std::localtime(&time_t_start)};
 
     std::cout << std::put_time(ptm_start, "%Y/%m/%d %H:%M:%S") << " Reading started" << std::endl;
-    while (true)
+    for (TripleRecord triple: triples)
     {
-        // subject
-        // node_index subject_index = node_ID_Mapper.getID(parts[0]);
-        node_index subject_index = read_uint_ENTITY_little_endian(inputstream);
-
-        // edge
-        // edge_type edge_label = edge_ID_Mapper.getID(parts[1]);
-        edge_type edge_label = read_PREDICATE_little_endian(inputstream);
-
-        // object
-        // node_index object_index = node_ID_Mapper.getID(parts[2]);
-        node_index object_index = read_uint_ENTITY_little_endian(inputstream);
-
-        // Break when the last valid values have been read
-        if (inputstream.eof())
-        {
-            break;
-        }
+        node_index subject_index = triple.subject;
+        edge_type edge_label = triple.predicate;
+        node_index object_index = triple.object;
         // std::cout << subject_index << " " << edge_label <<  " " << object_index << std::endl;
 
         // Add Nodes
@@ -552,11 +362,15 @@ void read_graph_from_stream_timed(std::istream &inputstream, Graph &g)
 #endif
 }
 
+void read_graph_from_file_timed(const std::string &filename, Graph &g)
+{
+    visit_triple_file(filename, [&](const auto &triples) { read_graph_from_triples_timed(triples, g); });
+}
+
 void read_graph_timed(const std::string &filename, Graph &g)
 {
 
-    std::ifstream infile(filename, std::ifstream::in);
-    read_graph_from_stream_timed(infile, g);
+    read_graph_from_file_timed(filename, g);
 }
 
 class SummaryObjectSet
@@ -717,8 +531,9 @@ public:
         }
         return removed_edges;
     }
-    void write_graph_to_file_binary(std::ostream &outputstream)
+    void write_graph_to_file_binary(const std::string &output_file_path)
     {
+        CondensedEdgeFileWriter writer(output_file_path);
         for (auto node_key_val: this->get_nodes())
         {
             block_or_singleton_index subject = node_key_val.first;
@@ -728,12 +543,11 @@ public:
                 for (block_or_singleton_index object: edge_key_val.second.get_objects())
                 {
                     // std::cout << "DEBUG spo: " << subject << " " << predicate << " " << object << std::endl;
-                    write_int_BLOCK_OR_SINGLETON_little_endian(outputstream, subject);
-                    write_uint_PREDICATE_little_endian(outputstream, predicate);
-                    write_int_BLOCK_OR_SINGLETON_little_endian(outputstream, object);
+                    writer.write({subject, predicate, object});
                 }
             }
         }
+        writer.finish();
     }
     // void write_graph_to_file_json(std::ostream &outputstream)
     // {
@@ -836,7 +650,6 @@ int main(int ac, char *av[])
     // std::string summary_graph_file_path_json = summary_graph_file_path_base + "0001.json";
     // std::string condensed_summary_graph_file_path = experiment_directory + "bisimulation/summary_graph_condensed.bin";
 
-    std::ofstream summary_graph_file_binary(summary_graph_file_path_binary, std::ios::trunc | std::ofstream::out);
     // std::ofstream summary_graph_file_json(summary_graph_file_path_json, std::ios::trunc | std::ofstream::out);
 
     StopWatch<boost::chrono::process_cpu_clock> w = StopWatch<boost::chrono::process_cpu_clock>::create_not_started();
@@ -847,7 +660,7 @@ int main(int ac, char *av[])
 
     SummaryGraph gs;
 
-    std::ifstream blocksfile(blocks_file, std::ifstream::in);
+    OutcomeFile blocksfile(blocks_file);
     boost::unordered_flat_map<node_index, block_or_singleton_index> node_to_block_map;
     boost::unordered_flat_map<block_index, boost::unordered_flat_set<node_index>> blocks;
 
@@ -867,21 +680,12 @@ int main(int ac, char *av[])
     std::cout << std::put_time(ptm_reverse_index_done, "%Y/%m/%d %H:%M:%S") << " Processing k=1" << std::endl;
     
     // Read the first outcome file
-    while (true)
+    for (const auto &[block, block_nodes]: blocksfile)
     {
-        block_index block = read_uint_BLOCK_little_endian(blocksfile);
-        // new_blocks.emplace(block);
-        if (blocksfile.eof())
-        {
-            break;
-        }
         // std::cout << "DEBUG block: " << block <<std::endl;
         assert(block <= MAX_SIGNED_BLOCK_SIZE);  // Later, we are storing a block_index as a block_or_singleton_index, so we need to check if the cast is possible
         gs.add_block_node(block);
-        u_int64_t block_size = read_uint_ENTITY_little_endian(blocksfile);
-        // std::cout << "DEBUG block size: " << block_size <<std::endl;
-        for (uint64_t i = 0; i < block_size; i++) {
-            node_index node = read_uint_ENTITY_little_endian(blocksfile);
+        for (node_index node: block_nodes) {
             // std::cout << "DEBUG node: " << node <<std::endl;
             node_to_block_map[node] = (block_or_singleton_index) block;
             blocks[block].emplace(node);
@@ -930,9 +734,8 @@ int main(int ac, char *av[])
             gs.add_edge_to_node(subject_block, predicate, object_block, true);
         }
     }
-    gs.write_graph_to_file_binary(summary_graph_file_binary);
+    gs.write_graph_to_file_binary(summary_graph_file_path_binary);
     // gs.write_graph_to_file_json(summary_graph_file_json);
-    summary_graph_file_binary.close();
     // summary_graph_file_json.close();
     // std::ifstream summary_graph_file_input(summary_graph_file_path, std::ifstream::in);
     // const int BufferSize = 8 * 16184;
@@ -974,15 +777,14 @@ int main(int ac, char *av[])
 
         std::string current_mapping = experiment_directory + "bisimulation/mapping-" + previous_i_string + "to" + i_string + ".bin";
         std::string current_outcome = experiment_directory + "bisimulation/outcome_condensed-" + i_string + ".bin";
-        std::ifstream current_mapping_file(current_mapping, std::ifstream::in);
-        std::ifstream current_outcome_file(current_outcome, std::ifstream::in);
+        MappingFile current_mapping_file(current_mapping);
+        OutcomeFile current_outcome_file(current_outcome);
 
         // std::ostringstream k_next_stringstream;
         // k_next_stringstream << std::setw(4) << std::setfill('0') << i+2;
         // std::string k_next_string(k_next_stringstream.str());
 
         std::string summary_graph_file_path = summary_graph_file_path_base + i_string + ".bin";
-        std::ofstream summary_graph_file_binary(summary_graph_file_path, std::ios::trunc | std::ofstream::out);
         // std::ofstream summary_graph_file_json(summary_graph_file_path_base + i_string + ".json", std::ios::trunc | std::ofstream::out);
 
         boost::unordered_flat_set<block_index> split_block_incides;
@@ -993,20 +795,12 @@ int main(int ac, char *av[])
         // std::cout << "DEBUG new mapping: " << current_mapping << std::endl;
 
         // Read a mapping file
-        while (true)
+        for (const auto &[old_block, new_blocks]: current_mapping_file)
         {
-            block_index old_block = read_uint_BLOCK_little_endian(current_mapping_file);
-            if (current_mapping_file.eof())
-            {
-                break;
-            }
             split_block_incides.emplace(old_block);
 
-            block_index new_block_count = read_uint_BLOCK_little_endian(current_mapping_file);
-            
-            for (block_index j = 0; j < new_block_count; j++)
+            for (block_index new_block: new_blocks)
             {
-                block_index new_block = read_uint_BLOCK_little_endian(current_mapping_file);
                 // std::cout << "DEBUG old --> new: " << old_block << " " << new_block << std::endl;
                 if (new_block == 0)
                 {
@@ -1039,25 +833,16 @@ int main(int ac, char *av[])
         // boost::unordered_flat_set<block_or_singleton_index> new_blocks;
 
         // Read an outcome file
-        while (true)
+        for (const auto &[block, block_nodes]: current_outcome_file)
         {
-            block_index block = read_uint_BLOCK_little_endian(current_outcome_file);
-            // new_blocks.emplace(block);
-            if (current_outcome_file.eof())
-            {
-                break;
-            }
             // std::cout << "DEBUG block: " << block <<std::endl;
             assert(block <= MAX_SIGNED_BLOCK_SIZE);  // Later, we are storing a block_index as a block_or_singleton_index, so we need to check if the cast is possible
             if (gs.get_nodes().count(block) == 0)
             {
                 gs.add_block_node(block);
             }
-            u_int64_t block_size = read_uint_ENTITY_little_endian(current_outcome_file);
-            // std::cout << "DEBUG block size: " << block_size <<std::endl;
             blocks[(block_or_singleton_index) block].clear();  // Remove the old map
-            for (uint64_t i = 0; i < block_size; i++) {
-                node_index node = read_uint_ENTITY_little_endian(current_outcome_file);
+            for (node_index node: block_nodes) {
                 // std::cout << "DEBUG node: " << node <<std::endl;
                 node_to_block_map[node] = (block_or_singleton_index) block;
                 blocks[(block_or_singleton_index) block].emplace(node);
@@ -1147,7 +932,7 @@ int main(int ac, char *av[])
                 gs.add_edge_to_node(subject, edge.label, object, true);
             }
         }
-        gs.write_graph_to_file_binary(summary_graph_file_binary);
+        gs.write_graph_to_file_binary(summary_graph_file_path);
         // gs.write_graph_to_file_json(summary_graph_file_json);
     }
 }
\ No newline at end of file
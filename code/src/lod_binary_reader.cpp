@@ -7,34 +7,7 @@
 #include <boost/program_options.hpp>
 // #include <vector>
 
-const int BYTES_PER_ENTITY = 5;
-const int BYTES_PER_PREDICATE = 4;
-
-u_int64_t read_uint_ENTITY_little_endian(std::istream &inputstream)
-{
-    char data[8];
-    inputstream.read(data, BYTES_PER_ENTITY);
-    u_int64_t result = uint64_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_ENTITY; i++)
-    {
-        result |= (uint64_t(data[i]) & 255) << (i * 8); // `& 255` makes sure that we only write one byte of data << (i * 8);
-    }
-    return result;
-}
-
-u_int32_t read_PREDICATE_little_endian(std::istream &inputstream)
-{
-    char data[4];
-    inputstream.read(data, BYTES_PER_PREDICATE);
-    u_int32_t result = uint32_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_PREDICATE; i++)
-    {
-        result |= (uint32_t(data[i]) & 255) << (i * 8); // `& 255` makes sure that we only write one byte of data
-    }
-    return result;
-}
+#include "../include/binary_formats.hpp"
 
 int main(int ac, char *av[])
 {
@@ -55,16 +28,12 @@ int main(int ac, char *av[])
 
     std::string input_file = vm["input_file"].as<std::string>();
 
-    std::ifstream infile(input_file, std::ifstream::in);
-    while (true)
+    visit_triple_file(input_file, [](const auto &triples)
     {
-        u_int64_t subject = read_uint_ENTITY_little_endian(infile);
-        u_int32_t predicate = read_PREDICATE_little_endian(infile);
-        u_int64_t object = read_uint_ENTITY_little_endian(infile);
-        if (infile.eof())
+        triples.verify_checksum();
+        for (TripleRecord triple: triples)
         {
-            break;
+            std::cout << triple.subject << "\t" << triple.predicate << "\t" << triple.object << std::endl;
         }
-        std::cout << subject << "\t" << predicate << "\t" << object << std::endl;
-    }
+    });
 }
@@ -7,20 +7,7 @@
 #include <boost/program_options.hpp>
 // #include <vector>
 
-const int BYTES_PER_BLOCK = 4;
-
-u_int64_t read_uint_BLOCK_little_endian(std::istream &inputstream)
-{
-    char data[8];
-    inputstream.read(data, BYTES_PER_BLOCK);
-    u_int64_t result = u_int64_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_BLOCK; i++)
-    {
-        result |= (u_int64_t(data[i]) & 255) << (i * 8); // `& 255` makes sure that we only write one byte of data << (i * 8);
-    }
-    return result;
-}
+#include "../include/binary_formats.hpp"
 
 int main(int ac, char *av[])
 {
@@ -41,26 +28,20 @@ int main(int ac, char *av[])
 
     std::string input_file = vm["input_file"].as<std::string>();
 
-    std::ifstream infile(input_file, std::ifstream::in);
     u_int64_t split_count = 0;
-    while (true)
+    MappingFile mappings(input_file);
+    mappings.verify_checksum();
+    for (const auto &[original_block, new_blocks]: mappings)
     {
-        u_int64_t original_block = read_uint_BLOCK_little_endian(infile);
-        if (infile.eof())
-        {
-            if (split_count == 0)
-            {
-                std::cout << "There were no splits: This is a fixed point of the bisimulation." << std::endl;
-            }
-            break;
-        }
         split_count++;
-        u_int64_t new_blocks_count = read_uint_BLOCK_little_endian(infile);
-        std::cout << "Original Block: " << original_block << ", New Block Count: " << new_blocks_count << std::endl;
-        for (u_int64_t i = 0; i < new_blocks_count; i++)
+        std::cout << "Original Block: " << original_block << ", New Block Count: " << new_blocks.size() << std::endl;
+        for (block_index new_block: new_blocks)
         {
-            u_int64_t new_block = read_uint_BLOCK_little_endian(infile);
             std::cout << "New Block: " << new_block << std::endl;
         }
     }
+    if (split_count == 0)
+    {
+        std::cout << "There were no splits: This is a fixed point of the bisimulation." << std::endl;
+    }
 }
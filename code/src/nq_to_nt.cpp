@@ -1,12 +1,27 @@
+#include <array>
 #include <fstream>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <boost/program_options.hpp>
 
-// Allocate space for a triple's worth of indices (6)
-size_t* parse_triple(std::string line)
+#include "../include/mapped_file.hpp"
+
+// Every term starts with an index, so checking before storing a starting index keeps malformed lines within bounds
+void check_index_count(size_t current_index, size_t max_indices)
+{
+    if (current_index + 1 >= max_indices)
+    {
+        throw std::runtime_error("Found more terms than expected on a line");
+    }
+}
+
+// Find a triple's worth of indices (6)
+std::array<size_t, 6> parse_triple(std::string_view line)
 {
-    size_t* indices = new size_t[6];
+    std::array<size_t, 6> indices;
     char searching_char = '\0';
     size_t current_index = 0;
     bool search_for_qualifier = false;
@@ -22,16 +37,19 @@ size_t* parse_triple(std::string line)
                 switch (line[i])
                 {
                     case '<':
+                        check_index_count(current_index, indices.size());
                         indices[current_index] = i;
                         searching_char = '>';
                         current_index++;
                         break;
                     case '"':
+                        check_index_count(current_index, indices.size());
                         indices[current_index] = i;
                         searching_char = '"';
                         current_index++;
                         break;
                     case '_':
+                        check_index_count(current_index, indices.size());
                         indices[current_index] = i;
                         searching_char = ' ';
                         current_index++;
@@ -45,7 +63,7 @@ size_t* parse_triple(std::string line)
                 {
                 case '>':
                     // If the next character is not a space, ignore this character
-                    if (!(line[i+1] == ' '))
+                    if (i+1 == line.length() || !(line[i+1] == ' '))
                     {
                         break;
                     }
@@ -74,7 +92,7 @@ size_t* parse_triple(std::string line)
                     // else
 
                     searching_char = '\0';
-                    if (line[i+1] == ' ')
+                    if (i+1 < line.length() && line[i+1] == ' ')
                     {
                         indices[current_index] = i;
                         current_index++;
@@ -97,10 +115,10 @@ size_t* parse_triple(std::string line)
     return indices;
 }
 
-// Allocate space for a quad's worth of indices (8)
-size_t* parse_quad(std::string line)
+// Find a quad's worth of indices (8)
+std::array<size_t, 8> parse_quad(std::string_view line)
 {
-    size_t* indices = new size_t[8];
+    std::array<size_t, 8> indices;
     char searching_char = '\0';
     size_t current_index = 0;
     bool search_for_qualifier = false;
@@ -116,16 +134,19 @@ size_t* parse_quad(std::string line)
                 switch (line[i])
                 {
                     case '<':
+                        check_index_count(current_index, indices.size());
                         indices[current_index] = i;
                         searching_char = '>';
                         current_index++;
                         break;
                     case '"':
+                        check_index_count(current_index, indices.size());
                         indices[current_index] = i;
                         searching_char = '"';
                         current_index++;
                         break;
                     case '_':
+                        check_index_count(current_index, indices.size());
                         indices[current_index] = i;
                         searching_char = ' ';
                         current_index++;
@@ -139,7 +160,7 @@ size_t* parse_quad(std::string line)
                 {
                 case '>':
                     // If the next character is not a space, ignore this character
-                    if (!(line[i+1] == ' '))
+                    if (i+1 == line.length() || !(line[i+1] == ' '))
                     {
                         break;
                     }
@@ -168,7 +189,7 @@ size_t* parse_quad(std::string line)
                     // else
 
                     searching_char = '\0';
-                    if (line[i+1] == ' ')
+                    if (i+1 < line.length() && line[i+1] == ' ')
                     {
                         indices[current_index] = i;
                         current_index++;
@@ -215,39 +236,62 @@ int main(int ac, char *av[])
     std::string input_file = vm["input_file"].as<std::string>();
     std::string output_file = vm["output_file"].as<std::string>();
 
-    std::ifstream infile(input_file);
     std::ofstream outfile(output_file, std::ifstream::out);
 
-    if (!infile.is_open())
+    if (!outfile.is_open())
     {
         perror("error while opening file");
     }
 
-    if (!outfile.is_open())
+    // Writes the triple component of a quad, using views into the line to avoid copying it
+    auto convert_line = [&outfile](std::string_view line)
     {
-        perror("error while opening file");
-    }
+        std::array<size_t, 8> index = parse_quad(line);
 
-    std::string line;
+        // Set this to 4 if you want to store the full quad
+        // Set this to 3 if you only want to store the triple component
+        size_t tuple_size = 3;
+
+        for (size_t i = 0; i < tuple_size; i++)
+        {
+            outfile << line.substr(index[i*2], index[i*2+1]-index[i*2]+1) << " ";
+        }
+        outfile << ".\n";
+    };
+
+    // These are declared outside of the try block, because `line` still views them when an error is reported
+    std::optional<MappedFile> mapped_input;
+    std::string line_buffer;
+    std::string_view line;
     size_t line_count = 1;
     try
     {
-        while(std::getline(infile, line))
+        // Regular files are mapped into memory, other inputs (e.g. named pipes) are read as a stream
+        if (MappedFile::is_mappable(input_file))
+        {
+            mapped_input.emplace(input_file);
+            LineScanner lines(mapped_input->contents());
+            while (lines.next_line(line))
+            {
+                convert_line(line);
+                line_count++;
+            }
+        }
+        else
         {
-            size_t* index = parse_quad(line);
+            std::ifstream infile(input_file);
 
-            // Set this to 4 if you want to store the full quad
-            // Set this to 3 if you only want to store the triple component
-            size_t tuple_size = 3;
+            if (!infile.is_open())
+            {
+                perror("error while opening file");
+            }
 
-            for (size_t i = 0; i < tuple_size; i++)
+            while(std::getline(infile, line_buffer))
             {
-                outfile << line.substr(*(index+i*2), *(index+i*2+1)-*(index+i*2)+1) << " ";
+                line = line_buffer;
+                convert_line(line);
+                line_count++;
             }
-            outfile << "." << std::endl;
-            // Free up the space from the heap
-            delete[] index;
-            line_count++;
         }
     }
     catch(const std::exception& e)
@@ -256,4 +300,5 @@ int main(int ac, char *av[])
         std::cout << "Line number: " << line_count << std::endl;
         std::cout << line << std::endl;
     }
+    outfile.flush();
 }
\ No newline at end of file
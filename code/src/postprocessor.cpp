@@ -13,60 +13,7 @@
 #include <boost/algorithm/string.hpp>
 #include <filesystem>
 
-const int BYTES_PER_ENTITY = 5;
-const int BYTES_PER_BLOCK = 4;
-
-u_int64_t read_uint_ENTITY_little_endian(std::istream &inputstream)
-{
-    char data[8];
-    inputstream.read(data, BYTES_PER_ENTITY);
-    if (inputstream.eof())
-    {
-        return UINT64_MAX;
-    }
-    if (inputstream.fail())
-    {
-        std::cout << "Read entity failed with code: " << inputstream.rdstate() << std::endl;
-        std::cout << "Goodbit: " << inputstream.good() << std::endl;
-        std::cout << "Eofbit:  " << inputstream.eof() << std::endl;
-        std::cout << "Failbit: " << (inputstream.fail() && !inputstream.bad()) << std::endl;
-        std::cout << "Badbit:  " << inputstream.bad() << std::endl;
-        exit(inputstream.rdstate());
-    }
-    u_int64_t result = u_int64_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_ENTITY; i++)
-    {
-        result |= (u_int64_t(data[i]) & 255) << (i * 8); // `& 255` makes sure that we only write one byte of data << (i * 8);
-    }
-    return result;
-}
-
-u_int64_t read_uint_BLOCK_little_endian(std::istream &inputstream)
-{
-    char data[8];
-    inputstream.read(data, BYTES_PER_BLOCK);
-    if (inputstream.eof())
-    {
-        return UINT64_MAX;
-    }
-    if (inputstream.fail())
-    {
-        std::cout << "Read block failed with code: " << inputstream.rdstate() << std::endl;
-        std::cout << "Goodbit: " << inputstream.good() << std::endl;
-        std::cout << "Eofbit:  " << inputstream.eof() << std::endl;
-        std::cout << "Failbit: " << (inputstream.fail() && !inputstream.bad()) << std::endl;
-        std::cout << "Badbit:  " << inputstream.bad() << std::endl;
-        exit(inputstream.rdstate());
-    }
-    u_int64_t result = u_int64_t(0);
-
-    for (unsigned int i = 0; i < BYTES_PER_BLOCK; i++)
-    {
-        result |= (u_int64_t(data[i]) & 255) << (i * 8); // `& 255` makes sure that we only write one byte of data << (i * 8);
-    }
-    return result;
-}
+#include "../include/binary_formats.hpp"
 
 int main(int ac, char *av[])
 {
@@ -133,63 +80,38 @@ int main(int ac, char *av[])
         std::string input_file = input_path + "bisimulation/outcome_condensed-" + i_string + ".bin";
         std::string output_file = input_path + "post_hoc_results/statistics_condensed-" + i_string + ".json";
 
-        std::ifstream infile(input_file, std::ifstream::in);
         std::ofstream outfile(output_file, std::ios::trunc | std::ofstream::out);
 
         std::string mapping_file = input_path + "bisimulation/mapping-" + i_string + "to" + i_next_string + ".bin";
-        std::ifstream mappingfile(mapping_file, std::ifstream::in);
 
         uint64_t disappeared_count = 0;
         uint64_t split_count = 0;
         uint64_t block_node_count = 0;
-        while (true)
+        if (std::filesystem::exists(mapping_file))  // The last outcome has no mapping to a next one
         {
-            // Skip reading the block ID, since we do not need it
-            mappingfile.seekg(BYTES_PER_BLOCK, std::ios_base::cur);
-            u_int64_t new_block_count = read_uint_BLOCK_little_endian(mappingfile);
-            if (mappingfile.eof())
+            for (const auto &mapping: MappingFile(mapping_file))
             {
-                // if (split_count == 0)
-                // {
-                //     last_file = true;
-                // }
-                break;
-            }
-            split_count++;
-            // If the split count is 1 and the new block id is 0, then the block got split into only singletons and therefore dissapeared
-            if (new_block_count == 1)
-            {
-                u_int64_t new_block = read_uint_BLOCK_little_endian(mappingfile);
-                if (new_block == 0)
+                split_count++;
+                // If the split count is 1 and the new block id is 0, then the block got split into only singletons and therefore dissapeared
+                if (mapping.values.size() == 1 && mapping.values[0] == 0)
                 {
                     disappeared_count++;
                 }
             }
-            // Jump to the next block
-            else
-            {
-                mappingfile.seekg(new_block_count*BYTES_PER_BLOCK, std::ios_base::cur);
-            }
         }
 
         u_int64_t block_count = 0;
         outfile << "{\n    \"New block sizes\": {";  // A mapping from each block to its size
         
-        while (true)
+        for (const auto &[block, block_entities]: OutcomeFile(input_file))
         {
-            u_int64_t block = read_uint_BLOCK_little_endian(infile);
-            if (infile.eof())
-            {
-                break;
-            }
             if (block_count > 0)
             {
                 outfile << ",";
             }
-            u_int64_t block_size = read_uint_ENTITY_little_endian(infile);
+            u_int64_t block_size = block_entities.size();
             block_node_count += block_size;
             outfile << "\"" << block  << "\"" << ":" << block_size;
-            infile.seekg(block_size*BYTES_PER_ENTITY, std::ios_base::cur);
             block_count++;
         }
 
@@ -1,9 +1,18 @@
 
 #include <fstream>
 #include <string>
+#include <array>
+#include <charconv>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <thread>
 // #define BOOST_USE_VALGRIND  // TODO disable this command in the final running version
 #include <boost/algorithm/string.hpp>
 #include <boost/unordered/unordered_flat_map.hpp>
+#include <boost/unordered/unordered_flat_set.hpp>
 #define BOOST_CHRONO_HEADER_ONLY
 #include <boost/chrono.hpp>
 #include <chrono>
@@ -16,6 +25,16 @@
 
 #include "../include/my_exception.hpp"
 #include "../include/binary_io.hpp"
+#include "../include/binary_formats.hpp"
+#include "../include/mapped_file.hpp"
+#include "../include/structural_scan.hpp"
+#include "../include/string_arena.hpp"
+#include "../include/external_sort.hpp"
+#include "../include/decompressing_stream.hpp"
+#include "../include/turtle_parser.hpp"
+#include "../include/csr_graph.hpp"
+#include "../include/term_dictionary.hpp"
+#include "../include/iri_prefixes.hpp"
 
 using json = nlohmann::json;
 
@@ -24,6 +43,10 @@ using json = nlohmann::json;
 // This variable is set to true for the LOD laundromat dataset
 bool trigfile;
 
+// This variable should be set in main. If it is set to true, the input is a TriG file with any number of graph blocks.
+// A block is opened by a line of the form "<graph> {" (or "GRAPH <graph> {", or "{" for the default graph) and closed by a line "}".
+bool multi_graph_trig;
+
 // This variable should be set in main. It indicates whether or not we want to skip rdf-lists
 bool skipRDFlists;
 
@@ -33,32 +56,226 @@ bool skip_literals;
 // This variable should be set in main. It indicates whether or not we want to put type information on the predicates instead of the object.
 bool types_to_predicates;
 
+// This variable should be set in main. If it is set to true, the dictionaries are written as binary TermDictionary files instead of "term id" lines.
+bool binary_dictionary;
+
+// The relation dictionary is usually tiny, so it starts small and grows when needed (e.g. when types are turned into predicates)
+const std::size_t expected_relations = 1 << 16;
+
+// Allows looking up std::string keys with a std::string_view, such that a string only has to be created when a new key is inserted
+struct StringViewHash
+{
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view key) const
+    {
+        return boost::hash<std::string_view>()(key);
+    }
+};
+
 template <typename T>
-class IDMapper
+using string_view_map = boost::unordered_flat_map<std::string, T, StringViewHash, std::equal_to<>>;
+
+using string_view_set = boost::unordered_flat_set<std::string, StringViewHash, std::equal_to<>>;
+
+// Writes the entries of a dictionary either as "term id" lines or as a binary TermDictionary, depending on `binary_dictionary`.
+// A binary dictionary needs its entries in sorted order, see `write_dictionary` for entries in any order.
+class DictionaryWriter
 {
-    boost::unordered_flat_map<std::string, T> mapping;
+    std::string filename;
+    std::ofstream text_out;
+    std::optional<TermDictionaryWriter> binary_out;
+    std::string term_buffer;
 
 public:
-    IDMapper() : mapping(100000000)
+    explicit DictionaryWriter(const std::string &filename) : filename(filename)
+    {
+        if (binary_dictionary)
+        {
+            this->binary_out.emplace(filename);
+            return;
+        }
+        this->text_out.open(filename, std::ios::trunc);
+        if (!this->text_out.is_open())
+        {
+            throw MyException("Opening the file to dump to failed");
+        }
+    }
+
+    void add(std::string_view term, uint64_t id)
     {
+        if (this->binary_out)
+        {
+            this->binary_out->add(term, id);
+        }
+        else
+        {
+            this->text_out << term << " " << id << '\n';
+        }
     }
 
-    T getID(std::string &stringID)
+    // Adds the term prefix + local, which is how the IDMappers store their terms
+    void add(std::string_view prefix, std::string_view local, uint64_t id)
+    {
+        if (this->binary_out)
+        {
+            this->term_buffer.assign(prefix).append(local);
+            this->binary_out->add(this->term_buffer, id);
+        }
+        else
+        {
+            this->text_out << prefix << local << " " << id << '\n';
+        }
+    }
+
+    void close()
+    {
+        if (this->binary_out)
+        {
+            this->binary_out->close();
+        }
+        else
+        {
+            this->text_out.close();
+        }
+    }
+};
+
+// Writes the entries that `for_each_entry(visit)` passes to `visit(prefix, local, id)`, which may come in any order. The term of an entry is prefix + local.
+// The strings must stay valid until the dictionary is written, since a binary dictionary sorts views of them first.
+template <typename EntrySource>
+void write_dictionary(const std::string &filename, EntrySource &&for_each_entry)
+{
+    DictionaryWriter writer(filename);
+    if (binary_dictionary)
+    {
+        struct Entry
+        {
+            std::string_view prefix;
+            std::string_view local;
+            uint64_t id;
+        };
+        std::vector<Entry> entries;
+        for_each_entry([&entries](std::string_view prefix, std::string_view local, uint64_t id)
+        {
+            entries.push_back({prefix, local, id});
+        });
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+        {
+            return compare_concatenations(a.prefix, a.local, b.prefix, b.local) < 0;
+        });
+        for (const Entry &entry : entries)
+        {
+            writer.add(entry.prefix, entry.local, entry.id);
+        }
+    }
+    else
+    {
+        for_each_entry([&writer](std::string_view prefix, std::string_view local, uint64_t id)
+        {
+            writer.add(prefix, local, id);
+        });
+    }
+    writer.close();
+}
+
+// Decides which named graphs of an n-quads or TriG file are kept. The graph term itself is always dropped, so the kept graphs are merged into one.
+// The default graph is represented by an empty name.
+class GraphFilter
+{
+public:
+    enum class Mode
+    {
+        keep_all,
+        include,
+        exclude
+    };
+
+private:
+    Mode mode = Mode::keep_all;
+    string_view_set graphs;
+
+public:
+    // Reads one graph name per line. IRIs may be written with or without angle brackets, and empty lines and lines starting with '#' are ignored.
+    void load(Mode filter_mode, const std::string &filename)
+    {
+        std::ifstream graph_file(filename);
+        if (!graph_file.is_open())
+        {
+            throw MyException("Opening the graph list failed: " + filename);
+        }
+        this->mode = filter_mode;
+        std::string graph_line;
+        while (std::getline(graph_file, graph_line))
+        {
+            std::string_view graph = trim_view(graph_line);
+            if (graph.empty() || graph[0] == '#')
+            {
+                continue;
+            }
+            if (graph.front() == '<' && graph.back() == '>')
+            {
+                graph = graph.substr(1, graph.size()-2);
+            }
+            this->graphs.emplace(graph);
+        }
+    }
+
+    bool active() const
+    {
+        return this->mode != Mode::keep_all;
+    }
+
+    bool accepts(std::string_view graph) const
+    {
+        switch (this->mode)
+        {
+        case Mode::include:
+            return this->graphs.contains(graph);
+        case Mode::exclude:
+            return !this->graphs.contains(graph);
+        default:
+            return true;
+        }
+    }
+};
+
+// This variable should be set in main. It decides which graphs of an n-quads or TriG input are kept.
+GraphFilter graph_filter;
+
+// The strings are interned in an arena, so the dictionary does not pay for a heap allocation (and std::string overhead) per entry.
+// Frequent namespaces are only stored once, see PrefixedStringMap.
+template <typename T>
+class IDMapper
+{
+    PrefixedStringMap<T> mapping;
+
+public:
+    // The expected size is used to size the hash table upfront, it will still grow beyond that if needed
+    explicit IDMapper(std::size_t expected_size) : mapping(expected_size)
     {
-        T potentially_new = mapping.size();
-        auto result = mapping.try_emplace(stringID, potentially_new);
-        T the_id = (*result.first).second;
-        return the_id;
     }
 
-    auto getMappingCend()
+    T getID(std::string_view stringID)
     {
-        return mapping.cend();
+        const T *existing_id = mapping.find(stringID);
+        if (existing_id != nullptr)
+        {
+            return *existing_id;
+        }
+        T the_id = mapping.size();
+        mapping.insert(stringID, the_id);
+        return the_id;
     }
 
-    auto tryGetIDIt(std::string &stringID)
+    std::optional<T> tryGetID(std::string_view stringID)
     {
-        return mapping.find(stringID);
+        const T *existing_id = mapping.find(stringID);
+        if (existing_id == nullptr)
+        {
+            return std::nullopt;
+        }
+        return *existing_id;
     }
 
     std::size_t size()
@@ -66,36 +283,194 @@ public:
         return mapping.size();
     }
 
-    void dump(std::ostream &out)
+    // Reads a text dictionary as written by `dump_to_file`, such that its strings keep their IDs and new strings get the IDs after them.
+    // This requires the IDs in the file to be dense, which is checked against the number of IDs in the metadata.
+    void load_from_file(const std::string &filename, std::size_t expected_count)
     {
-        for (auto a = this->mapping.cbegin(); a != this->mapping.cend(); a++)
+        MappedFile dictionary(filename);
+        LineScanner lines(dictionary.contents());
+        std::string_view line;
+        while (lines.next_line(line))
+        {
+            std::size_t separator = line.rfind(' ');
+            uint64_t id;
+            if (separator == std::string_view::npos
+                || std::from_chars(line.data() + separator + 1, line.data() + line.size(), id).ec != std::errc()
+                || id >= expected_count)
+            {
+                throw MyException("The line \"" + std::string(line) + "\" in " + filename + " is not a valid dictionary entry for " + std::to_string(expected_count) + " IDs");
+            }
+            mapping.insert(line.substr(0, separator), T(id));
+        }
+        if (mapping.size() != expected_count)
         {
-            std::string str(a->first);
-            T id = a->second;
-            out << str << " " << id << '\n';
+            throw MyException("The dictionary " + filename + " has " + std::to_string(mapping.size()) + " entries, but its metadata lists " + std::to_string(expected_count));
         }
+    }
+
+    void dump(std::ostream &out, T first_id = 0)
+    {
+        mapping.for_each([&out, first_id](std::string_view prefix, std::string_view local, T id)
+        {
+            if (id >= first_id)
+            {
+                out << prefix << local << " " << id << '\n';
+            }
+        });
         out.flush();
     }
 
-    void dump_to_file(const std::string &filename)
+    // Writes the strings that got an ID of at least `first_new_id`, i.e. the ones that were not loaded by `load_from_file`, in the text format
+    void dump_new_to_file(const std::string &filename, T first_new_id)
     {
         std::ofstream mapping_out(filename, std::ios::trunc);
         if (!mapping_out.is_open())
         {
-            throw MyException("Opening the file to dump to failed");
+            throw MyException("Opening the file to write the new dictionary entries to failed: " + filename);
         }
-        this->dump(mapping_out);
+        this->dump(mapping_out, first_new_id);
         mapping_out.close();
+        if (mapping_out.fail())
+        {
+            throw MyException("Writing the new dictionary entries to " + filename + " failed, the disk might be full");
+        }
+    }
+
+    void dump_to_file(const std::string &filename)
+    {
+        write_dictionary(filename, [this](auto &&visit)
+        {
+            mapping.for_each(visit);
+        });
+    }
+};
+
+// A thread-safe variant of the IDMapper, used when converting with multiple threads.
+// The strings are spread over shards that each have their own lock, and new IDs are handed out by a shared counter, so the IDs stay dense.
+template <typename T>
+class ConcurrentIDMapper
+{
+    static constexpr std::size_t SHARD_COUNT = 256;
+
+    struct Shard
+    {
+        std::mutex mutex;
+        // Every shard learns the frequent namespaces from its own share of the sample
+        PrefixedStringMap<T> mapping{0, PrefixedStringMap<T>::DEFAULT_SAMPLE_SIZE / SHARD_COUNT};
+    };
+
+    std::array<Shard, SHARD_COUNT> shards;
+    std::atomic<T> next_id;
+    StringViewHash hasher;
+
+    Shard &getShard(std::string_view stringID)
+    {
+        return shards[hasher(stringID) % SHARD_COUNT];
+    }
+
+public:
+    explicit ConcurrentIDMapper(std::size_t expected_size) : next_id(0)
+    {
+        for (Shard &shard : shards)
+        {
+            shard.mapping.reserve(expected_size / SHARD_COUNT);
+        }
+    }
+
+    T getID(std::string_view stringID)
+    {
+        Shard &shard = getShard(stringID);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const T *existing_id = shard.mapping.find(stringID);
+        if (existing_id != nullptr)
+        {
+            return *existing_id;
+        }
+        T the_id = next_id.fetch_add(1);
+        shard.mapping.insert(stringID, the_id);
+        return the_id;
+    }
+
+    std::optional<T> tryGetID(std::string_view stringID)
+    {
+        Shard &shard = getShard(stringID);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const T *existing_id = shard.mapping.find(stringID);
+        if (existing_id == nullptr)
+        {
+            return std::nullopt;
+        }
+        return *existing_id;
+    }
+
+    std::size_t size()
+    {
+        return next_id.load();
+    }
+
+    void dump(std::ostream &out)
+    {
+        for (Shard &shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.mapping.for_each([&out](std::string_view prefix, std::string_view local, T id)
+            {
+                out << prefix << local << " " << id << '\n';
+            });
+        }
+        out.flush();
+    }
+
+    void dump_to_file(const std::string &filename)
+    {
+        write_dictionary(filename, [this](auto &&visit)
+        {
+            for (Shard &shard : shards)
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.mapping.for_each(visit);
+            }
+        });
     }
 };
 
-std::vector<std::string::iterator> parse_tuple(std::string &line)
+// The iterators found by `parse_tuple`. A well-formed triple has exactly 9 of them, and a quad has 12.
+// They are stored in place to avoid a heap allocation per line. Any further iterators are only counted, so malformed lines can still be detected.
+class TupleIndices
 {
-    std::vector<std::string::iterator> indices;
+    static constexpr std::size_t MAX_INDICES = 12;
+    std::array<std::string_view::const_iterator, MAX_INDICES> indices;
+    std::size_t count = 0;
+
+public:
+    void push_back(std::string_view::const_iterator index)
+    {
+        if (count < MAX_INDICES)
+        {
+            indices[count] = index;
+        }
+        count++;
+    }
+
+    std::size_t size() const
+    {
+        return count;
+    }
+
+    std::string_view::const_iterator operator[](std::size_t i) const
+    {
+        return indices[i];
+    }
+};
+
+TupleIndices parse_tuple(std::string_view line)
+{
+    TupleIndices indices;
     char searching_char = '\0';
     bool search_for_qualifier = false;
     bool escaped;
-    for (std::string::iterator i = line.begin(); i != line.end(); ++i)
+    // Only the structural characters can change the state below, so the (vectorized) scan lets us skip all other characters
+    for_each_structural_character(line, [&](std::string_view::const_iterator i)
     {
         // We have separate code for string qualifiers (e.g. @nl)
         if (!search_for_qualifier)
@@ -126,7 +501,7 @@ std::vector<std::string::iterator> parse_tuple(std::string &line)
                 {
                 case '>':
                     // If the next character is not a space, ignore this character
-                    if (!(*(i+1) == ' '))
+                    if (i+1 == line.end() || !(*(i+1) == ' '))
                     {
                         break;
                     }
@@ -144,7 +519,7 @@ std::vector<std::string::iterator> parse_tuple(std::string &line)
                 case '"':
                     // Literals may contain escaped " characters
                     escaped = false;
-                    std::string::iterator previous_index = i-1;
+                    std::string_view::const_iterator previous_index = i-1;
                     while (*previous_index == '\\')
                     {
                         escaped = !escaped;
@@ -158,7 +533,7 @@ std::vector<std::string::iterator> parse_tuple(std::string &line)
                     searching_char = '\0';
                     // Push the end of contents iterator
                     indices.push_back(i);
-                    if (*(i+1) == ' ')
+                    if (i+1 != line.end() && *(i+1) == ' ')
                     {
                         // In this case the end of qualifiers iterator coincides with the end of contents iterator
                         indices.push_back(i);
@@ -178,164 +553,465 @@ std::vector<std::string::iterator> parse_tuple(std::string &line)
             indices.push_back(i-1);
             search_for_qualifier = false;
         }
-    }
+    });
     return indices;
 }
 
-void convert_graph(std::istream &inputstream,
-                   std::ostream &outputstream,
-                   const std::string &node_ID_file,
-                   const std::string &edge_ID_file
-)
-{
-    IDMapper<node_index> node_ID_Mapper;
-    IDMapper<edge_type> edge_ID_Mapper;
+const std::string literal_node_string = "_:literalNode";
+const std::string rdf_type_node_string = "_:rdfTypeNode";
 
-    std::string literal_node_string = "_:literalNode";
-    std::string rdf_type_node_string = "_:rdfTypeNode";
+const std::string rdf_type_string = "http://www.w3.org/1999/02/22-rdf-syntax-ns#type";
 
-    std::string rdf_type_string = "http://www.w3.org/1999/02/22-rdf-syntax-ns#type";
-
-    const int BufferSize = 8 * 16184;
+// Hands out the lines of a stream that cannot be mapped into memory (e.g. a named pipe), with the same interface as the LineScanner
+class StreamLineSource
+{
+private:
+    static const int BufferSize = 8 * 16184;
 
+    std::istream &inputstream;
     char _buffer[BufferSize];
-
-    inputstream.rdbuf()->pubsetbuf(_buffer, BufferSize);
-
     std::string line;
-    unsigned long line_counter = 0;
 
-    if (trigfile)
+public:
+    explicit StreamLineSource(std::istream &inputstream) : inputstream(inputstream)
     {
-        std::getline(inputstream, line);
-        boost::trim(line);
-        std::string suffix = "> {";
-        size_t suffix_len = suffix.size();
-        if (line[0] == '<' && line.substr(line.size()-suffix_len, suffix_len) == "> {")
-        {
-            std::cout << "Skipping the first line, because a `trigfile` has been set to true. The fist line was: " << line << std::endl;
-        }
-        else
+        inputstream.rdbuf()->pubsetbuf(_buffer, BufferSize);
+    }
+
+    bool next_line(std::string_view &line_view)
+    {
+        if (!std::getline(this->inputstream, this->line))
         {
-            throw MyException("`trigfile` has been set to true, but the first line (without line break characters) did not have the form \"<.*> {\": " + line);
+            return false;
         }
+        line_view = this->line;
+        return true;
     }
 
-    bool must_end = false;
+    bool bad() const
+    {
+        return this->inputstream.bad();
+    }
+};
 
-    while (std::getline(inputstream, line))
+// Checks (and skips) the first line of a trig file, which should look like "<.*> {"
+void check_trig_header(std::string_view line)
+{
+    line = trim_view(line);
+    std::string_view suffix = "> {";
+    if (line.size() >= suffix.size() && line[0] == '<' && line.substr(line.size()-suffix.size()) == suffix)
+    {
+        std::cout << "Skipping the first line, because a `trigfile` has been set to true. The fist line was: " << line << std::endl;
+    }
+    else
     {
-        const std::string original_line(line);
+        throw MyException("`trigfile` has been set to true, but the first line (without line break characters) did not have the form \"<.*> {\": " + std::string(line));
+    }
+}
 
-        if (line_counter % 1000000 == 0)
-        {
-            auto now{boost::chrono::system_clock::to_time_t(boost::chrono::system_clock::now())};
-            std::tm* ptm{std::localtime(&now)};
-            std::cout << std::put_time(ptm, "%Y/%m/%d %H:%M:%S") << " done with " << line_counter << " triples" << std::endl;
-        }
-        line_counter++;
+// Removes the angle brackets of an IRI, blank nodes keep their "_:" prefix such that they can not collide with an IRI
+std::string_view graph_name(std::string_view graph, unsigned long line_counter)
+{
+    if (graph.front() == '<' && graph.back() == '>')
+    {
+        return graph.substr(1, graph.size()-2);
+    }
+    if (graph.substr(0, 2) == "_:")
+    {
+        return graph;
+    }
+    throw MyException("The graph on line " + std::to_string(line_counter) + " could not be identified as an IRI or blank node");
+}
 
-        boost::trim(line);
-        if (line[0] == '#' || line == "")
-        {
-            // ignore comment line
-            continue;
-        }
-        if (must_end)
+// Whether a (trimmed) line of a multi-graph TriG file opens or closes a graph block, rather than holding a triple
+bool is_graph_block_line(std::string_view line)
+{
+    return line == "}" || line.back() == '{';
+}
+
+// Keeps track of the graph block that the lines of a multi-graph TriG file are in
+class TrigGraphTracker
+{
+private:
+    std::string current_graph;
+    bool in_block = false;
+
+public:
+    // Returns true if the (trimmed, non-empty) line opened or closed a graph block
+    bool handle_line(std::string_view line, unsigned long line_counter)
+    {
+        if (!is_graph_block_line(line))
         {
-            throw MyException("The file must have ended here, but did not!");
+            return false;
         }
-        if (trigfile)
+        if (line == "}")
         {
-            if (line == "}")
+            if (!this->in_block)
             {
-                must_end = true;
-                continue;
+                throw MyException("Line " + std::to_string(line_counter) + " closes a graph block, but no graph block was opened");
             }
+            this->in_block = false;
+            this->current_graph.clear();
+            return true;
         }
-        
-        // Get a vector of indices to the start and end of each element in the tuple
-        std::vector<std::string::iterator> string_indices = parse_tuple(line);
-
-        // Check if we got the expected amount of iterators
-        if (!(string_indices.size() == 9))
-        {
-            throw MyException("Wrong number of iterators returned by `parse_tuple`: expected 9 (3 each for subject, predicate and object), but got "
-                              + std::to_string(string_indices.size()) + " instead");
-        }
-
-        // Get to subject, predicate and object from the provided indices
-        // Note that we ignore the end of qualifiers iterators at positions 2, 5 and 8
-        std::string subject = std::string(string_indices[0], string_indices[1]+1);
-        std::string predicate = std::string(string_indices[3], string_indices[4]+1);
-        std::string object = std::string(string_indices[6], string_indices[7]+1);
-
-        // Remove the angle brackets for enitites and remove the underscores for blank nodes
-        if (subject.front() == '<' && subject.back() == '>')
-        {
-            subject = subject.substr(1, subject.size()-2);
-        }
-        else if (subject.substr(0, 2) == "_:")
+        if (this->in_block)
         {
-            subject = subject.substr(2, subject.size()-2);
+            throw MyException("Line " + std::to_string(line_counter) + " opens a graph block inside another graph block");
         }
-        else
+        std::string_view graph = trim_view(line.substr(0, line.size()-1));
+        if (graph.size() >= 5 && boost::iequals(graph.substr(0, 5), "GRAPH"))
         {
-            throw MyException("The subject on line " + std::to_string(line_counter) + " could not be identified as an entity or blank node");
+            graph = trim_view(graph.substr(5));
         }
+        this->current_graph = graph.empty() ? std::string_view() : graph_name(graph, line_counter);
+        this->in_block = true;
+        return true;
+    }
 
-        // Remove the angle brackets and for relations
-        if (predicate.front() == '<' && predicate.back() == '>')
-        {
-            predicate = predicate.substr(1, predicate.size()-2);
-        }
-        else
-        {
-            throw MyException("The predicate on line " + std::to_string(line_counter) + " could not be identified as a relation");
-        }
+    std::string_view graph() const
+    {
+        return this->current_graph;
+    }
 
-        // Remove the angle brackets and for enitites, remove the underscores for blank nodes and remove the double quotes for literals
-        if (object.front() == '<' && object.back() == '>')
-        {
-            object = object.substr(1, object.size()-2);
-        }
-        else if (object.substr(0, 2) == "_:")
-        {
-            object = object.substr(0, object.size()-2);
-        }
-        else if (object.front() == '"' && object.back() == '"')
+    void finish() const
+    {
+        if (this->in_block)
         {
-            if (skip_literals)
-            {
-                continue;
-            }
-            object = literal_node_string;
+            throw MyException("The file ended inside a graph block");
         }
-        else
+    }
+};
+
+// Strips the n-triples syntax from the terms of a triple: the angle brackets of IRIs and the underscores of blank nodes, and literals are replaced by the literal node.
+// Returns false if the triple should be skipped according to the `skip_literals` and `skipRDFlists` settings.
+bool normalize_terms(unsigned long line_counter,
+                     std::string_view &subject,
+                     std::string_view &predicate,
+                     std::string_view &object)
+{
+    // Remove the angle brackets for enitites and remove the underscores for blank nodes
+    if (subject.front() == '<' && subject.back() == '>')
+    {
+        subject = subject.substr(1, subject.size()-2);
+    }
+    else if (subject.substr(0, 2) == "_:")
+    {
+        subject = subject.substr(2, subject.size()-2);
+    }
+    else
+    {
+        throw MyException("The subject on line " + std::to_string(line_counter) + " could not be identified as an entity or blank node");
+    }
+
+    // Remove the angle brackets and for relations
+    if (predicate.front() == '<' && predicate.back() == '>')
+    {
+        predicate = predicate.substr(1, predicate.size()-2);
+    }
+    else
+    {
+        throw MyException("The predicate on line " + std::to_string(line_counter) + " could not be identified as a relation");
+    }
+
+    // Remove the angle brackets and for enitites, remove the underscores for blank nodes and remove the double quotes for literals
+    if (object.front() == '<' && object.back() == '>')
+    {
+        object = object.substr(1, object.size()-2);
+    }
+    else if (object.substr(0, 2) == "_:")
+    {
+        object = object.substr(2, object.size()-2);
+    }
+    else if (object.front() == '"' && object.back() == '"')
+    {
+        if (skip_literals)
+        {
+            return false;
+        }
+        object = literal_node_string;
+    }
+    else
+    {
+        throw MyException("The object on line " + std::to_string(line_counter) + " could not be identified as an entity, blank node or literal");
+    }
+
+    // If we want to skip RDF lists
+    if (skipRDFlists)
+    {
+        if (predicate == "http://www.w3.org/1999/02/22-rdf-syntax-ns#first" ||
+            predicate == "http://www.w3.org/1999/02/22-rdf-syntax-ns#rest" ||
+            object == "http://www.w3.org/1999/02/22-rdf-syntax-ns#nil" ||
+            object == "http://www.w3.org/1999/02/22-rdf-syntax-ns#List" ||
+            subject == "http://www.w3.org/1999/02/22-rdf-syntax-ns#nil" ||
+            subject == "http://www.w3.org/1999/02/22-rdf-syntax-ns#List" ||
+            predicate == "http://www.w3.org/1999/02/22-rdf-syntax-ns#nil" ||  // This one and the ones after are less likely to cause problems, but we remove them just in case
+            predicate == "http://www.w3.org/1999/02/22-rdf-syntax-ns#List" ||
+            object == "http://www.w3.org/1999/02/22-rdf-syntax-ns#first" ||
+            object == "http://www.w3.org/1999/02/22-rdf-syntax-ns#rest" ||
+            subject == "http://www.w3.org/1999/02/22-rdf-syntax-ns#first" ||
+            subject == "http://www.w3.org/1999/02/22-rdf-syntax-ns#rest")
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Splits a (trimmed, non-empty, non-comment) line into its subject, predicate and object, as views into the line.
+// The line may be a quad, whose graph term is checked against the `graph_filter` and then dropped. Otherwise the triple belongs to `context_graph`,
+// which is the enclosing graph block for multi-graph TriG files.
+// Returns false if the triple should be skipped according to the `graph_filter`, `skip_literals` and `skipRDFlists` settings.
+bool extract_terms(std::string_view line,
+                   unsigned long line_counter,
+                   std::string_view &subject,
+                   std::string_view &predicate,
+                   std::string_view &object,
+                   std::string_view context_graph = std::string_view())
+{
+    // Get the indices to the start and end of each element in the tuple
+    TupleIndices string_indices = parse_tuple(line);
+
+    // Check if we got the expected amount of iterators
+    bool is_quad = string_indices.size() == 12;
+    if (!(string_indices.size() == 9 || is_quad))
+    {
+        throw MyException("Wrong number of iterators returned by `parse_tuple`: expected 9 (3 each for subject, predicate and object) or 12 (including a graph), but got "
+                          + std::to_string(string_indices.size()) + " instead");
+    }
+
+    // Note that the graph is checked before anything else, since filtering graphs may skip most of the lines
+    if (graph_filter.active())
+    {
+        std::string_view graph = context_graph;
+        if (is_quad)
+        {
+            graph = graph_name(std::string_view(string_indices[9], string_indices[10]+1), line_counter);
+        }
+        if (!graph_filter.accepts(graph))
+        {
+            return false;
+        }
+    }
+
+    // Get to subject, predicate and object from the provided indices
+    // Note that we ignore the end of qualifiers iterators at positions 2, 5 and 8
+    subject = std::string_view(string_indices[0], string_indices[1]+1);
+    predicate = std::string_view(string_indices[3], string_indices[4]+1);
+    object = std::string_view(string_indices[6], string_indices[7]+1);
+
+    return normalize_terms(line_counter, subject, predicate, object);
+}
+
+// Reads the number of IDs (`num_nodes` or `num_relations`) from the metadata written next to a dictionary by `write_ID_metadata`
+std::size_t read_ID_count(const std::string &ID_file, const std::string &count_key)
+{
+    std::string ID_metadata_file = boost::filesystem::path(ID_file).replace_extension(".meta.json").string();
+    std::ifstream ID_metadata_in(ID_metadata_file);
+    if (!ID_metadata_in.is_open())
+    {
+        throw MyException("Opening the dictionary metadata failed: " + ID_metadata_file);
+    }
+    json ID_metadata_json;
+    ID_metadata_in >> ID_metadata_json;
+    return ID_metadata_json.at(count_key).get<std::size_t>();
+}
+
+void write_ID_metadata(const std::string &node_ID_file,
+                       const std::string &edge_ID_file,
+                       std::size_t num_nodes,
+                       std::size_t num_relations,
+                       std::optional<node_index> literal_node_id,
+                       std::optional<node_index> rdf_type_node_id,
+                       std::optional<edge_type> rdf_type_relation_id)
+{
+    std::string node_ID_metadata_file = boost::filesystem::path(node_ID_file).replace_extension(".meta.json").string();
+    std::string edge_ID_metadata_file = boost::filesystem::path(edge_ID_file).replace_extension(".meta.json").string();
+
+    std::ofstream node_ID_metadata_out(node_ID_metadata_file, std::ios::trunc);
+    std::ofstream edge_ID_metadata_out(edge_ID_metadata_file, std::ios::trunc);
+
+    json node_ID_metadata_json = json::object();
+    json special_nodes_json = json::object();
+
+    node_ID_metadata_json["num_nodes"] = num_nodes;
+    if (literal_node_id)
+    {
+        special_nodes_json[literal_node_string] = *literal_node_id;
+    }
+    if (rdf_type_node_id)
+    {
+        special_nodes_json[rdf_type_node_string] = *rdf_type_node_id;
+    }
+    node_ID_metadata_json["special_nodes"] = special_nodes_json;
+
+    json edge_ID_metadata_json = json::object();
+    json special_relations_json = json::object();
+
+    edge_ID_metadata_json["num_relations"] = num_relations;
+    if (rdf_type_relation_id)
+    {
+        special_relations_json[rdf_type_string] = *rdf_type_relation_id;
+    }
+    edge_ID_metadata_json["special_relations"] = special_relations_json;
+
+    node_ID_metadata_out << node_ID_metadata_json.dump(4);
+    edge_ID_metadata_out << edge_ID_metadata_json.dump(4);
+    node_ID_metadata_out.close();
+    edge_ID_metadata_out.close();
+}
+
+// Calls `visit(subject, predicate, object)` for every triple that is not skipped, handling comments and the trig header and footer.
+// The lines are provided by either a LineScanner (for mapped files) or a StreamLineSource
+template <typename LineSource, typename TripleVisitor>
+void for_each_triple(LineSource &lines, TripleVisitor &&visit)
+{
+    std::string_view line;
+    unsigned long line_counter = 0;
+
+    if (trigfile && lines.next_line(line))
+    {
+        check_trig_header(line);
+    }
+
+    bool must_end = false;
+    TrigGraphTracker graph_tracker;
+
+    std::string_view subject;
+    std::string_view predicate;
+    std::string_view object;
+
+    while (lines.next_line(line))
+    {
+        if (line_counter % 1000000 == 0)
         {
-            throw MyException("The object on line " + std::to_string(line_counter) + " could not be identified as an entity, blank node or literal");
+            auto now{boost::chrono::system_clock::to_time_t(boost::chrono::system_clock::now())};
+            std::tm* ptm{std::localtime(&now)};
+            std::cout << std::put_time(ptm, "%Y/%m/%d %H:%M:%S") << " done with " << line_counter << " triples" << std::endl;
         }
+        line_counter++;
 
-        // If we want to skip RDF lists
-        if (skipRDFlists)
+        line = trim_view(line);
+        if (line.empty() || line[0] == '#')
+        {
+            // ignore comment line
+            continue;
+        }
+        if (must_end)
+        {
+            throw MyException("The file must have ended here, but did not!");
+        }
+        if (trigfile)
         {
-            if (predicate == "http://www.w3.org/1999/02/22-rdf-syntax-ns#first" ||
-                predicate == "http://www.w3.org/1999/02/22-rdf-syntax-ns#rest" ||
-                object == "http://www.w3.org/1999/02/22-rdf-syntax-ns#nil" ||
-                object == "http://www.w3.org/1999/02/22-rdf-syntax-ns#List" ||
-                subject == "http://www.w3.org/1999/02/22-rdf-syntax-ns#nil" ||
-                subject == "http://www.w3.org/1999/02/22-rdf-syntax-ns#List" ||
-                predicate == "http://www.w3.org/1999/02/22-rdf-syntax-ns#nil" ||  // This one and the ones after are less likely to cause problems, but we remove them just in case
-                predicate == "http://www.w3.org/1999/02/22-rdf-syntax-ns#List" ||
-                object == "http://www.w3.org/1999/02/22-rdf-syntax-ns#first" ||
-                object == "http://www.w3.org/1999/02/22-rdf-syntax-ns#rest" ||
-                subject == "http://www.w3.org/1999/02/22-rdf-syntax-ns#first" ||
-                subject == "http://www.w3.org/1999/02/22-rdf-syntax-ns#rest")
+            if (line == "}")
             {
+                must_end = true;
                 continue;
             }
         }
-        
+        if (multi_graph_trig && graph_tracker.handle_line(line, line_counter))
+        {
+            continue;
+        }
+
+        if (!extract_terms(line, line_counter, subject, predicate, object, graph_tracker.graph()))
+        {
+            continue;
+        }
+        visit(subject, predicate, object);
+    }
+    graph_tracker.finish();
+}
+
+// Calls `visit(subject, predicate, object)` for every triple of a Turtle file that is not skipped.
+// The parser produces the terms in n-triples syntax, so they are normalized like the terms of an n-triples line.
+template <typename TripleVisitor>
+void for_each_triple(TurtleParser &parser, TripleVisitor &&visit)
+{
+    unsigned long triple_counter = 0;
+    parser.parse([&](std::string_view subject, std::string_view predicate, std::string_view object)
+    {
+        if (triple_counter % 1000000 == 0)
+        {
+            auto now{boost::chrono::system_clock::to_time_t(boost::chrono::system_clock::now())};
+            std::tm* ptm{std::localtime(&now)};
+            std::cout << std::put_time(ptm, "%Y/%m/%d %H:%M:%S") << " done with " << triple_counter << " triples" << std::endl;
+        }
+        triple_counter++;
+
+        if (!normalize_terms(parser.line_number(), subject, predicate, object))
+        {
+            return;
+        }
+        visit(subject, predicate, object);
+    });
+}
+
+// Throws if the entities do not fit in IDs of `entity_bytes` bytes
+void check_entity_count(std::size_t num_nodes, int entity_bytes)
+{
+    if (num_nodes > (uint64_t(1) << (8 * entity_bytes)))
+    {
+        throw MyException("The graph has " + std::to_string(num_nodes) + " entities, which do not fit in IDs of " + std::to_string(entity_bytes) + " bytes. Use a larger --entity_bytes");
+    }
+}
+
+// Appends the contents of `delta_file` to `filename` and removes `delta_file`
+void append_file(const std::string &delta_file, const std::string &filename)
+{
+    {
+        std::ifstream inputstream(delta_file, std::ios::binary);
+        std::ofstream outputstream(filename, std::ios::app | std::ios::binary);
+        if (!inputstream.is_open() || !outputstream.is_open())
+        {
+            throw MyException("Opening " + delta_file + " to append it to " + filename + " failed");
+        }
+        // Streaming an empty buffer counts as a failure, so an empty delta is skipped
+        if (inputstream.peek() != std::ifstream::traits_type::eof())
+        {
+            outputstream << inputstream.rdbuf();
+        }
+        outputstream.close();
+        if (outputstream.fail())
+        {
+            throw MyException("Appending " + delta_file + " to " + filename + " failed, the disk might be full");
+        }
+    }
+    boost::filesystem::remove(delta_file);
+}
+
+// The triples are provided by a line source (see `for_each_triple`) or a TurtleParser.
+// If `append` is set, the existing dictionaries are loaded first, such that only the new terms get new IDs (after the existing ones).
+// The new triples then form a segment that is appended to the existing binary encoding, and only the new terms are appended to the dictionaries.
+// Nothing is appended before the whole input has been converted and the entities are known to fit: the triples go to a separate segment in `outputstream`,
+// and the new terms to files next to the dictionaries. Then `append_segment` appends the triples, after which the new terms are appended as well.
+template <int ENTITY_BYTES, typename TripleSource, typename SegmentAppender>
+void convert_graph(TripleSource &lines,
+                   std::ostream &outputstream,
+                   const std::string &node_ID_file,
+                   const std::string &edge_ID_file,
+                   std::size_t expected_entities,
+                   bool append,
+                   SegmentAppender &&append_segment
+)
+{
+    std::size_t previous_nodes = append ? read_ID_count(node_ID_file, "num_nodes") : 0;
+    std::size_t previous_relations = append ? read_ID_count(edge_ID_file, "num_relations") : 0;
+
+    IDMapper<node_index> node_ID_Mapper(previous_nodes + expected_entities);
+    IDMapper<edge_type> edge_ID_Mapper(previous_relations + expected_relations);
+    if (append)
+    {
+        node_ID_Mapper.load_from_file(node_ID_file, previous_nodes);
+        edge_ID_Mapper.load_from_file(edge_ID_file, previous_relations);
+
+        auto now{boost::chrono::system_clock::to_time_t(boost::chrono::system_clock::now())};
+        std::tm* ptm{std::localtime(&now)};
+        std::cout << std::put_time(ptm, "%Y/%m/%d %H:%M:%S") << " appending to the existing " << previous_nodes << " entities and " << previous_relations << " relations" << std::endl;
+    }
+
+    BlockWriter triples(outputstream);
+    for_each_triple(lines, [&](std::string_view subject, std::string_view predicate, std::string_view object)
+    {
         // subject
         node_index subject_index = node_ID_Mapper.getID(subject);
 
@@ -346,10 +1022,10 @@ void convert_graph(std::istream &inputstream,
         node_index object_index;
 
         bool object_index_initialized = false;
-        auto rdf_type_relation_id_iterator = edge_ID_Mapper.tryGetIDIt(rdf_type_string);
-        if (types_to_predicates and (rdf_type_relation_id_iterator != edge_ID_Mapper.getMappingCend()))  // Check if we run in types_to_predicates mode and if we have already found rdf:type
+        std::optional<edge_type> rdf_type_relation_id = types_to_predicates ? edge_ID_Mapper.tryGetID(rdf_type_string) : std::nullopt;
+        if (types_to_predicates and rdf_type_relation_id)  // Check if we run in types_to_predicates mode and if we have already found rdf:type
         {
-            if (edge_index == rdf_type_relation_id_iterator->second)  // If the current edge_index belongs to rdf:type, then encode the object as an edge
+            if (edge_index == *rdf_type_relation_id)  // If the current edge_index belongs to rdf:type, then encode the object as an edge
             {
                 edge_index = edge_ID_Mapper.getID(object);  // TODO there is currently no check to see if this cast is possible (in practice it likely will be possible)
                 object_index = node_ID_Mapper.getID(rdf_type_node_string);
@@ -363,58 +1039,608 @@ void convert_graph(std::istream &inputstream,
         }
 
         // Write the indices in our binary format
-        write_uint_ENTITY_little_endian(outputstream, subject_index);
-        write_uint_PREDICATE_little_endian(outputstream, edge_index);
-        write_uint_ENTITY_little_endian(outputstream, object_index);
+        triples.write_triple<ENTITY_BYTES>(subject_index, edge_index, object_index);
+    });
+    triples.flush();
+    check_entity_count(node_ID_Mapper.size(), ENTITY_BYTES);
+    if (append)
+    {
+        std::string node_ID_delta_file = node_ID_file + ".appending";
+        std::string edge_ID_delta_file = edge_ID_file + ".appending";
+        node_ID_Mapper.dump_new_to_file(node_ID_delta_file, previous_nodes);
+        edge_ID_Mapper.dump_new_to_file(edge_ID_delta_file, previous_relations);
+        append_segment();
+        append_file(node_ID_delta_file, node_ID_file);
+        append_file(edge_ID_delta_file, edge_ID_file);
     }
-    if (inputstream.bad())
+    else
     {
-        perror("error happened while reading file");
+        node_ID_Mapper.dump_to_file(node_ID_file);
+        edge_ID_Mapper.dump_to_file(edge_ID_file);
     }
-    node_ID_Mapper.dump_to_file(node_ID_file);
-    edge_ID_Mapper.dump_to_file(edge_ID_file);
 
-    auto entity_map_cend = node_ID_Mapper.getMappingCend();
-    auto literal_node_id_iterator = node_ID_Mapper.tryGetIDIt(literal_node_string);
-    auto rdf_type_node_id_iterator = node_ID_Mapper.tryGetIDIt(rdf_type_node_string);
+    write_ID_metadata(node_ID_file,
+                      edge_ID_file,
+                      node_ID_Mapper.size(),
+                      edge_ID_Mapper.size(),
+                      node_ID_Mapper.tryGetID(literal_node_string),
+                      node_ID_Mapper.tryGetID(rdf_type_node_string),
+                      edge_ID_Mapper.tryGetID(rdf_type_string));
+}
 
-    auto relation_map_cend = edge_ID_Mapper.getMappingCend();
-    auto rdf_type_relation_id_iterator = edge_ID_Mapper.tryGetIDIt(rdf_type_string);
+// Converts the graph with a bounded amount of memory, for inputs whose dictionary does not fit in memory.
+// Every triple takes three consecutive slots (subject, predicate and object). The terms are collected with the slots they occur in and spilled to sorted runs
+// in `run_directory` whenever the memory budget is used up. Merging the runs assigns the IDs, after which the (slot, ID) pairs are sorted back into triple order.
+// The IDs are dense, but they follow the sorted order of the strings instead of the order in which they first appear.
+template <int ENTITY_BYTES, typename TripleSource>
+void convert_graph_external(TripleSource &lines,
+                            std::ostream &outputstream,
+                            const std::string &node_ID_file,
+                            const std::string &edge_ID_file,
+                            const std::string &run_directory,
+                            std::size_t memory_budget
+)
+{
+    external_sort::RunDirectory runs(run_directory);
+    external_sort::ExternalIDMapper<node_index> node_ID_Mapper(runs, "entities");
+    external_sort::ExternalIDMapper<edge_type> edge_ID_Mapper(runs, "relations");
 
-    std::string node_ID_metadata_file = boost::filesystem::path(node_ID_file).replace_extension(".meta.json").string();
-    std::string edge_ID_metadata_file = boost::filesystem::path(edge_ID_file).replace_extension(".meta.json").string();
+    uint64_t triple_count = 0;
+    for_each_triple(lines, [&](std::string_view subject, std::string_view predicate, std::string_view object)
+    {
+        uint64_t slot = triple_count * 3;
+        node_ID_Mapper.add(subject, slot);
+        if (types_to_predicates && predicate == rdf_type_string)  // Encode the object as an edge, like in `convert_graph`
+        {
+            edge_ID_Mapper.add(predicate);  // rdf:type keeps its ID, even though no triple refers to it
+            edge_ID_Mapper.add(object, slot + 1);
+            node_ID_Mapper.add(rdf_type_node_string, slot + 2);
+        }
+        else
+        {
+            edge_ID_Mapper.add(predicate, slot + 1);
+            node_ID_Mapper.add(object, slot + 2);
+        }
+        triple_count++;
 
-    std::ofstream node_ID_metadata_out(node_ID_metadata_file, std::ios::trunc);
-    std::ofstream edge_ID_metadata_out(edge_ID_metadata_file, std::ios::trunc);
+        if (node_ID_Mapper.memory_usage() + edge_ID_Mapper.memory_usage() > memory_budget)
+        {
+            node_ID_Mapper.spill();
+            edge_ID_Mapper.spill();
+        }
+    });
 
-    json node_ID_metadata_json = json::object();
-    json special_nodes_json = json::object();
+    auto now{boost::chrono::system_clock::to_time_t(boost::chrono::system_clock::now())};
+    std::tm* ptm{std::localtime(&now)};
+    std::cout << std::put_time(ptm, "%Y/%m/%d %H:%M:%S") << " assigning IDs to the terms of " << triple_count << " triples" << std::endl;
+
+    std::optional<node_index> literal_node_id;
+    std::optional<node_index> rdf_type_node_id;
+    std::optional<edge_type> rdf_type_relation_id;
+
+    // The last terms are spilled before the slot sorter takes its share of the memory
+    node_ID_Mapper.spill();
+    edge_ID_Mapper.spill();
+    external_sort::PairSorter slots(runs, memory_budget);
 
-    node_ID_metadata_json["num_nodes"] = node_ID_Mapper.size();
-    if (literal_node_id_iterator != entity_map_cend)
+    // The IDs are assigned in sorted order of the terms, so even a binary dictionary can be written while they are assigned
+    DictionaryWriter node_ID_out(node_ID_file);
+    DictionaryWriter edge_ID_out(edge_ID_file);
+    std::size_t num_nodes = node_ID_Mapper.assign_IDs(slots, [&](std::string_view term, node_index id)
     {
-        special_nodes_json[literal_node_string] = literal_node_id_iterator->second;
+        node_ID_out.add(term, id);
+        if (term == literal_node_string)
+        {
+            literal_node_id = id;
+        }
+        else if (term == rdf_type_node_string)
+        {
+            rdf_type_node_id = id;
+        }
+    });
+    std::size_t num_relations = edge_ID_Mapper.assign_IDs(slots, [&](std::string_view term, edge_type id)
+    {
+        edge_ID_out.add(term, id);
+        if (term == rdf_type_string)
+        {
+            rdf_type_relation_id = id;
+        }
+    });
+    node_ID_out.close();
+    edge_ID_out.close();
+
+    // Every slot has exactly one ID, so the sorted pairs can be written out three at a time
+    uint64_t expected_slot = 0;
+    BlockWriter triples(outputstream);
+    slots.merge([&](uint64_t slot, uint64_t id)
+    {
+        if (slot != expected_slot)
+        {
+            throw MyException("The external sort lost track of slot " + std::to_string(expected_slot));
+        }
+        if (slot % 3 == 1)
+        {
+            triples.write_uint_PREDICATE_little_endian(id);
+        }
+        else
+        {
+            triples.write_little_endian<ENTITY_BYTES>(id);
+        }
+        expected_slot++;
+    });
+    triples.flush();
+    if (expected_slot != triple_count * 3)
+    {
+        throw MyException("The external sort lost track of slot " + std::to_string(expected_slot));
     }
-    if (rdf_type_node_id_iterator != entity_map_cend)
+    boost::filesystem::remove_all(run_directory);
+
+    write_ID_metadata(node_ID_file,
+                      edge_ID_file,
+                      num_nodes,
+                      num_relations,
+                      literal_node_id,
+                      rdf_type_node_id,
+                      rdf_type_relation_id);
+}
+
+// The outcome of converting one newline-aligned chunk of the input in `convert_graph_parallel`
+// The graph blocks in a chunk of a multi-graph TriG file. A chunk does not know whether it starts inside a block, so the lines are followed
+// for both cases (indexed by whether the chunk starts inside a block), and `convert_multi_threaded` picks the right case in input order.
+struct GraphBlockNesting
+{
+    bool ends_in_block[2] = {false, true};
+    unsigned long error_line[2] = {0, 0};  // The line (within the chunk) that opens a block inside a block or closes no block, or 0 if there is none
+    bool error_opens[2] = {false, false};  // Whether that line opens a block
+
+    void handle_line(std::string_view line, unsigned long line_count)
     {
-        special_nodes_json[rdf_type_node_string] = rdf_type_node_id_iterator->second;
+        bool opens = line != "}";
+        for (int start = 0; start < 2; start++)
+        {
+            if (this->error_line[start] != 0)
+            {
+                continue;
+            }
+            if (opens == this->ends_in_block[start])
+            {
+                this->error_line[start] = line_count;
+                this->error_opens[start] = opens;
+            }
+            else
+            {
+                this->ends_in_block[start] = opens;
+            }
+        }
     }
-    node_ID_metadata_json["special_nodes"] = special_nodes_json;
+};
 
-    json edge_ID_metadata_json = json::object();
-    json special_relations_json = json::object();
+struct ChunkResult
+{
+    std::string encoded;  // The binary encoding of the triples in the chunk
+    unsigned long line_count = 0;
+    unsigned long triple_count = 0;  // The number of triples that were encoded, which excludes the skipped lines
+    bool has_content = false;  // Whether the chunk contained any line that is not empty or a comment
+    bool ended = false;  // Whether the chunk contained the closing "}" of a trig file
+    GraphBlockNesting nesting;
+    std::exception_ptr error;
+};
 
-    edge_ID_metadata_json["num_relations"] = edge_ID_Mapper.size();
-    if (rdf_type_relation_id_iterator != relation_map_cend)
+template <int ENTITY_BYTES>
+void convert_chunk(std::string_view chunk,
+                   ConcurrentIDMapper<node_index> &node_ID_Mapper,
+                   ConcurrentIDMapper<edge_type> &edge_ID_Mapper,
+                   ChunkResult &result)
+{
+    try
     {
-        special_relations_json[rdf_type_string] = rdf_type_relation_id_iterator->second;
+        std::ostringstream outputstream;
+        BlockWriter triples(outputstream);
+
+        // The relations are few and very frequent, so we cache them locally to avoid contention on their shards
+        string_view_map<edge_type> edge_ID_cache;
+        auto get_edge_ID = [&](std::string_view edge_string)
+        {
+            auto cache_iterator = edge_ID_cache.find(edge_string);
+            if (cache_iterator != edge_ID_cache.end())
+            {
+                return cache_iterator->second;
+            }
+            edge_type the_id = edge_ID_Mapper.getID(edge_string);
+            edge_ID_cache.emplace(std::string(edge_string), the_id);
+            return the_id;
+        };
+        // The same holds for the literal node and the rdf:type node
+        std::optional<node_index> literal_node_id;
+        std::optional<node_index> rdf_type_node_id;
+
+        LineScanner lines(chunk);
+        std::string_view line;
+        std::string_view subject;
+        std::string_view predicate;
+        std::string_view object;
+
+        while (lines.next_line(line))
+        {
+            result.line_count++;
+
+            line = trim_view(line);
+            if (line.empty() || line[0] == '#')
+            {
+                // ignore comment line
+                continue;
+            }
+            if (result.ended)
+            {
+                throw MyException("The file must have ended here, but did not!");
+            }
+            result.has_content = true;
+            if (trigfile)
+            {
+                if (line == "}")
+                {
+                    result.ended = true;
+                    continue;
+                }
+            }
+            // A chunk may start inside a graph block, so graphs can not be filtered here, and the nesting is checked once the chunks are in order
+            if (multi_graph_trig && is_graph_block_line(line))
+            {
+                result.nesting.handle_line(line, result.line_count);
+                continue;
+            }
+
+            if (!extract_terms(line, result.line_count, subject, predicate, object))
+            {
+                continue;
+            }
+
+            node_index subject_index = node_ID_Mapper.getID(subject);
+            edge_type edge_index = get_edge_ID(predicate);
+            node_index object_index;
+
+            if (types_to_predicates && predicate == rdf_type_string)
+            {
+                // Encode the object of an rdf:type triple as an edge
+                edge_index = get_edge_ID(object);
+                if (!rdf_type_node_id)
+                {
+                    rdf_type_node_id = node_ID_Mapper.getID(rdf_type_node_string);
+                }
+                object_index = *rdf_type_node_id;
+            }
+            else if (object == literal_node_string)
+            {
+                if (!literal_node_id)
+                {
+                    literal_node_id = node_ID_Mapper.getID(literal_node_string);
+                }
+                object_index = *literal_node_id;
+            }
+            else
+            {
+                object_index = node_ID_Mapper.getID(object);
+            }
+
+            triples.write_triple<ENTITY_BYTES>(subject_index, edge_index, object_index);
+            result.triple_count++;
+        }
+        triples.flush();
+        result.encoded = outputstream.str();
     }
-    edge_ID_metadata_json["special_relations"] = special_relations_json;
+    catch (...)
+    {
+        result.error = std::current_exception();
+    }
+}
 
-    node_ID_metadata_out << node_ID_metadata_json.dump(4);
-    edge_ID_metadata_out << edge_ID_metadata_json.dump(4);
-    node_ID_metadata_out.close();
-    edge_ID_metadata_out.close();
+// Cuts newline-aligned chunks of roughly `chunk_size` bytes from a stream that cannot be mapped into memory
+class StreamChunkSource
+{
+private:
+    std::istream &inputstream;
+    std::size_t chunk_size;
+    std::string leftover;  // Whatever was read beyond the last line break of the previous chunk
+
+public:
+    StreamChunkSource(std::istream &inputstream, std::size_t chunk_size) : inputstream(inputstream), chunk_size(chunk_size)
+    {
+        if (trigfile)
+        {
+            std::string line;
+            std::getline(inputstream, line);
+            check_trig_header(line);
+        }
+    }
+
+    // The returned chunk is stored in `storage`, which has to outlive the view
+    std::string_view next_chunk(std::string &storage)
+    {
+        storage = std::move(this->leftover);
+        this->leftover.clear();
+        while (this->inputstream)
+        {
+            std::size_t old_size = storage.size();
+            storage.resize(old_size + this->chunk_size);
+            this->inputstream.read(storage.data() + old_size, this->chunk_size);
+            storage.resize(old_size + this->inputstream.gcount());
+
+            std::size_t last_line_break = storage.rfind('\n');
+            if (last_line_break != std::string::npos && last_line_break >= old_size)
+            {
+                this->leftover.assign(storage, last_line_break + 1);
+                storage.resize(last_line_break + 1);
+                break;
+            }
+            // Otherwise the chunk does not contain a full line yet, so we keep reading
+        }
+        return storage;
+    }
+
+    bool bad() const
+    {
+        return this->inputstream.bad();
+    }
+};
+
+// Cuts newline-aligned chunks of roughly `chunk_size` bytes from a mapped file, without copying them
+class MappedChunkSource
+{
+private:
+    std::string_view remainder;
+    std::size_t chunk_size;
+
+public:
+    MappedChunkSource(std::string_view contents, std::size_t chunk_size) : remainder(contents), chunk_size(chunk_size)
+    {
+        if (trigfile)
+        {
+            LineScanner lines(contents);
+            std::string_view line;
+            if (lines.next_line(line))
+            {
+                check_trig_header(line);
+            }
+            this->remainder = lines.remainder();
+        }
+    }
+
+    std::string_view next_chunk(std::string &)
+    {
+        if (this->remainder.size() <= this->chunk_size)
+        {
+            std::string_view chunk = this->remainder;
+            this->remainder = std::string_view();
+            return chunk;
+        }
+        std::size_t line_break = this->remainder.find('\n', this->chunk_size - 1);
+        std::size_t length = line_break == std::string_view::npos ? this->remainder.size() : line_break + 1;
+        std::string_view chunk = this->remainder.substr(0, length);
+        this->remainder.remove_prefix(length);
+        return chunk;
+    }
+
+    bool bad() const
+    {
+        return false;
+    }
+};
+
+// The chunks are provided by either a MappedChunkSource or a StreamChunkSource
+template <int ENTITY_BYTES, typename ChunkSource>
+void convert_graph_parallel(ChunkSource &chunk_source,
+                            std::ostream &outputstream,
+                            const std::string &node_ID_file,
+                            const std::string &edge_ID_file,
+                            unsigned int thread_count,
+                            std::size_t expected_entities
+)
+{
+    ConcurrentIDMapper<node_index> node_ID_Mapper(expected_entities);
+    ConcurrentIDMapper<edge_type> edge_ID_Mapper(expected_relations);
+
+    // A round consists of one chunk per thread. The storage is only used for chunks read from a stream.
+    auto read_round = [&](std::vector<std::string> &storage)
+    {
+        storage.resize(thread_count);
+        std::vector<std::string_view> chunks;
+        for (unsigned int i = 0; i < thread_count; i++)
+        {
+            std::string_view chunk = chunk_source.next_chunk(storage[i]);
+            if (chunk.empty())
+            {
+                break;
+            }
+            chunks.push_back(chunk);
+        }
+        return chunks;
+    };
+
+    unsigned long line_counter = 0;
+    unsigned long triple_counter = 0;
+    bool must_end = false;
+    bool in_graph_block = false;
+
+    std::vector<std::string> storage;
+    std::vector<std::string> next_storage;
+    std::vector<std::string_view> chunks = read_round(storage);
+    while (!chunks.empty())
+    {
+        // Each chunk in a round gets its own thread
+        std::vector<ChunkResult> results(chunks.size());
+        std::vector<std::thread> workers;
+        for (std::size_t i = 0; i < chunks.size(); i++)
+        {
+            workers.emplace_back(convert_chunk<ENTITY_BYTES>, chunks[i], std::ref(node_ID_Mapper), std::ref(edge_ID_Mapper), std::ref(results[i]));
+        }
+        // Read the next round while the workers are busy
+        std::vector<std::string_view> next_chunks = read_round(next_storage);
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+
+        // Write the results in input order
+        for (ChunkResult &result : results)
+        {
+            if (result.error)
+            {
+                try
+                {
+                    std::rethrow_exception(result.error);
+                }
+                catch (const MyException &e)
+                {
+                    throw MyException(std::string(e.what()) + " (line numbers are counted from line " + std::to_string(line_counter + 1) + " onwards)");
+                }
+            }
+            if (must_end && result.has_content)
+            {
+                throw MyException("The file must have ended here, but did not!");
+            }
+            must_end = must_end || result.ended;
+            if (multi_graph_trig)
+            {
+                int start = in_graph_block;
+                if (result.nesting.error_line[start] != 0)
+                {
+                    std::string line_number = std::to_string(line_counter + result.nesting.error_line[start]);
+                    throw MyException(result.nesting.error_opens[start] ? "Line " + line_number + " opens a graph block inside another graph block"
+                                                                        : "Line " + line_number + " closes a graph block, but no graph block was opened");
+                }
+                in_graph_block = result.nesting.ends_in_block[start];
+            }
+            outputstream.write(result.encoded.data(), result.encoded.size());
+            if (outputstream.fail())
+            {
+                throw MyException("Writing the binary encoding failed");
+            }
+            line_counter += result.line_count;
+            triple_counter += result.triple_count;
+        }
+
+        auto now{boost::chrono::system_clock::to_time_t(boost::chrono::system_clock::now())};
+        std::tm* ptm{std::localtime(&now)};
+        std::cout << std::put_time(ptm, "%Y/%m/%d %H:%M:%S") << " done with " << triple_counter << " triples" << std::endl;
+
+        chunks = std::move(next_chunks);
+        std::swap(storage, next_storage);
+    }
+    if (chunk_source.bad())
+    {
+        perror("error happened while reading file");
+    }
+    if (in_graph_block)
+    {
+        throw MyException("The file ended inside a graph block");
+    }
+    node_ID_Mapper.dump_to_file(node_ID_file);
+    edge_ID_Mapper.dump_to_file(edge_ID_file);
+
+    write_ID_metadata(node_ID_file,
+                      edge_ID_file,
+                      node_ID_Mapper.size(),
+                      edge_ID_Mapper.size(),
+                      node_ID_Mapper.tryGetID(literal_node_string),
+                      node_ID_Mapper.tryGetID(rdf_type_node_string),
+                      edge_ID_Mapper.tryGetID(rdf_type_string));
+}
+
+// A triple of the binary encoding packed into two 64-bit values, such that comparing the pairs compares (subject, predicate, object).
+// With 5-byte entities, the 40-bit subject and the upper 24 bits of the predicate share the first value, the lower 8 bits of the predicate
+// and the 40-bit object share the second. Entities of up to 6 bytes fit, since the 32-bit predicate then still fits between them.
+using packed_triple = std::pair<uint64_t, uint64_t>;
+
+template <int ENTITY_BYTES>
+inline packed_triple pack_triple(const TripleRecord &triple)
+{
+    constexpr int ENTITY_BITS = 8 * ENTITY_BYTES;
+    constexpr int LOW_PREDICATE_BITS = ENTITY_BITS - 32;  // The bits of the predicate that go into the second value
+    return packed_triple((triple.subject << (64 - ENTITY_BITS)) | (triple.predicate >> LOW_PREDICATE_BITS),
+                         ((uint64_t(triple.predicate) & ((uint64_t(1) << LOW_PREDICATE_BITS) - 1)) << ENTITY_BITS) | triple.object);
+}
+
+template <int ENTITY_BYTES>
+inline void write_packed_triple(SizedTripleFileWriter<ENTITY_BYTES> &writer, packed_triple triple)
+{
+    constexpr int ENTITY_BITS = 8 * ENTITY_BYTES;
+    constexpr int LOW_PREDICATE_BITS = ENTITY_BITS - 32;
+    writer.write({triple.first >> (64 - ENTITY_BITS),
+                  edge_type(((triple.first & ((uint64_t(1) << (64 - ENTITY_BITS)) - 1)) << LOW_PREDICATE_BITS) | (triple.second >> ENTITY_BITS)),
+                  triple.second & ((uint64_t(1) << ENTITY_BITS) - 1)});
+}
+
+// Removes the duplicate triples from the binary encoding and returns the number of triples that were removed.
+// Without a memory budget, a hash set of the triples keeps the first occurrence of every triple, so the order of the triples is preserved.
+// With a memory budget, the triples are sorted externally and the duplicates are dropped while merging, so the triples end up sorted by (subject, predicate, object).
+template <int ENTITY_BYTES>
+std::size_t deduplicate_triples(const std::string &binary_file, std::optional<std::size_t> memory_budget, const std::string &run_directory)
+{
+    auto now{boost::chrono::system_clock::to_time_t(boost::chrono::system_clock::now())};
+    std::tm* ptm{std::localtime(&now)};
+    std::cout << std::put_time(ptm, "%Y/%m/%d %H:%M:%S") << " removing duplicate triples" << std::endl;
+
+    std::string deduplicated_file = binary_file + ".deduplicated";
+    std::size_t triple_count;
+    std::size_t unique_count = 0;
+    {
+        SizedTripleFile<ENTITY_BYTES> encoding(binary_file);
+        triple_count = encoding.size();
+
+        SizedTripleFileWriter<ENTITY_BYTES> triples(deduplicated_file);
+        if (memory_budget)
+        {
+            external_sort::RunDirectory runs(run_directory);
+            external_sort::PairSorter sorter(runs, *memory_budget, "triples");
+            for (TripleRecord record: encoding)
+            {
+                packed_triple triple = pack_triple<ENTITY_BYTES>(record);
+                sorter.add(triple.first, triple.second);
+            }
+            std::optional<packed_triple> previous;
+            sorter.merge([&](uint64_t first, uint64_t second)
+            {
+                packed_triple triple(first, second);
+                if (triple != previous)
+                {
+                    write_packed_triple(triples, triple);
+                    previous = triple;
+                    unique_count++;
+                }
+            });
+            boost::filesystem::remove_all(run_directory);
+        }
+        else
+        {
+            boost::unordered_flat_set<packed_triple> seen_triples(triple_count);
+            for (TripleRecord record: encoding)
+            {
+                packed_triple triple = pack_triple<ENTITY_BYTES>(record);
+                if (seen_triples.insert(triple).second)
+                {
+                    write_packed_triple(triples, triple);
+                }
+            }
+            unique_count = seen_triples.size();
+        }
+        triples.finish();
+    }
+    boost::filesystem::rename(deduplicated_file, binary_file);
+    return triple_count - unique_count;
+}
+
+// Writes the number of triples in the binary encoding and the number of duplicates that were removed from it
+void write_triple_metadata(const std::string &binary_file, std::size_t num_triples, std::size_t duplicate_triples)
+{
+    std::string triple_metadata_file = boost::filesystem::path(binary_file).replace_extension(".meta.json").string();
+    std::ofstream triple_metadata_out(triple_metadata_file, std::ios::trunc);
+
+    json triple_metadata_json = json::object();
+    triple_metadata_json["num_triples"] = num_triples;
+    triple_metadata_json["duplicate_triples"] = duplicate_triples;
+
+    triple_metadata_out << triple_metadata_json.dump(4);
+    triple_metadata_out.close();
 }
 
 int main(int ac, char *av[])
@@ -428,7 +1654,19 @@ int main(int ac, char *av[])
     global.add_options()("skipRDFlists", "Makes the code ignore RDF lists");
     global.add_options()("skip_literals", "Triples with literal objects will be ignored.");
     global.add_options()("laundromat", "Set this flag to run on the LOD laundromat dataset");
+    global.add_options()("trig", "The input is a TriG file with any number of graph blocks, each opened by a line \"<graph> {\" and closed by a line \"}\"");
+    global.add_options()("include_graphs", po::value<std::string>(), "A file listing the graph IRIs (one per line) whose triples are kept, the other graphs are dropped");
+    global.add_options()("exclude_graphs", po::value<std::string>(), "A file listing the graph IRIs (one per line) whose triples are dropped");
+    global.add_options()("turtle", "The input is a Turtle file instead of n-triples. Turtle is parsed on a single thread.");
     global.add_options()("types_to_predicates", "Transforms triples of the form <subject> <rdf:type> <object> to <subject> <object> _:rdfTypeNode");
+    global.add_options()("expected_entities", po::value<std::size_t>(), "The expected number of distinct entities, used to size the dictionary upfront. By default this is estimated from the input file size.");
+    global.add_options()("memory_budget", po::value<std::size_t>(), "Encodes the graph with an external sort that uses roughly this many MiB of memory, instead of keeping the dictionary in memory. Use this if the distinct IRIs do not fit in memory.");
+    global.add_options()("append", "Encodes the input as a delta of an earlier run in the output path: the existing dictionaries are extended and the new triples are appended to the binary encoding.");
+    global.add_options()("deduplicate", "Removes duplicate triples from the binary encoding after it has been written. With a memory budget, this uses an external sort and leaves the triples sorted.");
+    global.add_options()("csr", "Also writes the graph in CSR format (graph_csr.bin), with the outgoing edges and the distinct predecessors of every node. The bisimulator maps this file instead of reading the triples, as long as binary_encoding.bin is not changed.");
+    global.add_options()("binary_dictionary", "Writes the dictionaries as binary files (entity2ID.dict and rel2ID.dict) that can be mapped and searched, instead of entity2ID.txt and rel2ID.txt.");
+    global.add_options()("entity_bytes", po::value<int>(), "The number of bytes (4, 5 or 6) of every entity ID in binary_encoding.bin. The default of 5 bytes holds up to 2^40 entities, 4 bytes make the encoding smaller for graphs of up to 2^32 entities. When appending, the width of the existing encoding is used.");
+    global.add_options()("threads", po::value<unsigned int>()->default_value(1), "The number of threads used for parsing. With more than one thread the input is split into chunks that are converted in parallel.");
     po::positional_options_description pos;
     pos.add("input_file", 1).add("output_path", 2);
 
@@ -451,25 +1689,273 @@ int main(int ac, char *av[])
     // Set the `trigfile` global variable
     trigfile = vm.count("laundromat");
 
+    // Set the `multi_graph_trig` global variable
+    multi_graph_trig = vm.count("trig");
+    if (trigfile && multi_graph_trig)
+    {
+        throw MyException("The laundromat and trig flags can not be combined");
+    }
+
+    bool turtle = vm.count("turtle");
+    if (turtle && (trigfile || multi_graph_trig))
+    {
+        throw MyException("The turtle flag can not be combined with the laundromat or trig flags");
+    }
+
+    // Set the `graph_filter` global variable
+    if (vm.count("include_graphs") && vm.count("exclude_graphs"))
+    {
+        throw MyException("Graphs can either be included or excluded, but not both");
+    }
+    if (vm.count("include_graphs"))
+    {
+        graph_filter.load(GraphFilter::Mode::include, vm["include_graphs"].as<std::string>());
+    }
+    if (vm.count("exclude_graphs"))
+    {
+        graph_filter.load(GraphFilter::Mode::exclude, vm["exclude_graphs"].as<std::string>());
+    }
+
     // Set the `types_to_predicates` global variable
     types_to_predicates = vm.count("types_to_predicates");
-    
-    std::ifstream infile(input_file);
-    std::ofstream outfile(output_path + "/binary_encoding.bin", std::ifstream::out);
 
-    if (!infile.is_open())
+    unsigned int thread_count = vm["threads"].as<unsigned int>();
+    if (thread_count == 0)
     {
-        perror("error while opening file");
+        throw MyException("The number of threads must be at least 1");
+    }
+    if (turtle && (thread_count > 1 || graph_filter.active()))
+    {
+        throw MyException("A Turtle file is parsed on a single thread and has no graphs to filter");
+    }
+    if (thread_count > 1 && multi_graph_trig && graph_filter.active())
+    {
+        throw MyException("Filtering the graphs of a TriG file requires a single thread, since a chunk does not know which graph block it starts in");
+    }
+
+    std::optional<std::size_t> memory_budget;
+    if (vm.count("memory_budget"))
+    {
+        memory_budget = vm["memory_budget"].as<std::size_t>() * 1024 * 1024;
+        if (*memory_budget == 0)
+        {
+            throw MyException("The memory budget must be at least 1 MiB");
+        }
+        if (thread_count > 1)
+        {
+            throw MyException("The memory budget can not be combined with multiple threads, the external sort runs on a single thread");
+        }
+    }
+
+    bool append = vm.count("append");
+    if (append && (thread_count > 1 || memory_budget))
+    {
+        throw MyException("Appending to an existing encoding requires a single thread and an in-memory dictionary");
+    }
+    if (append && vm.count("binary_dictionary"))
+    {
+        throw MyException("A binary dictionary can not be appended to, since its terms are sorted. Writing it again would take time in proportion to the whole graph instead of the appended triples");
     }
 
+    // The triples are written after a placeholder header by several code paths, the complete header is written once they are done.
+    // When appending, the header of the existing encoding is checked first. The new triples are written to a segment without a header,
+    // which is only appended to the encoding once the whole input has been converted, so a failure leaves the encoding as it was.
+    std::string binary_file = output_path + "/binary_encoding.bin";
+    bool existing_encoding = append && boost::filesystem::exists(binary_file) && boost::filesystem::file_size(binary_file) > 0;
+    int entity_bytes = BYTES_PER_ENTITY;
+    if (existing_encoding)
+    {
+        // The triples are appended to the file as it is on disk, which can not be done to a compressed container
+        if (is_frame_container(MappedFile(binary_file, MADV_RANDOM, false).contents()))
+        {
+            throw MyException("The existing encoding " + binary_file + " is compressed, decompress it with binary_container before appending to it");
+        }
+        // Throws if the existing encoding has no header or holds another format
+        visit_triple_file(binary_file, [](const auto &) {});
+        entity_bytes = triple_file_entity_bytes(binary_file);
+    }
+    if (vm.count("entity_bytes"))
+    {
+        if (existing_encoding && vm["entity_bytes"].as<int>() != entity_bytes)
+        {
+            throw MyException("The existing encoding has entities of " + std::to_string(entity_bytes) + " bytes, the appended triples must have the same width");
+        }
+        entity_bytes = vm["entity_bytes"].as<int>();
+    }
+    // This also rejects an unsupported width before anything is written
+    FieldWidths triple_field_bytes = dispatch_entity_bytes(entity_bytes, [](auto width) { return SizedTripleFormat<decltype(width)::value>::FIELD_BYTES; });
+
+    std::string segment_file = binary_file + ".appending";
+    std::ofstream outfile(existing_encoding ? segment_file : binary_file, std::ios::out | std::ios::trunc | std::ios::binary);
+
     if (!outfile.is_open())
     {
         perror("error while opening file");
     }
+    if (!existing_encoding)
+    {
+        FileHeader placeholder = FileHeader::placeholder(FileKind::TRIPLES, triple_field_bytes);
+        outfile.write(reinterpret_cast<const char *>(&placeholder), sizeof(FileHeader));
+    }
 
-    std::string node_ID_file = output_path + "/entity2ID.txt";
-    std::string rel_ID_file = output_path + "/rel2ID.txt";
+    // Set the `binary_dictionary` global variable
+    binary_dictionary = vm.count("binary_dictionary");
 
-    convert_graph(infile, outfile, node_ID_file, rel_ID_file);
-    outfile.flush();
+    std::string dictionary_extension = binary_dictionary ? ".dict" : ".txt";
+    std::string node_ID_file = output_path + "/entity2ID" + dictionary_extension;
+    std::string rel_ID_file = output_path + "/rel2ID" + dictionary_extension;
+    std::string run_directory = output_path + "/external_sort_runs";
+
+    const std::size_t chunk_size = 32 * 1024 * 1024;
+
+    // Regular files are mapped into memory, such that the lines can be parsed without copying them.
+    // Compressed files and other inputs (e.g. a named pipe) are read as a stream, which is decompressed by a separate thread if needed.
+    bool regular_file = MappedFile::is_mappable(input_file);
+    bool compressed_file = regular_file && detect_file_compression(input_file) != Compression::none;
+
+    // Without an explicit hint we assume roughly one new entity per 256 bytes of (uncompressed) input, which overestimates for most real data.
+    // Compressed n-triples are assumed to be about 8 times smaller than the original.
+    // The estimate is capped to avoid reserving an excessive table for very large files, the dictionary can still grow beyond it.
+    std::size_t expected_entities = 1 << 20;
+    if (vm.count("expected_entities"))
+    {
+        expected_entities = vm["expected_entities"].as<std::size_t>();
+    }
+    else if (regular_file)
+    {
+        std::size_t input_size = boost::filesystem::file_size(input_file) * (compressed_file ? 8 : 1);
+        expected_entities = std::min<std::size_t>(input_size / 256, 100000000);
+    }
+
+    // Converts the triples of a LineScanner, StreamLineSource or TurtleParser on this thread
+    auto convert_single_threaded = [&](auto &triples)
+    {
+        dispatch_entity_bytes(entity_bytes, [&](auto width)
+        {
+            constexpr int ENTITY_BYTES = decltype(width)::value;
+            if (memory_budget)
+            {
+                convert_graph_external<ENTITY_BYTES>(triples, outfile, node_ID_file, rel_ID_file, run_directory, *memory_budget);
+            }
+            else
+            {
+                convert_graph<ENTITY_BYTES>(triples, outfile, node_ID_file, rel_ID_file, expected_entities, append, [&]()
+                {
+                    if (!existing_encoding)
+                    {
+                        // The new encoding is sealed below, like one that is not appended to
+                        return;
+                    }
+                    outfile.close();
+                    if (outfile.fail())
+                    {
+                        throw MyException("Writing the appended triples to " + segment_file + " failed, the disk might be full");
+                    }
+                    append_sealed_records<SizedTripleFormat<ENTITY_BYTES>>(binary_file, segment_file);
+                });
+            }
+        });
+    };
+
+    // Converts the chunks of a MappedChunkSource or StreamChunkSource on `thread_count` threads
+    auto convert_multi_threaded = [&](auto &chunks)
+    {
+        dispatch_entity_bytes(entity_bytes, [&](auto width)
+        {
+            convert_graph_parallel<decltype(width)::value>(chunks, outfile, node_ID_file, rel_ID_file, thread_count, expected_entities);
+        });
+    };
+
+    // The generated blank nodes of a Turtle file are numbered within the number of existing entities, which grows with every input that adds one,
+    // so those of an appended file do not merge with those of the earlier files
+    unsigned long blank_node_scope = turtle && append ? read_ID_count(node_ID_file, "num_nodes") : 0;
+
+    if (regular_file && !compressed_file)
+    {
+        MappedFile mapped_input(input_file);
+        if (turtle)
+        {
+            TurtleInput turtle_input(mapped_input.contents());
+            TurtleParser parser(turtle_input, blank_node_scope);
+            convert_single_threaded(parser);
+        }
+        else if (thread_count > 1)
+        {
+            MappedChunkSource chunks(mapped_input.contents(), chunk_size);
+            convert_multi_threaded(chunks);
+        }
+        else
+        {
+            LineScanner lines(mapped_input.contents());
+            convert_single_threaded(lines);
+        }
+    }
+    else
+    {
+        DecompressingStream infile(input_file);
+        std::cout << "Reading the " << compression_name(infile.get_compression()) << " input as a stream" << std::endl;
+
+        if (turtle)
+        {
+            TurtleInput turtle_input(infile);
+            TurtleParser parser(turtle_input, blank_node_scope);
+            convert_single_threaded(parser);
+            if (turtle_input.bad())
+            {
+                perror("error happened while reading file");
+            }
+        }
+        else if (thread_count > 1)
+        {
+            StreamChunkSource chunks(infile, chunk_size);
+            convert_multi_threaded(chunks);
+        }
+        else
+        {
+            StreamLineSource lines(infile);
+            convert_single_threaded(lines);
+            if (lines.bad())
+            {
+                perror("error happened while reading file");
+            }
+        }
+    }
+    if (outfile.is_open())
+    {
+        outfile.close();
+    }
+
+    // The IDs were cut to `entity_bytes` bytes, which must be enough for all of them. Otherwise the header is not written, so the encoding can not be read.
+    check_entity_count(read_ID_count(node_ID_file, "num_nodes"), entity_bytes);
+
+    dispatch_entity_bytes(entity_bytes, [&](auto width)
+    {
+        constexpr int ENTITY_BYTES = decltype(width)::value;
+        // An existing encoding was already sealed when the segment was appended to it
+        if (!existing_encoding)
+        {
+            seal_file_header<SizedTripleFormat<ENTITY_BYTES>>(binary_file);
+        }
+
+        if (vm.count("deduplicate"))
+        {
+            std::size_t duplicate_triples = deduplicate_triples<ENTITY_BYTES>(binary_file, memory_budget, run_directory);
+            write_triple_metadata(binary_file, SizedTripleFile<ENTITY_BYTES>(binary_file).size(), duplicate_triples);
+            std::cout << "Removed " << duplicate_triples << " duplicate triples" << std::endl;
+        }
+    });
+
+    if (vm.count("csr"))
+    {
+        auto now{boost::chrono::system_clock::to_time_t(boost::chrono::system_clock::now())};
+        std::tm* ptm{std::localtime(&now)};
+        std::cout << std::put_time(ptm, "%Y/%m/%d %H:%M:%S") << " building the CSR graph" << std::endl;
+        // The bisimulator takes the id for rdf:type from the CSR graph, so it is copied from the metadata that was just written
+        std::ifstream rel2id_metadata_file(boost::filesystem::path(rel_ID_file).replace_extension(".meta.json").string());
+        json rel2id_metadata;
+        rel2id_metadata_file >> rel2id_metadata;
+        edge_type rdf_type_id = rel2id_metadata["special_relations"].value(rdf_type_string, MAX_EDGE_ID);
+        uint64_t node_count = build_csr_graph(output_path + "/binary_encoding.bin", output_path + "/graph_csr.bin", rdf_type_id);
+        std::cout << "Wrote the CSR graph with " << node_count << " nodes" << std::endl;
+    }
 }
\ No newline at end of file
@@ -8,6 +8,31 @@ BYTES_PER_ENTITY = 5
 BYTES_PER_PREDICATE = 4
 BYTES_PER_BLOCK = 4
 BYTES_PER_BLOCK_OR_SINGLETON = 5
+# Every binary file starts with a header of 48 bytes (see code/include/file_header.hpp)
+FILE_HEADER_BYTES = 48
+# Outcome files written with --pack_outcomes have this flag, their entities are stored as bit-packed gaps (see delta_pack in code/src/binary_io.cpp)
+FILE_HEADER_DELTA_PACKED = 2
+DELTA_FRAME_VALUES = 128
+
+def skip_file_header(f) -> bytes:
+    header = f.read(FILE_HEADER_BYTES)
+    assert header.startswith(b"SUMMARYB"), f"{f.name} has no file header, it was probably written by an older version of the pipeline"
+    return header
+
+def read_outcome_entities(f, block_size: int, delta_packed: bool) -> list[int]:
+    if not delta_packed:
+        return [int.from_bytes(f.read(BYTES_PER_ENTITY), "little", signed=False) for i in range(block_size)]
+    entities = []
+    previous = -1
+    for frame_start in range(0, block_size, DELTA_FRAME_VALUES):
+        frame_size = min(DELTA_FRAME_VALUES, block_size - frame_start)
+        bits = f.read(1)[0]
+        frame = int.from_bytes(f.read((frame_size * bits + 7) // 8), "little")
+        for i in range(frame_size):
+            previous += ((frame >> (i * bits)) & ((1 << bits) - 1)) + 1
+            entities.append(previous)
+    return entities
+
 
 def summary_vectors_to_original_vectors(node_to_block: list[int], summary_vectors: torch.Tensor, dim: int = 0) -> torch.Tensor:
     return torch.index_select(summary_vectors, dim, torch.as_tensor(node_to_block))
@@ -21,10 +46,12 @@ def get_original_graph(experiment_directory) -> tuple[list[list[int]], list[int]
     edge_type = []
 
     with open(graph_binary_file, "rb") as f:
-        while (subject_bytes := f.read(BYTES_PER_BLOCK_OR_SINGLETON)):
-            subject_id = int.from_bytes(subject_bytes, "little", signed=True)
+        # The preprocessor can write the entities in 4 to 6 bytes (--entity_bytes), the header records the width
+        bytes_per_entity = skip_file_header(f)[14]
+        while (subject_bytes := f.read(bytes_per_entity)):
+            subject_id = int.from_bytes(subject_bytes, "little", signed=False)
             predicate_id = int.from_bytes(f.read(BYTES_PER_PREDICATE), "little", signed=False)
-            object_id = int.from_bytes(f.read(BYTES_PER_BLOCK_OR_SINGLETON), "little", signed=True)
+            object_id = int.from_bytes(f.read(bytes_per_entity), "little", signed=False)
 
             edge_index[0].append(subject_id)
             edge_index[1].append(object_id)
@@ -42,6 +69,7 @@ def get_summary_graph(experiment_directory: str, k: int) -> tuple[list[list[int]
     edge_type = []
 
     with open(summary_graph_file, "rb") as f:
+        skip_file_header(f)
         while (subject_bytes := f.read(BYTES_PER_BLOCK_OR_SINGLETON)):
             subject_id = int.from_bytes(subject_bytes, "little", signed=True)
             predicate_id = int.from_bytes(f.read(BYTES_PER_PREDICATE), "little", signed=False)
@@ -70,6 +98,7 @@ def get_outcome(experiment_directory: str, k: int) -> tuple[list[int], list[set[
     outcome_file = experiment_directory + "bisimulation/outcome_condensed-0001.bin"
 
     with open(outcome_file, "rb") as f:
+        delta_packed = bool(skip_file_header(f)[13] & FILE_HEADER_DELTA_PACKED)
         while (block_bytes := f.read(BYTES_PER_BLOCK)):
             block_id = int.from_bytes(block_bytes, "little", signed=False)
 
@@ -78,8 +107,7 @@ def get_outcome(experiment_directory: str, k: int) -> tuple[list[int], list[set[
                 blocks += [set() for i in range(block_id+1-len(blocks))]
             
             block_size = int.from_bytes(f.read(BYTES_PER_ENTITY), "little", signed=False)
-            for i in range(block_size):
-                node_id = int.from_bytes(f.read(BYTES_PER_ENTITY), "little", signed=False)
+            for node_id in read_outcome_entities(f, block_size, delta_packed):
                 blocks[block_id].add(node_id)
                 node_to_block[node_id] = block_id
     
@@ -96,6 +124,7 @@ def get_outcome(experiment_directory: str, k: int) -> tuple[list[int], list[set[
         # Load the refines edges
         refines_edges = {}
         with open(mapping_file, "rb") as f:
+            skip_file_header(f)
             while (split_block_bytes := f.read(BYTES_PER_BLOCK)):
                 split_block_id = int.from_bytes(split_block_bytes, "little", signed=False)
                 refines_edges[split_block_id] = set()
@@ -115,6 +144,7 @@ def get_outcome(experiment_directory: str, k: int) -> tuple[list[int], list[set[
 
         # Update the blocks
         with open(outcome_file, "rb") as f:
+            delta_packed = bool(skip_file_header(f)[13] & FILE_HEADER_DELTA_PACKED)
             while (block_bytes := f.read(BYTES_PER_BLOCK)):
                 block_id = int.from_bytes(block_bytes, "little", signed=False)
                 assert block_id != 0, "The outcome should not explicitly encode block 0"  # We do not explicitly store the 0 block (which is reserved for singletons)
@@ -124,8 +154,7 @@ def get_outcome(experiment_directory: str, k: int) -> tuple[list[int], list[set[
                     blocks += [set() for i in range(block_id+1-len(blocks))]
 
                 block_size = int.from_bytes(f.read(BYTES_PER_ENTITY), "little", signed=False)
-                for i in range(block_size):
-                    node_id = int.from_bytes(f.read(BYTES_PER_ENTITY), "little", signed=False)
+                for node_id in read_outcome_entities(f, block_size, delta_packed):
                     new_singletons.discard(node_id)  # Since node_id might not be present in new_singletons, we use .discard() instead of .remove()
                     blocks[block_id].add(node_id)
                     node_to_block[node_id] = block_id
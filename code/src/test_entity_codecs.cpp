@@ -0,0 +1,152 @@
+// This program checks the bulk entity codecs of binary_io.hpp (`encode_entities` and `decode_entities`) against the single value functions
+// `write_uint_ENTITY_little_endian` and `read_uint_ENTITY_little_endian`, which are the reference for the byte layout.
+// The bulk codecs take a SIMD path that depends on the instruction sets the compiler targets, so the program should be built once for every
+// path (see setup_experiments.sh). It prints the path it was built for and exits with 1 at the first mismatch.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../include/binary_io.hpp"
+#include "../include/my_exception.hpp"
+
+constexpr std::size_t MAX_COUNT = 300;
+// The input and output are shifted by every offset up to this one, such that the unaligned loads and stores are covered
+constexpr std::size_t MAX_OFFSET = 8;
+// Guard bytes around the encoded values, to detect writes beyond the last value
+constexpr std::size_t GUARD_BYTES = 32;
+constexpr std::byte GUARD = std::byte{0xA5};
+constexpr node_index GUARD_VALUE = 0xDEADBEEFDEADBEEF;
+constexpr node_index MAX_ENTITY = (node_index(1) << (8 * BYTES_PER_ENTITY)) - 1;
+
+const char *dispatch_path()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSSE3__)
+    return "SSSE3";
+#else
+    return "scalar";
+#endif
+}
+
+// Values of every kind: the extremes, single set bits, bytes with the top bit set and random values. Some values have bits above the
+// lowest BYTES_PER_ENTITY bytes, which the encoders should both drop.
+std::vector<node_index> make_values(std::mt19937_64 &generator, std::size_t count, int kind)
+{
+    std::vector<node_index> values(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        node_index random = generator();
+        switch (kind)
+        {
+        case 0:
+            values[i] = random & MAX_ENTITY;
+            break;
+        case 1:
+            values[i] = (i % 2 == 0) ? 0 : MAX_ENTITY;
+            break;
+        case 2:
+            values[i] = node_index(1) << (random % (8 * BYTES_PER_ENTITY));
+            break;
+        case 3:
+            values[i] = 0x8080808080 ^ (random & 0x0101010101);
+            break;
+        default:
+            values[i] = random;
+            break;
+        }
+    }
+    return values;
+}
+
+void check(bool condition, const std::string &what, std::size_t count, std::size_t offset, int kind)
+{
+    if (!condition)
+    {
+        throw MyException(what + " (" + std::to_string(count) + " values of kind " + std::to_string(kind) + " at offset " + std::to_string(offset) + ")");
+    }
+}
+
+void test_round_trip(const std::vector<node_index> &values, std::size_t offset, int kind)
+{
+    const std::size_t count = values.size();
+    const std::size_t bytes = count * BYTES_PER_ENTITY;
+
+    std::ostringstream reference_stream;
+    for (node_index value: values)
+    {
+        write_uint_ENTITY_little_endian(reference_stream, value);
+    }
+    const std::string reference = reference_stream.str();
+    check(reference.size() == bytes, "The reference writer wrote the wrong number of bytes", count, offset, kind);
+
+    std::vector<std::byte> encoded(offset + bytes + GUARD_BYTES, GUARD);
+    encode_entities(values.data(), count, encoded.data() + offset);
+    for (std::size_t i = 0; i < offset; i++)
+    {
+        check(encoded[i] == GUARD, "encode_entities wrote before its output", count, offset, kind);
+    }
+    for (std::size_t i = 0; i < bytes; i++)
+    {
+        check(encoded[offset + i] == std::byte(reference[i]), "encode_entities differs from write_uint_ENTITY_little_endian at byte " + std::to_string(i), count, offset, kind);
+    }
+    for (std::size_t i = offset + bytes; i < encoded.size(); i++)
+    {
+        check(encoded[i] == GUARD, "encode_entities wrote beyond its output", count, offset, kind);
+    }
+
+    std::istringstream reference_input(reference);
+    std::vector<node_index> decoded(count + 4, GUARD_VALUE);
+    decode_entities(encoded.data() + offset, count, decoded.data());
+    for (std::size_t i = 0; i < count; i++)
+    {
+        node_index expected = read_uint_ENTITY_little_endian(reference_input);
+        check(decoded[i] == expected, "decode_entities differs from read_uint_ENTITY_little_endian at value " + std::to_string(i), count, offset, kind);
+        check(expected == (values[i] & MAX_ENTITY), "read_uint_ENTITY_little_endian does not return the lowest bytes of value " + std::to_string(i), count, offset, kind);
+    }
+    for (std::size_t i = count; i < decoded.size(); i++)
+    {
+        check(decoded[i] == GUARD_VALUE, "decode_entities wrote beyond its output", count, offset, kind);
+    }
+
+    // The decoder must not depend on the bytes after the input either, since the SIMD loads can reach beyond the last value
+    std::vector<std::byte> tight(offset + bytes);
+    std::copy(encoded.begin(), encoded.begin() + offset + bytes, tight.begin());
+    std::vector<node_index> decoded_tight(count);
+    decode_entities(tight.data() + offset, count, decoded_tight.data());
+    check(std::equal(decoded_tight.begin(), decoded_tight.end(), decoded.begin()), "decode_entities depends on the bytes after its input", count, offset, kind);
+}
+
+int main()
+{
+    std::cout << "Testing the entity codecs on the " << dispatch_path() << " path" << std::endl;
+    std::mt19937_64 generator(42);
+    std::size_t tests = 0;
+    try
+    {
+        for (std::size_t count = 0; count <= MAX_COUNT; count++)
+        {
+            for (int kind = 0; kind < 5; kind++)
+            {
+                std::vector<node_index> values = make_values(generator, count, kind);
+                for (std::size_t offset = 0; offset < MAX_OFFSET; offset++)
+                {
+                    test_round_trip(values, offset, kind);
+                    tests++;
+                }
+            }
+        }
+    }
+    catch (const MyException &e)
+    {
+        std::cout << "Failed: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "All " << tests << " round trips match the single value functions" << std::endl;
+    return 0;
+}
@@ -9,6 +9,9 @@ compiler_flags="${compiler_flags//,/ }"
 # Remove commas and add spaces
 boost_flags="${boost_flags//,/ }"
 
+# Remove commas and add spaces
+library_flags="${library_flags//,/ }"
+
 # Parse arguments
 output=""
 sources=()
@@ -49,4 +52,5 @@ g++ \
     -L "${boost_path}lib/" \
     $boost_flags \
     -o "$output" \
-    "${boost_path}lib/libboost_program_options.a"
+    "${boost_path}lib/libboost_program_options.a" \
+    $library_flags
@@ -203,6 +203,7 @@ echo $(date) $(hostname) "${logging_process}.Info: Compiler location: $(which g+
 echo $(date) $(hostname) "${logging_process}.Info: Creating compilation with the following settings:" >> $log_file
 echo $(date) $(hostname) "${logging_process}.Info: boost_path=${boost_path}" >> $log_file
 echo $(date) $(hostname) "${logging_process}.Info: compiler_flags=${compiler_flags}" >> $log_file
+echo $(date) $(hostname) "${logging_process}.Info: library_flags=${library_flags}" >> $log_file
 
 # Remove carriage returns from the compiler script and make sure we can run it 
 sed -i 's/\r//g' ./compile.sh
@@ -254,6 +255,42 @@ echo Compiling count_uncondensed_and_condensed.cpp
 echo $(date) $(hostname) "${logging_process}.Info: Compiling count_uncondensed_and_condensed.cpp" >> $log_file
 ./compile.sh ../$git_hash/code/src/count_uncondensed_and_condensed.cpp ../$git_hash/code/src/my_exception.cpp ../$git_hash/code/src/binary_io.cpp -o ../$git_hash/code/bin/count_vertices_and_edges
 
+# Compile the tool for compressing binary files
+echo Copying binary_container.cpp
+echo $(date) $(hostname) "${logging_process}.Info: Copying binary_container.cpp" >> $log_file
+cp ../code/src/binary_container.cpp ../$git_hash/code/src/binary_container.cpp
+echo Compiling binary_container.cpp
+echo $(date) $(hostname) "${logging_process}.Info: Compiling binary_container.cpp" >> $log_file
+./compile.sh ../$git_hash/code/src/binary_container.cpp ../$git_hash/code/src/my_exception.cpp ../$git_hash/code/src/binary_io.cpp -o ../$git_hash/code/bin/binary_container
+
+# Compile the n-quads to n-triples converter, which maps its input (and expands compressed containers) like the other programs
+echo Copying nq_to_nt.cpp
+echo $(date) $(hostname) "${logging_process}.Info: Copying nq_to_nt.cpp" >> $log_file
+cp ../code/src/nq_to_nt.cpp ../$git_hash/code/src/nq_to_nt.cpp
+echo Compiling nq_to_nt.cpp
+echo $(date) $(hostname) "${logging_process}.Info: Compiling nq_to_nt.cpp" >> $log_file
+./compile.sh ../$git_hash/code/src/nq_to_nt.cpp ../$git_hash/code/src/my_exception.cpp ../$git_hash/code/src/binary_io.cpp -o ../$git_hash/code/bin/nq_to_nt
+
+# Compile and run the test of the bulk entity codecs, once for every SIMD path they can take (the later -m flags override -march=native)
+echo Copying test_entity_codecs.cpp
+echo $(date) $(hostname) "${logging_process}.Info: Copying test_entity_codecs.cpp" >> $log_file
+cp ../code/src/test_entity_codecs.cpp ../$git_hash/code/src/test_entity_codecs.cpp
+for codec_path in avx2 ssse3 scalar; do
+  case $codec_path in
+    'avx2') codec_flags='' ;;
+    'ssse3') codec_flags='-mno-avx2' ;;
+    'scalar') codec_flags='-mno-avx2 -mno-avx -mno-sse4.2 -mno-sse4.1 -mno-ssse3' ;;
+  esac
+  echo Compiling test_entity_codecs.cpp for the $codec_path path
+  echo $(date) $(hostname) "${logging_process}.Info: Compiling test_entity_codecs.cpp for the $codec_path path" >> $log_file
+  ./compile.sh $codec_flags ../$git_hash/code/src/test_entity_codecs.cpp ../$git_hash/code/src/my_exception.cpp ../$git_hash/code/src/binary_io.cpp -o ../$git_hash/code/bin/test_entity_codecs_$codec_path
+  if ! ../$git_hash/code/bin/test_entity_codecs_$codec_path >> $log_file; then
+    echo "The entity codecs do not match the single value functions on the $codec_path path, see $log_file"
+    echo $(date) $(hostname) "${logging_process}.Error: The entity codecs do not match the single value functions on the $codec_path path" >> $log_file
+    exit 1
+  fi
+done
+
 # Echo that the compilation was successful
 echo C++ copying and compiling successful
 echo $(date) $(hostname) "${logging_process}.Info: C++ copying and compiling successful" >> $log_file
@@ -316,8 +353,12 @@ skipRDFlists=false
 skip_literals=false
 laundromat=false
 types_to_predicates=false
-use_lz4=false
-lz4_command=/usr/local/lz4
+deduplicate=false
+csr=false
+binary_dictionary=false
+threads=1
+memory_budget=
+entity_bytes=5
 EOF
 
 # Make sure the file will have Unix style line endings
@@ -390,11 +431,6 @@ done
 # Load in the settings
 . ./preprocessor.config
 
-# Exit if laundromat is true with use_lz4 false
-if [ \$laundromat == "true" ] && [ \$use_lz4 == "false" ]; then
-  echo $'The laundromat dataset only works with lz4 enabled. This can be changed in preprocessor.config\nAborting'
-fi
-
 # Set a boolean based on the value of skipRDFlists
 case \$skipRDFlists in
   'true') skiplists=' --skipRDFlists' ;;
@@ -423,13 +459,48 @@ case \$types_to_predicates in
   *) echo "types_to_predicates has been set to \\"\$types_to_predicates\\" in preprocessor.config. Please change it to \\"true\\" or \\"false\\" instead"; exit 1 ;;
 esac
 
-# Sanity check the value of use_lz4
-case \$use_lz4 in
-  'true');;
-  'false');;
-  *) echo "use_lz4 has been set to \\"\$use_lz4\\" in preprocessor.config. Please change it to \\"true\\" or \\"false\\" instead"; exit 1 ;;
+# Set a boolean based on the value of deduplicate
+case \$deduplicate in
+  'true') deduplicate_flag=' --deduplicate' ;;
+  'false') deduplicate_flag='' ;;
+  *) echo "deduplicate has been set to \\"\$deduplicate\\" in preprocessor.config. Please change it to \\"true\\" or \\"false\\" instead"; exit 1 ;;
+esac
+
+# Set a boolean based on the value of csr
+case \$csr in
+  'true') csr_flag=' --csr' ;;
+  'false') csr_flag='' ;;
+  *) echo "csr has been set to \\"\$csr\\" in preprocessor.config. Please change it to \\"true\\" or \\"false\\" instead"; exit 1 ;;
+esac
+
+# Set a boolean based on the value of binary_dictionary
+case \$binary_dictionary in
+  'true') binary_dictionary_flag=' --binary_dictionary' ;;
+  'false') binary_dictionary_flag='' ;;
+  *) echo "binary_dictionary has been set to \\"\$binary_dictionary\\" in preprocessor.config. Please change it to \\"true\\" or \\"false\\" instead"; exit 1 ;;
+esac
+
+# Sanity check the value of threads
+if ! [[ \$threads =~ ^[1-9][0-9]*\$ ]]; then
+  echo "threads has been set to \\"\$threads\\" in preprocessor.config. Please change it to a positive integer instead"; exit 1
+fi
+threads_flag=" --threads=\$threads"
+
+# Sanity check the value of entity_bytes
+case \$entity_bytes in
+  4|5|6) entity_bytes_flag=" --entity_bytes=\$entity_bytes" ;;
+  *) echo "entity_bytes has been set to \\"\$entity_bytes\\" in preprocessor.config. Please change it to 4, 5 or 6 instead"; exit 1 ;;
 esac
 
+# Sanity check the value of memory_budget (left empty, the dictionary is kept in memory)
+if [[ -z "\$memory_budget" ]]; then
+  memory_budget_flag=''
+elif [[ \$memory_budget =~ ^[1-9][0-9]*\$ ]]; then
+  memory_budget_flag=" --memory_budget=\$memory_budget"
+else
+  echo "memory_budget has been set to \\"\$memory_budget\\" in preprocessor.config. Please change it to a positive integer (in MiB) or leave it empty instead"; exit 1
+fi
+
 # Print the settings
 echo Using the following settings:
 echo job_name=\$job_name
@@ -443,8 +514,12 @@ echo skipRDFlists=\$skipRDFlists
 echo skip_literals=\$skip_literals
 echo laundromat=\$laundromat
 echo types_to_predicates=\$types_to_predicates
-echo use_lz4=\$use_lz4
-echo lz4_command=\$lz4_command
+echo deduplicate=\$deduplicate
+echo csr=\$csr
+echo binary_dictionary=\$binary_dictionary
+echo threads=\$threads
+echo memory_budget=\$memory_budget
+echo entity_bytes=\$entity_bytes
 
 if ! \$skip_user_read; then
   # Ask the user to run the experiment with the aforementioned settings
@@ -464,27 +539,17 @@ fi
 # Create a directory for the experiments
 dataset_path="\${1}"
 dataset_file="\${1##*/}"
-# Remove the extra extension from the LOD Laundromat file (.trig.lz4)
+# Remove the extra extension from compressed files (e.g. .trig.lz4 for the LOD Laundromat)
 dataset_name="\${dataset_file%.*}"
-if [ \$use_lz4 == "true" ]; then
-  dataset_name="\${dataset_name%.*}"
-fi
+case \${dataset_file##*.} in
+  'lz4'|'zst'|'gz'|'bz2') dataset_name="\${dataset_name%.*}" ;;
+esac
 dataset_path_absolute=\$(realpath \$dataset_path)/
 output_dir=../\$dataset_name/
 mkdir \$output_dir
 
-# Use a different set of commands for the LOD Laundromat and semopenalex datasets, because they are compressed with lz4
-if [ \$use_lz4 == "true" ]; then
-  preprocessor_command=\$(cat << EOM
-mkfifo ttl_buffer
-/usr/bin/time -v \$lz4_command -d -c \$dataset_path -d -c > ttl_buffer &
-../code/bin/preprocessor ./ttl_buffer ./\$skiplists\$skip_literals_flag\$types_to_predicates_flag\$laundromat_flag
-rm ./ttl_buffer
-EOM
-  )
-else
-  preprocessor_command="/usr/bin/time -v ../code/bin/preprocessor \$dataset_path ./\$skiplists\$skip_literals_flag\$types_to_predicates_flag"
-fi
+# Compressed datasets (e.g. the lz4 compressed LOD Laundromat) are decompressed by the preprocessor itself
+preprocessor_command="/usr/bin/time -v ../code/bin/preprocessor \$dataset_path ./\$skiplists\$skip_literals_flag\$types_to_predicates_flag\$deduplicate_flag\$csr_flag\$binary_dictionary_flag\$threads_flag\$memory_budget_flag\$entity_bytes_flag\$laundromat_flag"
 
 # Create a log file for the experiments
 log_file=\${output_dir}experiments.log
@@ -505,8 +570,12 @@ echo \$(date) \$(hostname) "\${logging_process}.Info: skipRDFlists=\$skipRDFlist
 echo \$(date) \$(hostname) "\${logging_process}.Info: skip_literals=\$skip_literals" >> \$log_file
 echo \$(date) \$(hostname) "\${logging_process}.Info: laundromat=\$laundromat" >> \$log_file
 echo \$(date) \$(hostname) "\${logging_process}.Info: types_to_predicates=\$types_to_predicates" >> \$log_file
-echo \$(date) \$(hostname) "\${logging_process}.Info: use_lz4=\$use_lz4" >> \$log_file
-echo \$(date) \$(hostname) "\${logging_process}.Info: lz4_command=\$lz4_command" >> \$log_file
+echo \$(date) \$(hostname) "\${logging_process}.Info: deduplicate=\$deduplicate" >> \$log_file
+echo \$(date) \$(hostname) "\${logging_process}.Info: csr=\$csr" >> \$log_file
+echo \$(date) \$(hostname) "\${logging_process}.Info: binary_dictionary=\$binary_dictionary" >> \$log_file
+echo \$(date) \$(hostname) "\${logging_process}.Info: threads=\$threads" >> \$log_file
+echo \$(date) \$(hostname) "\${logging_process}.Info: memory_budget=\$memory_budget" >> \$log_file
+echo \$(date) \$(hostname) "\${logging_process}.Info: entity_bytes=\$entity_bytes" >> \$log_file
 
 # Create the slurm script
 echo Creating slurm script
@@ -607,6 +676,10 @@ output=slurm_bisimulator.out
 nodelist=
 bisimulation_mode=run_k_bisimulation_store_partition_condensed_timed
 typed_start=true
+pack_outcomes=false
+threads=
+snapshot=false
+reorder=none
 EOF
 
 # Make sure the file will have Unix style line endings
@@ -690,6 +763,10 @@ echo output=\$output
 echo nodelist=\$nodelist
 echo bisimulation_mode=\$bisimulation_mode
 echo typed_start=\$typed_start
+echo pack_outcomes=\$pack_outcomes
+echo threads=\$threads
+echo snapshot=\$snapshot
+echo reorder=\$reorder
 
 if ! \$skip_user_read; then
   # Ask the user to run the experiment with the aforementioned settings
@@ -726,6 +803,10 @@ echo \$(date) \$(hostname) "\${logging_process}.Info: output=\$output" >> \$log_
 echo \$(date) \$(hostname) "\${logging_process}.Info: nodelist=\$nodelist" >> \$log_file
 echo \$(date) \$(hostname) "\${logging_process}.Info: bisimulation_mode=\$bisimulation_mode" >> \$log_file
 echo \$(date) \$(hostname) "\${logging_process}.Info: typed_start=\$typed_start" >> \$log_file
+echo \$(date) \$(hostname) "\${logging_process}.Info: pack_outcomes=\$pack_outcomes" >> \$log_file
+echo \$(date) \$(hostname) "\${logging_process}.Info: threads=\$threads" >> \$log_file
+echo \$(date) \$(hostname) "\${logging_process}.Info: snapshot=\$snapshot" >> \$log_file
+echo \$(date) \$(hostname) "\${logging_process}.Info: reorder=\$reorder" >> \$log_file
 
 # Set a flag based on the value of typed_start
 case \$typed_start in
@@ -734,6 +815,35 @@ case \$typed_start in
   *) echo "typed_start has been set to \\"\$typed_start\\" in preprocessor.config. Please change it to \\"true\\" or \\"false\\" instead"; exit 1 ;;
 esac
 
+# Set a flag based on the value of pack_outcomes
+case \$pack_outcomes in
+  'true') pack_outcomes_flag=' --pack_outcomes' ;;
+  'false') pack_outcomes_flag='' ;;
+  *) echo "pack_outcomes has been set to \\"\$pack_outcomes\\" in bisimulator.config. Please change it to \\"true\\" or \\"false\\" instead"; exit 1 ;;
+esac
+
+# Sanity check the value of threads (left empty, all hardware threads are used)
+if [[ -z "\$threads" ]]; then
+  bisimulator_threads_flag=''
+elif [[ \$threads =~ ^[1-9][0-9]*\$ ]]; then
+  bisimulator_threads_flag=" --threads=\$threads"
+else
+  echo "threads has been set to \\"\$threads\\" in bisimulator.config. Please change it to a positive integer or leave it empty instead"; exit 1
+fi
+
+# Set a flag based on the value of snapshot
+case \$snapshot in
+  'true') snapshot_flag=' --snapshot' ;;
+  'false') snapshot_flag='' ;;
+  *) echo "snapshot has been set to \\"\$snapshot\\" in bisimulator.config. Please change it to \\"true\\" or \\"false\\" instead"; exit 1 ;;
+esac
+
+# Sanity check the value of reorder
+case \$reorder in
+  'none'|'bfs'|'degree'|'rcm') reorder_flag=" --reorder=\$reorder" ;;
+  *) echo "reorder has been set to \\"\$reorder\\" in bisimulator.config. Please change it to one of \\"none\\", \\"bfs\\", \\"degree\\" or \\"rcm\\" instead"; exit 1 ;;
+esac
+
 # Create the slurm script
 echo Creating slurm script
 echo \$(date) \$(hostname) "\${logging_process}.Info: Creating slurm script" >> \$log_file
@@ -751,7 +861,7 @@ cat >\$bisimulator_job << EOF2
 status=\\\$(grep 'summary_status' state.toml | cut -d'=' -f2 | tr -d ' "')
 if [[ "\\\$status" == "preprocessed" ]]; then
   export LD_LIBRARY_PATH=${boost_path}lib:\\\$LD_LIBRARY_PATH  # Force the correct boost to be used
-  /usr/bin/time -v ../code/bin/bisimulator \$bisimulation_mode ./ --output=./\$typed_start_flag
+  /usr/bin/time -v ../code/bin/bisimulator \$bisimulation_mode ./ --output=./\$typed_start_flag\$pack_outcomes_flag\$bisimulator_threads_flag\$snapshot_flag\$reorder_flag
   if [ \\\$? -eq 0 ]; then
     sed -i '/^summary_status =/c\summary_status = "bisimulation_complete"' state.toml
   else
@@ -1943,11 +2053,11 @@ logging_process="Run_All_Script"
 
 dataset_path="\${1}"
 dataset_file="\${1##*/}"
-# Remove the extra extension from the LOD Laundromat file (.trig.lz4)
+# Remove the extra extension from compressed files (e.g. .trig.lz4 for the LOD Laundromat)
 dataset_name="\${dataset_file%.*}"
-if [ \$use_lz4 == "true" ]; then
-  dataset_name="\${dataset_name%.*}"
-fi
+case \${dataset_file##*.} in
+  'lz4'|'zst'|'gz'|'bz2') dataset_name="\${dataset_name%.*}" ;;
+esac
 dataset_path_absolute=\$(realpath \$dataset_path)/
 output_dir=../\$dataset_name/
 log_file=\${output_dir}experiments.log